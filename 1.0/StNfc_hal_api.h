@@ -1,6 +1,6 @@
 /******************************************************************************
  *
- *  Copyright (C) 1999-2012 Broadcom Corporation
+ *  Copyright (C) 2018 ST Microelectronics S.A.
  *
  *  Licensed under the Apache License, Version 2.0 (the "License");
  *  you may not use this file except in compliance with the License.
@@ -14,41 +14,36 @@
  *  See the License for the specific language governing permissions and
  *  limitations under the License.
  *
+ *
  ******************************************************************************/
-#ifndef DATA_TYPES_H
-#define DATA_TYPES_H
 
-#include <stdbool.h>
-#include <stdint.h>
-#ifndef NULL
-#define NULL 0
-#endif
+#ifndef _STNFC_HAL_API_H_
+#define _STNFC_HAL_API_H_
 
-#ifndef FALSE
-#define FALSE 0
+#include <hardware/nfc.h>
+
+/* Called from the C libhardware module, nfc_nci_st21nfc.c. */
+#ifdef __cplusplus
+extern "C" {
 #endif
 
-typedef uint32_t TIME_STAMP;
+#define NFC_MODE_OFF 0
 
-#ifndef TRUE
-#define TRUE (!FALSE)
-#endif
+int StNfc_hal_open(nfc_stack_callback_t* p_cback,
+                   nfc_stack_data_callback_t* p_data_cback);
+int StNfc_hal_write(uint16_t data_len, const uint8_t* p_data);
+int StNfc_hal_core_initialized(uint8_t* p_core_init_rsp_params);
 
-typedef unsigned char UBYTE;
+int StNfc_hal_pre_discover();
 
-#ifdef __arm
-#define PACKED __packed
-#define INLINE __inline
-#else
-#define PACKED
-#define INLINE
-#endif
+int StNfc_hal_close(int nfc_mode);
 
-#ifndef BIG_ENDIAN
-#define BIG_ENDIAN FALSE
-#endif
+int StNfc_hal_control_granted();
 
-#define UINT16_LOW_BYTE(x) ((x) & 0xff)
-#define UINT16_HI_BYTE(x) ((x) >> 8)
+int StNfc_hal_power_cycle();
 
+#ifdef __cplusplus
+}
 #endif
+
+#endif /* _STNFC_HAL_API_H_ */
@@ -0,0 +1,96 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 1999-2012 Broadcom Corporation
+ *  Copyright (C) 2013 ST Microelectronics S.A.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  Modified by ST Microelectronics S.A. (adaptation of nfc_nci.c for ST21NFC
+ *NCI version)
+ *
+ ******************************************************************************/
+
+#include <hardware/nfc.h>
+
+#include "StNfc_hal_api.h"
+#include "android_logmsg.h"
+#include "config.h"
+#include "hal_front_end.h"
+
+const char* halVersion = "ST21NFC NCI Version 3.0.5";
+
+uint8_t hal_dta_state = 0;
+
+/*
+ * NCI HAL method implementations, on the front end core shared with the HIDL
+ * and AIDL services.
+ */
+
+int StNfc_hal_open(nfc_stack_callback_t* p_cback,
+                   nfc_stack_data_callback_t* p_data_cback) {
+  STLOG_HAL_D("HAL st21nfc: %s %s", __func__, halVersion);
+  // The legacy module read its settings from libnfc-st.conf and never
+  // updated the FW. The shared core runs the FW update and the NFCC
+  // configuration from libnfc-hal-st.conf: without it, it would fall back to
+  // the default FW location, so the device must opt in with that file.
+  if (!IsConfigFound()) {
+    STLOG_HAL_E(
+        "HAL st21nfc: %s libnfc-hal-st.conf not found, the HAL settings "
+        "(STNFC_HAL_LOGLEVEL included) are no longer read from libnfc-st.conf",
+        __func__);
+    p_cback(HAL_NFC_OPEN_CPLT_EVT, HAL_NFC_STATUS_FAILED);
+    return -1;
+  }
+  hal_dta_state = 0;
+  return HalFrontEnd::getInstance().open(halVersion, p_cback, p_data_cback);
+}
+
+int StNfc_hal_write(uint16_t data_len, const uint8_t* p_data) {
+  STLOG_HAL_D("HAL st21nfc: %s", __func__);
+  return HalFrontEnd::getInstance().write(data_len, p_data);
+}
+
+int StNfc_hal_core_initialized(uint8_t* p_core_init_rsp_params) {
+  STLOG_HAL_D("HAL st21nfc: %s", __func__);
+  hal_dta_state = *p_core_init_rsp_params;
+  HalFrontEnd::getInstance().coreInitialized();
+  return 0;  // return != 0 to signal ready immediate
+}
+
+int StNfc_hal_pre_discover() {
+  STLOG_HAL_D("HAL st21nfc: %s", __func__);
+
+  return 0;  // false if no vendor-specific pre-discovery actions are needed
+}
+
+int StNfc_hal_close(int nfc_mode_value) {
+  STLOG_HAL_D("HAL st21nfc: %s nfc_mode = %d", __func__, nfc_mode_value);
+
+  int ret = HalFrontEnd::getInstance().close(nfc_mode_value);
+  hal_dta_state = 0;
+  if (ret < 0) {
+    STLOG_HAL_E("HAL st21nfc: %s async_callback_thread_end failed", __func__);
+  }
+  return ret;
+}
+
+int StNfc_hal_control_granted() {
+  STLOG_HAL_D("HAL st21nfc: %s", __func__);
+
+  return 0;
+}
+
+int StNfc_hal_power_cycle() {
+  STLOG_HAL_D("HAL st21nfc: %s", __func__);
+  return HalFrontEnd::getInstance().powerCycle();
+}
@@ -20,7 +20,6 @@
  *
  ******************************************************************************/
 
-#include <cutils/properties.h>
 #include <errno.h>
 #include <hardware/nfc.h>
 #include <string.h>
@@ -28,320 +27,37 @@
 #include "StNfc_hal_api.h"
 #include "android_logmsg.h"
 #include "hal_config.h"
+#include "hal_front_end.h"
 #include "halcore.h"
 
-extern void HalCoreCallback(void* context, uint32_t event, const void* d,
-                            size_t length);
-extern bool I2cOpenLayer(void* dev, HAL_CALLBACK callb, HALHANDLE* pHandle);
-
-typedef struct {
-  struct nfc_nci_device nci_device;  // nci_device must be first struct member
-  // below declarations are private variables within HAL
-  nfc_stack_callback_t* p_cback;
-  nfc_stack_data_callback_t* p_data_cback;
-  HALHANDLE hHAL;
-  nfc_stack_callback_t* p_cback_unwrap;
-} st21nfc_dev_t;
-
 const char* halVersion = "ST21NFC HAL1.1 Version 3.1.16";
 
-uint8_t cmd_set_nfc_mode_enable[] = {0x2f, 0x02, 0x02, 0x02, 0x01};
-uint8_t hal_is_closed = 1;
-pthread_mutex_t hal_mtx = PTHREAD_MUTEX_INITIALIZER;
-st21nfc_dev_t dev;
 uint8_t hal_dta_state = 0;
-int nfc_mode = 0;
 
 using namespace android::hardware::nfc::V1_1;
 using android::hardware::nfc::V1_1::NfcEvent;
 
 /*
- * NCI HAL method implementations. These must be overridden
- */
-
-extern bool hal_wrapper_open(st21nfc_dev_t* dev, nfc_stack_callback_t* p_cback,
-                             nfc_stack_data_callback_t* p_data_cback,
-                             HALHANDLE* pHandle);
-
-extern int hal_wrapper_close(int call_cb, int nfc_mode);
-
-extern void hal_wrapper_send_config();
-extern void hal_wrapper_factoryReset();
-
-/* Make sure to always post nfc_stack_callback_t in a separate thread.
-This prevents a possible deadlock in upper layer on some sequences.
-We need to synchronize finely for the callback called for hal close,
-otherwise the upper layer either does not receive the event, or deadlocks,
-because the HAL is closing while the callback may be blocked.
+ * NCI HAL method implementations, on the front end core shared with the AIDL
+ * service.
  */
-static struct async_callback_struct {
-  pthread_mutex_t mutex;
-  pthread_cond_t cond;
-  pthread_t thr;
-  int event_pending;
-  int stop_thread;
-  int thread_running;
-  nfc_event_t event;
-  nfc_status_t event_status;
-} async_callback_data;
-
-static void* async_callback_thread_fct(void* arg) {
-  int ret;
-  struct async_callback_struct* pcb_data = (struct async_callback_struct*)arg;
-
-  ret = pthread_mutex_lock(&pcb_data->mutex);
-  if (ret != 0) {
-    STLOG_HAL_E("HAL: %s pthread_mutex_lock failed", __func__);
-    goto error;
-  }
-
-  do {
-    if (pcb_data->event_pending == 0) {
-      ret = pthread_cond_wait(&pcb_data->cond, &pcb_data->mutex);
-      if (ret != 0) {
-        STLOG_HAL_E("HAL: %s pthread_cond_wait failed", __func__);
-        break;
-      }
-    }
-
-    if (pcb_data->event_pending) {
-      nfc_event_t event = pcb_data->event;
-      nfc_status_t event_status = pcb_data->event_status;
-      int ending = pcb_data->stop_thread;
-      pcb_data->event_pending = 0;
-      ret = pthread_cond_signal(&pcb_data->cond);
-      if (ret != 0) {
-        STLOG_HAL_E("HAL: %s pthread_cond_signal failed", __func__);
-        break;
-      }
-      if (ending) {
-        pcb_data->thread_running = 0;
-      }
-      ret = pthread_mutex_unlock(&pcb_data->mutex);
-      if (ret != 0) {
-        STLOG_HAL_E("HAL: %s pthread_mutex_unlock failed", __func__);
-      }
-      STLOG_HAL_D("HAL st21nfc: %s event %hhx status %hhx", __func__, event,
-                  event_status);
-      dev.p_cback_unwrap(event, event_status);
-      if (ending) {
-        return NULL;
-      }
-      ret = pthread_mutex_lock(&pcb_data->mutex);
-      if (ret != 0) {
-        STLOG_HAL_E("HAL: %s pthread_mutex_lock failed", __func__);
-        goto error;
-      }
-    }
-  } while (pcb_data->stop_thread == 0 || pcb_data->event_pending);
-
-  ret = pthread_mutex_unlock(&pcb_data->mutex);
-  if (ret != 0) {
-    STLOG_HAL_E("HAL: %s pthread_mutex_unlock failed", __func__);
-  }
-
-error:
-  pcb_data->thread_running = 0;
-  return NULL;
-}
-
-static int async_callback_thread_start() {
-  int ret;
-
-  memset(&async_callback_data, 0, sizeof(async_callback_data));
-
-  ret = pthread_mutex_init(&async_callback_data.mutex, NULL);
-  if (ret != 0) {
-    STLOG_HAL_E("HAL: %s pthread_mutex_init failed", __func__);
-    return ret;
-  }
-
-  ret = pthread_cond_init(&async_callback_data.cond, NULL);
-  if (ret != 0) {
-    STLOG_HAL_E("HAL: %s pthread_cond_init failed", __func__);
-    return ret;
-  }
-
-  async_callback_data.thread_running = 1;
-
-  ret = pthread_create(&async_callback_data.thr, NULL,
-                       async_callback_thread_fct, &async_callback_data);
-  if (ret != 0) {
-    STLOG_HAL_E("HAL: %s pthread_create failed", __func__);
-    async_callback_data.thread_running = 0;
-    return ret;
-  }
-
-  return 0;
-}
-
-static int async_callback_thread_end() {
-  if (async_callback_data.thread_running != 0) {
-    int ret;
-
-    ret = pthread_mutex_lock(&async_callback_data.mutex);
-    if (ret != 0) {
-      STLOG_HAL_E("HAL: %s pthread_mutex_lock failed", __func__);
-      return ret;
-    }
-
-    async_callback_data.stop_thread = 1;
-
-    // Wait for the thread to have no event pending
-    while (async_callback_data.thread_running &&
-           async_callback_data.event_pending) {
-      ret = pthread_cond_signal(&async_callback_data.cond);
-      if (ret != 0) {
-        STLOG_HAL_E("HAL: %s pthread_cond_signal failed", __func__);
-        return ret;
-      }
-      ret = pthread_cond_wait(&async_callback_data.cond,
-                              &async_callback_data.mutex);
-      if (ret != 0) {
-        STLOG_HAL_E("HAL: %s pthread_cond_wait failed", __func__);
-        break;
-      }
-    }
-
-    ret = pthread_mutex_unlock(&async_callback_data.mutex);
-    if (ret != 0) {
-      STLOG_HAL_E("HAL: %s pthread_mutex_unlock failed", __func__);
-      return ret;
-    }
-
-    ret = pthread_cond_signal(&async_callback_data.cond);
-    if (ret != 0) {
-      STLOG_HAL_E("HAL: %s pthread_cond_signal failed", __func__);
-      return ret;
-    }
-
-    ret = pthread_detach(async_callback_data.thr);
-    if (ret != 0) {
-      STLOG_HAL_E("HAL: %s pthread_detach failed", __func__);
-      return ret;
-    }
-  }
-  return 0;
-}
-
-static void async_callback_post(nfc_event_t event, nfc_status_t event_status) {
-  int ret;
-
-  if (pthread_equal(pthread_self(), async_callback_data.thr)) {
-    dev.p_cback_unwrap(event, event_status);
-  }
-
-  ret = pthread_mutex_lock(&async_callback_data.mutex);
-  if (ret != 0) {
-    STLOG_HAL_E("HAL: %s pthread_mutex_lock failed", __func__);
-    return;
-  }
-
-  if (async_callback_data.thread_running == 0) {
-    (void)pthread_mutex_unlock(&async_callback_data.mutex);
-    STLOG_HAL_E("HAL: %s thread is not running", __func__);
-    dev.p_cback_unwrap(event, event_status);
-    return;
-  }
-
-  while (async_callback_data.event_pending) {
-    ret = pthread_cond_wait(&async_callback_data.cond,
-                            &async_callback_data.mutex);
-    if (ret != 0) {
-      STLOG_HAL_E("HAL: %s pthread_cond_wait failed", __func__);
-      return;
-    }
-  }
-
-  async_callback_data.event_pending = 1;
-  async_callback_data.event = event;
-  async_callback_data.event_status = event_status;
-
-  ret = pthread_mutex_unlock(&async_callback_data.mutex);
-  if (ret != 0) {
-    STLOG_HAL_E("HAL: %s pthread_mutex_unlock failed", __func__);
-    return;
-  }
-
-  ret = pthread_cond_signal(&async_callback_data.cond);
-  if (ret != 0) {
-    STLOG_HAL_E("HAL: %s pthread_cond_signal failed", __func__);
-    return;
-  }
-}
-/* ------ */
 
 int StNfc_hal_open(nfc_stack_callback_t* p_cback,
                    nfc_stack_data_callback_t* p_data_cback) {
-  bool result = false;
-
   STLOG_HAL_D("HAL st21nfc: %s %s", __func__, halVersion);
-
-  (void)pthread_mutex_lock(&hal_mtx);
-
-  if (!hal_is_closed) {
-    hal_wrapper_close(0, nfc_mode);
-  }
-
-  dev.p_cback = p_cback;  // will be replaced by wrapper version
-  dev.p_cback_unwrap = p_cback;
-  dev.p_data_cback = p_data_cback;
   hal_dta_state = 0;
-  // Initialize and get global logging level
-  InitializeSTLogLevel();
-
-  if ((hal_is_closed || !async_callback_data.thread_running) &&
-      (async_callback_thread_start() != 0)) {
-    dev.p_cback(HAL_NFC_OPEN_CPLT_EVT, HAL_NFC_STATUS_FAILED);
-    (void)pthread_mutex_unlock(&hal_mtx);
-    return -1;  // We are doomed, stop it here, NOW !
-  }
-  result =
-      hal_wrapper_open(&dev, async_callback_post, p_data_cback, &(dev.hHAL));
-
-  if (!result || !(dev.hHAL)) {
-    async_callback_post(HAL_NFC_OPEN_CPLT_EVT, HAL_NFC_STATUS_FAILED);
-    (void)pthread_mutex_unlock(&hal_mtx);
-    return -1;  // We are doomed, stop it here, NOW !
-  }
-  hal_is_closed = 0;
-  (void)pthread_mutex_unlock(&hal_mtx);
-  return 0;
+  return HalFrontEnd::getInstance().open(halVersion, p_cback, p_data_cback);
 }
 
 int StNfc_hal_write(uint16_t data_len, const uint8_t* p_data) {
   STLOG_HAL_D("HAL st21nfc: %s", __func__);
-
-  /* check if HAL is closed */
-  int ret = (int)data_len;
-  (void)pthread_mutex_lock(&hal_mtx);
-  if (hal_is_closed) {
-    ret = 0;
-  }
-
-  if (!ret) {
-    (void)pthread_mutex_unlock(&hal_mtx);
-    return ret;
-  }
-  if (!HalSendDownstream(dev.hHAL, p_data, data_len)) {
-    STLOG_HAL_E("HAL st21nfc %s  SendDownstream failed", __func__);
-    (void)pthread_mutex_unlock(&hal_mtx);
-    return 0;
-  }
-  (void)pthread_mutex_unlock(&hal_mtx);
-
-  return ret;
+  return HalFrontEnd::getInstance().write(data_len, p_data);
 }
 
 int StNfc_hal_core_initialized(uint8_t* p_core_init_rsp_params) {
   STLOG_HAL_D("HAL st21nfc: %s", __func__);
-
-  (void)pthread_mutex_lock(&hal_mtx);
   hal_dta_state = *p_core_init_rsp_params;
-
-  hal_wrapper_send_config();
-  (void)pthread_mutex_unlock(&hal_mtx);
-
+  HalFrontEnd::getInstance().coreInitialized();
   return 0;  // return != 0 to signal ready immediate
 }
 
@@ -354,30 +70,15 @@ int StNfc_hal_pre_discover() {
 int StNfc_hal_close(int nfc_mode_value) {
   STLOG_HAL_D("HAL st21nfc: %s nfc_mode = %d", __func__, nfc_mode_value);
 
-  /* check if HAL is closed */
-  (void)pthread_mutex_lock(&hal_mtx);
-  if (hal_is_closed) {
-    (void)pthread_mutex_unlock(&hal_mtx);
-    return 1;
-  }
-  if (hal_wrapper_close(1, nfc_mode_value) == 0) {
-    hal_is_closed = 1;
-    (void)pthread_mutex_unlock(&hal_mtx);
-    return 1;
-  }
-  hal_is_closed = 1;
-  (void)pthread_mutex_unlock(&hal_mtx);
-
+  int ret = HalFrontEnd::getInstance().close(nfc_mode_value);
   hal_dta_state = 0;
-
-  deInitializeHalLog();
-
-  if (async_callback_thread_end() != 0) {
+  if (ret < 0) {
     STLOG_HAL_E("HAL st21nfc: %s async_callback_thread_end failed", __func__);
-    return -1;  // We are doomed, stop it here, NOW !
+  }
+  if (ret != 0) {
+    return ret;
   }
 
-  usleep(10000);  // give 10ms for the callback thread to pass the binder
   STLOG_HAL_D("HAL st21nfc: %s close", __func__);
   return 0;
 }
@@ -390,22 +91,7 @@ int StNfc_hal_control_granted() {
 
 int StNfc_hal_power_cycle() {
   STLOG_HAL_D("HAL st21nfc: %s", __func__);
-
-  /* check if HAL is closed */
-  int ret = HAL_NFC_STATUS_OK;
-  (void)pthread_mutex_lock(&hal_mtx);
-  if (hal_is_closed) {
-    ret = HAL_NFC_STATUS_FAILED;
-  }
-
-  if (ret != HAL_NFC_STATUS_OK) {
-    (void)pthread_mutex_unlock(&hal_mtx);
-    return ret;
-  }
-  async_callback_post(HAL_NFC_OPEN_CPLT_EVT, HAL_NFC_STATUS_OK);
-
-  (void)pthread_mutex_unlock(&hal_mtx);
-  return HAL_NFC_STATUS_OK;
+  return HalFrontEnd::getInstance().powerCycle();
 }
 
 void StNfc_hal_factoryReset() {
@@ -417,7 +103,7 @@ void StNfc_hal_factoryReset() {
 int StNfc_hal_closeForPowerOffCase() {
   STLOG_HAL_D("HAL st21nfc: %s", __func__);
 
-  return StNfc_hal_close(nfc_mode);
+  return StNfc_hal_close(HalFrontEnd::getInstance().nfcMode());
 }
 
 void StNfc_hal_getConfig(NfcConfig& config) {
@@ -432,7 +118,7 @@ void StNfc_hal_getConfig(NfcConfig& config) {
 
   if (GetNumValue(NAME_CE_ON_SWITCH_OFF_STATE, &num, sizeof(num))) {
     if (num == 0x1) {
-      nfc_mode = 0x2;
+      HalFrontEnd::getInstance().setNfcMode(0x2);
     }
   }
 
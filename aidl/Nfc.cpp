@@ -19,6 +19,7 @@
 #include <android-base/logging.h>
 
 #include "StNfc_hal_api.h"
+#include "hal_binder_calls.h"
 #include "hal_event_logger.h"
 
 namespace aidl {
@@ -57,6 +58,7 @@ void OnDeath(void* cookie) {
 
 ::ndk::ScopedAStatus Nfc::open(
     const std::shared_ptr<INfcClientCallback>& clientCallback) {
+  HalBinderCalls::Scope scope(HalBinderCalls::CALL_OPEN);
   LOG(INFO) << "open";
   if (clientCallback == nullptr) {
     LOG(INFO) << "Nfc::open null callback";
@@ -88,6 +90,7 @@ void OnDeath(void* cookie) {
 }
 
 ::ndk::ScopedAStatus Nfc::close(NfcCloseType type) {
+  HalBinderCalls::Scope scope(HalBinderCalls::CALL_CLOSE);
   LOG(INFO) << "close";
   if (Nfc::mCallback == nullptr) {
     LOG(ERROR) << __func__ << "mCallback null";
@@ -111,6 +114,7 @@ void OnDeath(void* cookie) {
 }
 
 ::ndk::ScopedAStatus Nfc::coreInitialized() {
+  HalBinderCalls::Scope scope(HalBinderCalls::CALL_CORE_INITIALIZED);
   LOG(INFO) << "coreInitialized";
   if (Nfc::mCallback == nullptr) {
     LOG(ERROR) << __func__ << "mCallback null";
@@ -125,12 +129,14 @@ void OnDeath(void* cookie) {
 }
 
 ::ndk::ScopedAStatus Nfc::factoryReset() {
+  HalBinderCalls::Scope scope(HalBinderCalls::CALL_FACTORY_RESET);
   LOG(INFO) << "factoryReset";
   StNfc_hal_factoryReset();
   return ndk::ScopedAStatus::ok();
 }
 
 ::ndk::ScopedAStatus Nfc::getConfig(NfcConfig* _aidl_return) {
+  HalBinderCalls::Scope scope(HalBinderCalls::CALL_GET_CONFIG);
   LOG(INFO) << "getConfig";
   NfcConfig nfcVendorConfig;
   StNfc_hal_getConfig(nfcVendorConfig);
@@ -140,6 +146,7 @@ void OnDeath(void* cookie) {
 }
 
 ::ndk::ScopedAStatus Nfc::powerCycle() {
+  HalBinderCalls::Scope scope(HalBinderCalls::CALL_POWER_CYCLE);
   LOG(INFO) << "powerCycle";
   if (Nfc::mCallback == nullptr) {
     LOG(ERROR) << __func__ << "mCallback null";
@@ -152,6 +159,7 @@ void OnDeath(void* cookie) {
 }
 
 ::ndk::ScopedAStatus Nfc::preDiscover() {
+  HalBinderCalls::Scope scope(HalBinderCalls::CALL_PRE_DISCOVER);
   if (Nfc::mCallback == nullptr) {
     LOG(ERROR) << __func__ << "mCallback null";
     return ndk::ScopedAStatus::fromServiceSpecificError(
@@ -165,6 +173,7 @@ void OnDeath(void* cookie) {
 
 ::ndk::ScopedAStatus Nfc::write(const std::vector<uint8_t>& data,
                                 int32_t* _aidl_return) {
+  HalBinderCalls::Scope scope(HalBinderCalls::CALL_WRITE);
   if (Nfc::mCallback == nullptr) {
     LOG(ERROR) << __func__ << "mCallback null";
     return ndk::ScopedAStatus::fromServiceSpecificError(
@@ -175,17 +184,20 @@ void OnDeath(void* cookie) {
 }
 
 ::ndk::ScopedAStatus Nfc::setEnableVerboseLogging(bool enable) {
+  HalBinderCalls::Scope scope(HalBinderCalls::CALL_SET_VERBOSE_LOGGING);
   LOG(INFO) << "setVerboseLogging";
   StNfc_hal_setLogging(enable);
   return ndk::ScopedAStatus::ok();
 }
 
 ::ndk::ScopedAStatus Nfc::isVerboseLoggingEnabled(bool* _aidl_return) {
+  HalBinderCalls::Scope scope(HalBinderCalls::CALL_IS_VERBOSE_LOGGING);
   *_aidl_return = StNfc_hal_isLoggingEnabled();
   return ndk::ScopedAStatus::ok();
 }
 
 binder_status_t Nfc::dump(int fd, const char**, uint32_t) {
+  HalBinderCalls::Scope scope(HalBinderCalls::CALL_DUMP);
   StNfc_hal_dump(fd);
   return STATUS_OK;
 }
@@ -20,6 +20,10 @@
 #include <aidl/android/hardware/nfc/INfcClientCallback.h>
 #include <android-base/logging.h>
 
+#include <algorithm>
+#include <vector>
+
+#include "hal_metrics.h"
 #include "hardware_nfc.h"
 
 namespace aidl {
@@ -104,7 +108,14 @@ struct Nfc : public BnNfc {
   }
 
   static void dataCallback(uint16_t data_len, uint8_t* p_data) {
-    std::vector<uint8_t> data(p_data, p_data + data_len);
+    // Reused from one frame to the next: once sized for the largest NCI
+    // frame, delivering data up to the stack does not allocate anymore.
+    thread_local std::vector<uint8_t> data;
+    if (data.capacity() < data_len) {
+      HalMetrics::getInstance().increment(HalMetrics::RX_DELIVERY_ALLOCATIONS);
+      data.reserve(std::max<size_t>(data_len, UINT8_MAX + 3));
+    }
+    data.assign(p_data, p_data + data_len);
     if (mCallback != nullptr) {
       auto ret = mCallback->sendData(data);
       if (!ret.isOk()) {
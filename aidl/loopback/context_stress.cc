@@ -0,0 +1,252 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Concurrency check of the per-controller HAL state: several controllers,
+// each with its own StNfcContext and fake NFCC, are opened in parallel and
+// exchange data packets at the same time, then closed. Every callback must
+// run bound to the context of its controller and every controller must see
+// all of its own traffic and none of the others'. Build it with
+// sanitize: { thread: true } to also check they share no state unguarded.
+//
+// Usage: st21nfc_context_stress [--controllers=N] [--exchanges=N]
+
+#include <hardware/nfc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "fake_nfcc.h"
+#include "hal_context.h"
+#include "st21nfc_dev.h"
+
+extern bool hal_wrapper_open(st21nfc_dev_t* dev, nfc_stack_callback_t* p_cback,
+                             nfc_stack_data_callback_t* p_data_cback,
+                             HALHANDLE* pHandle);
+extern int hal_wrapper_close(int call_cb, int nfc_mode);
+
+#define STRESS_TIMEOUT std::chrono::seconds(2)
+#define STRESS_DATA_PAYLOAD 16
+
+struct Controller {
+  int index = 0;
+  StNfcContext context;
+  FakeNfcc nfcc;
+  st21nfc_dev_t dev = {};
+
+  std::mutex mutex;
+  std::condition_variable cond;
+  bool openDone = false;
+  bool closeDone = false;
+  uint64_t responses = 0;
+  uint64_t dataPackets = 0;
+  uint64_t dataBytes = 0;
+};
+
+static std::vector<Controller*> sControllers;
+static std::atomic<int> sFailures(0);
+
+/**
+ * Controller the calling thread is bound to.
+ * @return The controller, NULL if the thread runs on no controller context
+ */
+static Controller* CurrentController() {
+  for (Controller* c : sControllers) {
+    if (&c->context == StNfcContext::current()) return c;
+  }
+  return nullptr;
+}
+
+static void StressStackCallback(nfc_event_t event, nfc_status_t /* status */) {
+  Controller* c = CurrentController();
+  if (c == nullptr) {
+    fprintf(stderr, "event %u on a thread bound to no controller\n", event);
+    sFailures++;
+    return;
+  }
+  std::lock_guard<std::mutex> lock(c->mutex);
+  if (event == HAL_NFC_OPEN_CPLT_EVT) c->openDone = true;
+  if (event == HAL_NFC_CLOSE_CPLT_EVT) c->closeDone = true;
+  c->cond.notify_all();
+}
+
+static void StressDataCallback(uint16_t length, uint8_t* data) {
+  Controller* c = CurrentController();
+  if (c == nullptr) {
+    fprintf(stderr, "frame on a thread bound to no controller\n");
+    sFailures++;
+    return;
+  }
+  std::lock_guard<std::mutex> lock(c->mutex);
+  if ((data[0] & 0xe0) == 0x40) {
+    c->responses++;
+  } else if ((data[0] & 0xe0) == 0x00) {
+    c->dataPackets++;
+    c->dataBytes += length;
+  }
+  c->cond.notify_all();
+}
+
+template <class Predicate>
+static bool WaitFor(Controller* c, Predicate done) {
+  std::unique_lock<std::mutex> lock(c->mutex);
+  return c->cond.wait_for(lock, STRESS_TIMEOUT, done);
+}
+
+/**
+ * Open one controller, bring it to READY, exchange data packets with its
+ * fake NFCC and close it, all on the calling thread bound to its context.
+ * @param c Controller
+ * @param exchanges Number of data packets sent, each echoed by the NFCC
+ * @return true if every step completed
+ */
+static bool RunController(Controller* c, uint64_t exchanges) {
+  static const uint8_t kCoreReset[] = {0x20, 0x00, 0x01, 0x01};
+  static const uint8_t kCoreInit[] = {0x20, 0x01, 0x02, 0x00, 0x00};
+  uint8_t packet[3 + STRESS_DATA_PAYLOAD] = {0x00, 0x00, STRESS_DATA_PAYLOAD};
+  StNfcContext::Scope scope(&c->context);
+  HALHANDLE hHAL = nullptr;
+
+  snprintf(c->context.transport.devNode, sizeof(c->context.transport.devNode),
+           "%s", c->nfcc.devicePath().c_str());
+  packet[3] = c->index;
+
+  if (!hal_wrapper_open(&c->dev, StressStackCallback, StressDataCallback,
+                        &hHAL) ||
+      !WaitFor(c, [c] { return c->openDone; })) {
+    fprintf(stderr, "controller %d: open failed\n", c->index);
+    return false;
+  }
+  if (!HalSendDownstream(hHAL, kCoreReset, sizeof(kCoreReset)) ||
+      !WaitFor(c, [c] { return c->responses >= 1; }) ||
+      !HalSendDownstream(hHAL, kCoreInit, sizeof(kCoreInit)) ||
+      !WaitFor(c, [c] { return c->responses >= 2; })) {
+    fprintf(stderr, "controller %d: NFCC initialization failed\n", c->index);
+    return false;
+  }
+  for (uint64_t i = 0; i < exchanges; i++) {
+    if (!HalSendDownstream(hHAL, packet, sizeof(packet)) ||
+        !WaitFor(c, [c, i] { return c->dataPackets > i; })) {
+      fprintf(stderr, "controller %d: data packet %llu not echoed\n",
+              c->index, (unsigned long long)i);
+      return false;
+    }
+  }
+  hal_wrapper_close(1, 0);
+  if (!WaitFor(c, [c] { return c->closeDone; })) {
+    fprintf(stderr, "controller %d: close failed\n", c->index);
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(c->mutex);
+  if (c->dataPackets != exchanges ||
+      c->dataBytes != exchanges * (3 + STRESS_DATA_PAYLOAD)) {
+    fprintf(stderr, "controller %d: %llu data packets, %llu expected\n",
+            c->index, (unsigned long long)c->dataPackets,
+            (unsigned long long)exchanges);
+    return false;
+  }
+  return true;
+}
+
+/*
+ * The HAL reads its configuration from the working directory (see the
+ * nfc_nci.st21nfc.loopback library). The device node is left out: each
+ * controller sets its own in its I2cTransportContext.
+ */
+static bool PrepareConfiguration() {
+  const char* tmp = getenv("TMPDIR");
+  std::string dir = std::string(tmp ? tmp : "/data/local/tmp") +
+                    "/st21nfc_context_stress.XXXXXX";
+  FILE* conf;
+
+  if (mkdtemp(&dir[0]) == nullptr || chdir(dir.c_str()) != 0) {
+    fprintf(stderr, "cannot enter %s\n", dir.c_str());
+    return false;
+  }
+  conf = fopen("libnfc-hal-st.conf", "w");
+  if (conf == nullptr) {
+    fprintf(stderr, "cannot write the configuration in %s\n", dir.c_str());
+    return false;
+  }
+  fprintf(conf,
+          "STNFC_HAL_LOGLEVEL=1\n"
+          "STNFC_FW_PATH_STORAGE=\"%s\"\n"
+          "STNFC_FW_BIN_NAME=\"/none.bin\"\n"
+          "STNFC_FW_CONF_NAME=\"/none_conf.bin\"\n"
+          "HAL_EVENT_LOG_DEBUG_ENABLED=0\n"
+          "HAL_EVENT_LOG_STORAGE=\"%s\"\n",
+          dir.c_str(), dir.c_str());
+  fclose(conf);
+  return true;
+}
+
+int main(int argc, char** argv) {
+  int controllers = 4;
+  uint64_t exchanges = 2000;
+  std::vector<std::thread> threads;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strncmp(argv[i], "--controllers=", 14)) {
+      controllers = atoi(argv[i] + 14);
+    } else if (!strncmp(argv[i], "--exchanges=", 12)) {
+      exchanges = strtoull(argv[i] + 12, nullptr, 0);
+    } else {
+      fprintf(stderr, "usage: %s [--controllers=N] [--exchanges=N]\n",
+              argv[0]);
+      return 1;
+    }
+  }
+  if (controllers < 1 || !PrepareConfiguration()) return 1;
+
+  for (int i = 0; i < controllers; i++) {
+    Controller* c = new Controller();
+    c->index = i;
+    c->nfcc.setDataResponseLength(STRESS_DATA_PAYLOAD);
+    if (!c->nfcc.start()) {
+      fprintf(stderr, "controller %d: fake NFCC failed to start\n", i);
+      return 1;
+    }
+    sControllers.push_back(c);
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  for (Controller* c : sControllers) {
+    threads.emplace_back([c, exchanges] {
+      if (!RunController(c, exchanges)) sFailures++;
+    });
+  }
+  for (std::thread& t : threads) t.join();
+  double elapsed = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+
+  for (Controller* c : sControllers) {
+    c->nfcc.stop();
+    delete c;
+  }
+  printf("%d controllers x %llu exchanges in %.3f s, %d failures\n",
+         controllers, (unsigned long long)exchanges, elapsed,
+         sFailures.load());
+  return sFailures ? 1 : 0;
+}
@@ -0,0 +1,231 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "fake_nfcc.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <vector>
+
+#define NCI_HEADER_SIZE 3
+#define NCI_MT_DATA 0x00
+#define NCI_MT_CMD 0x01
+
+// HW_ST54L with FW 2.6: observe mode v2 and exit frames are supported.
+#define FAKE_NFCC_HW_VERSION 0x06
+#define FAKE_NFCC_FW_MAJOR 0x02
+#define FAKE_NFCC_FW_MINOR 0x06
+
+FakeNfcc::FakeNfcc()
+    : mMaster(-1),
+      mSlave(-1),
+      mStopPipe{-1, -1},
+      mDataRspLength(32),
+      mDataEcho(true),
+      mObserveMode(0) {}
+
+FakeNfcc::~FakeNfcc() { stop(); }
+
+bool FakeNfcc::start() {
+  struct termios tio;
+
+  mMaster = posix_openpt(O_RDWR | O_NOCTTY);
+  if (mMaster < 0 || grantpt(mMaster) != 0 || unlockpt(mMaster) != 0) {
+    fprintf(stderr, "cannot allocate a pseudo terminal: %s\n",
+            strerror(errno));
+    return false;
+  }
+  mSlavePath = ptsname(mMaster);
+
+  // Keep one slave descriptor open for the whole run: the line settings stay
+  // in place across HAL open/close and the master never sees a hang-up.
+  mSlave = open(mSlavePath.c_str(), O_RDWR | O_NOCTTY);
+  if (mSlave < 0 || tcgetattr(mSlave, &tio) != 0) {
+    fprintf(stderr, "cannot open %s: %s\n", mSlavePath.c_str(),
+            strerror(errno));
+    return false;
+  }
+  // Raw mode, VMIN=1: a read returns what is available. The I2C layer reads
+  // the header then expects the whole payload at once, which holds as long
+  // as each frame is written with a single call, see inject().
+  cfmakeraw(&tio);
+  if (tcsetattr(mSlave, TCSANOW, &tio) != 0 || pipe(mStopPipe) != 0) {
+    fprintf(stderr, "cannot set up %s: %s\n", mSlavePath.c_str(),
+            strerror(errno));
+    return false;
+  }
+
+  // The reset pulse ioctl is a no-op on a pty: queue the CORE_RESET_NTF
+  // the HAL waits for after opening the device.
+  sendResetNtf();
+  mThread = std::thread(&FakeNfcc::run, this);
+  return true;
+}
+
+void FakeNfcc::stop() {
+  if (mThread.joinable()) {
+    char cmd = 'X';
+    (void)write(mStopPipe[1], &cmd, 1);
+    mThread.join();
+  }
+  for (int* fd : {&mMaster, &mSlave, &mStopPipe[0], &mStopPipe[1]}) {
+    if (*fd >= 0) close(*fd);
+    *fd = -1;
+  }
+}
+
+bool FakeNfcc::inject(const uint8_t* data, size_t length) {
+  std::lock_guard<std::mutex> lock(mWriteMutex);
+  // Frames are written in one call so the HAL never sees half of one.
+  return write(mMaster, data, length) == (ssize_t)length;
+}
+
+uint64_t FakeNfcc::cpuTimeNs() {
+  clockid_t clock;
+  struct timespec ts;
+
+  if (!mThread.joinable() ||
+      pthread_getcpuclockid(mThread.native_handle(), &clock) != 0 ||
+      clock_gettime(clock, &ts) != 0) {
+    return 0;
+  }
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void FakeNfcc::sendResetNtf() {
+  // NCI 2.0 CORE_RESET_NTF, ST layout of the manufacturer specific info.
+  uint8_t ntf[33] = {0x60, 0x00, sizeof(ntf) - NCI_HEADER_SIZE, 0x01, 0x00,
+                     0x20, 0x02, sizeof(ntf) - 8};
+  ntf[8] = FAKE_NFCC_HW_VERSION;
+  ntf[10] = FAKE_NFCC_FW_MAJOR;
+  ntf[11] = FAKE_NFCC_FW_MINOR;
+  inject(ntf, sizeof(ntf));
+}
+
+void FakeNfcc::handleFrame(const uint8_t* data, size_t length) {
+  uint8_t mt = (data[0] >> 5) & 0x07;
+  uint8_t gid = data[0] & 0x0F;
+  uint8_t oid = data[1] & 0x3F;
+
+  if (mt == NCI_MT_DATA) {
+    // ISO-DEP like exchange: answer with a R-APDU, then give the credit back.
+    uint8_t rsp[NCI_HEADER_SIZE + 255];
+    uint8_t rspLength = mDataRspLength;
+    uint8_t credits[] = {0x60, 0x06, 0x03, 0x01, (uint8_t)(data[0] & 0x0F),
+                         0x01};
+
+    if (!mDataEcho) {
+      // Card emulation: the packet is a R-APDU for the reader, the credit
+      // comes back once it is sent.
+      inject(credits, sizeof(credits));
+      return;
+    }
+    rsp[0] = data[0] & 0x0F;
+    rsp[1] = 0x00;
+    rsp[2] = rspLength;
+    for (int i = 0; i < rspLength; i++) rsp[NCI_HEADER_SIZE + i] = i;
+    if (rspLength >= 2) {
+      rsp[NCI_HEADER_SIZE + rspLength - 2] = 0x90;
+      rsp[NCI_HEADER_SIZE + rspLength - 1] = 0x00;
+    }
+    inject(rsp, NCI_HEADER_SIZE + rspLength);
+    inject(credits, sizeof(credits));
+    return;
+  }
+  if (mt != NCI_MT_CMD) return;
+
+  if (gid == 0x00 && oid == 0x00) {
+    // CORE_RESET_CMD
+    uint8_t rsp[] = {0x40, 0x00, 0x01, 0x00};
+    inject(rsp, sizeof(rsp));
+    sendResetNtf();
+  } else if (gid == 0x00 && oid == 0x01) {
+    // CORE_INIT_CMD: 1 credit on the HCI connection, so none is lent.
+    uint8_t rsp[17] = {0x40, 0x01, sizeof(rsp) - NCI_HEADER_SIZE};
+    uint8_t credits[] = {0x60, 0x06, 0x03, 0x01, 0x01, 0x01};
+    rsp[8] = 0x04;
+    rsp[10] = 0x04;
+    rsp[11] = 0xFF;
+    rsp[12] = 0xFF;
+    rsp[13] = 0x01;
+    inject(rsp, sizeof(rsp));
+    inject(credits, sizeof(credits));
+  } else if (gid == 0x00 && oid == 0x02) {
+    // CORE_SET_CONFIG_CMD
+    uint8_t rsp[] = {0x40, 0x02, 0x02, 0x00, 0x00};
+    inject(rsp, sizeof(rsp));
+  } else if (gid == 0x0F && oid == 0x02) {
+    // PROP_NFC_MODE_SET_CMD: the CLF restarts when NFC is switched on.
+    uint8_t rsp[] = {0x4f, 0x02, 0x01, 0x00};
+    inject(rsp, sizeof(rsp));
+    if (length >= 5 && data[4] == 0x01) sendResetNtf();
+  } else if (gid == 0x01 && oid == 0x16 && length >= 4) {
+    // RF_SET_LISTEN_OBSERVE_MODE_STATE_CMD
+    uint8_t rsp[] = {0x41, 0x16, 0x01, 0x00};
+    mObserveMode = data[3];
+    inject(rsp, sizeof(rsp));
+  } else if (gid == 0x01 && oid == 0x17) {
+    // RF_GET_LISTEN_OBSERVE_MODE_STATE_CMD
+    uint8_t rsp[] = {0x41, 0x17, 0x02, 0x00, mObserveMode};
+    inject(rsp, sizeof(rsp));
+  } else {
+    uint8_t rsp[] = {(uint8_t)(0x40 | gid), oid, 0x01, 0x00};
+    inject(rsp, sizeof(rsp));
+  }
+}
+
+void FakeNfcc::run() {
+  std::vector<uint8_t> stream;
+  uint8_t buffer[1024];
+  struct pollfd fds[2] = {{mMaster, POLLIN, 0}, {mStopPipe[0], POLLIN, 0}};
+
+  pthread_setname_np(pthread_self(), "fake_nfcc");
+  while (true) {
+    if (poll(fds, 2, -1) < 0) {
+      if (errno == EINTR) continue;
+      break;
+    }
+    if (fds[1].revents & POLLIN) break;
+    if (!(fds[0].revents & POLLIN)) continue;
+
+    ssize_t n = read(mMaster, buffer, sizeof(buffer));
+    if (n <= 0) {
+      if (n < 0 && errno == EINTR) continue;
+      break;
+    }
+    // The HAL writes whole frames, but nothing forces reads to preserve
+    // their boundaries: split the byte stream on the NCI headers.
+    stream.insert(stream.end(), buffer, buffer + n);
+    size_t offset = 0;
+    while (stream.size() - offset >= NCI_HEADER_SIZE &&
+           stream.size() - offset >=
+               (size_t)NCI_HEADER_SIZE + stream[offset + 2]) {
+      size_t length = NCI_HEADER_SIZE + stream[offset + 2];
+      handleFrame(stream.data() + offset, length);
+      offset += length;
+    }
+    stream.erase(stream.begin(), stream.begin() + offset);
+  }
+}
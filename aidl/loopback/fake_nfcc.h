@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/*
+ * In-process NFCC model sitting on the master side of a pseudo terminal. The
+ * HAL opens the slave side as its device node: the st21nfc ioctls fail on it
+ * and are ignored by the I2C layer, while reads and writes carry raw NCI
+ * frames as with the real driver.
+ *
+ * Only what is needed to bring the HAL to READY and to answer the benchmark
+ * traffic is modelled: CORE_RESET, CORE_INIT, PROP_NFC_MODE_SET, the listen
+ * observe mode commands, a generic OK response for any other command, and an
+ * ISO-DEP like echo for data packets, or only their credit back.
+ */
+class FakeNfcc {
+ public:
+  FakeNfcc();
+  ~FakeNfcc();
+
+  bool start();
+  void stop();
+
+  const std::string& devicePath() const { return mSlavePath; }
+
+  // Payload length of the data packets sent back for each received one.
+  void setDataResponseLength(uint8_t length) { mDataRspLength = length; }
+  // false to only return the credit of received data packets, as when the
+  // stack answers a reader in card emulation.
+  void setDataEcho(bool echo) { mDataEcho = echo; }
+
+  // Send one frame to the HAL as if it came from the NFCC. Thread safe.
+  bool inject(const uint8_t* data, size_t length);
+
+  // CPU time used by the model thread, so it can be left out of HAL costs.
+  uint64_t cpuTimeNs();
+
+ private:
+  FakeNfcc(const FakeNfcc&) = delete;
+  FakeNfcc& operator=(const FakeNfcc&) = delete;
+
+  void run();
+  void handleFrame(const uint8_t* data, size_t length);
+  void sendResetNtf();
+
+  int mMaster;
+  int mSlave;
+  int mStopPipe[2];
+  std::string mSlavePath;
+  std::thread mThread;
+  std::mutex mWriteMutex;
+  std::atomic<uint8_t> mDataRspLength;
+  std::atomic<bool> mDataEcho;
+  uint8_t mObserveMode;
+};
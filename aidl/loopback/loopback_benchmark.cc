@@ -0,0 +1,499 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// End-to-end benchmark of the HAL: StNfc_hal_open() is run against a fake
+// NFCC on a pseudo terminal, then NCI traffic goes through StNfc_hal_write()
+// and the stack callbacks as it would in the NFC service. Results are
+// printed as one JSON object so they can be tracked across changes.
+//
+// It is built against each service front end (AIDL, HIDL 1.1 and 1.2), all
+// on the same HalFrontEnd core: their results are to match.
+//
+// Usage: st21nfc_loopback_benchmark [--iterations=N] [--scenario=NAME]
+//                                   [--label=TEXT] [--output=FILE]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "StNfc_hal_api.h"
+#include "fake_nfcc.h"
+#include "hal_front_end.h"
+
+// Threads a frame crosses between StNfc_hal_write() and the stack callbacks.
+// Reported with the results so runs of different thread models are not
+// compared by mistake.
+static const char* kThreadModel = "io-thread+hal-worker+async-cb";
+
+#define LOOPBACK_MAX_WINDOW 64
+#define LOOPBACK_TIMEOUT std::chrono::seconds(2)
+
+typedef bool (*FrameMatcher)(const uint8_t* data, uint16_t length);
+
+// PROP_FW_DBG_NTF as sent by the FW in observe mode: field on, REQA, WUPA,
+// ATQB request and field off, each TLV ending with its 4 bytes timestamp.
+static const uint8_t kPollingLoopNtf[] = {
+    0x6f, 0x02, 0x38, 0x30, 0x00, 0x00,
+    // T_fieldOn
+    0x10, 0x04, 0x00, 0x01, 0x02, 0x03,
+    // T_CERx, short frame, REQA
+    0x09, 0x0b, 0x01, 0x30, 0x00, 0x00, 0x07, 0x00, 0x26, 0x00, 0x01, 0x03,
+    0x04,
+    // T_CERx, short frame, WUPA
+    0x09, 0x0b, 0x01, 0x30, 0x00, 0x00, 0x07, 0x00, 0x52, 0x00, 0x01, 0x04,
+    0x05,
+    // T_CERx, type B, REQB
+    0x09, 0x0d, 0x07, 0x30, 0x00, 0x00, 0x09, 0x00, 0x05, 0x00, 0x00, 0x00,
+    0x01, 0x05, 0x06,
+    // T_fieldOff
+    0x11, 0x04, 0x00, 0x01, 0x06, 0x07};
+
+// Commands cycled through by the mixed scenario, each answered by one RSP.
+static const std::vector<std::vector<uint8_t>> kMixedCommands = {
+    // CORE_GET_CONFIG_CMD
+    {0x20, 0x03, 0x02, 0x01, 0x00},
+    // CORE_SET_CONFIG_CMD
+    {0x20, 0x02, 0x04, 0x01, 0xa1, 0x01, 0x19},
+    // Android passive observer query, rewritten by the HAL
+    {0x2f, 0x0c, 0x01, 0x04},
+    // RF_SET_LISTEN_MODE_ROUTING_CMD, one empty entry
+    {0x21, 0x01, 0x02, 0x00, 0x00},
+};
+
+static struct {
+  std::mutex mutex;
+  std::condition_variable cond;
+  bool openDone;
+  uint8_t openStatus;
+  bool closeDone;
+
+  FrameMatcher match;
+  uint64_t sent[LOOPBACK_MAX_WINDOW];
+  uint64_t issued;
+  uint64_t completed;
+  std::vector<uint64_t> latencies;
+  uint64_t txFrames;
+  uint64_t txBytes;
+  uint64_t rxFrames;
+  uint64_t rxBytes;
+} sLoop;
+
+static FakeNfcc sNfcc;
+
+struct Result {
+  Result(const char* scenario, size_t inFlight, size_t size)
+      : name(scenario), window(inFlight), payload(size) {}
+
+  std::string name;
+  size_t window;
+  size_t payload;
+  uint64_t transactions = 0;
+  uint64_t elapsedNs = 0;
+  uint64_t cpuNs = 0;
+  uint64_t txFrames = 0;
+  uint64_t txBytes = 0;
+  uint64_t rxFrames = 0;
+  uint64_t rxBytes = 0;
+  std::vector<uint64_t> latencies;
+  bool timedOut = false;
+};
+
+static uint64_t NowNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static uint64_t ProcessCpuNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static bool IsCoreResetRsp(const uint8_t* data, uint16_t length) {
+  return length >= 4 && data[0] == 0x40 && data[1] == 0x00;
+}
+
+static bool IsCoreInitRsp(const uint8_t* data, uint16_t length) {
+  return length >= 4 && data[0] == 0x40 && data[1] == 0x01;
+}
+
+static bool IsRsp(const uint8_t* data, uint16_t length) {
+  return length >= 3 && (data[0] & 0xE0) == 0x40;
+}
+
+static bool IsObserverRsp(const uint8_t* data, uint16_t length) {
+  return length >= 5 && data[0] == 0x4f && data[1] == 0x0c;
+}
+
+static bool IsDataPacket(const uint8_t* data, uint16_t length) {
+  return length >= 3 && (data[0] & 0xE0) == 0x00;
+}
+
+static bool IsPollingLoopNtf(const uint8_t* data, uint16_t length) {
+  return length >= 4 && data[0] == 0x6f && data[1] == 0x0c && data[3] == 0x03;
+}
+
+static void LoopbackStackCallback(nfc_event_t event, nfc_status_t status) {
+  std::lock_guard<std::mutex> lock(sLoop.mutex);
+  if (event == HAL_NFC_OPEN_CPLT_EVT) {
+    sLoop.openDone = true;
+    sLoop.openStatus = status;
+  } else if (event == HAL_NFC_CLOSE_CPLT_EVT) {
+    sLoop.closeDone = true;
+  }
+  sLoop.cond.notify_all();
+}
+
+static void LoopbackDataCallback(uint16_t length, uint8_t* data) {
+  uint64_t now = NowNs();
+  std::lock_guard<std::mutex> lock(sLoop.mutex);
+
+  sLoop.rxFrames++;
+  sLoop.rxBytes += length;
+  if (sLoop.match && sLoop.completed < sLoop.issued &&
+      sLoop.match(data, length)) {
+    sLoop.latencies.push_back(
+        now - sLoop.sent[sLoop.completed % LOOPBACK_MAX_WINDOW]);
+    sLoop.completed++;
+    sLoop.cond.notify_all();
+  }
+}
+
+static bool LoopbackWrite(const uint8_t* data, size_t length) {
+  {
+    std::lock_guard<std::mutex> lock(sLoop.mutex);
+    sLoop.txFrames++;
+    sLoop.txBytes += length;
+  }
+  return StNfc_hal_write(length, data) == (int)length;
+}
+
+/**
+ * Issue |count| transactions with at most |window| of them in flight. A
+ * transaction completes when the stack receives a frame accepted by |match|;
+ * its latency is measured from just before |send| is called.
+ */
+static bool RunTransactions(uint64_t count, size_t window, FrameMatcher match,
+                            const std::function<bool(uint64_t)>& send,
+                            Result* result) {
+  bool ok = true;
+  uint64_t cpuStart, nfccStart, start;
+
+  {
+    std::lock_guard<std::mutex> lock(sLoop.mutex);
+    sLoop.match = match;
+    sLoop.issued = 0;
+    sLoop.completed = 0;
+    sLoop.latencies.clear();
+    sLoop.latencies.reserve(count);
+    sLoop.txFrames = sLoop.txBytes = 0;
+    sLoop.rxFrames = sLoop.rxBytes = 0;
+  }
+  cpuStart = ProcessCpuNs();
+  nfccStart = sNfcc.cpuTimeNs();
+  start = NowNs();
+
+  for (uint64_t seq = 0; ok && seq < count; seq++) {
+    {
+      std::unique_lock<std::mutex> lock(sLoop.mutex);
+      ok = sLoop.cond.wait_for(lock, LOOPBACK_TIMEOUT, [&] {
+        return sLoop.issued - sLoop.completed < window;
+      });
+      if (!ok) break;
+      sLoop.sent[seq % LOOPBACK_MAX_WINDOW] = NowNs();
+      sLoop.issued++;
+    }
+    ok = send(seq);
+  }
+  {
+    std::unique_lock<std::mutex> lock(sLoop.mutex);
+    ok = sLoop.cond.wait_for(lock, LOOPBACK_TIMEOUT, [&] {
+           return sLoop.completed == sLoop.issued;
+         }) &&
+         ok;
+  }
+
+  uint64_t elapsed = NowNs() - start;
+  uint64_t cpu = ProcessCpuNs() - cpuStart;
+  uint64_t nfccCpu = sNfcc.cpuTimeNs() - nfccStart;
+
+  std::lock_guard<std::mutex> lock(sLoop.mutex);
+  sLoop.match = nullptr;
+  if (result) {
+    result->transactions = sLoop.completed;
+    result->elapsedNs = elapsed;
+    result->cpuNs = cpu > nfccCpu ? cpu - nfccCpu : 0;
+    result->txFrames = sLoop.txFrames;
+    result->txBytes = sLoop.txBytes;
+    result->rxFrames = sLoop.rxFrames;
+    result->rxBytes = sLoop.rxBytes;
+    result->latencies.swap(sLoop.latencies);
+    result->timedOut = !ok;
+  }
+  return ok;
+}
+
+static bool SendAndWait(const uint8_t* cmd, size_t length, FrameMatcher match) {
+  return RunTransactions(
+      1, 1, match, [&](uint64_t) { return LoopbackWrite(cmd, length); },
+      nullptr);
+}
+
+/**
+ * Bring the HAL up the way the NFC stack does: open, then CORE_RESET and
+ * CORE_INIT. The HAL inserts PROP_NFC_MODE_SET in between and only forwards
+ * the CORE_INIT_RSP once it is READY.
+ */
+static bool OpenHal() {
+  uint8_t coreReset[] = {0x20, 0x00, 0x01, 0x01};
+  uint8_t coreInit[] = {0x20, 0x01, 0x02, 0x00, 0x00};
+
+  if (StNfc_hal_open(LoopbackStackCallback, LoopbackDataCallback) != 0) {
+    fprintf(stderr, "StNfc_hal_open failed\n");
+    return false;
+  }
+  {
+    std::unique_lock<std::mutex> lock(sLoop.mutex);
+    if (!sLoop.cond.wait_for(lock, LOOPBACK_TIMEOUT,
+                             [] { return sLoop.openDone; }) ||
+        sLoop.openStatus != HAL_NFC_STATUS_OK) {
+      fprintf(stderr, "HAL_NFC_OPEN_CPLT_EVT not received or failed\n");
+      return false;
+    }
+  }
+  if (!SendAndWait(coreReset, sizeof(coreReset), IsCoreResetRsp) ||
+      !SendAndWait(coreInit, sizeof(coreInit), IsCoreInitRsp)) {
+    fprintf(stderr, "NFCC initialization failed\n");
+    return false;
+  }
+  return true;
+}
+
+static void CloseHal() {
+  StNfc_hal_close(NFC_MODE_OFF);
+  std::unique_lock<std::mutex> lock(sLoop.mutex);
+  sLoop.cond.wait_for(lock, LOOPBACK_TIMEOUT, [] { return sLoop.closeDone; });
+}
+
+static bool RunIsoDep(const char* name, uint64_t count, uint8_t payload,
+                      std::vector<Result>* results) {
+  // C-APDU of |payload| bytes on the static RF connection, the fake NFCC
+  // answers with a R-APDU of the same size and a CORE_CONN_CREDITS_NTF.
+  std::vector<uint8_t> packet(3 + payload);
+  Result result(name, 1, payload);
+
+  packet[2] = payload;
+  for (int i = 0; i < payload; i++) packet[3 + i] = i;
+  sNfcc.setDataResponseLength(payload);
+
+  auto send = [&](uint64_t) {
+    return LoopbackWrite(packet.data(), packet.size());
+  };
+  RunTransactions(std::min<uint64_t>(count, 100), 1, IsDataPacket, send,
+                  nullptr);
+  RunTransactions(count, 1, IsDataPacket, send, &result);
+  results->push_back(std::move(result));
+  return !results->back().timedOut;
+}
+
+static bool RunObserveFlood(uint64_t count, size_t window,
+                            std::vector<Result>* results) {
+  uint8_t enable[] = {0x2f, 0x0c, 0x02, 0x02, 0x01};
+  uint8_t disable[] = {0x2f, 0x0c, 0x02, 0x02, 0x00};
+  Result result("observe_mode_polling_loop", window, sizeof(kPollingLoopNtf));
+
+  if (!SendAndWait(enable, sizeof(enable), IsObserverRsp)) return false;
+
+  // Polling loop notifications are pushed by the NFCC side, up to |window|
+  // of them queued in the transport at any time.
+  auto send = [&](uint64_t) {
+    return sNfcc.inject(kPollingLoopNtf, sizeof(kPollingLoopNtf));
+  };
+  RunTransactions(std::min<uint64_t>(count, 100), window, IsPollingLoopNtf,
+                  send, nullptr);
+  RunTransactions(count, window, IsPollingLoopNtf, send, &result);
+  results->push_back(std::move(result));
+
+  return SendAndWait(disable, sizeof(disable), IsObserverRsp) &&
+         !results->back().timedOut;
+}
+
+static bool RunMixedCommands(uint64_t count, std::vector<Result>* results) {
+  Result result("mixed_commands", 1, 0);
+
+  auto send = [&](uint64_t seq) {
+    const std::vector<uint8_t>& cmd =
+        kMixedCommands[seq % kMixedCommands.size()];
+    return LoopbackWrite(cmd.data(), cmd.size());
+  };
+  RunTransactions(std::min<uint64_t>(count, 100), 1, IsRsp, send, nullptr);
+  RunTransactions(count, 1, IsRsp, send, &result);
+  results->push_back(std::move(result));
+  return !results->back().timedOut;
+}
+
+static double Percentile(const std::vector<uint64_t>& sorted, int percent) {
+  if (sorted.empty()) return 0;
+  size_t index = std::min(sorted.size() - 1, sorted.size() * percent / 100);
+  return sorted[index] / 1000.0;
+}
+
+static std::string ToJson(const std::string& label,
+                          std::vector<Result>& results) {
+  std::ostringstream oss;
+
+  oss << "{\"benchmark\":\"st21nfc_loopback\",\"version\":1,\"label\":\""
+      << label << "\",\"front_end\":\"" << HalFrontEnd::getInstance().name()
+      << "\",\"front_end_core\":" << HalFrontEnd::version()
+      << ",\"thread_model\":\"" << kThreadModel << "\",\"scenarios\":[";
+  for (size_t i = 0; i < results.size(); i++) {
+    Result& r = results[i];
+    double seconds = r.elapsedNs / 1e9;
+    uint64_t frames = r.txFrames + r.rxFrames;
+    uint64_t bytes = r.txBytes + r.rxBytes;
+    uint64_t sum = 0;
+
+    std::sort(r.latencies.begin(), r.latencies.end());
+    for (uint64_t l : r.latencies) sum += l;
+    oss << (i ? "," : "") << "\n{\"name\":\"" << r.name
+        << "\",\"window\":" << r.window << ",\"payload_bytes\":" << r.payload
+        << ",\"transactions\":" << r.transactions
+        << ",\"timed_out\":" << (r.timedOut ? "true" : "false")
+        << ",\"elapsed_s\":" << seconds << ",\"tx_frames\":" << r.txFrames
+        << ",\"tx_bytes\":" << r.txBytes << ",\"rx_frames\":" << r.rxFrames
+        << ",\"rx_bytes\":" << r.rxBytes << ",\"frames_per_s\":"
+        << (seconds > 0 ? frames / seconds : 0) << ",\"bytes_per_s\":"
+        << (seconds > 0 ? bytes / seconds : 0)
+        << ",\"transactions_per_s\":"
+        << (seconds > 0 ? r.transactions / seconds : 0)
+        << ",\"rtt_us\":{\"mean\":"
+        << (r.latencies.empty() ? 0 : sum / 1000.0 / r.latencies.size())
+        << ",\"p50\":" << Percentile(r.latencies, 50)
+        << ",\"p90\":" << Percentile(r.latencies, 90)
+        << ",\"p99\":" << Percentile(r.latencies, 99)
+        << ",\"max\":" << Percentile(r.latencies, 100)
+        << "},\"cpu_us_per_frame\":"
+        << (frames ? r.cpuNs / 1000.0 / frames : 0) << "}";
+  }
+  oss << "\n]}\n";
+  return oss.str();
+}
+
+/*
+ * The HAL reads its configuration from the working directory (see the
+ * nfc_nci.st21nfc.loopback library): point the device node to the pty and
+ * keep every file the HAL may write in the scratch directory.
+ */
+static bool PrepareConfiguration(const std::string& devicePath) {
+  const char* tmp = getenv("TMPDIR");
+  std::string dir = std::string(tmp ? tmp : "/data/local/tmp") +
+                    "/st21nfc_loopback.XXXXXX";
+  FILE* conf;
+
+  if (mkdtemp(&dir[0]) == nullptr || chdir(dir.c_str()) != 0) {
+    fprintf(stderr, "cannot enter %s\n", dir.c_str());
+    return false;
+  }
+  conf = fopen("libnfc-hal-st.conf", "w");
+  if (conf == nullptr) {
+    fprintf(stderr, "cannot write the configuration in %s\n", dir.c_str());
+    return false;
+  }
+  fprintf(conf,
+          "STNFC_HAL_LOGLEVEL=1\n"
+          "ST_NFC_DEV_NODE=\"%s\"\n"
+          "STNFC_FW_PATH_STORAGE=\"%s\"\n"
+          "STNFC_FW_BIN_NAME=\"/none.bin\"\n"
+          "STNFC_FW_CONF_NAME=\"/none_conf.bin\"\n"
+          "HAL_EVENT_LOG_DEBUG_ENABLED=0\n"
+          "HAL_EVENT_LOG_STORAGE=\"%s\"\n",
+          devicePath.c_str(), dir.c_str(), dir.c_str());
+  fclose(conf);
+  return true;
+}
+
+int main(int argc, char** argv) {
+  uint64_t iterations = 20000;
+  std::string scenario = "all";
+  std::string label;
+  std::string output;
+  std::vector<Result> results;
+  bool ok = true;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strncmp(argv[i], "--iterations=", 13)) {
+      iterations = strtoull(argv[i] + 13, nullptr, 0);
+    } else if (!strncmp(argv[i], "--scenario=", 11)) {
+      scenario = argv[i] + 11;
+    } else if (!strncmp(argv[i], "--label=", 8)) {
+      label = argv[i] + 8;
+    } else if (!strncmp(argv[i], "--output=", 9)) {
+      output = argv[i] + 9;
+    } else {
+      fprintf(stderr,
+              "usage: %s [--iterations=N] "
+              "[--scenario=all|iso_dep|observe|mixed] [--label=TEXT] "
+              "[--output=FILE]\n",
+              argv[0]);
+      return 1;
+    }
+  }
+
+  if (!sNfcc.start() || !PrepareConfiguration(sNfcc.devicePath()) ||
+      !OpenHal()) {
+    return 1;
+  }
+
+  if (scenario == "all" || scenario == "iso_dep") {
+    ok = RunIsoDep("iso_dep_short", iterations, 16, &results) && ok;
+    ok = RunIsoDep("iso_dep_long", iterations, 255, &results) && ok;
+  }
+  if (scenario == "all" || scenario == "observe") {
+    ok = RunObserveFlood(iterations, 8, &results) && ok;
+  }
+  if (scenario == "all" || scenario == "mixed") {
+    ok = RunMixedCommands(iterations, &results) && ok;
+  }
+
+  CloseHal();
+  sNfcc.stop();
+
+  std::string json = ToJson(label, results);
+  if (output.empty()) {
+    fputs(json.c_str(), stdout);
+  } else {
+    FILE* f = fopen(output.c_str(), "w");
+    if (f == nullptr) {
+      fprintf(stderr, "cannot write %s\n", output.c_str());
+      return 1;
+    }
+    fputs(json.c_str(), f);
+    fclose(f);
+  }
+  return ok ? 0 : 1;
+}
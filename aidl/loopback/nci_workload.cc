@@ -0,0 +1,206 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "nci_workload.h"
+
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+
+#define NCI_HEADER_SIZE 3
+#define NCI_MAX_PAYLOAD 255
+
+// PROP_FW_DBG_NTF: 6f 02, then the trace format, ST54L, and 2 bytes.
+#define FW_DBG_FORMAT_ST54L 0x30
+#define FW_DBG_HEADER_SIZE 6
+#define FW_TRACE_T_CERX 0x09
+#define FW_TRACE_T_FIELD_ON 0x10
+#define FW_TRACE_T_FIELD_OFF 0x11
+
+static const char* kProfileNames[NciWorkload::PROFILE_MAX] = {
+    "iso_dep", "hce", "felica", "observe", "ese_hci", "fw_trace",
+};
+
+// C-APDU instructions: SELECT, READ BINARY, READ RECORD, UPDATE BINARY,
+// INTERNAL AUTHENTICATE, GET DATA.
+static const uint8_t kApduIns[] = {0xa4, 0xb0, 0xb2, 0xd6, 0x88, 0xca};
+
+// Requests seen in a polling loop: frame type of the CERx TLV, its size
+// byte and the frame.
+struct PollingRequest {
+  uint8_t type;
+  uint8_t size;
+  uint8_t length;
+  uint8_t data[6];
+};
+
+static const PollingRequest kPollingRequests[] = {
+    {0x01, 0x07, 1, {0x26}},                               // REQA
+    {0x01, 0x07, 1, {0x52}},                               // WUPA
+    {0x07, 0x09, 3, {0x05, 0x00, 0x00}},                   // REQB
+    {0x08, 0x06, 6, {0x06, 0x00, 0xff, 0xff, 0x01, 0x00}}, // SENSF_REQ
+};
+
+NciWorkload::NciWorkload(uint64_t seed, Profile profile) : mFwTime(0) {
+  // One stream per profile: running a subset does not change the others.
+  std::seed_seq seq{(uint32_t)seed, (uint32_t)(seed >> 32), (uint32_t)profile};
+  mRandom.seed(seq);
+}
+
+const char* NciWorkload::profileName(Profile profile) {
+  if (profile >= PROFILE_MAX) return "unknown";
+  return kProfileNames[profile];
+}
+
+bool NciWorkload::profileFromName(const char* name, Profile* profile) {
+  for (int p = 0; p < PROFILE_MAX; p++) {
+    if (strcmp(name, kProfileNames[p]) == 0) {
+      *profile = (Profile)p;
+      return true;
+    }
+  }
+  return false;
+}
+
+uint32_t NciWorkload::uniform(uint32_t min, uint32_t max) {
+  return std::uniform_int_distribution<uint32_t>(min, max)(mRandom);
+}
+
+void NciWorkload::appendTimestamp(std::vector<uint8_t>* frame) {
+  mFwTime += uniform(20, 2000);
+  frame->push_back(mFwTime >> 24);
+  frame->push_back(mFwTime >> 16);
+  frame->push_back(mFwTime >> 8);
+  frame->push_back(mFwTime);
+}
+
+void NciWorkload::commandApdu(size_t size, std::vector<uint8_t>* frame) {
+  size = std::clamp<size_t>(size, 4, NCI_MAX_PAYLOAD);
+  frame->assign(NCI_HEADER_SIZE + size, 0);
+  (*frame)[2] = size;
+  (*frame)[4] = kApduIns[uniform(0, sizeof(kApduIns) - 1)];
+  (*frame)[5] = uniform(0, 0xff);
+  (*frame)[6] = uniform(0, 0xff);
+  if (size > 5) {
+    (*frame)[7] = size - 5;
+    for (size_t i = 8; i < frame->size(); i++) (*frame)[i] = uniform(0, 0xff);
+  }
+}
+
+void NciWorkload::responseApdu(size_t size, std::vector<uint8_t>* frame) {
+  size = std::clamp<size_t>(size, 2, NCI_MAX_PAYLOAD);
+  frame->assign(NCI_HEADER_SIZE + size, 0);
+  (*frame)[2] = size;
+  for (size_t i = NCI_HEADER_SIZE; i < frame->size() - 2; i++) {
+    (*frame)[i] = uniform(0, 0xff);
+  }
+  (*frame)[frame->size() - 2] = 0x90;
+  (*frame)[frame->size() - 1] = 0x00;
+}
+
+void NciWorkload::felicaPollingCmd(std::vector<uint8_t>* frame) {
+  // System code ffff, request code 1 (system code), time slot 0f
+  *frame = {0x21, 0x08, 0x04, 0xff, 0xff, 0x01, 0x0f};
+}
+
+void NciWorkload::felicaPollingNtf(std::vector<uint8_t>* frame) {
+  uint32_t cards = uniform(1, 4);
+
+  *frame = {0x61, 0x08, 0x00, 0x00, (uint8_t)cards};
+  for (uint32_t c = 0; c < cards; c++) {
+    // Length, response code, IDm, PMm, system code
+    frame->push_back(19);
+    frame->push_back(0x01);
+    for (int i = 0; i < 16; i++) frame->push_back(uniform(0, 0xff));
+    frame->push_back(0x12);
+    frame->push_back(0xfc);
+  }
+  (*frame)[2] = frame->size() - NCI_HEADER_SIZE;
+}
+
+void NciWorkload::pollingLoopNtf(std::vector<uint8_t>* frame) {
+  uint32_t requests = uniform(1, 6);
+
+  *frame = {0x6f, 0x02, 0x00, FW_DBG_FORMAT_ST54L, 0x00, 0x00};
+  frame->insert(frame->end(), {FW_TRACE_T_FIELD_ON, 0x04});
+  appendTimestamp(frame);
+  for (uint32_t r = 0; r < requests; r++) {
+    const PollingRequest& request =
+        kPollingRequests[uniform(0, std::size(kPollingRequests) - 1)];
+    uint8_t gain = uniform(0, 15);
+
+    // T, L, type, gain, 2 bytes, error, size, frame, timestamp
+    frame->insert(frame->end(),
+                  {FW_TRACE_T_CERX, (uint8_t)(10 + request.length),
+                   request.type, (uint8_t)(gain << 4), 0x00, 0x00,
+                   request.size, 0x00});
+    frame->insert(frame->end(), request.data, request.data + request.length);
+    appendTimestamp(frame);
+  }
+  frame->insert(frame->end(), {FW_TRACE_T_FIELD_OFF, 0x04});
+  appendTimestamp(frame);
+  (*frame)[2] = frame->size() - NCI_HEADER_SIZE;
+}
+
+void NciWorkload::hciApdu(size_t size, std::vector<uint8_t>* frame) {
+  size = std::clamp<size_t>(size, 4, NCI_MAX_PAYLOAD - 2);
+  frame->assign(NCI_HEADER_SIZE + 2 + size, 0);
+  (*frame)[0] = NCI_WORKLOAD_HCI_CONN_ID;
+  (*frame)[2] = 2 + size;
+  (*frame)[3] = NCI_WORKLOAD_HCI_APDU_PIPE;
+  (*frame)[4] = NCI_WORKLOAD_HCI_EVT_TRANSMIT_DATA;
+  (*frame)[6] = kApduIns[uniform(0, sizeof(kApduIns) - 1)];
+  for (size_t i = 7; i < frame->size(); i++) (*frame)[i] = uniform(0, 0xff);
+}
+
+void NciWorkload::fwTraceNtf(std::vector<uint8_t>* frame) {
+  size_t length = uniform(8, 64);
+
+  *frame = {0x6f, 0x02, 0x00, FW_DBG_FORMAT_ST54L, 0x00, 0x00};
+  while (frame->size() - FW_DBG_HEADER_SIZE + 6 <= length) {
+    // Internal FW events: types the polling loop decoding ignores.
+    uint8_t value = uniform(0, 4);
+    frame->push_back(uniform(0x20, 0x2f));
+    frame->push_back(value + 4);
+    for (uint8_t i = 0; i < value; i++) frame->push_back(uniform(0, 0xff));
+    appendTimestamp(frame);
+  }
+  (*frame)[2] = frame->size() - NCI_HEADER_SIZE;
+}
+
+static uint64_t MonotonicNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+NciWorkloadPacer::NciWorkloadPacer(uint32_t framesPerSecond)
+    : mPeriodNs(framesPerSecond ? 1000000000ull / framesPerSecond : 0),
+      mNextNs(MonotonicNs()) {}
+
+void NciWorkloadPacer::wait() {
+  struct timespec ts;
+
+  if (!mPeriodNs) return;
+  ts.tv_sec = mNextNs / 1000000000;
+  ts.tv_nsec = mNextNs % 1000000000;
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) ==
+         EINTR) {
+  }
+  mNextNs += mPeriodNs;
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <random>
+#include <vector>
+
+#define NCI_WORKLOAD_HCI_CONN_ID 0x01
+// HCP header of the APDU pipe of the eSE, EVT_TRANSMIT_DATA
+#define NCI_WORKLOAD_HCI_APDU_PIPE 0x99
+#define NCI_WORKLOAD_HCI_EVT_TRANSMIT_DATA 0x50
+
+/*
+ * Frames of the synthetic NCI workloads. The content, APDU instructions,
+ * FeliCa IDm, polling loop TLVs and their timing, only depends on the seed
+ * and the profile, so that two runs, or two builds, see the same traffic:
+ *   iso_dep   C-APDUs of the stack, answered by R-APDUs of the card
+ *   hce       C-APDUs of a reader, answered by R-APDUs of the stack
+ *   felica    RF_T3T_POLLING_CMD and their NTF with 1 to 4 cards
+ *   observe   PROP_FW_DBG_NTF polling loops, observe mode on
+ *   ese_hci   EVT_TRANSMIT_DATA on the HCI connection and credits back
+ *   fw_trace  PROP_FW_DBG_NTF of the FW, noise the stack never waits for
+ */
+class NciWorkload {
+ public:
+  enum Profile {
+    PROFILE_ISO_DEP,
+    PROFILE_HCE,
+    PROFILE_FELICA,
+    PROFILE_OBSERVE,
+    PROFILE_ESE_HCI,
+    PROFILE_FW_TRACE,
+    PROFILE_MAX,
+  };
+
+  NciWorkload(uint64_t seed, Profile profile);
+
+  static const char* profileName(Profile profile);
+  // Returns false if name is not a profile.
+  static bool profileFromName(const char* name, Profile* profile);
+
+  // Data packet on the static RF connection carrying a C-APDU of size bytes
+  // (4 to 255), iso_dep and hce.
+  void commandApdu(size_t size, std::vector<uint8_t>* frame);
+  // Data packet carrying a R-APDU of size bytes (2 to 255), ending with
+  // SW 9000, hce.
+  void responseApdu(size_t size, std::vector<uint8_t>* frame);
+  // RF_T3T_POLLING_CMD for the wildcard system code, felica.
+  void felicaPollingCmd(std::vector<uint8_t>* frame);
+  // Its RF_T3T_POLLING_NTF, 1 to 4 cards answering.
+  void felicaPollingNtf(std::vector<uint8_t>* frame);
+  // PROP_FW_DBG_NTF of a polling loop: field on, 1 to 6 requests of types
+  // A, B and F, field off.
+  void pollingLoopNtf(std::vector<uint8_t>* frame);
+  // EVT_TRANSMIT_DATA of size APDU bytes to the eSE, ese_hci.
+  void hciApdu(size_t size, std::vector<uint8_t>* frame);
+  // PROP_FW_DBG_NTF of FW trace TLVs, 8 to 64 bytes, fw_trace.
+  void fwTraceNtf(std::vector<uint8_t>* frame);
+
+ private:
+  uint32_t uniform(uint32_t min, uint32_t max);
+  void appendTimestamp(std::vector<uint8_t>* frame);
+
+  std::mt19937_64 mRandom;
+  uint32_t mFwTime;  // FW timestamp of the polling loop TLVs
+};
+
+/*
+ * Pacing of frames at a rate, on absolute deadlines so that the time spent
+ * producing them does not add up.
+ */
+class NciWorkloadPacer {
+ public:
+  // 0 for no pacing.
+  explicit NciWorkloadPacer(uint32_t framesPerSecond);
+
+  // Sleeps until the time of the next frame.
+  void wait();
+
+ private:
+  uint64_t mPeriodNs;
+  uint64_t mNextNs;
+};
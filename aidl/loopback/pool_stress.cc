@@ -0,0 +1,269 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Check of the HAL buffer pool against a worker thread deadlock: while the
+// HAL worker thread delivers a frame, writer threads standing for the binder
+// threads fill the pool with HalTrySendDownstream until it refuses them,
+// then the worker sends frames itself, as the wrapper does from its
+// callbacks. Only the worker frees buffers: it must get them from its own
+// share, never wait for one. A round that does not complete in time is
+// reported as that deadlock.
+//
+// Usage: st21nfc_pool_stress [--rounds=N] [--writers=N]
+
+#include <hardware/nfc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "fake_nfcc.h"
+#include "hal_context.h"
+#include "st21nfc_dev.h"
+
+extern bool hal_wrapper_open(st21nfc_dev_t* dev, nfc_stack_callback_t* p_cback,
+                             nfc_stack_data_callback_t* p_data_cback,
+                             HALHANDLE* pHandle);
+extern int hal_wrapper_close(int call_cb, int nfc_mode);
+
+#define STRESS_TIMEOUT std::chrono::seconds(5)
+#define STRESS_DATA_PAYLOAD 16
+// Frames the worker sends from the callback, below NUM_BUFFERS_WORKER_RESERVE
+#define STRESS_WORKER_FRAMES 3
+
+static const uint8_t kDataPacket[3 + STRESS_DATA_PAYLOAD] = {
+    0x00, 0x00, STRESS_DATA_PAYLOAD};
+
+static FakeNfcc sNfcc;
+static HALHANDLE sHal = nullptr;
+static int sWriters = 4;
+
+static std::mutex sMutex;
+static std::condition_variable sCond;
+static bool sOpenDone = false;
+static bool sCloseDone = false;
+static uint64_t sResponses = 0;
+static uint64_t sDataPackets = 0;
+// Set to fill the pool from the next data packet delivered
+static bool sFillArmed = false;
+static bool sRoundDone = false;
+static uint64_t sWriterFrames = 0;
+static uint64_t sWriterRefusals = 0;
+static int sWorkerSent = 0;
+
+static void StressStackCallback(nfc_event_t event, nfc_status_t /* status */) {
+  std::lock_guard<std::mutex> lock(sMutex);
+  if (event == HAL_NFC_OPEN_CPLT_EVT) sOpenDone = true;
+  if (event == HAL_NFC_CLOSE_CPLT_EVT) sCloseDone = true;
+  sCond.notify_all();
+}
+
+/**
+ * Writer standing for a binder thread: queues data packets until the pool
+ * refuses one.
+ * @param frames Incremented for each packet queued
+ */
+static void FillPool(std::atomic<uint64_t>* frames) {
+  while (HalTrySendDownstream(sHal, kDataPacket, sizeof(kDataPacket))) {
+    (*frames)++;
+  }
+}
+
+/**
+ * Runs on the HAL worker thread, holding the buffer of the frame delivered.
+ * When armed, has the pool filled by the writers, then sends from here.
+ */
+static void FillThenSendFromWorker() {
+  std::atomic<uint64_t> frames(0);
+  std::vector<std::thread> writers;
+  int sent = 0;
+
+  for (int i = 0; i < sWriters; i++) {
+    writers.emplace_back(FillPool, &frames);
+  }
+  for (std::thread& t : writers) t.join();
+
+  for (int i = 0; i < STRESS_WORKER_FRAMES; i++) {
+    if (HalSendDownstream(sHal, kDataPacket, sizeof(kDataPacket))) sent++;
+  }
+
+  std::lock_guard<std::mutex> lock(sMutex);
+  sWriterFrames += frames;
+  sWriterRefusals += sWriters;
+  sWorkerSent += sent;
+  sRoundDone = true;
+  sCond.notify_all();
+}
+
+static void StressDataCallback(uint16_t /* length */, uint8_t* data) {
+  bool fill = false;
+  {
+    std::lock_guard<std::mutex> lock(sMutex);
+    if ((data[0] & 0xe0) == 0x40) {
+      sResponses++;
+    } else if ((data[0] & 0xe0) == 0x00) {
+      sDataPackets++;
+      fill = sFillArmed;
+      sFillArmed = false;
+    }
+    sCond.notify_all();
+  }
+  if (fill) FillThenSendFromWorker();
+}
+
+template <class Predicate>
+static bool WaitFor(Predicate done) {
+  std::unique_lock<std::mutex> lock(sMutex);
+  return sCond.wait_for(lock, STRESS_TIMEOUT, done);
+}
+
+/**
+ * One round: a data packet whose echo makes the worker run
+ * FillThenSendFromWorker(), then every packet queued must come back.
+ * @return true if the round completed
+ */
+static bool RunRound(int round) {
+  uint64_t expected;
+  {
+    std::lock_guard<std::mutex> lock(sMutex);
+    sFillArmed = true;
+    sRoundDone = false;
+    expected = sDataPackets + 1;
+  }
+  if (!HalSendDownstream(sHal, kDataPacket, sizeof(kDataPacket)) ||
+      !WaitFor([] { return sRoundDone; })) {
+    // The worker may be blocked for good: the HAL cannot be closed.
+    fprintf(stderr, "round %d: the worker thread did not complete\n", round);
+    return false;
+  }
+  {
+    std::lock_guard<std::mutex> lock(sMutex);
+    expected += sWriterFrames + sWorkerSent;
+    sWriterFrames = 0;
+    if (sWorkerSent != STRESS_WORKER_FRAMES) {
+      fprintf(stderr, "round %d: the worker sent %d of %d frames\n", round,
+              sWorkerSent, STRESS_WORKER_FRAMES);
+      return false;
+    }
+    sWorkerSent = 0;
+  }
+  if (!WaitFor([expected] { return sDataPackets >= expected; })) {
+    fprintf(stderr, "round %d: %llu data packets, %llu expected\n", round,
+            (unsigned long long)sDataPackets, (unsigned long long)expected);
+    return false;
+  }
+  return true;
+}
+
+/*
+ * The HAL reads its configuration from the working directory (see the
+ * nfc_nci.st21nfc.loopback library).
+ */
+static bool PrepareConfiguration() {
+  const char* tmp = getenv("TMPDIR");
+  std::string dir = std::string(tmp ? tmp : "/data/local/tmp") +
+                    "/st21nfc_pool_stress.XXXXXX";
+  FILE* conf;
+
+  if (mkdtemp(&dir[0]) == nullptr || chdir(dir.c_str()) != 0) {
+    fprintf(stderr, "cannot enter %s\n", dir.c_str());
+    return false;
+  }
+  conf = fopen("libnfc-hal-st.conf", "w");
+  if (conf == nullptr) {
+    fprintf(stderr, "cannot write the configuration in %s\n", dir.c_str());
+    return false;
+  }
+  fprintf(conf,
+          "STNFC_HAL_LOGLEVEL=1\n"
+          "STNFC_FW_PATH_STORAGE=\"%s\"\n"
+          "STNFC_FW_BIN_NAME=\"/none.bin\"\n"
+          "STNFC_FW_CONF_NAME=\"/none_conf.bin\"\n"
+          "HAL_EVENT_LOG_DEBUG_ENABLED=0\n"
+          "HAL_EVENT_LOG_STORAGE=\"%s\"\n",
+          dir.c_str(), dir.c_str());
+  fclose(conf);
+  return true;
+}
+
+int main(int argc, char** argv) {
+  static const uint8_t kCoreReset[] = {0x20, 0x00, 0x01, 0x01};
+  static const uint8_t kCoreInit[] = {0x20, 0x01, 0x02, 0x00, 0x00};
+  st21nfc_dev_t dev = {};
+  int rounds = 20;
+  int failures = 0;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strncmp(argv[i], "--rounds=", 9)) {
+      rounds = atoi(argv[i] + 9);
+    } else if (!strncmp(argv[i], "--writers=", 10)) {
+      sWriters = atoi(argv[i] + 10);
+    } else {
+      fprintf(stderr, "usage: %s [--rounds=N] [--writers=N]\n", argv[0]);
+      return 1;
+    }
+  }
+  if (rounds < 1 || sWriters < 1 || !PrepareConfiguration()) return 1;
+
+  sNfcc.setDataResponseLength(STRESS_DATA_PAYLOAD);
+  if (!sNfcc.start()) {
+    fprintf(stderr, "fake NFCC failed to start\n");
+    return 1;
+  }
+  snprintf(StNfcContext::current()->transport.devNode,
+           sizeof(StNfcContext::current()->transport.devNode), "%s",
+           sNfcc.devicePath().c_str());
+
+  if (!hal_wrapper_open(&dev, StressStackCallback, StressDataCallback,
+                        &sHal) ||
+      !WaitFor([] { return sOpenDone; })) {
+    fprintf(stderr, "open failed\n");
+    return 1;
+  }
+  if (!HalSendDownstream(sHal, kCoreReset, sizeof(kCoreReset)) ||
+      !WaitFor([] { return sResponses >= 1; }) ||
+      !HalSendDownstream(sHal, kCoreInit, sizeof(kCoreInit)) ||
+      !WaitFor([] { return sResponses >= 2; })) {
+    fprintf(stderr, "NFCC initialization failed\n");
+    return 1;
+  }
+
+  for (int round = 0; round < rounds; round++) {
+    if (!RunRound(round)) {
+      // Leave without closing: the HAL threads may never return.
+      _exit(1);
+    }
+    {
+      std::lock_guard<std::mutex> lock(sMutex);
+      if (sWriterRefusals == 0) failures++;
+    }
+  }
+
+  hal_wrapper_close(1, 0);
+  if (!WaitFor([] { return sCloseDone; })) failures++;
+  sNfcc.stop();
+  printf("%d rounds, %d writers, %llu data packets, %d failures\n", rounds,
+         sWriters, (unsigned long long)sDataPackets, failures);
+  return failures ? 1 : 0;
+}
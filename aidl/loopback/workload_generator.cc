@@ -0,0 +1,781 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Synthetic NCI workloads driven through the HAL: the frames of each profile
+// (see nci_workload.h) go down through StNfc_hal_write() and up from a fake
+// NFCC on a pseudo terminal, as in st21nfc_loopback_benchmark. The same seed
+// gives the same frames, so the HAL logs (--log-level), its metrics and
+// timeline (--metrics) and the JSON results of two builds can be compared.
+//
+// Usage: st21nfc_workload_generator [--profile=NAME] [--count=N] [--seed=S]
+//                                   [--apdu-size=N] [--rate=N] [--burst=N]
+//                                   [--noise-rate=N] [--log-level=N]
+//                                   [--metrics=FILE] [--label=TEXT]
+//                                   [--output=FILE]
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "StNfc_hal_api.h"
+#include "fake_nfcc.h"
+#include "nci_workload.h"
+
+#define WORKLOAD_TIMEOUT std::chrono::seconds(2)
+// Largest payload of an NCI packet, the APDU sizes are bound by it.
+#define WORKLOAD_MAX_APDU_SIZE 255
+
+typedef bool (*FrameMatcher)(const uint8_t* data, uint16_t length);
+
+struct Options {
+  std::string profile = "all";
+  uint64_t count = 1000;
+  uint64_t seed = 1;
+  size_t apduSize = 32;
+  uint32_t rate = 1000;
+  uint32_t burst = 4;
+  uint32_t noiseRate = 0;
+  int logLevel = 1;
+  std::string metrics;
+  std::string label;
+  std::string output;
+};
+
+static struct {
+  std::mutex mutex;
+  std::condition_variable cond;
+  bool openDone;
+  uint8_t openStatus;
+  bool closeDone;
+
+  // Upstream frames accepted by match, and when the stack got them. For the
+  // polling loop frames, also the time of their field on TLV.
+  FrameMatcher match;
+  std::vector<uint64_t> matched;
+  std::vector<uint32_t> matchedPollingTimes;
+  uint64_t txFrames;
+  uint64_t txBytes;
+  uint64_t rxFrames;
+  uint64_t rxBytes;
+} sLoop;
+
+static FakeNfcc sNfcc;
+
+struct Result {
+  explicit Result(NciWorkload::Profile p) : profile(p) {}
+
+  NciWorkload::Profile profile;
+  uint64_t issued = 0;
+  uint64_t completed = 0;
+  uint64_t elapsedNs = 0;
+  uint64_t cpuNs = 0;
+  uint64_t txFrames = 0;
+  uint64_t txBytes = 0;
+  uint64_t rxFrames = 0;
+  uint64_t rxBytes = 0;
+  uint32_t digest = 2166136261u;  // FNV-1a of the generated frames
+  std::vector<uint64_t> latencies;
+  bool timedOut = false;
+};
+
+static uint64_t NowNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static uint64_t ProcessCpuNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void Digest(const std::vector<uint8_t>& frame, Result* result) {
+  for (uint8_t b : frame) result->digest = (result->digest ^ b) * 16777619u;
+}
+
+static bool IsCoreResetRsp(const uint8_t* data, uint16_t length) {
+  return length >= 4 && data[0] == 0x40 && data[1] == 0x00;
+}
+
+static bool IsCoreInitRsp(const uint8_t* data, uint16_t length) {
+  return length >= 4 && data[0] == 0x40 && data[1] == 0x01;
+}
+
+static bool IsRsp(const uint8_t* data, uint16_t length) {
+  return length >= 3 && (data[0] & 0xE0) == 0x40;
+}
+
+static bool IsObserverRsp(const uint8_t* data, uint16_t length) {
+  return length >= 5 && data[0] == 0x4f && data[1] == 0x0c;
+}
+
+static bool IsRfDataPacket(const uint8_t* data, uint16_t length) {
+  return length >= 3 && data[0] == 0x00;
+}
+
+static bool IsRfCreditsNtf(const uint8_t* data, uint16_t length) {
+  return length >= 6 && data[0] == 0x60 && data[1] == 0x06 && data[4] == 0x00;
+}
+
+static bool IsHciCreditsNtf(const uint8_t* data, uint16_t length) {
+  return length >= 6 && data[0] == 0x60 && data[1] == 0x06 &&
+         data[4] == NCI_WORKLOAD_HCI_CONN_ID;
+}
+
+static bool IsT3tPollingRsp(const uint8_t* data, uint16_t length) {
+  return length >= 4 && data[0] == 0x41 && data[1] == 0x08;
+}
+
+static bool IsT3tPollingNtf(const uint8_t* data, uint16_t length) {
+  return length >= 5 && data[0] == 0x61 && data[1] == 0x08;
+}
+
+static bool IsPollingLoopNtf(const uint8_t* data, uint16_t length) {
+  return length >= 4 && data[0] == 0x6f && data[1] == 0x0c && data[3] == 0x03;
+}
+
+static void WorkloadStackCallback(nfc_event_t event, nfc_status_t status) {
+  std::lock_guard<std::mutex> lock(sLoop.mutex);
+  if (event == HAL_NFC_OPEN_CPLT_EVT) {
+    sLoop.openDone = true;
+    sLoop.openStatus = status;
+  } else if (event == HAL_NFC_CLOSE_CPLT_EVT) {
+    sLoop.closeDone = true;
+  }
+  sLoop.cond.notify_all();
+}
+
+/**
+ * Time of the field on TLV opening a polling loop frame given to the stack
+ * (6f 0c, 03, then type, flags, length and time of each TLV).
+ * @return The time in us, 0 if the frame has no TLV
+ */
+static uint32_t ReceivedPollingTime(const uint8_t* data, uint16_t length) {
+  if (length < 11) return 0;
+  return (uint32_t)data[7] << 24 | data[8] << 16 | data[9] << 8 | data[10];
+}
+
+/**
+ * Same time, for a polling loop frame of the workload (see
+ * NciWorkload::pollingLoopNtf()), converted from the 3.95 us unit of the
+ * ST54L as handlePollingLoopData() does. The workload times only grow, so
+ * that the frames delivered can be told from the ones the HAL dropped.
+ */
+static uint32_t SentPollingTime(const std::vector<uint8_t>& frame) {
+  uint32_t fwTime = (uint32_t)frame[8] << 24 | frame[9] << 16 |
+                    frame[10] << 8 | frame[11];
+  return fwTime * 1024 / 259;
+}
+
+static void WorkloadDataCallback(uint16_t length, uint8_t* data) {
+  uint64_t now = NowNs();
+  std::lock_guard<std::mutex> lock(sLoop.mutex);
+
+  sLoop.rxFrames++;
+  sLoop.rxBytes += length;
+  if (sLoop.match && sLoop.match(data, length)) {
+    sLoop.matched.push_back(now);
+    if (IsPollingLoopNtf(data, length)) {
+      sLoop.matchedPollingTimes.push_back(ReceivedPollingTime(data, length));
+    }
+    sLoop.cond.notify_all();
+  }
+}
+
+static bool WorkloadWrite(const std::vector<uint8_t>& frame) {
+  {
+    std::lock_guard<std::mutex> lock(sLoop.mutex);
+    sLoop.txFrames++;
+    sLoop.txBytes += frame.size();
+  }
+  return StNfc_hal_write(frame.size(), frame.data()) == (int)frame.size();
+}
+
+// Frames coming from the NFCC are counted on the way up only.
+static bool WorkloadInject(const std::vector<uint8_t>& frame) {
+  return sNfcc.inject(frame.data(), frame.size());
+}
+
+/**
+ * Start accepting the upstream frames of |match|, dropping the ones matched
+ * so far.
+ */
+static void Expect(FrameMatcher match) {
+  std::lock_guard<std::mutex> lock(sLoop.mutex);
+  sLoop.match = match;
+  sLoop.matched.clear();
+  sLoop.matchedPollingTimes.clear();
+}
+
+/**
+ * Wait for |count| frames accepted since Expect().
+ * @return the times they were received, fewer on timeout
+ */
+static std::vector<uint64_t> WaitMatched(size_t count) {
+  std::unique_lock<std::mutex> lock(sLoop.mutex);
+  sLoop.cond.wait_for(lock, WORKLOAD_TIMEOUT,
+                      [count] { return sLoop.matched.size() >= count; });
+  return sLoop.matched;
+}
+
+/**
+ * WaitMatched() for polling loop frames.
+ * @param count Number of frames
+ * @param times Filled with the time of their field on TLV
+ * @return the times they were received, fewer on timeout
+ */
+static std::vector<uint64_t> WaitPollingLoops(size_t count,
+                                              std::vector<uint32_t>* times) {
+  std::vector<uint64_t> received = WaitMatched(count);
+  std::lock_guard<std::mutex> lock(sLoop.mutex);
+
+  *times = sLoop.matchedPollingTimes;
+  return received;
+}
+
+static bool WriteAndWait(const std::vector<uint8_t>& cmd, FrameMatcher match) {
+  Expect(match);
+  return WorkloadWrite(cmd) && !WaitMatched(1).empty();
+}
+
+/**
+ * Bring the HAL up the way the NFC stack does: open, then CORE_RESET and
+ * CORE_INIT.
+ */
+static bool OpenHal() {
+  if (StNfc_hal_open(WorkloadStackCallback, WorkloadDataCallback) != 0) {
+    fprintf(stderr, "StNfc_hal_open failed\n");
+    return false;
+  }
+  {
+    std::unique_lock<std::mutex> lock(sLoop.mutex);
+    if (!sLoop.cond.wait_for(lock, WORKLOAD_TIMEOUT,
+                             [] { return sLoop.openDone; }) ||
+        sLoop.openStatus != HAL_NFC_STATUS_OK) {
+      fprintf(stderr, "HAL_NFC_OPEN_CPLT_EVT not received or failed\n");
+      return false;
+    }
+  }
+  if (!WriteAndWait({0x20, 0x00, 0x01, 0x01}, IsCoreResetRsp) ||
+      !WriteAndWait({0x20, 0x01, 0x02, 0x00, 0x00}, IsCoreInitRsp)) {
+    fprintf(stderr, "NFCC initialization failed\n");
+    return false;
+  }
+  return true;
+}
+
+static void CloseHal() {
+  StNfc_hal_close(NFC_MODE_OFF);
+  std::unique_lock<std::mutex> lock(sLoop.mutex);
+  sLoop.cond.wait_for(lock, WORKLOAD_TIMEOUT, [] { return sLoop.closeDone; });
+}
+
+/**
+ * Latency of each transaction, from |sent| to |received|: both are in the
+ * order of the transactions, the HAL keeps the order of the frames.
+ */
+static void AddLatencies(const std::vector<uint64_t>& sent,
+                         const std::vector<uint64_t>& received,
+                         Result* result) {
+  size_t count = std::min(sent.size(), received.size());
+
+  for (size_t i = 0; i < count; i++) {
+    result->latencies.push_back(received[i] - sent[i]);
+  }
+  result->completed += count;
+}
+
+/**
+ * Latency of each polling loop frame delivered to the stack. The HAL keeps
+ * their order but may drop some: a frame received is paired with the next
+ * one sent of the same field on time, the ones skipped were dropped.
+ */
+static void AddPollingLoopLatencies(const std::vector<uint64_t>& sent,
+                                    const std::vector<uint32_t>& sentTimes,
+                                    const std::vector<uint64_t>& received,
+                                    const std::vector<uint32_t>& receivedTimes,
+                                    Result* result) {
+  size_t count = std::min(received.size(), receivedTimes.size());
+  size_t s = 0;
+
+  for (size_t r = 0; r < count; r++) {
+    while (s < sent.size() && sentTimes[s] != receivedTimes[r]) s++;
+    if (s == sent.size()) break;
+    result->latencies.push_back(received[r] - sent[s]);
+    result->completed++;
+    s++;
+  }
+}
+
+// C-APDUs of the stack, each answered by the fake NFCC with a R-APDU of the
+// same size and the credit.
+static void RunIsoDep(NciWorkload& workload, const Options& options,
+                      Result* result) {
+  std::vector<uint8_t> frame;
+
+  sNfcc.setDataResponseLength(std::max<size_t>(options.apduSize, 2));
+  for (uint64_t i = 0; i < options.count && !result->timedOut; i++) {
+    workload.commandApdu(options.apduSize, &frame);
+    Digest(frame, result);
+    Expect(IsRfDataPacket);
+    std::vector<uint64_t> sent = {NowNs()};
+    result->issued++;
+    WorkloadWrite(frame);
+    std::vector<uint64_t> received = WaitMatched(1);
+    AddLatencies(sent, received, result);
+    result->timedOut = received.empty();
+  }
+}
+
+// Bursts of C-APDUs of a reader, the stack answering each once the burst is
+// received: latency is from the C-APDU sent by the NFCC to the credit of its
+// R-APDU.
+static void RunHce(NciWorkload& workload, const Options& options,
+                   Result* result) {
+  std::vector<uint8_t> frame;
+  uint32_t burst = std::max<uint32_t>(options.burst, 1);
+
+  sNfcc.setDataEcho(false);
+  for (uint64_t i = 0; i < options.count && !result->timedOut; i += burst) {
+    size_t n = std::min<uint64_t>(burst, options.count - i);
+    std::vector<uint64_t> sent;
+
+    Expect(IsRfDataPacket);
+    for (size_t b = 0; b < n; b++) {
+      workload.commandApdu(options.apduSize, &frame);
+      Digest(frame, result);
+      sent.push_back(NowNs());
+      result->issued++;
+      WorkloadInject(frame);
+    }
+    if (WaitMatched(n).size() < n) {
+      result->timedOut = true;
+      break;
+    }
+    Expect(IsRfCreditsNtf);
+    for (size_t b = 0; b < n; b++) {
+      workload.responseApdu(options.apduSize, &frame);
+      Digest(frame, result);
+      WorkloadWrite(frame);
+    }
+    std::vector<uint64_t> received = WaitMatched(n);
+    AddLatencies(sent, received, result);
+    result->timedOut = received.size() < n;
+  }
+  sNfcc.setDataEcho(true);
+}
+
+// RF_T3T_POLLING_CMD, then the NTF of the cards found.
+static void RunFelica(NciWorkload& workload, const Options& options,
+                      Result* result) {
+  std::vector<uint8_t> cmd, ntf;
+
+  for (uint64_t i = 0; i < options.count && !result->timedOut; i++) {
+    workload.felicaPollingCmd(&cmd);
+    workload.felicaPollingNtf(&ntf);
+    Digest(cmd, result);
+    Digest(ntf, result);
+    std::vector<uint64_t> sent = {NowNs()};
+    result->issued++;
+    if (!WriteAndWait(cmd, IsT3tPollingRsp)) {
+      result->timedOut = true;
+      break;
+    }
+    Expect(IsT3tPollingNtf);
+    WorkloadInject(ntf);
+    std::vector<uint64_t> received = WaitMatched(1);
+    AddLatencies(sent, received, result);
+    result->timedOut = received.empty();
+  }
+}
+
+// Polling loops at the rate of the FW in observe mode, not waiting for the
+// stack: the ones not delivered are the drops.
+static void RunObserve(NciWorkload& workload, const Options& options,
+                       Result* result) {
+  std::vector<uint8_t> frame;
+  std::vector<uint64_t> sent;
+  std::vector<uint32_t> sentTimes, receivedTimes;
+  NciWorkloadPacer pacer(options.rate);
+
+  if (!WriteAndWait({0x2f, 0x0c, 0x02, 0x02, 0x01}, IsObserverRsp)) {
+    result->timedOut = true;
+    return;
+  }
+  Expect(IsPollingLoopNtf);
+  sent.reserve(options.count);
+  sentTimes.reserve(options.count);
+  for (uint64_t i = 0; i < options.count; i++) {
+    workload.pollingLoopNtf(&frame);
+    Digest(frame, result);
+    sentTimes.push_back(SentPollingTime(frame));
+    pacer.wait();
+    sent.push_back(NowNs());
+    result->issued++;
+    WorkloadInject(frame);
+  }
+  std::vector<uint64_t> received =
+      WaitPollingLoops(sent.size(), &receivedTimes);
+  AddPollingLoopLatencies(sent, sentTimes, received, receivedTimes, result);
+  if (!WriteAndWait({0x2f, 0x0c, 0x02, 0x02, 0x00}, IsObserverRsp)) {
+    result->timedOut = true;
+  }
+}
+
+// EVT_TRANSMIT_DATA to the eSE, completed by the credit of the HCI
+// connection.
+static void RunEseHci(NciWorkload& workload, const Options& options,
+                      Result* result) {
+  std::vector<uint8_t> frame;
+
+  sNfcc.setDataResponseLength(std::max<size_t>(options.apduSize, 2));
+  for (uint64_t i = 0; i < options.count && !result->timedOut; i++) {
+    workload.hciApdu(options.apduSize, &frame);
+    Digest(frame, result);
+    Expect(IsHciCreditsNtf);
+    std::vector<uint64_t> sent = {NowNs()};
+    result->issued++;
+    WorkloadWrite(frame);
+    std::vector<uint64_t> received = WaitMatched(1);
+    AddLatencies(sent, received, result);
+    result->timedOut = received.empty();
+  }
+}
+
+// FW traces nobody waits for, then one command: its response comes after
+// them, once they all went through the HAL.
+static void RunFwTrace(NciWorkload& workload, const Options& options,
+                       Result* result) {
+  std::vector<uint8_t> frame;
+  NciWorkloadPacer pacer(options.rate);
+
+  for (uint64_t i = 0; i < options.count; i++) {
+    workload.fwTraceNtf(&frame);
+    Digest(frame, result);
+    pacer.wait();
+    result->issued++;
+    WorkloadInject(frame);
+  }
+  std::vector<uint64_t> sent = {NowNs()};
+  Expect(IsRsp);
+  WorkloadWrite({0x20, 0x03, 0x02, 0x01, 0x00});
+  std::vector<uint64_t> received = WaitMatched(1);
+  AddLatencies(sent, received, result);
+  result->completed = received.empty() ? 0 : result->issued;
+  result->timedOut = received.empty();
+}
+
+static void RunProfile(NciWorkload::Profile profile, const Options& options,
+                       std::vector<Result>* results) {
+  NciWorkload workload(options.seed, profile);
+  Result result(profile);
+  uint64_t cpuStart, nfccStart, start;
+
+  {
+    std::lock_guard<std::mutex> lock(sLoop.mutex);
+    sLoop.txFrames = sLoop.txBytes = 0;
+    sLoop.rxFrames = sLoop.rxBytes = 0;
+  }
+  cpuStart = ProcessCpuNs();
+  nfccStart = sNfcc.cpuTimeNs();
+  start = NowNs();
+
+  switch (profile) {
+    case NciWorkload::PROFILE_ISO_DEP:
+      RunIsoDep(workload, options, &result);
+      break;
+    case NciWorkload::PROFILE_HCE:
+      RunHce(workload, options, &result);
+      break;
+    case NciWorkload::PROFILE_FELICA:
+      RunFelica(workload, options, &result);
+      break;
+    case NciWorkload::PROFILE_OBSERVE:
+      RunObserve(workload, options, &result);
+      break;
+    case NciWorkload::PROFILE_ESE_HCI:
+      RunEseHci(workload, options, &result);
+      break;
+    case NciWorkload::PROFILE_FW_TRACE:
+      RunFwTrace(workload, options, &result);
+      break;
+    default:
+      break;
+  }
+
+  uint64_t elapsed = NowNs() - start;
+  uint64_t cpu = ProcessCpuNs() - cpuStart;
+  uint64_t nfccCpu = sNfcc.cpuTimeNs() - nfccStart;
+
+  Expect(nullptr);
+  {
+    std::lock_guard<std::mutex> lock(sLoop.mutex);
+    result.txFrames = sLoop.txFrames;
+    result.txBytes = sLoop.txBytes;
+    result.rxFrames = sLoop.rxFrames;
+    result.rxBytes = sLoop.rxBytes;
+  }
+  result.elapsedNs = elapsed;
+  result.cpuNs = cpu > nfccCpu ? cpu - nfccCpu : 0;
+  results->push_back(std::move(result));
+}
+
+/*
+ * FW trace noise under the other profiles: PROP_FW_DBG_NTF pushed by the
+ * NFCC at |rate| per second until stopped. Its frames are those of the
+ * fw_trace profile, where they fall between the others depends on timing.
+ */
+class NoiseInjector {
+ public:
+  NoiseInjector(uint64_t seed, uint32_t rate)
+      : mWorkload(seed, NciWorkload::PROFILE_FW_TRACE),
+        mRate(rate),
+        mStop(false),
+        mInjected(0) {}
+
+  void start() {
+    if (mRate) mThread = std::thread(&NoiseInjector::run, this);
+  }
+
+  void stop() {
+    mStop = true;
+    if (mThread.joinable()) mThread.join();
+  }
+
+  uint64_t injected() const { return mInjected; }
+
+ private:
+  void run() {
+    std::vector<uint8_t> frame;
+    NciWorkloadPacer pacer(mRate);
+
+    while (!mStop) {
+      mWorkload.fwTraceNtf(&frame);
+      pacer.wait();
+      WorkloadInject(frame);
+      mInjected++;
+    }
+  }
+
+  NciWorkload mWorkload;
+  uint32_t mRate;
+  std::atomic<bool> mStop;
+  std::atomic<uint64_t> mInjected;
+  std::thread mThread;
+};
+
+static double Percentile(const std::vector<uint64_t>& sorted, int percent) {
+  if (sorted.empty()) return 0;
+  size_t index = std::min(sorted.size() - 1, sorted.size() * percent / 100);
+  return sorted[index] / 1000.0;
+}
+
+static std::string ToJson(const Options& options, uint64_t noiseFrames,
+                          std::vector<Result>& results) {
+  std::ostringstream oss;
+
+  oss << "{\"benchmark\":\"st21nfc_workload\",\"version\":1,\"label\":\""
+      << options.label << "\",\"seed\":" << options.seed
+      << ",\"apdu_size\":" << options.apduSize << ",\"rate\":" << options.rate
+      << ",\"burst\":" << options.burst
+      << ",\"noise_rate\":" << options.noiseRate
+      << ",\"noise_frames\":" << noiseFrames << ",\"profiles\":[";
+  for (size_t i = 0; i < results.size(); i++) {
+    Result& r = results[i];
+    double seconds = r.elapsedNs / 1e9;
+    uint64_t frames = r.txFrames + r.rxFrames;
+    uint64_t sum = 0;
+    char digest[9];
+
+    std::sort(r.latencies.begin(), r.latencies.end());
+    for (uint64_t l : r.latencies) sum += l;
+    snprintf(digest, sizeof(digest), "%08x", r.digest);
+    oss << (i ? "," : "") << "\n{\"name\":\""
+        << NciWorkload::profileName(r.profile) << "\",\"digest\":\"" << digest
+        << "\",\"issued\":" << r.issued << ",\"completed\":" << r.completed
+        << ",\"dropped\":" << r.issued - r.completed
+        << ",\"timed_out\":" << (r.timedOut ? "true" : "false")
+        << ",\"elapsed_s\":" << seconds << ",\"tx_frames\":" << r.txFrames
+        << ",\"tx_bytes\":" << r.txBytes << ",\"rx_frames\":" << r.rxFrames
+        << ",\"rx_bytes\":" << r.rxBytes << ",\"frames_per_s\":"
+        << (seconds > 0 ? frames / seconds : 0) << ",\"latency_us\":{\"mean\":"
+        << (r.latencies.empty() ? 0 : sum / 1000.0 / r.latencies.size())
+        << ",\"p50\":" << Percentile(r.latencies, 50)
+        << ",\"p90\":" << Percentile(r.latencies, 90)
+        << ",\"p99\":" << Percentile(r.latencies, 99)
+        << ",\"max\":" << Percentile(r.latencies, 100)
+        << "},\"cpu_us_per_frame\":"
+        << (frames ? r.cpuNs / 1000.0 / frames : 0) << "}";
+  }
+  oss << "\n]}\n";
+  return oss.str();
+}
+
+/*
+ * The HAL reads its configuration from the working directory (see the
+ * nfc_nci.st21nfc.loopback library). With a log level of 3 or more, DispHal
+ * logs every frame of the workload.
+ */
+static bool PrepareConfiguration(const std::string& devicePath, int logLevel) {
+  const char* tmp = getenv("TMPDIR");
+  std::string dir = std::string(tmp ? tmp : "/data/local/tmp") +
+                    "/st21nfc_workload.XXXXXX";
+  FILE* conf;
+
+  if (mkdtemp(&dir[0]) == nullptr || chdir(dir.c_str()) != 0) {
+    fprintf(stderr, "cannot enter %s\n", dir.c_str());
+    return false;
+  }
+  conf = fopen("libnfc-hal-st.conf", "w");
+  if (conf == nullptr) {
+    fprintf(stderr, "cannot write the configuration in %s\n", dir.c_str());
+    return false;
+  }
+  fprintf(conf,
+          "STNFC_HAL_LOGLEVEL=%d\n"
+          "ST_NFC_DEV_NODE=\"%s\"\n"
+          "STNFC_FW_PATH_STORAGE=\"%s\"\n"
+          "STNFC_FW_BIN_NAME=\"/none.bin\"\n"
+          "STNFC_FW_CONF_NAME=\"/none_conf.bin\"\n"
+          "HAL_EVENT_LOG_DEBUG_ENABLED=0\n"
+          "HAL_EVENT_LOG_STORAGE=\"%s\"\n",
+          logLevel, devicePath.c_str(), dir.c_str(), dir.c_str());
+  fclose(conf);
+  return true;
+}
+
+/**
+ * Write what the HAL gives to dumpsys, metrics and timeline included.
+ * @return false if |path| cannot be written
+ */
+static bool DumpMetrics(const std::string& path) {
+  int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+  if (fd < 0) {
+    fprintf(stderr, "cannot write %s\n", path.c_str());
+    return false;
+  }
+  StNfc_hal_dump(fd);
+  close(fd);
+  return true;
+}
+
+static void Usage(const char* name) {
+  fprintf(stderr,
+          "usage: %s [--profile=all|iso_dep|hce|felica|observe|ese_hci|"
+          "fw_trace] [--count=N] [--seed=S] [--apdu-size=N] [--rate=N] "
+          "[--burst=N] [--noise-rate=N] [--log-level=N] [--metrics=FILE] "
+          "[--label=TEXT] [--output=FILE]\n",
+          name);
+}
+
+int main(int argc, char** argv) {
+  Options options;
+  std::vector<NciWorkload::Profile> profiles;
+  std::vector<Result> results;
+  bool ok = true;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strncmp(argv[i], "--profile=", 10)) {
+      options.profile = argv[i] + 10;
+    } else if (!strncmp(argv[i], "--count=", 8)) {
+      options.count = strtoull(argv[i] + 8, nullptr, 0);
+    } else if (!strncmp(argv[i], "--seed=", 7)) {
+      options.seed = strtoull(argv[i] + 7, nullptr, 0);
+    } else if (!strncmp(argv[i], "--apdu-size=", 12)) {
+      options.apduSize = strtoul(argv[i] + 12, nullptr, 0);
+      if (options.apduSize > WORKLOAD_MAX_APDU_SIZE) {
+        fprintf(stderr, "--apdu-size is at most %d\n", WORKLOAD_MAX_APDU_SIZE);
+        return 1;
+      }
+    } else if (!strncmp(argv[i], "--rate=", 7)) {
+      options.rate = strtoul(argv[i] + 7, nullptr, 0);
+    } else if (!strncmp(argv[i], "--burst=", 8)) {
+      options.burst = strtoul(argv[i] + 8, nullptr, 0);
+    } else if (!strncmp(argv[i], "--noise-rate=", 13)) {
+      options.noiseRate = strtoul(argv[i] + 13, nullptr, 0);
+    } else if (!strncmp(argv[i], "--log-level=", 12)) {
+      options.logLevel = atoi(argv[i] + 12);
+    } else if (!strncmp(argv[i], "--metrics=", 10)) {
+      options.metrics = argv[i] + 10;
+    } else if (!strncmp(argv[i], "--label=", 8)) {
+      options.label = argv[i] + 8;
+    } else if (!strncmp(argv[i], "--output=", 9)) {
+      options.output = argv[i] + 9;
+    } else {
+      Usage(argv[0]);
+      return 1;
+    }
+  }
+  if (options.profile == "all") {
+    for (int p = 0; p < NciWorkload::PROFILE_MAX; p++) {
+      profiles.push_back((NciWorkload::Profile)p);
+    }
+  } else {
+    NciWorkload::Profile profile;
+    if (!NciWorkload::profileFromName(options.profile.c_str(), &profile)) {
+      Usage(argv[0]);
+      return 1;
+    }
+    profiles.push_back(profile);
+  }
+
+  if (!sNfcc.start() ||
+      !PrepareConfiguration(sNfcc.devicePath(), options.logLevel) ||
+      !OpenHal()) {
+    return 1;
+  }
+
+  NoiseInjector noise(options.seed, options.noiseRate);
+  noise.start();
+  for (NciWorkload::Profile profile : profiles) {
+    RunProfile(profile, options, &results);
+    ok = !results.back().timedOut && ok;
+  }
+  noise.stop();
+
+  if (!options.metrics.empty()) ok = DumpMetrics(options.metrics) && ok;
+  CloseHal();
+  sNfcc.stop();
+
+  std::string json = ToJson(options, noise.injected(), results);
+  if (options.output.empty()) {
+    fputs(json.c_str(), stdout);
+  } else {
+    FILE* f = fopen(options.output.c_str(), "w");
+    if (f == nullptr) {
+      fprintf(stderr, "cannot write %s\n", options.output.c_str());
+      return 1;
+    }
+    fputs(json.c_str(), f);
+    fclose(f);
+  }
+  return ok ? 0 : 1;
+}
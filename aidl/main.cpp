@@ -21,6 +21,7 @@
 #include <dlfcn.h>
 
 #include "Nfc.h"
+#include "hal_binder_calls.h"
 
 #if defined(ST_LIB_32)
 #define VENDOR_LIB_PATH "/vendor/lib/"
@@ -55,10 +56,17 @@ int main() {
       LOG(INFO) << ("ST NFC HAL STReset Done.");
     }
   }
-  if (!ABinderProcess_setThreadPoolMaxThreadCount(1)) {
+  // The main thread joins the pool, the others are started by the driver
+  // when needed. dump and getConfig can then run while a write is blocked.
+  uint32_t threads = HalBinderCalls::threadCount();
+  LOG(INFO) << "binder threads: " << threads;
+  if (!ABinderProcess_setThreadPoolMaxThreadCount(threads - 1)) {
     LOG(INFO) << "failed to set thread pool max thread count";
     return 1;
   }
+  if (threads > 1) {
+    ABinderProcess_startThreadPool();
+  }
   std::shared_ptr<Nfc> nfc_service = ndk::SharedRefBase::make<Nfc>();
 
   const std::string instance = std::string() + Nfc::descriptor + "/default";
@@ -23,16 +23,22 @@
 #include "config.h"
 
 #include <android-base/properties.h>
+#include <ctype.h>
 #include <log/log.h>
 #include <stdio.h>
 #include <sys/stat.h>
 
 #include <list>
+#include <mutex>
 #include <string>
 #include <vector>
 
 #include "android_logmsg.h"
-const char alternative_config_path[] = "";
+// Host builds (benchmarks) point this to their own configuration directory.
+#ifndef ST21NFC_ALTERNATIVE_CONFIG_PATH
+#define ST21NFC_ALTERNATIVE_CONFIG_PATH ""
+#endif
+const char alternative_config_path[] = ST21NFC_ALTERNATIVE_CONFIG_PATH;
 const char* transport_config_paths[] = {"/odm/etc/", "/vendor/etc/", "/etc/"};
 
 const int transport_config_path_size =
@@ -326,7 +332,7 @@ bool CNfcConfig::readConfig(const char* name, bool bResetContent) {
           state = END_LINE;
           pParam = new CNfcParam(token.c_str(), strValue);
           add(pParam);
-        } else if (isPrintable(c))
+        } else if (isprint((unsigned char)c))
           strValue.push_back(c);
         break;
       case END_LINE:
@@ -369,13 +375,17 @@ CNfcConfig::~CNfcConfig() {}
 **
 ** Function:    CNfcConfig::GetInstance()
 **
-** Description: get class singleton object
+** Description: get class singleton object, loading the configuration
+**              on first use. Controllers opened in parallel may race for
+**              that first load, the others wait until it is complete.
 **
 ** Returns:     none
 **
 *******************************************************************************/
 CNfcConfig& CNfcConfig::GetInstance() {
   static CNfcConfig theInstance;
+  static std::mutex loadMutex;
+  std::lock_guard<std::mutex> lock(loadMutex);
 
   if (theInstance.size() == 0 && theInstance.mValidFile) {
     string strPath;
@@ -668,6 +678,17 @@ extern "C" int GetStrValue(const char* name, char* pValue, unsigned long l) {
   return rConfig.getValue(name, pValue, len);
 }
 
+/*******************************************************************************
+**
+** Function:    IsConfigFound
+**
+** Description: API function telling if a configuration file was read
+**
+** Returns:     True if settings were read, otherwise False.
+**
+*******************************************************************************/
+extern "C" int IsConfigFound() { return !CNfcConfig::GetInstance().empty(); }
+
 /*******************************************************************************
 **
 ** Function:    GetByteArrayValue()
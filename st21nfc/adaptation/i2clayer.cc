@@ -22,6 +22,7 @@
 #include <assert.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <hardware/nfc.h>
 #include <limits.h>
 #include <linux/input.h> /* not required for all builds */
 #include <poll.h>
@@ -34,7 +35,10 @@
 
 #include "android_logmsg.h"
 #include "hal_config.h"
+#include "hal_context.h"
 #include "hal_event_logger.h"
+#include "hal_metrics.h"
+#include "hal_threads.h"
 #include "halcore.h"
 #include "halcore_private.h"
 
@@ -45,25 +49,10 @@
 #define ST21NFC_SET_POLARITY_HIGH _IOR(ST21NFC_MAGIC, 0x05, unsigned int)
 #define ST21NFC_SET_POLARITY_LOW _IOR(ST21NFC_MAGIC, 0x06, unsigned int)
 #define ST21NFC_RECOVERY _IOR(ST21NFC_MAGIC, 0x08, unsigned int)
-#define ST21NFC_CLK_ENABLE _IOR(ST21NFC_MAGIC, 0x11, unsigned int)
-#define ST21NFC_CLK_DISABLE _IOR(ST21NFC_MAGIC, 0x12, unsigned int)
 
 #define LINUX_DBGBUFFER_SIZE 300
 #define I2C_ERROR_COUNT_MAX 50
 
-int fidI2c = 0;
-static int cmdPipe[2] = {0, 0};
-static int notifyResetRequest = 0;
-static bool recovery_mode = false;
-static uint16_t i2c_error_count = 0;
-
-static struct pollfd event_table[3];
-static pthread_t threadHandle = (pthread_t)NULL;
-pthread_mutex_t i2ctransport_mtx = PTHREAD_MUTEX_INITIALIZER;
-
-unsigned long hal_ctrl_clk = 0;
-unsigned long hal_activerw_timer = 0;
-
 /**************************************************************************************************
  *
  *                                      Private API Declaration
@@ -76,6 +65,7 @@ static int SetToRecoveryMode(int fid);
 static int i2cRead(int fid, uint8_t* pvBuffer, int length);
 static int i2cGetGPIOState(int fid);
 static int i2cWrite(int fd, const uint8_t* pvBuffer, int length);
+static void i2cInjectFrames(HalFaultInjector* faults, HALHANDLE hHAL);
 
 /**************************************************************************************************
  *
@@ -86,32 +76,35 @@ static int i2cWrite(int fd, const uint8_t* pvBuffer, int length);
 /**
  * Worker thread for I2C data processing.
  * On exit of this thread, destroy the HAL thread instance.
- * @param arg  Handle of the HAL layer
+ * @param arg  Context of the controller served by the thread
  */
 static void* I2cWorkerThread(void* arg) {
+  StNfcContext* nfc = (StNfcContext*)arg;
+  StNfcContext::bindThread(nfc);
+  I2cTransportContext* ctx = &nfc->transport;
   bool closeThread = false;
-  HALHANDLE hHAL = (HALHANDLE)arg;
+  HALHANDLE hHAL = ctx->hHAL;
   STLOG_HAL_D("echo thread started...\n");
   bool readOk = false;
-  int eventNum = (notifyResetRequest <= 0) ? 2 : 3;
+  int eventNum = (ctx->notifyResetRequest <= 0) ? 2 : 3;
   bool resetting = false;
 
   do {
-    event_table[0].fd = fidI2c;
-    event_table[0].events = POLLIN;
-    event_table[0].revents = 0;
+    ctx->event_table[0].fd = ctx->fidI2c;
+    ctx->event_table[0].events = POLLIN;
+    ctx->event_table[0].revents = 0;
 
-    event_table[1].fd = cmdPipe[0];
-    event_table[1].events = POLLIN;
-    event_table[1].revents = 0;
+    ctx->event_table[1].fd = ctx->cmdPipe[0];
+    ctx->event_table[1].events = POLLIN;
+    ctx->event_table[1].revents = 0;
 
-    event_table[2].fd = notifyResetRequest;
-    event_table[2].events = POLLPRI;
-    event_table[2].revents = 0;
+    ctx->event_table[2].fd = ctx->notifyResetRequest;
+    ctx->event_table[2].events = POLLPRI;
+    ctx->event_table[2].revents = 0;
 
     STLOG_HAL_V("echo thread go to sleep...\n");
 
-    int poll_status = poll(event_table, eventNum, -1);
+    int poll_status = poll(ctx->event_table, eventNum, -1);
 
     if (-1 == poll_status) {
       poll_status = errno;
@@ -123,29 +116,43 @@ static void* I2cWorkerThread(void* arg) {
       break;
     }
 
-    if (event_table[0].revents & POLLIN) {
+    if (ctx->event_table[0].revents & POLLIN) {
       STLOG_HAL_V("echo thread wakeup from chip...\n");
-      uint8_t buffer[300];
       int count = 0;
 
       do {
-        if (recovery_mode) {
+        if (ctx->recovery_mode) {
           break;
         }
+        // Frames are read into a pool buffer, handed over as is to HALCore
+        HalBuffer* rx = HalAllocUpstreamBuffer(hHAL);
+        uint8_t* buffer = rx->data;
         // load first four bytes:
-        int bytesRead = i2cRead(fidI2c, buffer, 3);
+        int bytesRead;
+        if (nfc->faults.enabled() &&
+            nfc->faults.inject(HalFaultInjector::IDLE_STORM)) {
+          memset(buffer, 0x7E, 3);
+          bytesRead = 3;
+        } else if (nfc->faults.enabled() &&
+                   nfc->faults.inject(HalFaultInjector::SHORT_READ)) {
+          // Left in the driver, read again on the next wakeup
+          bytesRead = 2;
+        } else {
+          bytesRead = i2cRead(ctx->fidI2c, buffer, 3);
+        }
 
         if (bytesRead == 3) {
           if ((buffer[0] != 0x7E) && (buffer[1] != 0x7E)) {
             readOk = true;
           } else {
+            HalMetrics::getInstance().increment(HalMetrics::I2C_IDLE_RESYNCS);
             if (buffer[1] != 0x7E) {
               STLOG_HAL_W(
                   "Idle data: 2nd byte is 0x%02x\n, reading next 2 bytes",
                   buffer[1]);
               buffer[0] = buffer[1];
               buffer[1] = buffer[2];
-              bytesRead = i2cRead(fidI2c, buffer + 2, 1);
+              bytesRead = i2cRead(ctx->fidI2c, buffer + 2, 1);
               if (bytesRead == 1) {
                 readOk = true;
               }
@@ -153,7 +160,7 @@ static void* I2cWorkerThread(void* arg) {
               STLOG_HAL_W("Idle data: 3rd byte is 0x%02x\n, reading next  byte",
                           buffer[2]);
               buffer[0] = buffer[2];
-              bytesRead = i2cRead(fidI2c, buffer + 1, 2);
+              bytesRead = i2cRead(ctx->fidI2c, buffer + 1, 2);
               if (bytesRead == 2) {
                 readOk = true;
               }
@@ -167,44 +174,80 @@ static void* I2cWorkerThread(void* arg) {
             bytesRead = 0;
             if (remaining != 0) {
               // read and pass to HALCore
-              bytesRead = i2cRead(fidI2c, buffer + 3, remaining);
+              bytesRead = i2cRead(ctx->fidI2c, buffer + 3, remaining);
+            }
+            if (bytesRead == remaining && nfc->faults.enabled()) {
+              if (nfc->faults.inject(HalFaultInjector::TRUNCATE, buffer,
+                                     3 + remaining)) {
+                bytesRead = remaining - 1;
+              } else if (nfc->faults.inject(HalFaultInjector::DELAY, buffer,
+                                            3 + remaining)) {
+                usleep(nfc->faults.delayMs() * 1000);
+              }
             }
             if (bytesRead == remaining) {
-              if ((buffer[0] == 0x6f) && (buffer[1] == 0x02)) {
-                if (mDisplayFwLog) DispHal("RX DATA", buffer, 3 + bytesRead);
-              } else {
+              bool fwTrace = HalFwTrace::isTrace(buffer, 3 + bytesRead);
+              bool captured = fwTrace && nfc->fwTrace.enabled();
+              if (captured) {
+                nfc->fwTrace.capture(buffer, 3 + bytesRead);
+              } else if (nfc->fwTrace.nciEnabled()) {
+                nfc->fwTrace.captureFrame(false, buffer, 3 + bytesRead);
+              }
+              if (!captured && (!fwTrace || nfc->wrapper.mDisplayFwLog)) {
                 DispHal("RX DATA", buffer, 3 + bytesRead);
               }
-              HalSendUpstream(hHAL, buffer, 3 + bytesRead);
+              HalMetrics::getInstance().countFrame(HalMetrics::DIR_RX, buffer,
+                                                   3 + bytesRead);
+              rx->length = 3 + bytesRead;
+              if (nfc->faults.enabled()) {
+                nfc->faults.onRxFrame(buffer, rx->length);
+              }
+              // A captured trace only goes on for the observe mode polling
+              // loop frames, the buffer is freed below otherwise.
+              if (!captured || nfc->observe.wantsPollingLoopFrames()) {
+                HalSendUpstreamBuffer(hHAL, rx);
+                rx = nullptr;
+              }
+              if (nfc->faults.enabled()) i2cInjectFrames(&nfc->faults, hHAL);
             } else {
               readOk = false;
+              HalMetrics::getInstance().increment(
+                  HalMetrics::I2C_TRUNCATED_FRAMES);
               STLOG_HAL_E("! didn't read expected bytes from i2c\n");
             }
           }
 
-          i2c_error_count = 0;
+          ctx->i2c_error_count = 0;
         } else {
           STLOG_HAL_E("! didn't read 3 requested bytes from i2c\n");
-          if (i2c_error_count < I2C_ERROR_COUNT_MAX) {
+          HalMetrics::getInstance().increment(HalMetrics::I2C_READ_ERRORS);
+          if (ctx->i2c_error_count < I2C_ERROR_COUNT_MAX) {
             HalEventLogger::getInstance().log()
                 << "! didn't read 3 requested bytes from i2c, bytesRead:"
                 << bytesRead << " errno " << errno
-                << " count:" << i2c_error_count << std::endl;
-            i2c_error_count++;
+                << " count:" << ctx->i2c_error_count << std::endl;
+            ctx->i2c_error_count++;
           }
         }
 
         readOk = false;
-        memset(buffer, 0xca, sizeof(buffer));
+        if (rx) {
+          HalFreeUpstreamBuffer(hHAL, rx);
+        }
         /* read while we have data available, up to 2 times then allow writes */
-      } while ((i2cGetGPIOState(fidI2c) == 1) && (count++ < 2));
+      } while ((i2cGetGPIOState(ctx->fidI2c) == 1) && (count++ < 2));
     }
 
-    if (event_table[1].revents & POLLIN) {
+    if (ctx->event_table[1].revents & POLLIN) {
       STLOG_HAL_V("thread received command.. \n");
+      uint64_t posted = ctx->wakeupPostedUs.exchange(0);
+      if (posted) {
+        HalMetrics::getInstance().countWakeup(HalThreads::ROLE_IO,
+                                              HalThreads::nowUs() - posted);
+      }
 
       char cmd = 0;
-      read(cmdPipe[0], &cmd, 1);
+      read(ctx->cmdPipe[0], &cmd, 1);
 
       switch (cmd) {
         case 'X':
@@ -216,10 +259,16 @@ static void* I2cWorkerThread(void* arg) {
           size_t length;
           uint8_t buffer[MAX_BUFFER_SIZE];
           STLOG_HAL_V("received write command\n");
-          read(cmdPipe[0], &length, sizeof(length));
+          read(ctx->cmdPipe[0], &length, sizeof(length));
           if (length <= MAX_BUFFER_SIZE) {
-            read(cmdPipe[0], buffer, length);
-            i2cWrite(fidI2c, buffer, length);
+            read(ctx->cmdPipe[0], buffer, length);
+            if (i2cWrite(ctx->fidI2c, buffer, length) == 0) {
+              HalMetrics::getInstance().countFrame(HalMetrics::DIR_TX, buffer,
+                                                   length);
+              if (nfc->fwTrace.nciEnabled()) {
+                nfc->fwTrace.captureFrame(true, buffer, length);
+              }
+            }
           } else {
             STLOG_HAL_E(
                 "! received bigger data than expected!! Data not transmitted "
@@ -227,7 +276,7 @@ static void* I2cWorkerThread(void* arg) {
             size_t bytes_read = 1;
             // Read all the data to empty but do not use it as not expected
             while ((bytes_read > 0) && (length > 0)) {
-              bytes_read = read(cmdPipe[0], buffer, MAX_BUFFER_SIZE);
+              bytes_read = read(ctx->cmdPipe[0], buffer, MAX_BUFFER_SIZE);
               length = length - bytes_read;
             }
           }
@@ -235,20 +284,20 @@ static void* I2cWorkerThread(void* arg) {
       }
     }
 
-    if (event_table[2].revents & POLLPRI && eventNum > 2) {
+    if (ctx->event_table[2].revents & POLLPRI && eventNum > 2) {
       STLOG_HAL_W("thread received reset request command.. \n");
       char reset[10];
       int byte;
       reset[9] = '\0';
-      lseek(notifyResetRequest, 0, SEEK_SET);
-      byte = read(notifyResetRequest, &reset, sizeof(reset));
+      lseek(ctx->notifyResetRequest, 0, SEEK_SET);
+      byte = read(ctx->notifyResetRequest, &reset, sizeof(reset));
       if (byte < 10) {
         reset[byte] = '\0';
       }
       if (byte > 0 && reset[0] == '1' && resetting == false) {
         STLOG_HAL_E("trigger NFCC reset.. \n");
         resetting = true;
-        i2cResetPulse(fidI2c);
+        i2cResetPulse(ctx->fidI2c);
       }
     }
   } while (!closeThread);
@@ -256,11 +305,11 @@ static void* I2cWorkerThread(void* arg) {
   // Stop here if we got a serious error above.
   assert(closeThread);
 
-  close(fidI2c);
-  close(cmdPipe[0]);
-  close(cmdPipe[1]);
-  if (notifyResetRequest > 0) {
-    close(notifyResetRequest);
+  close(ctx->fidI2c);
+  close(ctx->cmdPipe[0]);
+  close(ctx->cmdPipe[1]);
+  if (ctx->notifyResetRequest > 0) {
+    close(ctx->notifyResetRequest);
   }
 
   HalDestroy(hHAL);
@@ -276,7 +325,10 @@ static void* I2cWorkerThread(void* arg) {
  * @return
  */
 int I2cWriteCmd(const uint8_t* x, size_t len) {
-  return write(cmdPipe[1], x, len);
+  I2cTransportContext* ctx = I2cTransportContext::current();
+  uint64_t idle = 0;
+  ctx->wakeupPostedUs.compare_exchange_strong(idle, HalThreads::nowUs());
+  return write(ctx->cmdPipe[1], x, len);
 }
 
 /**
@@ -286,13 +338,16 @@ int I2cWriteCmd(const uint8_t* x, size_t len) {
  * @param pHandle HAL context handle
  */
 bool I2cOpenLayer(void* dev, HAL_CALLBACK callb, HALHANDLE* pHandle) {
+  I2cTransportContext* ctx = I2cTransportContext::current();
   uint32_t NoDbgFlag = HAL_FLAG_DEBUG;
   char nfc_dev_node[64];
   char nfc_reset_req_node[128];
 
   /*Read device node path*/
-  if (!GetStrValue(NAME_ST_NFC_DEV_NODE, (char*)nfc_dev_node,
-                   sizeof(nfc_dev_node))) {
+  if (ctx->devNode[0] != '\0') {
+    snprintf(nfc_dev_node, sizeof(nfc_dev_node), "%s", ctx->devNode);
+  } else if (!GetStrValue(NAME_ST_NFC_DEV_NODE, (char*)nfc_dev_node,
+                          sizeof(nfc_dev_node))) {
     STLOG_HAL_D("Open /dev/st21nfc\n");
     strcpy(nfc_dev_node, "/dev/st21nfc");
   }
@@ -300,39 +355,29 @@ bool I2cOpenLayer(void* dev, HAL_CALLBACK callb, HALHANDLE* pHandle) {
   if (GetStrValue(NAME_ST_NFC_RESET_REQ_SYSFS, (char*)nfc_reset_req_node,
                   sizeof(nfc_reset_req_node))) {
     STLOG_HAL_D("Open %s\n", nfc_reset_req_node);
-    notifyResetRequest = open(nfc_reset_req_node, O_RDONLY);
-    if (notifyResetRequest < 0) {
+    ctx->notifyResetRequest = open(nfc_reset_req_node, O_RDONLY);
+    if (ctx->notifyResetRequest < 0) {
       STLOG_HAL_E("unable to open %s (%s) \n", nfc_reset_req_node,
                   strerror(errno));
     }
   }
 
-  (void)pthread_mutex_lock(&i2ctransport_mtx);
+  (void)pthread_mutex_lock(&ctx->i2ctransport_mtx);
 
-  fidI2c = open(nfc_dev_node, O_RDWR);
-  if (fidI2c < 0) {
+  ctx->fidI2c = open(nfc_dev_node, O_RDWR);
+  if (ctx->fidI2c < 0) {
     STLOG_HAL_W("unable to open %s (%s) \n", nfc_dev_node, strerror(errno));
-    (void)pthread_mutex_unlock(&i2ctransport_mtx);
+    (void)pthread_mutex_unlock(&ctx->i2ctransport_mtx);
     return false;
   }
 
-  GetNumValue(NAME_STNFC_CONTROL_CLK, &hal_ctrl_clk, sizeof(hal_ctrl_clk));
-  GetNumValue(NAME_STNFC_ACTIVERW_TIMER, &hal_activerw_timer,
-              sizeof(hal_activerw_timer));
-
-  if (hal_ctrl_clk) {
-    if (ioctl(fidI2c, ST21NFC_CLK_DISABLE, NULL) < 0) {
-      char msg[LINUX_DBGBUFFER_SIZE];
-      strerror_r(errno, msg, LINUX_DBGBUFFER_SIZE);
-      STLOG_HAL_E("ST21NFC_CLK_DISABLE failed errno %d(%s)", errno, msg);
-    }
-  }
-  i2cSetPolarity(fidI2c, false, false);
-  i2cResetPulse(fidI2c);
+  StNfcContext::current()->power.open(ctx->fidI2c);
+  i2cSetPolarity(ctx->fidI2c, false, false);
+  i2cResetPulse(ctx->fidI2c);
 
-  if ((pipe(cmdPipe) == -1)) {
+  if ((pipe(ctx->cmdPipe) == -1)) {
     STLOG_HAL_W("unable to open cmdpipe\n");
-    (void)pthread_mutex_unlock(&i2ctransport_mtx);
+    (void)pthread_mutex_unlock(&ctx->i2ctransport_mtx);
     return false;
   }
 
@@ -340,59 +385,67 @@ bool I2cOpenLayer(void* dev, HAL_CALLBACK callb, HALHANDLE* pHandle) {
 
   if (!*pHandle) {
     STLOG_HAL_E("failed to create NFC HAL Core \n");
-    (void)pthread_mutex_unlock(&i2ctransport_mtx);
+    (void)pthread_mutex_unlock(&ctx->i2ctransport_mtx);
     return false;
   }
 
-  (void)pthread_mutex_unlock(&i2ctransport_mtx);
+  (void)pthread_mutex_unlock(&ctx->i2ctransport_mtx);
 
-  return (pthread_create(&threadHandle, NULL, I2cWorkerThread, *pHandle) == 0);
+  ctx->hHAL = *pHandle;
+  StNfcContext::current()->fwTrace.open();
+  return (HalThreads::create(&ctx->threadHandle, HalThreads::ROLE_IO,
+                             I2cWorkerThread, StNfcContext::current()) == 0);
 }
 
 /**
  * Terminates the I2C layer.
  */
 void I2cCloseLayer() {
+  I2cTransportContext* ctx = I2cTransportContext::current();
   uint8_t cmd = 'X';
   int ret;
   ALOGD("%s: enter\n", __func__);
 
-  (void)pthread_mutex_lock(&i2ctransport_mtx);
+  (void)pthread_mutex_lock(&ctx->i2ctransport_mtx);
 
-  if (threadHandle == (pthread_t)NULL) {
-    (void)pthread_mutex_unlock(&i2ctransport_mtx);
+  if (ctx->threadHandle == (pthread_t)NULL) {
+    (void)pthread_mutex_unlock(&ctx->i2ctransport_mtx);
     return;
   }
 
   I2cWriteCmd(&cmd, sizeof(cmd));
   /* wait for terminate */
-  ret = pthread_join(threadHandle, (void**)NULL);
+  ret = pthread_join(ctx->threadHandle, (void**)NULL);
   if (ret != 0) {
     ALOGE("%s: failed to wait for thread (%d)", __func__, ret);
   }
-  threadHandle = (pthread_t)NULL;
-  (void)pthread_mutex_unlock(&i2ctransport_mtx);
+  ctx->threadHandle = (pthread_t)NULL;
+  StNfcContext::current()->power.close();
+  StNfcContext::current()->fwTrace.close();
+  (void)pthread_mutex_unlock(&ctx->i2ctransport_mtx);
 }
 
 /**
  * Terminates the I2C layer.
  */
 void I2cResetPulse() {
+  I2cTransportContext* ctx = I2cTransportContext::current();
   ALOGD("%s: enter\n", __func__);
 
-  (void)pthread_mutex_lock(&i2ctransport_mtx);
+  (void)pthread_mutex_lock(&ctx->i2ctransport_mtx);
 
-  i2cResetPulse(fidI2c);
-  (void)pthread_mutex_unlock(&i2ctransport_mtx);
+  i2cResetPulse(ctx->fidI2c);
+  (void)pthread_mutex_unlock(&ctx->i2ctransport_mtx);
 }
 void I2cRecovery() {
+  I2cTransportContext* ctx = I2cTransportContext::current();
   ALOGD("%s: enter\n", __func__);
 
-  (void)pthread_mutex_lock(&i2ctransport_mtx);
-  recovery_mode = true;
-  SetToRecoveryMode(fidI2c);
-  recovery_mode = false;
-  (void)pthread_mutex_unlock(&i2ctransport_mtx);
+  (void)pthread_mutex_lock(&ctx->i2ctransport_mtx);
+  ctx->recovery_mode = true;
+  SetToRecoveryMode(ctx->fidI2c);
+  ctx->recovery_mode = false;
+  (void)pthread_mutex_unlock(&ctx->i2ctransport_mtx);
 }
 /**************************************************************************************************
  *
@@ -470,60 +523,26 @@ static int SetToRecoveryMode(int fid) {
  * @return 0 if bytes written, -1 if error
  */
 static int i2cWrite(int fid, const uint8_t* pvBuffer, int length) {
+  HalFaultInjector* faults = &StNfcContext::current()->faults;
   int retries = 0;
   int result = 0;
   int halfsecs = 0;
-  int clk_state = -1;
   char msg[LINUX_DBGBUFFER_SIZE];
 
-  if ((hal_ctrl_clk || hal_activerw_timer) && length >= 4 &&
-      pvBuffer[0] == 0x20 && pvBuffer[1] == 0x09) {
-    if (hal_activerw_timer && (pvBuffer[3] == 0x01 || pvBuffer[3] == 0x03)) {
-      // screen off cases
-      hal_wrapper_set_state(HAL_WRAPPER_STATE_SET_ACTIVERW_TIMER);
-    }
-    if (hal_ctrl_clk && 0 > (clk_state = ioctl(fid, ST21NFC_CLK_STATE, NULL))) {
-      strerror_r(errno, msg, LINUX_DBGBUFFER_SIZE);
-      STLOG_HAL_E("ST21NFC_CLK_STATE failed errno %d(%s)", errno, msg);
-      clk_state = -1;
-    }
-    STLOG_HAL_D("ST21NFC_CLK_STATE = %d", clk_state);
-    if (clk_state == 1 && (pvBuffer[3] == 0x01 || pvBuffer[3] == 0x03)) {
-      // screen off cases
-      if (ioctl(fid, ST21NFC_CLK_DISABLE, NULL) < 0) {
-        strerror_r(errno, msg, LINUX_DBGBUFFER_SIZE);
-        STLOG_HAL_E("ST21NFC_CLK_DISABLE failed errno %d(%s)", errno, msg);
-      } else if (0 > (clk_state = ioctl(fid, ST21NFC_CLK_STATE, NULL))) {
-        strerror_r(errno, msg, LINUX_DBGBUFFER_SIZE);
-        STLOG_HAL_E("ST21NFC_CLK_STATE failed errno %d(%s)", errno, msg);
-        clk_state = -1;
-      }
-      if (clk_state != 0) {
-        STLOG_HAL_E("CLK_DISABLE STATE ERROR clk_state = %d", clk_state);
-      }
-    } else if (clk_state == 0 && (pvBuffer[3] == 0x02 || pvBuffer[3] == 0x00)) {
-      // screen on cases
-      if (ioctl(fid, ST21NFC_CLK_ENABLE, NULL) < 0) {
-        strerror_r(errno, msg, LINUX_DBGBUFFER_SIZE);
-        STLOG_HAL_E("ST21NFC_CLK_ENABLE failed errno %d(%s)", errno, msg);
-      } else if (0 > (clk_state = ioctl(fid, ST21NFC_CLK_STATE, NULL))) {
-        strerror_r(errno, msg, LINUX_DBGBUFFER_SIZE);
-        STLOG_HAL_E("ST21NFC_CLK_STATE failed errno %d(%s)", errno, msg);
-        clk_state = -1;
-      }
-      if (clk_state != 1) {
-        STLOG_HAL_E("CLK_ENABLE STATE ERROR clk_state = %d", clk_state);
-      }
-    }
-  }
-
 redo:
   while (retries < 3) {
-    result = write(fid, pvBuffer, length);
+    if (faults->enabled() &&
+        faults->inject(HalFaultInjector::WRITE_ERROR, pvBuffer, length)) {
+      result = -1;
+      errno = EREMOTEIO;
+    } else {
+      result = write(fid, pvBuffer, length);
+    }
 
     if (result < 0) {
       strerror_r(errno, msg, LINUX_DBGBUFFER_SIZE);
       STLOG_HAL_W("! i2cWrite!!, errno is '%s'", msg);
+      HalMetrics::getInstance().increment(HalMetrics::I2C_WRITE_RETRIES);
       usleep(4000);
       retries++;
     } else if (result > 0) {
@@ -531,6 +550,7 @@ redo:
       return result;
     } else {
       STLOG_HAL_W("write on i2c failed, retrying\n");
+      HalMetrics::getInstance().increment(HalMetrics::I2C_WRITE_RETRIES);
       usleep(4000);
       retries++;
     }
@@ -544,6 +564,7 @@ redo:
     goto redo;
   }
   /* The CLF did not recover, give up */
+  HalMetrics::getInstance().increment(HalMetrics::I2C_WRITE_ERRORS);
   return -1;
 } /* i2cWrite */
 
@@ -584,6 +605,7 @@ static int i2cRead(int fid, uint8_t* pvBuffer, int length) {
       int delay = delayTab[retries];
 
       retries++;
+      HalMetrics::getInstance().increment(HalMetrics::I2C_READ_RETRIES);
       STLOG_HAL_W("## i2cRead retry %d/3 in %d milliseconds.", retries, delay);
       usleep(delay * 1000);
       continue;
@@ -592,6 +614,27 @@ static int i2cRead(int fid, uint8_t* pvBuffer, int length) {
   return result;
 } /* i2cRead */
 
+/**
+ * Deliver the frames the fault injection adds after a received frame, as if
+ * they came from the NFCC.
+ * @param faults Fault injection of the controller
+ * @param hHAL HAL handle
+ */
+static void i2cInjectFrames(HalFaultInjector* faults, HALHANDLE hHAL) {
+  size_t length;
+
+  for (;;) {
+    HalBuffer* rx = HalAllocUpstreamBuffer(hHAL);
+    if (!faults->nextFrame(rx->data, &length)) {
+      HalFreeUpstreamBuffer(hHAL, rx);
+      return;
+    }
+    DispHal("RX DATA", rx->data, length);
+    rx->length = length;
+    HalSendUpstreamBuffer(hHAL, rx);
+  }
+} /* i2cInjectFrames */
+
 /**
  * Get the activation status of wake-up pin from st21nfc.
  *  The decision 'active' depends on selected polarity.
@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// CNfcConfig is private to config.cpp, which is built into this translation
+// unit to reach it. The configuration is read from the working directory
+// prepared by the benchmark main.
+#define ST21NFC_ALTERNATIVE_CONFIG_PATH "./"
+#include "../adaptation/config.cpp"
+
+#include <benchmark/benchmark.h>
+
+#include "hal_config.h"
+
+// Parameters looked up on the open and on the RF paths, plus a missing one.
+static const char* kNames[] = {NAME_STNFC_HAL_LOGLEVEL, NAME_CORE_CONF_PROP,
+                               NAME_STNFC_CONTROL_CLK, NAME_HAL_EVENT_LOG_STORAGE,
+                               "POLL_BAIL_OUT_MODE"};
+
+static void BM_ConfigFind(benchmark::State& state) {
+  CNfcConfig& config = CNfcConfig::GetInstance();
+  unsigned char savedLevel = hal_trace_level;
+  size_t i = 0;
+
+  hal_trace_level = state.range(0);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        config.find(kNames[i++ % (sizeof(kNames) / sizeof(kNames[0]))]));
+  }
+  hal_trace_level = savedLevel;
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ConfigFind)
+    ->Arg(STNFC_TRACE_LEVEL_ERROR)
+    ->Arg(STNFC_TRACE_LEVEL_DEBUG);
+
+static void BM_GetNumValue(benchmark::State& state) {
+  unsigned char savedLevel = hal_trace_level;
+  unsigned long num = 0;
+  size_t i = 0;
+
+  hal_trace_level = STNFC_TRACE_LEVEL_ERROR;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        GetNumValue(kNames[i++ % (sizeof(kNames) / sizeof(kNames[0]))], &num,
+                    sizeof(num)));
+  }
+  hal_trace_level = savedLevel;
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_GetNumValue);
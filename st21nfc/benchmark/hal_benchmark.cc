@@ -0,0 +1,214 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Benchmarks of the HAL helpers reachable through their public entry points,
+// plus the benchmark main which prepares the host environment.
+
+#include <android-base/file.h>
+#include <android/log.h>
+#include <benchmark/benchmark.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "android_logmsg.h"
+#include "hal_crc.h"
+#include "hal_fd.h"
+#include "hal_fwlog.h"
+
+// PROP_FW_DBG_NTF as sent by the FW in observe mode: field on, REQA, WUPA,
+// ATQB request and field off, each TLV ending with its 4 bytes timestamp.
+static const uint8_t kPollingLoopNtf[] = {
+    0x6f, 0x02, 0x38, 0x30, 0x00, 0x00,
+    // T_fieldOn
+    0x10, 0x04, 0x00, 0x01, 0x02, 0x03,
+    // T_CERx, short frame, REQA
+    0x09, 0x0b, 0x01, 0x30, 0x00, 0x00, 0x07, 0x00, 0x26, 0x00, 0x01, 0x03,
+    0x04,
+    // T_CERx, short frame, WUPA
+    0x09, 0x0b, 0x01, 0x30, 0x00, 0x00, 0x07, 0x00, 0x52, 0x00, 0x01, 0x04,
+    0x05,
+    // T_CERx, type B, REQB
+    0x09, 0x0d, 0x07, 0x30, 0x00, 0x00, 0x09, 0x00, 0x05, 0x00, 0x00, 0x00,
+    0x01, 0x05, 0x06,
+    // T_fieldOff
+    0x11, 0x04, 0x00, 0x01, 0x06, 0x07};
+
+static void BM_DispHal(benchmark::State& state) {
+  uint8_t frame[258];
+  unsigned char saved = hal_trace_level;
+  size_t length = state.range(1);
+
+  hal_trace_level = state.range(0);
+  for (size_t i = 0; i < sizeof(frame); i++) frame[i] = i;
+  frame[0] = 0x00;
+  frame[2] = length - 3;
+
+  for (auto _ : state) {
+    DispHal("RX DATA", frame, length);
+  }
+  hal_trace_level = saved;
+  state.SetBytesProcessed(state.iterations() * length);
+}
+BENCHMARK(BM_DispHal)
+    ->ArgsProduct({{STNFC_TRACE_LEVEL_NONE, STNFC_TRACE_LEVEL_ERROR,
+                    STNFC_TRACE_LEVEL_DEBUG, STNFC_TRACE_LEVEL_VERBOSE,
+                    STNFC_TRACE_LEVEL_DEBUG | STNFC_TRACE_FLAG_PRIVACY},
+                   {8, 258}});
+
+static void BM_NotifyPollingLoopFrames(benchmark::State& state) {
+  // Sized as the I/O thread buffers, the parser may look past the frame end.
+  uint8_t ntf[258] = {};
+  uint8_t out[258];
+  unsigned char saved = hal_trace_level;
+
+  hal_trace_level = STNFC_TRACE_LEVEL_ERROR;
+  hal_fd_getFwInfo()->chipHwVersion = HW_ST54L;
+  for (auto _ : state) {
+    memcpy(ntf, kPollingLoopNtf, sizeof(kPollingLoopNtf));
+    benchmark::DoNotOptimize(
+        notifyPollingLoopFrames(ntf, sizeof(kPollingLoopNtf), out));
+    benchmark::ClobberMemory();
+  }
+  hal_trace_level = saved;
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_NotifyPollingLoopFrames);
+
+// Bit serial CRC_A / CRC_B the table driven one replaced, kept as reference.
+static uint16_t Iso14443CrcBitwise(const uint8_t* data, size_t length,
+                                   int type) {
+  uint16_t crc = type == Type_A ? CRC_PRESET_A : CRC_PRESET_B;
+  for (size_t i = 0; i < length; i++) {
+    uint8_t bt = data[i] ^ (uint8_t)(crc & 0x00FF);
+    bt = (bt ^ (bt << 4));
+    crc = (crc >> 8) ^ ((uint32_t)bt << 8) ^ ((uint32_t)bt << 3) ^
+          ((uint32_t)bt >> 4);
+  }
+  return crc;
+}
+
+/*
+ * Checks iso14443_crc() against the reference: every 1 and 2 bytes input,
+ * then pseudo random frames of every length up to 255, whole and split in
+ * two for the incremental form.
+ */
+static bool CheckIso14443Crc() {
+  uint8_t data[255];
+  uint32_t seed = 1;
+
+  for (int type : {Type_A, Type_B}) {
+    for (int i = 0; i < 0x10000; i++) {
+      data[0] = i;
+      data[1] = i >> 8;
+      if (iso14443_crc(data, 1, type) != Iso14443CrcBitwise(data, 1, type) ||
+          iso14443_crc(data, 2, type) != Iso14443CrcBitwise(data, 2, type)) {
+        fprintf(stderr, "CRC mismatch, type %d input %04x\n", type, i);
+        return false;
+      }
+    }
+    for (int round = 0; round < 64; round++) {
+      for (size_t i = 0; i < sizeof(data); i++) {
+        seed = seed * 1103515245 + 12345;
+        data[i] = seed >> 16;
+      }
+      for (size_t length = 1; length <= sizeof(data); length++) {
+        uint16_t expected = Iso14443CrcBitwise(data, length, type);
+        size_t split = seed % (length + 1);
+        uint16_t crc = iso14443_crc_update(iso14443_crc_init(type), data,
+                                           split);
+        crc = iso14443_crc_update(crc, data + split, length - split);
+        if (iso14443_crc(data, length, type) != expected || crc != expected) {
+          fprintf(stderr, "CRC mismatch, type %d length %zu\n", type, length);
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+static void BM_Iso14443CrcBitwise(benchmark::State& state) {
+  uint8_t data[256];
+  size_t length = state.range(0);
+  int type = state.range(1);
+
+  for (size_t i = 0; i < sizeof(data); i++) data[i] = i * 7;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Iso14443CrcBitwise(data, length, type));
+  }
+  state.SetBytesProcessed(state.iterations() * length);
+}
+BENCHMARK(BM_Iso14443CrcBitwise)
+    ->ArgsProduct({{2, 16, 64, 255}, {Type_A, Type_B}});
+
+static void BM_Iso14443Crc(benchmark::State& state) {
+  uint8_t data[256];
+  size_t length = state.range(0);
+  int type = state.range(1);
+
+  for (size_t i = 0; i < sizeof(data); i++) data[i] = i * 7;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(iso14443_crc(data, length, type));
+  }
+  state.SetBytesProcessed(state.iterations() * length);
+}
+BENCHMARK(BM_Iso14443Crc)->ArgsProduct({{2, 16, 64, 255}, {Type_A, Type_B}});
+
+static void NullLogger(const struct __android_log_message* /* log_message */) {
+}
+
+/*
+ * The configuration is read from the working directory (see
+ * config_benchmark.cc): run from a scratch directory holding a copy of the
+ * example configuration so that GetNumValue() sees a realistic parameter set.
+ */
+static bool PrepareConfiguration() {
+  std::string conf;
+  std::string src = android::base::GetExecutableDirectory() +
+                    "/libnfc-hal-st-example.conf";
+  char dir[] = "/tmp/st21nfc_benchmark.XXXXXX";
+
+  if (!android::base::ReadFileToString(src, &conf)) {
+    fprintf(stderr, "cannot read %s\n", src.c_str());
+    return false;
+  }
+  if (mkdtemp(dir) == nullptr || chdir(dir) != 0) {
+    fprintf(stderr, "cannot enter %s\n", dir);
+    return false;
+  }
+  return android::base::WriteStringToFile(conf, "libnfc-hal-st.conf");
+}
+
+int main(int argc, char** argv) {
+  // Format everything as on device, but do not pay for the output itself.
+  __android_log_set_logger(NullLogger);
+  __android_log_set_minimum_priority(ANDROID_LOG_VERBOSE);
+
+  if (!PrepareConfiguration() || !CheckIso14443Crc()) return 1;
+  InitializeSTLogLevel();
+  // Allocates the FW info/capabilities used by the notification handlers.
+  hal_fd_init();
+
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
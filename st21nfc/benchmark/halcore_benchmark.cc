@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// The message ring and the buffer pool are private to halcore.cc, which is
+// built into this translation unit to reach them.
+#include "../hal/halcore.cc"
+
+#include <benchmark/benchmark.h>
+
+static void NullHalCallback(void* /* context */, uint32_t /* event */,
+                            const void* /* data */, size_t /* length */) {}
+
+/*
+ * Instance without worker thread, so that the benchmark alone drains the
+ * message ring.
+ */
+static HalInstance* CreateRingOnlyInstance() {
+  HalInstance* inst = (HalInstance*)calloc(1, sizeof(HalInstance));
+  sem_init(&inst->semaphore, 0, 0);
+  pthread_mutex_init(&inst->hMutex, NULL);
+  return inst;
+}
+
+static void DestroyRingOnlyInstance(HalInstance* inst) {
+  pthread_mutex_destroy(&inst->hMutex);
+  sem_destroy(&inst->semaphore);
+  free(inst);
+}
+
+static void BM_ThreadMessageRoundTrip(benchmark::State& state) {
+  HalInstance* inst = CreateRingOnlyInstance();
+  ThreadMessage msg = {};
+  ThreadMessage out;
+  int batch = state.range(0);
+
+  msg.command = MSG_RX_DATA;
+  msg.length = 32;
+  for (auto _ : state) {
+    for (int i = 0; i < batch; i++) HalEnqueueThreadMessage(inst, &msg);
+    for (int i = 0; i < batch; i++) {
+      HalDequeueThreadMessage(inst, &out);
+      sem_trywait(&inst->semaphore);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * batch);
+  DestroyRingOnlyInstance(inst);
+}
+BENCHMARK(BM_ThreadMessageRoundTrip)->Arg(1)->Arg(HAL_QUEUE_MAX - 1);
+
+static HalInstance* sPoolInstance;
+
+static void BM_BufferAllocFree(benchmark::State& state) {
+  if (state.thread_index() == 0) {
+    sPoolInstance =
+        (HalInstance*)HalCreate(nullptr, NullHalCallback, HAL_FLAG_NO_DEBUG);
+  }
+  for (auto _ : state) {
+    HalBuffer* b = HalAllocBuffer(sPoolInstance);
+    benchmark::DoNotOptimize(b);
+    HalFreeBuffer(sPoolInstance, b);
+  }
+  state.SetItemsProcessed(state.iterations());
+  if (state.thread_index() == 0) {
+    HalDestroy(sPoolInstance);
+    sPoolInstance = nullptr;
+  }
+}
+BENCHMARK(BM_BufferAllocFree)->ThreadRange(1, 16)->UseRealTime();
+
+// Cost of the fast failure the AIDL write path gets once the pool is drained.
+static void BM_BufferTryAllocExhausted(benchmark::State& state) {
+  HalInstance* inst =
+      (HalInstance*)HalCreate(nullptr, NullHalCallback, HAL_FLAG_NO_DEBUG);
+  HalBuffer* taken[NUM_BUFFERS_MAX];
+  int count = 0;
+
+  while (count < NUM_BUFFERS_MAX &&
+         (taken[count] = HalTryAllocBuffer(inst)) != nullptr) {
+    count++;
+  }
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(HalTryAllocBuffer(inst));
+  }
+  state.SetItemsProcessed(state.iterations());
+  for (int i = 0; i < count; i++) HalFreeBuffer(inst, taken[i]);
+  HalDestroy(inst);
+}
+BENCHMARK(BM_BufferTryAllocExhausted);
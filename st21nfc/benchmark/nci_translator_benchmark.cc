@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Benchmarks of the Android NCI extensions translation, one case per rule.
+
+#include <benchmark/benchmark.h>
+#include <string.h>
+
+#include <iterator>
+#include <vector>
+
+#include "hal_nci_translator.h"
+
+struct TranslatorCase {
+  const char* name;
+  uint8_t fwObserveMode;
+  std::vector<uint8_t> cmd;
+  std::vector<uint8_t> rsp;  // NFCC response to the translated command
+};
+
+static const TranslatorCase kCases[] = {
+    {"query_observe_per_tech",
+     2,
+     {0x2f, 0x0c, 0x01, 0x04},
+     {0x41, 0x17, 0x02, 0x00, 0x07}},
+    {"query_observe",
+     1,
+     {0x2f, 0x0c, 0x01, 0x04},
+     {0x40, 0x03, 0x05, 0x00, 0x01, 0xa3, 0x01, 0x01}},
+    {"observe_per_tech",
+     2,
+     {0x2f, 0x0c, 0x02, 0x02, 0x01},
+     {0x41, 0x16, 0x01, 0x00}},
+    {"observe",
+     1,
+     {0x2f, 0x0c, 0x02, 0x02, 0x01},
+     {0x40, 0x02, 0x02, 0x00, 0x00}},
+    {"observe_tech",
+     2,
+     {0x2f, 0x0c, 0x02, 0x05, 0x03},
+     {0x41, 0x16, 0x01, 0x00}},
+    // Two exit frames: REQA type A with its mask, and a raw prefix.
+    {"exit_frames",
+     2,
+     {0x2f, 0x0c, 0x15, 0x06, 0x00, 0x00, 0x01, 0xf4,
+      0x00, 0x05, 0x01, 0x26, 0x00, 0xff, 0xff,
+      0x10, 0x07, 0x01, 0xaa, 0xbb, 0xcc, 0xff, 0xff, 0x00},
+     {0x4f, 0x19, 0x01, 0x00}},
+    // Type A polling loop annotation, 8 bytes frame.
+    {"polling_loop_annotation",
+     2,
+     {0x2f, 0x0c, 0x0d, 0x09, 0x01, 0x00, 0x09, 0x00, 0x01, 0x02, 0x03, 0x04,
+      0x05, 0x06, 0x07, 0x08},
+     {0x4f, 0x1d, 0x01, 0x00}},
+};
+
+static void BM_TranslateCommand(benchmark::State& state) {
+  const TranslatorCase& c = kCases[state.range(0)];
+  HalNciTranslator translator;
+  HalNciTranslator::CommandResult result;
+  uint8_t out[HAL_NCI_MAX_FRAME_SIZE];
+
+  state.SetLabel(c.name);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(translator.translateCommand(
+        c.cmd.data(), c.cmd.size(), c.fwObserveMode, out, sizeof(out),
+        &result));
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TranslateCommand)->DenseRange(0, std::size(kCases) - 1);
+
+// Exit frames and annotations that miss the frame cache: one more command
+// than it holds, in turn, so each one is built.
+static void BM_TranslateCommandBuild(benchmark::State& state) {
+  const TranslatorCase& c = kCases[state.range(0)];
+  HalNciTranslator translator;
+  HalNciTranslator::CommandResult result;
+  uint8_t out[HAL_NCI_MAX_FRAME_SIZE];
+  std::vector<uint8_t> cmds[HAL_NCI_FRAME_CACHE_SIZE + 1];
+  size_t next = 0;
+
+  for (size_t i = 0; i < std::size(cmds); i++) {
+    cmds[i] = c.cmd;
+    cmds[i].back() ^= i;
+  }
+  state.SetLabel(c.name);
+  for (auto _ : state) {
+    const std::vector<uint8_t>& cmd = cmds[next];
+    next = (next + 1) % std::size(cmds);
+    benchmark::DoNotOptimize(translator.translateCommand(
+        cmd.data(), cmd.size(), c.fwObserveMode, out, sizeof(out), &result));
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TranslateCommandBuild)->Arg(5)->Arg(6);
+
+// Command then response, as for each exchange with the NFCC.
+static void BM_TranslateExchange(benchmark::State& state) {
+  const TranslatorCase& c = kCases[state.range(0)];
+  HalNciTranslator translator;
+  HalNciTranslator::CommandResult result;
+  HalNciTranslator::ObserveState observe = {0x07, false};
+  uint8_t out[HAL_NCI_MAX_FRAME_SIZE];
+  uint8_t rsp[HAL_NCI_MAX_FRAME_SIZE];
+
+  state.SetLabel(c.name);
+  for (auto _ : state) {
+    uint16_t length = c.rsp.size();
+    translator.translateCommand(c.cmd.data(), c.cmd.size(), c.fwObserveMode,
+                                out, sizeof(out), &result);
+    memcpy(rsp, c.rsp.data(), length);
+    benchmark::DoNotOptimize(
+        translator.translateResponse(rsp, &length, &observe));
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TranslateExchange)->DenseRange(0, std::size(kCases) - 1);
+
+// Frames seen while no Android extension is in flight: the common case.
+static void BM_TranslateResponseNotPending(benchmark::State& state) {
+  HalNciTranslator translator;
+  HalNciTranslator::ObserveState observe = {0x00, false};
+  uint8_t rsp[] = {0x60, 0x06, 0x03, 0x01, 0x00, 0x01};
+
+  for (auto _ : state) {
+    uint16_t length = sizeof(rsp);
+    benchmark::DoNotOptimize(
+        translator.translateResponse(rsp, &length, &observe));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TranslateResponseNotPending);
@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hal_binder_calls.h"
+
+#include "android_logmsg.h"
+#include "config.h"
+#include "hal_metrics.h"
+#include "hal_threads.h"
+
+static const char* kCallNames[HalBinderCalls::CALL_MAX] = {
+    "open",
+    "close",
+    "core_initialized",
+    "write",
+    "power_cycle",
+    "pre_discover",
+    "factory_reset",
+    "set_verbose_logging",
+    "get_config",
+    "is_verbose_logging",
+    "dump",
+};
+
+// Set while the thread has the turn. Binder may run an incoming call on a
+// thread waiting for the reply to one of its own outgoing calls (a nested
+// transaction): that call does not wait for the turn its thread holds.
+static thread_local bool sHasTurn = false;
+
+HalBinderCalls& HalBinderCalls::getInstance() {
+  static HalBinderCalls nfc_hal_binder_calls;
+  return nfc_hal_binder_calls;
+}
+
+HalBinderCalls::HalBinderCalls() : mNextTicket(0), mServing(0), mInFlight(0) {}
+
+uint32_t HalBinderCalls::threadCount() {
+  unsigned long num = 0;
+
+  if (!GetNumValue(NAME_STNFC_BINDER_THREADS, &num, sizeof(num)) || num == 0) {
+    return HAL_BINDER_THREADS_DEFAULT;
+  }
+  if (num > HAL_BINDER_THREADS_MAX) {
+    STLOG_HAL_W("%s: %lu binder threads, limited to %d", __func__, num,
+                HAL_BINDER_THREADS_MAX);
+    num = HAL_BINDER_THREADS_MAX;
+  }
+  return num;
+}
+
+const char* HalBinderCalls::callName(Call call) {
+  if (call >= CALL_MAX) return "unknown";
+  return kCallNames[call];
+}
+
+/**
+ * Wait for the turn of a new ticket.
+ * @return true if another call had the turn
+ */
+bool HalBinderCalls::enter() {
+  std::unique_lock<std::mutex> lock(mMutex);
+  uint64_t ticket = mNextTicket++;
+  bool waited = ticket != mServing;
+
+  mCond.wait(lock, [this, ticket] { return mServing == ticket; });
+  return waited;
+}
+
+void HalBinderCalls::leave() {
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mServing++;
+  }
+  mCond.notify_all();
+}
+
+void HalBinderCalls::setInFlight(int64_t delta) {
+  int64_t inFlight = mInFlight.fetch_add(delta, std::memory_order_relaxed);
+  HalMetrics::getInstance().setGauge(HalMetrics::BINDER_CALLS_IN_FLIGHT,
+                                     inFlight + delta);
+}
+
+HalBinderCalls::Scope::Scope(Call call)
+    : mCall(call),
+      mOrdered(isOrdered(call) && !sHasTurn),
+      mStartUs(HalThreads::nowUs()),
+      mWaitUs(0) {
+  HalBinderCalls& calls = getInstance();
+
+  calls.setInFlight(1);
+  if (!mOrdered) return;
+  if (calls.enter()) {
+    HalMetrics::getInstance().increment(HalMetrics::BINDER_CALLS_QUEUED);
+  }
+  sHasTurn = true;
+  mWaitUs = HalThreads::nowUs() - mStartUs;
+}
+
+HalBinderCalls::Scope::~Scope() {
+  HalBinderCalls& calls = getInstance();
+  uint64_t runUs = HalThreads::nowUs() - mStartUs - mWaitUs;
+
+  if (mOrdered) {
+    sHasTurn = false;
+    calls.leave();
+  }
+  calls.setInFlight(-1);
+  HalMetrics::getInstance().countBinderCall(mCall, mWaitUs, runUs);
+}
@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hal_callback_queue.h"
+
+#include "android_logmsg.h"
+#include "hal_metrics.h"
+#include "hal_threads.h"
+
+HalCallbackQueue::HalCallbackQueue()
+    : mHead(0), mCount(0), mPostedUs(0), mOpen(false), mStopping(false) {}
+
+void HalCallbackQueue::open() {
+  std::unique_lock<std::mutex> lock(mMutex);
+  // The consumer of the previous session closes the queue when it is done.
+  mCond.wait(lock, [this] { return !mOpen || !mStopping; });
+  mOpen = true;
+}
+
+void HalCallbackQueue::close() {
+  std::lock_guard<std::mutex> lock(mMutex);
+  mOpen = false;
+  mStopping = false;
+  mHead = 0;
+  mCount = 0;
+  mOverflow.clear();
+  mPostedUs = 0;
+  mCond.notify_all();
+}
+
+HalCallbackQueue::PostResult HalCallbackQueue::post(uint8_t event,
+                                                    uint8_t status) {
+  size_t depth;
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (!mOpen) return CLOSED;
+    if (mCount == HAL_CALLBACK_QUEUE_SIZE) {
+      // Behind what is already queued, the consumer takes it in turn
+      HalMetrics::getInstance().increment(HalMetrics::CALLBACK_QUEUE_OVERFLOWS);
+      STLOG_HAL_W("HAL: %s queue full, event %hhx status %hhx deferred",
+                  __func__, event, status);
+      mOverflow.push_back({event, status});
+      depth = mCount + mOverflow.size();
+    } else {
+      if (mCount == 0) mPostedUs = HalThreads::nowUs();
+      mRing[(mHead + mCount) % HAL_CALLBACK_QUEUE_SIZE] = {event, status};
+      depth = ++mCount;
+    }
+  }
+  mCond.notify_all();
+  HalMetrics::getInstance().setGauge(HalMetrics::CALLBACK_QUEUE_DEPTH, depth);
+  return POSTED;
+}
+
+bool HalCallbackQueue::take(uint8_t* event, uint8_t* status) {
+  std::unique_lock<std::mutex> lock(mMutex);
+  mCond.wait(lock, [this] { return mCount > 0 || mStopping; });
+
+  if (mCount == 0) {
+    // Stopped and drained: later posts are delivered by their caller.
+    mOpen = false;
+    mStopping = false;
+    mCond.notify_all();
+    return false;
+  }
+  if (mPostedUs) {
+    HalMetrics::getInstance().countWakeup(HalThreads::ROLE_CALLBACK,
+                                          HalThreads::nowUs() - mPostedUs);
+    mPostedUs = 0;
+  }
+  *event = mRing[mHead].event;
+  *status = mRing[mHead].status;
+  mHead = (mHead + 1) % HAL_CALLBACK_QUEUE_SIZE;
+  mCount--;
+  if (!mOverflow.empty()) {
+    // The ring only has room once the overflow is empty, order is kept
+    mRing[(mHead + mCount) % HAL_CALLBACK_QUEUE_SIZE] = mOverflow.front();
+    mOverflow.pop_front();
+    mCount++;
+  }
+  if (mCount == 0) mCond.notify_all();
+  HalMetrics::getInstance().setGauge(HalMetrics::CALLBACK_QUEUE_DEPTH,
+                                     mCount + mOverflow.size());
+  return true;
+}
+
+void HalCallbackQueue::stop() {
+  std::unique_lock<std::mutex> lock(mMutex);
+  if (!mOpen) return;
+  mStopping = true;
+  mCond.notify_all();
+  mCond.wait(lock, [this] { return !mOpen || mCount == 0; });
+}
@@ -0,0 +1,287 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hal_config_reconciler.h"
+
+#include <string.h>
+
+#include "android_logmsg.h"
+#include "hal_event_logger.h"
+#include "hal_metrics.h"
+
+#define NCI_MAX_PAYLOAD 255
+// CORE_SET_CONFIG_CMD / CORE_GET_CONFIG_CMD / CORE_GET_CONFIG_RSP
+#define NCI_CORE_SET_CONFIG_OID 0x02
+#define NCI_CORE_GET_CONFIG_OID 0x03
+// PROP_SET_CONFIG_CMD: 2F 02 L 04 00 <block> 01 00 <N> <N data>
+// PROP_GET_CONFIG_CMD: 2F 02 05 03 00 <block> 01 00
+// PROP_GET_CONFIG_RSP: 4F 02 L 00 xx xx <N> <N data>
+#define PROP_SET_HEADER_SIZE 9
+#define PROP_GET_RSP_HEADER_SIZE 7
+
+static bool HalConfigDeltaEnabled() {
+  unsigned long delta = 1;
+  GetNumValue(NAME_STNFC_CONFIG_DELTA, &delta, sizeof(delta));
+  return delta != 0;
+}
+
+HalConfigReconciler::HalConfigReconciler()
+    : mDelta(true),
+      mCoreLength(0),
+      mCoreCount(0),
+      mCoreNextGet(0),
+      mCoreNextSet(0),
+      mCoreDone(true),
+      mCoreStats(),
+      mPropPending(-1),
+      mPropStats() {}
+
+void HalConfigReconciler::beginCore(const uint8_t* cmd, size_t length) {
+  mDelta = HalConfigDeltaEnabled();
+  mCoreStats = Stats();
+  mCoreNextGet = 0;
+  mCoreNextSet = 0;
+  mCoreDone = false;
+
+  if (length > sizeof(mCoreCmd)) length = sizeof(mCoreCmd);
+  memcpy(mCoreCmd, cmd, length);
+  mCoreLength = length;
+  mCoreCount = 0;
+
+  if (mDelta && !parseCore(cmd, length)) {
+    STLOG_HAL_E("%s - invalid CORE_SET_CONFIG_CMD, sent as is", __func__);
+    mCoreCount = 0;
+  }
+}
+
+bool HalConfigReconciler::nextCoreCommand(uint8_t* cmd, size_t* length) {
+  size_t payload = 1;
+  size_t rsp = 2;
+  uint8_t n = 0;
+
+  if (mCoreDone) return false;
+
+  // Not reconciled: the command as is, once.
+  if (mCoreCount == 0) {
+    if (mCoreNextSet++ > 0) {
+      mCoreDone = true;
+      report("core", mCoreStats);
+      return false;
+    }
+    memcpy(cmd, mCoreCmd, mCoreLength);
+    *length = mCoreLength;
+    mCoreStats.sets++;
+    mCoreStats.setBytes += mCoreLength;
+    return true;
+  }
+
+  if (mCoreNextGet < mCoreCount) {
+    // As many IDs as fit, with their expected values in the response.
+    while (mCoreNextGet < mCoreCount) {
+      const CoreParam& p = mCoreParams[mCoreNextGet];
+      if (n > 0 && rsp + 2 + p.length > NCI_MAX_PAYLOAD) break;
+      cmd[4 + n++] = p.id;
+      rsp += 2 + p.length;
+      mCoreNextGet++;
+    }
+    cmd[0] = 0x20;
+    cmd[1] = NCI_CORE_GET_CONFIG_OID;
+    cmd[2] = 1 + n;
+    cmd[3] = n;
+    *length = 4 + n;
+    mCoreStats.reads++;
+    return true;
+  }
+
+  for (; mCoreNextSet < mCoreCount; mCoreNextSet++) {
+    const CoreParam& p = mCoreParams[mCoreNextSet];
+    if (!p.differs) {
+      mCoreStats.skipped++;
+      mCoreStats.skippedBytes += 2 + p.length;
+      continue;
+    }
+    if (n > 0 && payload + 2 + p.length > NCI_MAX_PAYLOAD) break;
+    cmd[3 + payload] = p.id;
+    cmd[4 + payload] = p.length;
+    memcpy(cmd + 5 + payload, mCoreCmd + p.offset, p.length);
+    payload += 2 + p.length;
+    n++;
+  }
+  if (n == 0) {
+    mCoreDone = true;
+    report("core", mCoreStats);
+    return false;
+  }
+  cmd[0] = 0x20;
+  cmd[1] = NCI_CORE_SET_CONFIG_OID;
+  cmd[2] = payload;
+  cmd[3] = n;
+  *length = 3 + payload;
+  mCoreStats.sets++;
+  mCoreStats.setBytes += *length;
+  return true;
+}
+
+void HalConfigReconciler::onCoreGetResponse(const uint8_t* rsp, size_t length) {
+  size_t pos = 5;
+
+  // With STATUS_INVALID_PARAM, the invalid ones come back empty.
+  if (length < 5 || rsp[0] != 0x40 || rsp[1] != NCI_CORE_GET_CONFIG_OID) {
+    return;
+  }
+  if (length > 3 + (size_t)rsp[2]) length = 3 + rsp[2];
+
+  for (uint8_t i = 0; i < rsp[4] && pos + 2 <= length; i++) {
+    uint8_t id = rsp[pos];
+    uint8_t len = rsp[pos + 1];
+    if (pos + 2 + len > length) break;
+    for (size_t p = 0; p < mCoreCount; p++) {
+      CoreParam& param = mCoreParams[p];
+      if (param.id == id && param.length == len &&
+          (len > 0 || rsp[3] == 0x00)) {
+        param.differs =
+            memcmp(mCoreCmd + param.offset, rsp + pos + 2, len) != 0;
+      }
+    }
+    pos += 2 + len;
+  }
+}
+
+void HalConfigReconciler::beginProp() {
+  mDelta = HalConfigDeltaEnabled();
+  mPropBlocks.clear();
+  mPropPending = -1;
+  mPropStats = Stats();
+}
+
+HalConfigReconciler::PropAction HalConfigReconciler::checkPropFrame(
+    const uint8_t* frame, size_t length, uint8_t* get, size_t* getLength) {
+  bool propSet = length >= PROP_SET_HEADER_SIZE && frame[0] == 0x2F &&
+                 frame[1] == 0x02 && frame[3] == 0x04 && frame[4] == 0x00 &&
+                 frame[6] == 0x01 && frame[7] == 0x00 &&
+                 (size_t)frame[2] + 3 == length &&
+                 PROP_SET_HEADER_SIZE + (size_t)frame[8] == length;
+
+  if (mDelta && propSet) {
+    uint8_t block = frame[5];
+    uint8_t n = frame[8];
+    auto it = mPropBlocks.find(block);
+
+    if (it == mPropBlocks.end()) {
+      get[0] = 0x2F;
+      get[1] = 0x02;
+      get[2] = 0x05;
+      get[3] = 0x03;
+      get[4] = 0x00;
+      get[5] = block;
+      get[6] = 0x01;
+      get[7] = 0x00;
+      *getLength = 8;
+      mPropPending = block;
+      mPropStats.reads++;
+      return PROP_READ;
+    }
+
+    std::vector<uint8_t>& current = it->second;
+    if (!current.empty() && current.size() >= n &&
+        memcmp(current.data(), frame + PROP_SET_HEADER_SIZE, n) == 0) {
+      mPropStats.skipped++;
+      mPropStats.skippedBytes += length;
+      return PROP_SKIP;
+    }
+    // What the block holds once the frame is applied.
+    if (!current.empty()) {
+      if (current.size() < n) current.resize(n);
+      memcpy(current.data(), frame + PROP_SET_HEADER_SIZE, n);
+    }
+  }
+
+  mPropStats.sets++;
+  mPropStats.setBytes += length;
+  return PROP_SEND;
+}
+
+void HalConfigReconciler::onPropGetResponse(const uint8_t* rsp, size_t length) {
+  std::vector<uint8_t> current;
+
+  if (mPropPending < 0) return;
+  if (length >= PROP_GET_RSP_HEADER_SIZE && rsp[0] == 0x4F &&
+      rsp[1] == 0x02 && rsp[3] == 0x00 &&
+      PROP_GET_RSP_HEADER_SIZE + (size_t)rsp[6] <= length) {
+    current.assign(rsp + PROP_GET_RSP_HEADER_SIZE,
+                   rsp + PROP_GET_RSP_HEADER_SIZE + rsp[6]);
+  } else {
+    STLOG_HAL_W("%s - block 0x%02X not read, frames sent as is", __func__,
+                mPropPending);
+  }
+  mPropBlocks[mPropPending] = current;
+  mPropPending = -1;
+}
+
+void HalConfigReconciler::endProp() {
+  report("custom", mPropStats);
+  mPropBlocks.clear();
+}
+
+/**
+ * Parse a CORE_SET_CONFIG_CMD into its parameters, all to be set until the
+ * NFCC reports the same value.
+ * @param cmd The command
+ * @param length Its length
+ * @return false if it is not a valid CORE_SET_CONFIG_CMD
+ */
+bool HalConfigReconciler::parseCore(const uint8_t* cmd, size_t length) {
+  size_t pos = 4;
+
+  if (length < 4 || cmd[0] != 0x20 || cmd[1] != NCI_CORE_SET_CONFIG_OID ||
+      (size_t)cmd[2] + 3 != length || cmd[3] > HAL_CONFIG_CORE_PARAMS_MAX) {
+    return false;
+  }
+  for (uint8_t i = 0; i < cmd[3]; i++) {
+    if (pos + 2 > length || pos + 2 + cmd[pos + 1] > length) return false;
+    CoreParam& p = mCoreParams[mCoreCount++];
+    p.id = cmd[pos];
+    p.length = cmd[pos + 1];
+    p.offset = pos + 2;
+    p.differs = true;
+    pos += 2 + p.length;
+  }
+  return pos == length;
+}
+
+/**
+ * Log and account what one application of the configuration sent.
+ * @param what Configuration applied
+ * @param stats Commands and bytes it sent and skipped
+ */
+void HalConfigReconciler::report(const char* what, const Stats& stats) {
+  HalMetrics& metrics = HalMetrics::getInstance();
+
+  metrics.increment(HalMetrics::CONFIG_READS, stats.reads);
+  metrics.increment(HalMetrics::CONFIG_SETS, stats.sets);
+  metrics.increment(HalMetrics::CONFIG_SET_BYTES, stats.setBytes);
+  metrics.increment(HalMetrics::CONFIG_SKIPPED, stats.skipped);
+  metrics.increment(HalMetrics::CONFIG_SKIPPED_BYTES, stats.skippedBytes);
+
+  STLOG_HAL_D("%s - %s: %u reads, %u sets (%u bytes), %u skipped (%u bytes)",
+              __func__, what, stats.reads, stats.sets, stats.setBytes,
+              stats.skipped, stats.skippedBytes);
+  HalEventLogger::getInstance().log()
+      << "config " << what << ": reads " << stats.reads << " sets "
+      << stats.sets << " (" << stats.setBytes << " bytes) skipped "
+      << stats.skipped << " (" << stats.skippedBytes << " bytes)"
+      << std::endl;
+}
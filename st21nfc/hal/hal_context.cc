@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <hardware/nfc.h>
+
+#include "hal_context.h"
+
+static thread_local StNfcContext* sThreadContext = nullptr;
+
+StNfcContext* StNfcContext::getDefault() {
+  static StNfcContext nfc_default_context;
+  return &nfc_default_context;
+}
+
+StNfcContext* StNfcContext::current() {
+  StNfcContext* ctx = sThreadContext;
+  return ctx ? ctx : getDefault();
+}
+
+void StNfcContext::bindThread(StNfcContext* ctx) { sThreadContext = ctx; }
+
+StNfcContext::Scope::Scope(StNfcContext* ctx) : mPrevious(sThreadContext) {
+  sThreadContext = ctx;
+}
+
+StNfcContext::Scope::~Scope() { sThreadContext = mPrevious; }
+
+I2cTransportContext* I2cTransportContext::current() {
+  return &StNfcContext::current()->transport;
+}
+
+HalCoreContext* HalCoreContext::current() {
+  return &StNfcContext::current()->core;
+}
+
+HalWrapperContext* HalWrapperContext::current() {
+  return &StNfcContext::current()->wrapper;
+}
+
+HalFdContext* HalFdContext::current() { return &StNfcContext::current()->fd; }
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hal_crc.h"
+
+#include <array>
+
+// CRC-16/CCITT, reflected: x^16 + x^12 + x^5 + 1
+#define CRC_POLY_REFLECTED 0x8408
+
+typedef std::array<std::array<uint16_t, 256>, 4> CrcTables;
+
+/*
+ * kCrcTables[0][b] is the CRC register update for the byte b. The next
+ * tables advance it by one more zero byte each, so that 4 input bytes are
+ * folded in with 4 independent lookups (slice-by-4).
+ */
+static constexpr CrcTables MakeCrcTables() {
+  CrcTables t{};
+  for (int i = 0; i < 256; i++) {
+    uint16_t crc = i;
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc & 1) ? (crc >> 1) ^ CRC_POLY_REFLECTED : crc >> 1;
+    }
+    t[0][i] = crc;
+  }
+  for (int k = 1; k < 4; k++) {
+    for (int i = 0; i < 256; i++) {
+      t[k][i] = (t[k - 1][i] >> 8) ^ t[0][t[k - 1][i] & 0xFF];
+    }
+  }
+  return t;
+}
+
+static constexpr CrcTables kCrcTables = MakeCrcTables();
+
+uint16_t iso14443_crc_init(int type) {
+  return type == Type_A ? CRC_PRESET_A : CRC_PRESET_B;
+}
+
+uint16_t iso14443_crc_update(uint16_t crc, const uint8_t* data,
+                             size_t szLen) {
+  for (; szLen >= 4; szLen -= 4, data += 4) {
+    uint16_t x = crc ^ (data[0] | (data[1] << 8));
+    crc = kCrcTables[3][x & 0xFF] ^ kCrcTables[2][x >> 8] ^
+          kCrcTables[1][data[2]] ^ kCrcTables[0][data[3]];
+  }
+  for (; szLen > 0; szLen--, data++) {
+    crc = (crc >> 8) ^ kCrcTables[0][(crc ^ *data) & 0xFF];
+  }
+  return crc;
+}
+
+uint16_t iso14443_crc(const uint8_t* data, size_t szLen, int type) {
+  return iso14443_crc_update(iso14443_crc_init(type), data, szLen);
+}
@@ -19,6 +19,7 @@
 #include <android-base/file.h>
 #include <android-base/logging.h>
 #include <fcntl.h>
+#include <hardware/nfc.h>
 #include <sys/stat.h>
 
 #include <cstring>
@@ -26,13 +27,13 @@
 
 #include "config.h"
 #include "hal_config.h"
+#include "hal_context.h"
+#include "hal_timeline.h"
 
 #define TIMESTAMP_BUFFER_SIZE 64
 #define HAL_LOG_FILE_SIZE 32 * 1024 * 1024
 #define HAL_MEM_BUFFER_SIZE 256 * 1024
 
-TimerActivity TimerAct;
-
 HalEventLogger& HalEventLogger::getInstance() {
   static HalEventLogger nfc_event_eventLogger;
   return nfc_event_eventLogger;
@@ -70,6 +71,9 @@ void HalEventLogger::initialize() {
   unsigned long num = 0;
   char HalLogPath[256];
 
+  // Each controller initializes the log when it is opened
+  std::unique_lock<std::mutex> lock(mMutex);
+
   if (GetNumValue(NAME_HAL_EVENT_LOG_DEBUG_ENABLED, &num, sizeof(num))) {
     logging_enabled = (num == 1) ? true : false;
   }
@@ -86,6 +90,7 @@ void HalEventLogger::initialize() {
   }
   EventFilePath = HalLogPath;
   EventFilePath += "/hal_event_log.txt";
+  lock.unlock();
 
   store_timer_activity("none", 0);
 }
@@ -113,7 +118,7 @@ void HalEventLogger::store_log() {
 }
 
 void HalEventLogger::dump_log(int fd) {
-  std::lock_guard<std::mutex> lock(mMutex);
+  std::unique_lock<std::mutex> lock(mMutex);
   LOG(DEBUG) << __func__;
   if (!logging_enabled) return;
   std::ostringstream oss;
@@ -133,6 +138,8 @@ void HalEventLogger::dump_log(int fd) {
               << " not exists or no content";
     oss << ss.str();
   }
+  // The reader of the dump may be slow, the log goes on meanwhile.
+  lock.unlock();
 
   dprintf(fd, "===== Nfc HAL Event Log v1 =====\n");
   ::android::base::WriteStringToFd(oss.str(), fd);
@@ -141,6 +148,8 @@ void HalEventLogger::dump_log(int fd) {
 }
 
 void HalEventLogger::store_timer_activity(std::string activity, uint32_t duration) {
-  TimerAct.activity = activity;
-  TimerAct.duration = duration;
+  TimerActivity* timerAct = &HalWrapperContext::current()->TimerAct;
+  timerAct->activity = activity;
+  timerAct->duration = duration;
+  if (duration) HalTimeline::getInstance().timerStart(activity, duration);
 }
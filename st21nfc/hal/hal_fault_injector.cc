@@ -0,0 +1,284 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hal_fault_injector.h"
+
+#include <cutils/properties.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "android_logmsg.h"
+#include "hal_event_logger.h"
+#include "hal_metrics.h"
+
+#define HAL_FAULT_INJECTION_PROP "vendor.nfc.debug.fault_injection"
+#define HAL_FAULT_SCHEDULE_SIZE 256
+
+// Above the 20 Act -> Act NTFs tolerated by the wrapper in READY.
+#define HAL_FAULT_ACT_STORM_COUNT 21
+#define HAL_FAULT_DELAY_MS 1100
+
+static const char* kFaultNames[HalFaultInjector::FAULT_MAX] = {
+    "short_read", "write_error", "idle_storm", "truncate",
+    "delay",      "reset_ntf",   "act_storm",  "overflow",
+};
+
+// CORE_RESET_NTF, reason unspecified
+static const uint8_t kResetNtf[] = {0x60, 0x00, 0x03, 0x00, 0x00, 0x00};
+// RF_DEACTIVATE of the active RW link, as seen without activation
+static const uint8_t kActToActNtf[] = {0x6F, 0x06, 0x00};
+// CORE_GENERIC_ERROR_NTF(buffer overflow)
+static const uint8_t kOverflowNtf[] = {0x60, 0x07, 0x01, 0xE1};
+
+static uint64_t HalFaultNowUs() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static bool HalFaultIsFrameFault(int fault) {
+  return fault == HalFaultInjector::RESET_NTF ||
+         fault == HalFaultInjector::ACT_STORM ||
+         fault == HalFaultInjector::OVERFLOW;
+}
+
+HalFaultInjector::HalFaultInjector()
+    : mEnabled(false),
+      mRules(),
+      mPending(),
+      mPendingCount(),
+      mPendingHead(0),
+      mPendingLength(0),
+      mLastFault(FAULT_MAX),
+      mLastFaultUs(0) {}
+
+void HalFaultInjector::configure() {
+  char schedule[HAL_FAULT_SCHEDULE_SIZE] = {0};
+
+  if (property_get(HAL_FAULT_INJECTION_PROP, schedule, "") <= 0 &&
+      !GetStrValue(NAME_STNFC_FAULT_INJECTION, schedule, sizeof(schedule))) {
+    schedule[0] = '\0';
+  }
+  configure(schedule);
+}
+
+bool HalFaultInjector::configure(const char* schedule) {
+  char buffer[HAL_FAULT_SCHEDULE_SIZE];
+  char* saveptr = NULL;
+  unsigned long seed = (unsigned long)HalFaultNowUs();
+  bool ok = true;
+
+  mEnabled = false;
+  memset(mRules, 0, sizeof(mRules));
+  mPendingHead = 0;
+  mPendingLength = 0;
+  mLastFault = FAULT_MAX;
+  if (schedule == NULL || schedule[0] == '\0') return true;
+
+  strncpy(buffer, schedule, sizeof(buffer) - 1);
+  buffer[sizeof(buffer) - 1] = '\0';
+  for (char* rule = strtok_r(buffer, "; ", &saveptr); rule != NULL;
+       rule = strtok_r(NULL, "; ", &saveptr)) {
+    if (strncmp(rule, "seed=", 5) == 0) {
+      seed = strtoul(rule + 5, NULL, 0);
+    } else if (!parseRule(rule)) {
+      STLOG_HAL_E("%s - invalid fault rule '%s'", __func__, rule);
+      ok = false;
+    }
+  }
+
+  if (!ok) {
+    memset(mRules, 0, sizeof(mRules));
+    return false;
+  }
+  for (const Rule& rule : mRules) mEnabled |= rule.active;
+  mRandom.seed(seed);
+
+  STLOG_HAL_W("%s - fault injection enabled: %s, seed %lu", __func__,
+              schedule, seed);
+  HalEventLogger::getInstance().log()
+      << __func__ << " fault injection " << schedule << " seed " << seed
+      << std::endl;
+  return true;
+}
+
+/**
+ * Parse one "<fault>:<key>=<value>,..." rule.
+ * @return false if the fault or a key is unknown, or a value out of range
+ */
+bool HalFaultInjector::parseRule(char* rule) {
+  char* saveptr = NULL;
+  char* keys = strchr(rule, ':');
+  int fault;
+
+  if (keys) *keys++ = '\0';
+  for (fault = 0; fault < FAULT_MAX; fault++) {
+    if (strcmp(rule, kFaultNames[fault]) == 0) break;
+  }
+  if (fault == FAULT_MAX) return false;
+
+  Rule& r = mRules[fault];
+  memset(&r, 0, sizeof(r));
+  r.active = true;
+  r.count = fault == ACT_STORM ? HAL_FAULT_ACT_STORM_COUNT : 1;
+  r.delayMs = HAL_FAULT_DELAY_MS;
+
+  for (char* key = keys ? strtok_r(keys, ",", &saveptr) : NULL; key != NULL;
+       key = strtok_r(NULL, ",", &saveptr)) {
+    char* value = strchr(key, '=');
+    if (!value) return false;
+    *value++ = '\0';
+
+    if (strcmp(key, "p") == 0) {
+      r.probability = strtod(value, NULL);
+      if (r.probability <= 0 || r.probability > 1) return false;
+    } else if (strcmp(key, "at") == 0) {
+      r.at = strtoul(value, NULL, 0);
+    } else if (strcmp(key, "every") == 0) {
+      r.every = strtoul(value, NULL, 0);
+    } else if (strcmp(key, "limit") == 0) {
+      r.limit = strtoul(value, NULL, 0);
+    } else if (strcmp(key, "count") == 0) {
+      r.count = strtoul(value, NULL, 0);
+      if (r.count == 0) return false;
+    } else if (strcmp(key, "ms") == 0) {
+      r.delayMs = strtoul(value, NULL, 0);
+    } else if (strcmp(key, "match") == 0) {
+      size_t digits = strlen(value);
+      if (digits == 0 || digits % 2 || digits / 2 > HAL_FAULT_MATCH_MAX) {
+        return false;
+      }
+      for (size_t i = 0; i < digits / 2; i++) {
+        char octet[3] = {value[2 * i], value[2 * i + 1], '\0'};
+        char* end;
+        r.match[i] = (uint8_t)strtoul(octet, &end, 16);
+        if (*end != '\0') return false;
+      }
+      r.matchLength = digits / 2;
+    } else {
+      return false;
+    }
+  }
+
+  // No schedule at all: every opportunity.
+  if (r.at == 0 && r.every == 0 && r.probability == 0) r.every = 1;
+  return true;
+}
+
+bool HalFaultInjector::inject(Fault fault, const uint8_t* data,
+                              size_t length) {
+  Rule& rule = mRules[fault];
+  bool trigger;
+
+  if (!mEnabled || !rule.active) return false;
+  if (rule.matchLength &&
+      (data == NULL || length < rule.matchLength ||
+       memcmp(data, rule.match, rule.matchLength) != 0)) {
+    return false;
+  }
+
+  if (rule.burst > 0) {
+    rule.burst--;
+    hit(fault);
+    return true;
+  }
+  if (rule.limit && rule.triggers >= rule.limit) return false;
+
+  rule.opportunities++;
+  if (rule.at) {
+    trigger = rule.opportunities == rule.at;
+  } else if (rule.every) {
+    trigger = rule.opportunities % rule.every == 0;
+  } else {
+    trigger = std::uniform_real_distribution<double>(0, 1)(mRandom) <
+              rule.probability;
+  }
+  if (!trigger) return false;
+
+  rule.triggers++;
+  if (!HalFaultIsFrameFault(fault)) rule.burst = rule.count - 1;
+  hit(fault);
+  return true;
+}
+
+void HalFaultInjector::onRxFrame(const uint8_t* data, size_t length) {
+  for (int fault = RESET_NTF; fault <= OVERFLOW; fault++) {
+    if (mPendingLength == HAL_FAULT_FRAME_MAX) return;
+    if (!inject((Fault)fault, data, length)) continue;
+
+    size_t tail = (mPendingHead + mPendingLength) % HAL_FAULT_FRAME_MAX;
+    mPending[tail] = (Fault)fault;
+    mPendingCount[tail] = mRules[fault].count;
+    mPendingLength++;
+  }
+}
+
+bool HalFaultInjector::nextFrame(uint8_t* data, size_t* length) {
+  const uint8_t* frame;
+
+  if (mPendingLength == 0) return false;
+
+  switch (mPending[mPendingHead]) {
+    case RESET_NTF:
+      frame = kResetNtf;
+      *length = sizeof(kResetNtf);
+      break;
+    case ACT_STORM:
+      frame = kActToActNtf;
+      *length = sizeof(kActToActNtf);
+      break;
+    default:
+      frame = kOverflowNtf;
+      *length = sizeof(kOverflowNtf);
+      break;
+  }
+  memcpy(data, frame, *length);
+
+  if (--mPendingCount[mPendingHead] == 0) {
+    mPendingHead = (mPendingHead + 1) % HAL_FAULT_FRAME_MAX;
+    mPendingLength--;
+  }
+  return true;
+}
+
+void HalFaultInjector::noteRecovery() {
+  int fault = mLastFault.exchange(FAULT_MAX, std::memory_order_acquire);
+  if (fault == FAULT_MAX) return;
+
+  uint64_t detectUs =
+      HalFaultNowUs() - mLastFaultUs.load(std::memory_order_relaxed);
+  if (detectUs > (uint64_t)HAL_FAULT_CORRELATION_WINDOW * 1000) return;
+
+  STLOG_HAL_W("%s - recovery %llu us after %s", __func__,
+              (unsigned long long)detectUs, kFaultNames[fault]);
+  HalMetrics::getInstance().countFaultRecovery((Fault)fault, detectUs);
+}
+
+const char* HalFaultInjector::faultName(Fault fault) {
+  if (fault >= FAULT_MAX) return "unknown";
+  return kFaultNames[fault];
+}
+
+void HalFaultInjector::hit(Fault fault) {
+  mLastFaultUs.store(HalFaultNowUs(), std::memory_order_relaxed);
+  mLastFault.store(fault, std::memory_order_release);
+  HalMetrics::getInstance().countFault(fault);
+
+  STLOG_HAL_W("%s - injecting %s", __func__, kFaultNames[fault]);
+  HalEventLogger::getInstance().log()
+      << __func__ << " " << kFaultNames[fault] << std::endl;
+}
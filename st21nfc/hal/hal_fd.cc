@@ -26,29 +26,11 @@
 #include <string.h>
 
 #include "android_logmsg.h"
+#include "hal_context.h"
 #include "hal_event_logger.h"
+#include "hal_metrics.h"
+#include "hal_threads.h"
 #include "halcore.h"
-/* Initialize fw info structure pointer used to access fw info structure */
-FWInfo* mFWInfo = NULL;
-
-FWCap* mFWCap = NULL;
-
-FILE* mFwFileBin;
-FILE* mCustomFileBin;
-char* mCustomFileBuffer;
-fpos_t mPos;
-fpos_t mPosInit;
-uint8_t mBinData[260];
-bool mRetry = true;
-bool mCustomParamFailed = false;
-bool mCustomParamDone = false;
-bool mUwbConfigDone = false;
-bool mUwbConfigNeeded = false;
-bool mGetCustomerField = false;
-uint8_t* pCmd;
-int mFWRecovCount = 0;
-const char* FwType = "generic";
-char mApduAuthent[24];
 
 static const uint8_t propNfcModeSetCmdOn[] = {0x2f, 0x02, 0x02, 0x02, 0x01};
 static const uint8_t coreInitCmd[] = {0x20, 0x01, 0x02, 0x00, 0x00};
@@ -113,12 +95,12 @@ static const uint8_t nciGetPropConfig[8] = {0x2F, 0x02, 0x05, 0x03,
                                             0x00, 0x06, 0x01, 0x00};
 static const uint8_t nciSetPropConfig[9] = {0x2F, 0x02, 0x00, 0x04, 0x00,
                                             0x06, 0x01, 0x00, 0x00};
-static uint8_t nciPropSetUwbConfig[128];
-static uint8_t nciPropSetConfig_CustomField[64];
-hal_fd_state_e mHalFDState = HAL_FD_STATE_AUTHENTICATE;
-hal_fd_st54l_state_e mHalFD54LState = HAL_FD_ST54L_STATE_PUY_KEYUSER;
 void SendExitLoadMode(HALHANDLE mmHalHandle);
 void SendSwitchToUserMode(HALHANDLE mmHalHandle);
+static bool hal_fd_read_frame(FILE* file, uint8_t* frame);
+static bool hal_fd_send_custom_frame(HALHANDLE mHalHandle, bool again);
+static bool hal_fd_find_uwb_conf();
+static void hal_fd_uwb_lib_name(char* name, size_t size);
 extern void hal_wrapper_update_complete();
 
 typedef size_t (*STLoadUwbParams)(void* out_buff, size_t buf_size);
@@ -154,6 +136,7 @@ static int GetProdType(uint8_t* UserKey) {
 }
 
 void hal_fd_parse_custom_file_txt_line(size_t* fileBinSize, char* line) {
+  HalFdContext* ctx = HalFdContext::current();
   const char* direct_ctrl_skip = "NCI_DIRECT_CTRL,2F,02,";
   const char* direct_ctrl = "NCI_DIRECT_CTRL";
   const char* send_prop_skip = "NCI_SEND_PROP,0F,02,";
@@ -175,8 +158,8 @@ void hal_fd_parse_custom_file_txt_line(size_t* fileBinSize, char* line) {
   if (*line == '\0') return;
 
   size_t newFileBinSize = *fileBinSize;
-  mCustomFileBuffer[newFileBinSize++] = 0x2f;
-  mCustomFileBuffer[newFileBinSize++] = 0x02;
+  ctx->mCustomFileBuffer[newFileBinSize++] = 0x2f;
+  ctx->mCustomFileBuffer[newFileBinSize++] = 0x02;
   size_t lenOffset = newFileBinSize++;
 
   size_t payloadLen = 0;
@@ -201,7 +184,7 @@ void hal_fd_parse_custom_file_txt_line(size_t* fileBinSize, char* line) {
     n[nidx++] = *p;
     if (nidx == 2) {
       int value = (int)strtol(n, NULL, 16);
-      mCustomFileBuffer[newFileBinSize++] = value;
+      ctx->mCustomFileBuffer[newFileBinSize++] = value;
       nidx = 0;
       payloadLen++;
     }
@@ -217,12 +200,13 @@ void hal_fd_parse_custom_file_txt_line(size_t* fileBinSize, char* line) {
     return;
   }
 
-  mCustomFileBuffer[lenOffset] = payloadLen;
+  ctx->mCustomFileBuffer[lenOffset] = payloadLen;
 
   *fileBinSize = newFileBinSize;
 }
 
 void hal_fd_convert_custom_file_txt(FILE* customFileTxt) {
+  HalFdContext* ctx = HalFdContext::current();
   size_t fileBinSize = 0;
   char buffer[1024];
   char* line;
@@ -244,20 +228,21 @@ void hal_fd_convert_custom_file_txt(FILE* customFileTxt) {
   size_t fileBinMaxSize = ftell(customFileTxt);
   fseek(customFileTxt, 0, SEEK_SET);
 
-  mCustomFileBuffer = (char*)calloc(fileBinMaxSize, sizeof(*mCustomFileBuffer));
-  if (!mCustomFileBuffer) {
+  ctx->mCustomFileBuffer =
+      (char*)calloc(fileBinMaxSize, sizeof(*ctx->mCustomFileBuffer));
+  if (!ctx->mCustomFileBuffer) {
     STLOG_HAL_E("%s - Failed to allocate FW config binary\n", __func__);
     return;
   }
 
-  mCustomFileBuffer[fileBinSize++] = (crc >> 8) & 0xff;
-  mCustomFileBuffer[fileBinSize++] = crc & 0xff;
+  ctx->mCustomFileBuffer[fileBinSize++] = (crc >> 8) & 0xff;
+  ctx->mCustomFileBuffer[fileBinSize++] = crc & 0xff;
 
   while ((line = fgets(buffer, sizeof(buffer), customFileTxt))) {
     hal_fd_parse_custom_file_txt_line(&fileBinSize, line);
   }
 
-  mCustomFileBin = fmemopen(mCustomFileBuffer, fileBinSize, "r");
+  ctx->mCustomFileBin = fmemopen(ctx->mCustomFileBuffer, fileBinSize, "r");
 }
 
 void hal_fd_convert_custom_file_path(char* ConfPath) {
@@ -271,6 +256,92 @@ void hal_fd_convert_custom_file_path(char* ConfPath) {
   fclose(customFileTxt);
 }
 
+/**
+ * Open the FW patch and custom configuration files and read their versions.
+ * @return FW_PATCH_AVAILABLE and FW_CUSTOM_PARAM_AVAILABLE, as found
+ */
+static uint8_t hal_fd_load_files() {
+  HalFdContext* ctx = HalFdContext::current();
+  uint8_t result = 0;
+  int ret;
+
+  // Check if FW patch binary file is present
+  // If not, get recovery FW patch file
+  if ((ctx->mFwFileBin = fopen(ctx->mFwPath, "r")) == NULL) {
+    STLOG_HAL_D("%s - %s not detected", __func__, ctx->mFwPath);
+  } else {
+    STLOG_HAL_D("%s - %s file detected\n", __func__, ctx->mFwPath);
+    result |= FW_PATCH_AVAILABLE;
+
+    ret = fread(ctx->mBinData, sizeof(uint8_t), 4, ctx->mFwFileBin);
+    if (ret != 4) {
+      STLOG_HAL_E("%s did not read 4 bytes \n", __func__);
+    }
+    ctx->mFWInfo->fileFwVersion =
+        ctx->mBinData[0] << 24 | ctx->mBinData[1] << 16 |
+        ctx->mBinData[2] << 8 | ctx->mBinData[3];
+
+    fgetpos(ctx->mFwFileBin, &ctx->mPosInit);
+    ret = fread(ctx->mBinData, sizeof(uint8_t), 5, ctx->mFwFileBin);
+    if (ret != 5) {
+      STLOG_HAL_E("%s did not read 5 bytes \n", __func__);
+    }
+    fsetpos(ctx->mFwFileBin, &ctx->mPosInit);  // reset pos in stream
+
+    if (ctx->mBinData[4] == 0x35) {
+      ctx->mFWInfo->fileHwVersion = HW_ST54L;
+    } else {
+      ret = fread(ctx->mApduAuthent, sizeof(uint8_t), 24, ctx->mFwFileBin);
+      if (ret != 24) {
+        STLOG_HAL_E("%s Wrong read nb \n", __func__);
+      }
+
+      // We use the last byte of the auth command to discriminate at the moment.
+      // it can be extended in case of conflict later.
+      switch (ctx->mApduAuthent[23]) {
+        case 0x43:
+        case 0xC7:
+          ctx->mFWInfo->fileHwVersion = HW_NFCD;
+          break;
+
+        case 0xE9:
+          ctx->mFWInfo->fileHwVersion = HW_ST54J;
+          break;
+      }
+    }
+
+    if (ctx->mFWInfo->fileHwVersion == 0) {
+      STLOG_HAL_E("%s --> %s integrates unknown patch NFC FW -- rejected\n",
+                  __func__, ctx->mFwPath);
+      fclose(ctx->mFwFileBin);
+      ctx->mFwFileBin = NULL;
+    } else {
+      fgetpos(ctx->mFwFileBin, &ctx->mPosInit);
+
+      STLOG_HAL_D("%s --> %s integrates patch NFC FW version 0x%08X (r:%d)\n",
+                  __func__, ctx->mFwPath, ctx->mFWInfo->fileFwVersion,
+                  ctx->mFWInfo->fileHwVersion);
+    }
+  }
+
+  hal_fd_convert_custom_file_path(ctx->mConfPath);
+
+  if (ctx->mCustomFileBin == NULL &&
+      (ctx->mCustomFileBin = fopen(ctx->mConfPath, "r")) == NULL) {
+    STLOG_HAL_D("%s - st21nfc custom configuration not detected\n", __func__);
+  } else {
+    STLOG_HAL_D("%s - %s file detected\n", __func__, ctx->mConfPath);
+    fread(ctx->mBinData, sizeof(uint8_t), 2, ctx->mCustomFileBin);
+    ctx->mFWInfo->fileCustVersion = ctx->mBinData[0] << 8 | ctx->mBinData[1];
+    STLOG_HAL_D("%s --> st21nfc_custom configuration version 0x%04X \n",
+                __func__, ctx->mFWInfo->fileCustVersion);
+    result |= FW_CUSTOM_PARAM_AVAILABLE;
+  }
+
+  ctx->mFilesLoaded = true;
+  return result;
+}
+
 /**
  * Send a HW reset and decode NCI_CORE_RESET_NTF information
  * @param pHwVersion is used to return HW version, part of NCI_CORE_RESET_NTF
@@ -286,12 +357,12 @@ void hal_fd_convert_custom_file_path(char* ConfPath) {
  */
 
 int hal_fd_init() {
+  HalFdContext* ctx = HalFdContext::current();
   uint8_t result = 0;
   char FwPath[256];
   char ConfPath[256];
   char fwBinName[256];
   char fwConfName[256];
-  int ret;
 
   STLOG_HAL_D("  %s - enter", __func__);
 
@@ -329,135 +400,91 @@ int hal_fd_init() {
   STLOG_HAL_D("%s - FW config binary file = %s", __func__, ConfPath);
 
   // Initializing structure holding FW patch details
-  mFWInfo = (FWInfo*)malloc(sizeof(FWInfo));
+  ctx->mFWInfo = (FWInfo*)malloc(sizeof(FWInfo));
 
-  if (mFWInfo == NULL) {
+  if (ctx->mFWInfo == NULL) {
     result = 0;
   }
 
-  memset(mFWInfo, 0, sizeof(FWInfo));
+  memset(ctx->mFWInfo, 0, sizeof(FWInfo));
 
   // Initializing structure holding FW Capabilities
-  mFWCap = (FWCap*)malloc(sizeof(FWCap));
+  ctx->mFWCap = (FWCap*)malloc(sizeof(FWCap));
 
-  if (mFWCap == NULL) {
+  if (ctx->mFWCap == NULL) {
     result = 0;
   }
 
-  memset(mFWCap, 0, sizeof(FWCap));
-
-  mFwFileBin = NULL;
-  mCustomFileBin = NULL;
-  mCustomFileBuffer = NULL;
-
-  // Check if FW patch binary file is present
-  // If not, get recovery FW patch file
-  if ((mFwFileBin = fopen((char*)FwPath, "r")) == NULL) {
-    STLOG_HAL_D("%s - %s not detected", __func__, fwBinName);
+  memset(ctx->mFWCap, 0, sizeof(FWCap));
+
+  ctx->mFwFileBin = NULL;
+  ctx->mCustomFileBin = NULL;
+  ctx->mCustomFileBuffer = NULL;
+  ctx->mFilesLoaded = false;
+  snprintf(ctx->mFwPath, sizeof(ctx->mFwPath), "%s", FwPath);
+  snprintf(ctx->mConfPath, sizeof(ctx->mConfPath), "%s", ConfPath);
+
+  if (ctx->mSnapshot.identify(StNfcContext::current()->transport.devNode,
+                              FwPath, ConfPath) &&
+      ctx->mSnapshot.restore(&result, ctx->mFWInfo, ctx->mFWCap)) {
+    // Files left closed until the NFCC shows an update may be needed.
+    HalEventLogger::getInstance().log()
+        << __func__ << " warm start" << std::endl;
   } else {
-    STLOG_HAL_D("%s - %s file detected\n", __func__, fwBinName);
-    result |= FW_PATCH_AVAILABLE;
-
-    ret = fread(mBinData, sizeof(uint8_t), 4, mFwFileBin);
-    if (ret != 4) {
-      STLOG_HAL_E("%s did not read 4 bytes \n", __func__);
-    }
-    mFWInfo->fileFwVersion =
-        mBinData[0] << 24 | mBinData[1] << 16 | mBinData[2] << 8 | mBinData[3];
-
-    fgetpos(mFwFileBin, &mPosInit);
-    ret = fread(mBinData, sizeof(uint8_t), 5, mFwFileBin);
-    if (ret != 5) {
-      STLOG_HAL_E("%s did not read 5 bytes \n", __func__);
-    }
-    fsetpos(mFwFileBin, &mPosInit);  // reset pos in stream
-
-    if (mBinData[4] == 0x35) {
-      mFWInfo->fileHwVersion = HW_ST54L;
-    } else {
-      ret = fread(mApduAuthent, sizeof(uint8_t), 24, mFwFileBin);
-      if (ret != 24) {
-        STLOG_HAL_E("%s Wrong read nb \n", __func__);
-      }
-
-      // We use the last byte of the auth command to discriminate at the moment.
-      // it can be extended in case of conflict later.
-      switch (mApduAuthent[23]) {
-        case 0x43:
-        case 0xC7:
-          mFWInfo->fileHwVersion = HW_NFCD;
-          break;
-
-        case 0xE9:
-          mFWInfo->fileHwVersion = HW_ST54J;
-          break;
-      }
-    }
-
-    if (mFWInfo->fileHwVersion == 0) {
-      STLOG_HAL_E("%s --> %s integrates unknown patch NFC FW -- rejected\n",
-                  __func__, FwPath);
-      fclose(mFwFileBin);
-      mFwFileBin = NULL;
-    } else {
-      fgetpos(mFwFileBin, &mPosInit);
-
-      STLOG_HAL_D("%s --> %s integrates patch NFC FW version 0x%08X (r:%d)\n",
-                  __func__, FwPath, mFWInfo->fileFwVersion,
-                  mFWInfo->fileHwVersion);
-    }
+    result = hal_fd_load_files();
+    ctx->mSnapshot.store(result, ctx->mFWInfo);
   }
 
-  hal_fd_convert_custom_file_path(ConfPath);
-
-  if (mCustomFileBin == NULL &&
-      (mCustomFileBin = fopen((char*)ConfPath, "r")) == NULL) {
-    STLOG_HAL_D("%s - st21nfc custom configuration not detected\n", __func__);
-  } else {
-    STLOG_HAL_D("%s - %s file detected\n", __func__, ConfPath);
-    fread(mBinData, sizeof(uint8_t), 2, mCustomFileBin);
-    mFWInfo->fileCustVersion = mBinData[0] << 8 | mBinData[1];
-    STLOG_HAL_D("%s --> st21nfc_custom configuration version 0x%04X \n",
-                __func__, mFWInfo->fileCustVersion);
-    result |= FW_CUSTOM_PARAM_AVAILABLE;
-  }
-
-  if (ft_CheckUWBConf()) {
+  if (hal_fd_find_uwb_conf()) {
     result |= FW_UWB_PARAM_AVAILABLE;
   }
 
   return result;
 }
 
+void hal_fd_ensure_files() {
+  HalFdContext* ctx = HalFdContext::current();
+
+  if (ctx->mFilesLoaded) return;
+  STLOG_HAL_D("%s - update may be needed, load the files", __func__);
+  hal_fd_load_files();
+  HalEventLogger::getInstance().log()
+      << __func__ << " warm start, files loaded" << std::endl;
+}
+
 void hal_fd_close() {
+  HalFdContext* ctx = HalFdContext::current();
   STLOG_HAL_D("  %s -enter", __func__);
-  mCustomParamFailed = false;
-  if (mFWInfo != NULL) {
-    free(mFWInfo);
-    mFWInfo = NULL;
+  ctx->mCustomParamFailed = false;
+  ctx->mFilesLoaded = false;
+  if (ctx->mFWInfo != NULL) {
+    free(ctx->mFWInfo);
+    ctx->mFWInfo = NULL;
   }
-  if (mFwFileBin != NULL) {
-    fclose(mFwFileBin);
-    mFwFileBin = NULL;
+  if (ctx->mFwFileBin != NULL) {
+    fclose(ctx->mFwFileBin);
+    ctx->mFwFileBin = NULL;
   }
-  if (mCustomFileBin != NULL) {
-    fclose(mCustomFileBin);
-    mCustomFileBin = NULL;
+  if (ctx->mCustomFileBin != NULL) {
+    fclose(ctx->mCustomFileBin);
+    ctx->mCustomFileBin = NULL;
   }
-  if (mCustomFileBuffer != NULL) {
-    free(mCustomFileBuffer);
-    mCustomFileBuffer = NULL;
+  if (ctx->mCustomFileBuffer != NULL) {
+    free(ctx->mCustomFileBuffer);
+    ctx->mCustomFileBuffer = NULL;
   }
 }
 
 FWInfo* hal_fd_getFwInfo() {
+  HalFdContext* ctx = HalFdContext::current();
   STLOG_HAL_D("  %s -enter", __func__);
-  return mFWInfo;
+  return ctx->mFWInfo;
 }
 
 FWCap* hal_fd_getFwCap() {
+  HalFdContext* ctx = HalFdContext::current();
   STLOG_HAL_D("  %s -enter", __func__);
-  return mFWCap;
+  return ctx->mFWCap;
 }
 
 /**
@@ -475,6 +502,7 @@ FWCap* hal_fd_getFwCap() {
  */
 
 uint8_t ft_cmd_HwReset(uint8_t* pdata, uint8_t* clf_mode) {
+  HalFdContext* ctx = HalFdContext::current();
   uint8_t result = 0;
 
   STLOG_HAL_D("  %s - execution", __func__);
@@ -483,28 +511,28 @@ uint8_t ft_cmd_HwReset(uint8_t* pdata, uint8_t* clf_mode) {
     STLOG_HAL_D("-> Router Mode NCI_CORE_RESET_NTF received after HW Reset");
 
     /* retrieve HW Version from NCI_CORE_RESET_NTF */
-    mFWInfo->chipHwVersion = pdata[8];
-    STLOG_HAL_D("   HwVersion = 0x%02X", mFWInfo->chipHwVersion);
+    ctx->mFWInfo->chipHwVersion = pdata[8];
+    STLOG_HAL_D("   HwVersion = 0x%02X", ctx->mFWInfo->chipHwVersion);
 
     /* retrieve FW Version from NCI_CORE_RESET_NTF */
-    mFWInfo->chipFwVersion =
+    ctx->mFWInfo->chipFwVersion =
         (pdata[10] << 24) | (pdata[11] << 16) | (pdata[12] << 8) | pdata[13];
-    STLOG_HAL_D("   FwVersion = 0x%08X", mFWInfo->chipFwVersion);
+    STLOG_HAL_D("   FwVersion = 0x%08X", ctx->mFWInfo->chipFwVersion);
     uint8_t FWVersionMajor = (uint8_t)(hal_fd_getFwInfo()->chipFwVersion >> 24);
     uint8_t FWVersionMinor =
         (uint8_t)((hal_fd_getFwInfo()->chipFwVersion & 0x00FF0000) >> 16);
     /* retrieve Loader Version from NCI_CORE_RESET_NTF */
-    mFWInfo->chipLoaderVersion =
+    ctx->mFWInfo->chipLoaderVersion =
         (pdata[14] << 16) | (pdata[15] << 8) | pdata[16];
-    STLOG_HAL_D("   LoaderVersion = 0x%06X", mFWInfo->chipLoaderVersion);
+    STLOG_HAL_D("   LoaderVersion = 0x%06X", ctx->mFWInfo->chipLoaderVersion);
 
     /* retrieve Customer Version from NCI_CORE_RESET_NTF */
-    mFWInfo->chipCustVersion = (pdata[31] << 8) | pdata[32];
-    STLOG_HAL_D("   CustomerVersion = 0x%04X", mFWInfo->chipCustVersion);
+    ctx->mFWInfo->chipCustVersion = (pdata[31] << 8) | pdata[32];
+    STLOG_HAL_D("   CustomerVersion = 0x%04X", ctx->mFWInfo->chipCustVersion);
 
     /* retrieve Uwb param Version from NCI_CORE_RESET_NTF */
-    mFWInfo->chipUwbVersion = (pdata[29] << 8) | pdata[30];
-    STLOG_HAL_D("   uwbVersion = 0x%04X", mFWInfo->chipUwbVersion);
+    ctx->mFWInfo->chipUwbVersion = (pdata[29] << 8) | pdata[30];
+    STLOG_HAL_D("   uwbVersion = 0x%04X", ctx->mFWInfo->chipUwbVersion);
 
     *clf_mode = FT_CLF_MODE_ROUTER;
   } else if ((pdata[2] == 0x39) && (pdata[3] == 0xA1)) {
@@ -512,42 +540,42 @@ uint8_t ft_cmd_HwReset(uint8_t* pdata, uint8_t* clf_mode) {
 
     /* deduce HW Version from Factory Loader version */
     if (pdata[16] == 0x01) {
-      mFWInfo->chipHwVersion = 0x05;  // ST54J
+      ctx->mFWInfo->chipHwVersion = 0x05;  // ST54J
     } else if (pdata[16] == 0x02) {
-      mFWInfo->chipHwVersion = 0x04;  // ST21NFCD
+      ctx->mFWInfo->chipHwVersion = 0x04;  // ST21NFCD
     } else {
-      mFWInfo->chipHwVersion = 0x03;  // ST21NFCD
+      ctx->mFWInfo->chipHwVersion = 0x03;  // ST21NFCD
     }
-    STLOG_HAL_D("   HwVersion = 0x%02X", mFWInfo->chipHwVersion);
+    STLOG_HAL_D("   HwVersion = 0x%02X", ctx->mFWInfo->chipHwVersion);
 
     /* Identify the Active loader. Normally only one should be detected*/
     if (pdata[11] == 0xA0) {
-      mFWInfo->chipLoaderVersion =
+      ctx->mFWInfo->chipLoaderVersion =
           (pdata[8] << 16) | (pdata[9] << 8) | pdata[10];
       STLOG_HAL_D("         - Most recent loader activated, revision 0x%06X",
-                  mFWInfo->chipLoaderVersion);
+                  ctx->mFWInfo->chipLoaderVersion);
     }
     if (pdata[15] == 0xA0) {
-      mFWInfo->chipLoaderVersion =
+      ctx->mFWInfo->chipLoaderVersion =
           (pdata[12] << 16) | (pdata[13] << 8) | pdata[14];
       STLOG_HAL_D("         - Least recent loader activated, revision 0x%06X",
-                  mFWInfo->chipLoaderVersion);
+                  ctx->mFWInfo->chipLoaderVersion);
     }
     if (pdata[19] == 0xA0) {
-      mFWInfo->chipLoaderVersion =
+      ctx->mFWInfo->chipLoaderVersion =
           (pdata[16] << 16) | (pdata[17] << 8) | pdata[18];
       STLOG_HAL_D("         - Factory loader activated, revision 0x%06X",
-                  mFWInfo->chipLoaderVersion);
+                  ctx->mFWInfo->chipLoaderVersion);
     }
 
     *clf_mode = FT_CLF_MODE_LOADER;
   } else if ((pdata[2] == 0x41) && (pdata[3] == 0xA2)) {
     STLOG_HAL_D("-> Loader V3 Mode NCI_CORE_RESET_NTF received after HW Reset");
-    mFWInfo->chipHwVersion = HW_ST54L;
-    STLOG_HAL_D("   HwVersion = 0x%02X", mFWInfo->chipHwVersion);
-    mFWInfo->chipFwVersion = 0;  // make sure FW will be updated.
+    ctx->mFWInfo->chipHwVersion = HW_ST54L;
+    STLOG_HAL_D("   HwVersion = 0x%02X", ctx->mFWInfo->chipHwVersion);
+    ctx->mFWInfo->chipFwVersion = 0;  // make sure FW will be updated.
     /* retrieve Production type* from NCI_CORE_RESET_NTF */
-    mFWInfo->chipProdType = GetProdType(&pdata[44]);
+    ctx->mFWInfo->chipProdType = GetProdType(&pdata[44]);
     *clf_mode = FT_CLF_MODE_LOADER;
   } else {
     STLOG_HAL_E(
@@ -556,35 +584,47 @@ uint8_t ft_cmd_HwReset(uint8_t* pdata, uint8_t* clf_mode) {
     *clf_mode = FT_CLF_MODE_ERROR;
   }
 
-  if ((mFWInfo->chipHwVersion == HW_ST54J) ||
-      (mFWInfo->chipHwVersion == HW_ST54L)) {
-    if ((mFwFileBin != NULL) &&
-        (mFWInfo->fileFwVersion != mFWInfo->chipFwVersion)) {
+  // After a warm start, the files are only opened if they may be needed.
+  if (!ctx->mFilesLoaded &&
+      ((*clf_mode != FT_CLF_MODE_ROUTER) ||
+       ((ctx->mFWInfo->fileHwVersion != 0) &&
+        (ctx->mFWInfo->fileFwVersion != ctx->mFWInfo->chipFwVersion)) ||
+       ((ctx->mFWInfo->fileCustVersion != 0) &&
+        (ctx->mFWInfo->chipCustVersion != ctx->mFWInfo->fileCustVersion)))) {
+    hal_fd_ensure_files();
+  }
+
+  if ((ctx->mFWInfo->chipHwVersion == HW_ST54J) ||
+      (ctx->mFWInfo->chipHwVersion == HW_ST54L)) {
+    if ((ctx->mFwFileBin != NULL) &&
+        (ctx->mFWInfo->fileFwVersion != ctx->mFWInfo->chipFwVersion)) {
       STLOG_HAL_D("---> Firmware update needed from 0x%08X to 0x%08X\n",
-                  mFWInfo->chipFwVersion, mFWInfo->fileFwVersion);
+                  ctx->mFWInfo->chipFwVersion, ctx->mFWInfo->fileFwVersion);
 
       result |= FW_UPDATE_NEEDED;
     } else {
       STLOG_HAL_D("---> No Firmware update needed\n");
     }
 
-    if ((mFWInfo->fileCustVersion != 0) &&
-        (mFWInfo->chipCustVersion != mFWInfo->fileCustVersion)) {
+    if ((ctx->mFWInfo->fileCustVersion != 0) &&
+        (ctx->mFWInfo->chipCustVersion != ctx->mFWInfo->fileCustVersion)) {
       STLOG_HAL_D(
           "%s - Need to apply new st21nfc custom configuration settings from "
           "0x%04X to 0x%04X\n",
-          __func__, mFWInfo->chipCustVersion, mFWInfo->fileCustVersion);
-      if (!mCustomParamFailed) result |= CONF_UPDATE_NEEDED;
+          __func__, ctx->mFWInfo->chipCustVersion,
+          ctx->mFWInfo->fileCustVersion);
+      if (!ctx->mCustomParamFailed) result |= CONF_UPDATE_NEEDED;
     } else {
       STLOG_HAL_D("%s - No need to apply custom configuration settings\n",
                   __func__);
     }
   }
-  if ((mFWInfo->fileUwbVersion != 0) &&
-      (mFWInfo->fileUwbVersion != mFWInfo->chipUwbVersion)) {
+  if (ctx->mUwbAvailable && !ctx->mUwbLoaded) ft_CheckUWBConf();
+  if ((ctx->mFWInfo->fileUwbVersion != 0) &&
+      (ctx->mFWInfo->fileUwbVersion != ctx->mFWInfo->chipUwbVersion)) {
     result |= UWB_CONF_UPDATE_NEEDED;
     STLOG_HAL_D("%s - Need to apply new uwb param configuration \n", __func__);
-    mUwbConfigNeeded = true;
+    ctx->mUwbConfigNeeded = true;
   }
 
   uint8_t FWVersionMajor = (uint8_t)(hal_fd_getFwInfo()->chipFwVersion >> 24);
@@ -593,21 +633,25 @@ uint8_t ft_cmd_HwReset(uint8_t* pdata, uint8_t* clf_mode) {
 
   if (hal_fd_getFwInfo()->chipHwVersion == HW_ST54L &&
       (FWVersionMajor >= 0x2) && (FWVersionMinor >= 0x5)) {
-    mFWCap->ObserveMode = 0x2;
+    ctx->mFWCap->ObserveMode = 0x2;
   } else {
-    mFWCap->ObserveMode = 0x1;
+    ctx->mFWCap->ObserveMode = 0x1;
   }
   if (hal_fd_getFwInfo()->chipHwVersion == HW_ST54L &&
       (FWVersionMajor >= 0x2) && (FWVersionMinor >= 0x6)) {
-    mFWCap->ExitFrameSupport = 0x1;
+    ctx->mFWCap->ExitFrameSupport = 0x1;
   } else {
-    mFWCap->ExitFrameSupport = 0x0;
+    ctx->mFWCap->ExitFrameSupport = 0x0;
+  }
+  if ((*clf_mode == FT_CLF_MODE_ROUTER) && (result == 0)) {
+    ctx->mSnapshot.storeChip(ctx->mFWInfo, ctx->mFWCap);
   }
   return result;
 } /* ft_cmd_HwReset */
 
 void ExitHibernateHandler(HALHANDLE mHalHandle, uint16_t data_len,
                           uint8_t* p_data) {
+  HalFdContext* ctx = HalFdContext::current();
   STLOG_HAL_D("%s - Enter", __func__);
   if (data_len < 3) {
     STLOG_HAL_E("%s - Error, too short data (%d)", __func__, data_len);
@@ -616,18 +660,18 @@ void ExitHibernateHandler(HALHANDLE mHalHandle, uint16_t data_len,
   switch (p_data[0]) {
     case 0x40:  //
       STLOG_HAL_D("%s - hibernate_exited = %d ", __func__,
-                  mFWInfo->hibernate_exited);
+                  ctx->mFWInfo->hibernate_exited);
 
       // CORE_INIT_RSP
       if ((p_data[1] == 0x1) && (p_data[3] == 0x0) &&
-          (mFWInfo->hibernate_exited == 0)) {
+          (ctx->mFWInfo->hibernate_exited == 0)) {
         // Send PROP_NFC_MODE_SET_CMD(ON)
         if (!HalSendDownstream(mHalHandle, propNfcModeSetCmdOn,
                                sizeof(propNfcModeSetCmdOn))) {
           STLOG_HAL_E("%s - SendDownstream failed", __func__);
         }
       } else if ((p_data[1] == 0x1) && (p_data[3] == 0x0) &&
-                 (mFWInfo->hibernate_exited == 1)) {
+                 (ctx->mFWInfo->hibernate_exited == 1)) {
         STLOG_HAL_D(
             "%s - send NCI_PROP_NFC_FW_UPDATE_CMD and use 100 ms timer for "
             "each cmd from here",
@@ -648,7 +692,7 @@ void ExitHibernateHandler(HALHANDLE mHalHandle, uint16_t data_len,
 
     case 0x4f:  //
       if ((p_data[1] == 0x02) && (p_data[3] == 0x00) &&
-          (mFWInfo->hibernate_exited == 1)) {
+          (ctx->mFWInfo->hibernate_exited == 1)) {
         STLOG_HAL_D("%s - NCI_PROP_NFC_FW_RSP : loader mode", __func__);
         I2cResetPulse();
         hal_wrapper_set_state(HAL_WRAPPER_STATE_OPEN);
@@ -666,9 +710,9 @@ void ExitHibernateHandler(HALHANDLE mHalHandle, uint16_t data_len,
           STLOG_HAL_E("%s - SendDownstream failed", __func__);
         }
       } else if (p_data[3] == 0xa0) {
-        mFWInfo->hibernate_exited = 1;
+        ctx->mFWInfo->hibernate_exited = 1;
         STLOG_HAL_D("%s - hibernate_exited = %d ", __func__,
-                    mFWInfo->hibernate_exited);
+                    ctx->mFWInfo->hibernate_exited);
 
         if (!HalSendDownstream(mHalHandle, coreInitCmd, sizeof(coreInitCmd))) {
           STLOG_HAL_E("%s - SendDownstream failed", __func__);
@@ -679,43 +723,99 @@ void ExitHibernateHandler(HALHANDLE mHalHandle, uint16_t data_len,
 }
 
 bool ft_CheckUWBConf() {
+  HalFdContext* ctx = HalFdContext::current();
   char uwbLibName[256];
+  uint64_t start = HalThreads::nowUs();
+  size_t lengthOutput = 0;
   STLOG_HAL_D("%s", __func__);
 
-  if (!GetStrValue(NAME_STNFC_UWB_LIB_NAME, (char*)uwbLibName,
-                   sizeof(uwbLibName))) {
-    STLOG_HAL_D(
-        "%s - UWB conf library name not found in conf. use default name ",
-        __func__);
-    strcpy(uwbLibName, "/vendor/lib64/libqorvo_uwb_params_nfcc.so");
-  }
-
+  hal_fd_uwb_lib_name(uwbLibName, sizeof(uwbLibName));
   STLOG_HAL_D("%s - UWB conf library = %s", __func__, uwbLibName);
 
-  void* stdll = dlopen(uwbLibName, RTLD_NOW);
+  memset(ctx->nciPropSetUwbConfig, 0, sizeof(ctx->nciPropSetUwbConfig));
+  void* stdll = dlopen(uwbLibName, RTLD_NOW | RTLD_LOCAL);
   if (stdll) {
     STLoadUwbParams fn =
         (STLoadUwbParams)dlsym(stdll, "load_uwb_params_from_files");
     if (fn) {
-      size_t lengthOutput = fn(nciPropSetUwbConfig + 9, 100);
+      lengthOutput = fn(ctx->nciPropSetUwbConfig + 9, 100);
       STLOG_HAL_D("%s: lengthOutput = %zu", __func__, lengthOutput);
       if (lengthOutput > 0) {
-        memcpy(nciPropSetUwbConfig, nciHeaderPropSetUwbConfig, 9);
-        nciPropSetUwbConfig[2] = lengthOutput + 6;
-        nciPropSetUwbConfig[8] = lengthOutput;
-        mFWInfo->fileUwbVersion =
-            nciPropSetUwbConfig[9] << 8 | nciPropSetUwbConfig[10];
-        STLOG_HAL_D("%s --> uwb configuration version 0x%04X \n", __func__,
-                    mFWInfo->fileUwbVersion);
-        return true;
+        memcpy(ctx->nciPropSetUwbConfig, nciHeaderPropSetUwbConfig, 9);
+        ctx->nciPropSetUwbConfig[2] = lengthOutput + 6;
+        ctx->nciPropSetUwbConfig[8] = lengthOutput;
       } else {
         STLOG_HAL_D("%s: lengthOutput null", __func__);
       }
     }
+    // The parameters are built, the library is not needed anymore.
+    dlclose(stdll);
   } else {
     STLOG_HAL_D("libqorvo_uwb_params_nfcc not found, do nothing.");
   }
-  return false;
+
+  ctx->mFWInfo->fileUwbVersion =
+      lengthOutput > 0
+          ? ctx->nciPropSetUwbConfig[9] << 8 | ctx->nciPropSetUwbConfig[10]
+          : 0;
+  STLOG_HAL_D("%s --> uwb configuration version 0x%04X \n", __func__,
+              ctx->mFWInfo->fileUwbVersion);
+  ctx->mUwbLoaded = true;
+  ctx->mSnapshot.storeUwb(ctx->mSnapshot.uwbKey(uwbLibName),
+                          ctx->nciPropSetUwbConfig,
+                          sizeof(ctx->nciPropSetUwbConfig));
+  HalMetrics::getInstance().countOpenPhase(HalMetrics::OPEN_UWB_PARAMS,
+                                           HalThreads::nowUs() - start);
+  return lengthOutput > 0;
+}
+
+/**
+ * Name of the UWB parameters library, from the configuration.
+ * @param name Buffer for the name
+ * @param size Its size
+ */
+static void hal_fd_uwb_lib_name(char* name, size_t size) {
+  if (!GetStrValue(NAME_STNFC_UWB_LIB_NAME, name, size)) {
+    STLOG_HAL_D(
+        "%s - UWB conf library name not found in conf. use default name ",
+        __func__);
+    snprintf(name, size, "%s", "/vendor/lib64/libqorvo_uwb_params_nfcc.so");
+  }
+}
+
+/**
+ * Check for the UWB parameters library, without loading it: the parameters
+ * it builds are taken from the warm start snapshot if they are there for
+ * the same library and parameter files, else ft_CheckUWBConf() loads them
+ * when the version of the NFCC is to be compared.
+ * @return true if the library is there
+ */
+static bool hal_fd_find_uwb_conf() {
+  HalFdContext* ctx = HalFdContext::current();
+  char uwbLibName[256];
+  uint32_t key;
+
+  hal_fd_uwb_lib_name(uwbLibName, sizeof(uwbLibName));
+  key = ctx->mSnapshot.uwbKey(uwbLibName);
+  ctx->mUwbLoaded = false;
+  ctx->mUwbAvailable = key != 0;
+  if (!ctx->mUwbAvailable) {
+    STLOG_HAL_D("%s - %s not found, do nothing.", __func__, uwbLibName);
+    return false;
+  }
+
+  if (ctx->mSnapshot.restoreUwb(key, ctx->nciPropSetUwbConfig,
+                                sizeof(ctx->nciPropSetUwbConfig))) {
+    ctx->mUwbLoaded = true;
+    if (ctx->nciPropSetUwbConfig[2] != 0) {
+      ctx->mFWInfo->fileUwbVersion =
+          ctx->nciPropSetUwbConfig[9] << 8 | ctx->nciPropSetUwbConfig[10];
+    }
+    STLOG_HAL_D("%s - cached uwb configuration version 0x%04X", __func__,
+                ctx->mFWInfo->fileUwbVersion);
+    return ctx->nciPropSetUwbConfig[2] != 0;
+  }
+  return true;
 }
 /*******************************************************************************
 **
@@ -728,9 +828,10 @@ bool ft_CheckUWBConf() {
 **
 *******************************************************************************/
 void resetHandlerState() {
+  HalFdContext* ctx = HalFdContext::current();
   STLOG_HAL_D("%s", __func__);
-  mHalFDState = HAL_FD_STATE_AUTHENTICATE;
-  mHalFD54LState = HAL_FD_ST54L_STATE_PUY_KEYUSER;
+  ctx->mHalFDState = HAL_FD_STATE_AUTHENTICATE;
+  ctx->mHalFD54LState = HAL_FD_ST54L_STATE_PUY_KEYUSER;
 }
 
 /*******************************************************************************
@@ -746,9 +847,10 @@ void resetHandlerState() {
 **
 *******************************************************************************/
 void UpdateHandler(HALHANDLE mHalHandle, uint16_t data_len, uint8_t* p_data) {
+  HalFdContext* ctx = HalFdContext::current();
   HalSendDownstreamStopTimer(mHalHandle);
 
-  switch (mHalFDState) {
+  switch (ctx->mHalFDState) {
     case HAL_FD_STATE_AUTHENTICATE:
       STLOG_HAL_D("%s - mHalFDState = HAL_FD_STATE_AUTHENTICATE", __func__);
 
@@ -756,11 +858,12 @@ void UpdateHandler(HALHANDLE mHalHandle, uint16_t data_len, uint8_t* p_data) {
         STLOG_HAL_D("%s - send APDU_AUTHENTICATION_CMD", __func__);
         HalEventLogger::getInstance().store_timer_activity(
             "send APDU_AUTHENTICATION_CMD", FW_TIMER_DURATION);
-        if (!HalSendDownstreamTimer(mHalHandle, (uint8_t*)mApduAuthent,
-                                    sizeof(mApduAuthent), FW_TIMER_DURATION)) {
+        if (!HalSendDownstreamTimer(mHalHandle, (uint8_t*)ctx->mApduAuthent,
+                                    sizeof(ctx->mApduAuthent),
+                                    FW_TIMER_DURATION)) {
           STLOG_HAL_E("%s - SendDownstream failed", __func__);
         }
-        mHalFDState = HAL_FD_STATE_ERASE_FLASH;
+        ctx->mHalFDState = HAL_FD_STATE_ERASE_FLASH;
       } else {
         STLOG_HAL_D("%s - FW flash not succeeded", __func__);
         SendExitLoadMode(mHalHandle);
@@ -783,9 +886,9 @@ void UpdateHandler(HALHANDLE mHalHandle, uint16_t data_len, uint8_t* p_data) {
             STLOG_HAL_E("%s - SendDownstream failed", __func__);
           }
 
-          fsetpos(mFwFileBin, &mPosInit);  // reset pos in stream
+          fsetpos(ctx->mFwFileBin, &ctx->mPosInit);  // reset pos in stream
 
-          mHalFDState = HAL_FD_STATE_SEND_RAW_APDU;
+          ctx->mHalFDState = HAL_FD_STATE_SEND_RAW_APDU;
 
         } else {
           STLOG_HAL_D("%s - FW flash not succeeded", __func__);
@@ -798,15 +901,15 @@ void UpdateHandler(HALHANDLE mHalHandle, uint16_t data_len, uint8_t* p_data) {
       STLOG_HAL_D("%s - mHalFDState = HAL_FD_STATE_SEND_RAW_APDU", __func__);
       if ((p_data[0] == 0x4f) && (p_data[1] == 0x04)) {
         if ((p_data[data_len - 2] == 0x90) && (p_data[data_len - 1] == 0x00)) {
-          mRetry = true;
+          ctx->mRetry = true;
 
-          fgetpos(mFwFileBin, &mPos);  // save current position in stream
-          if ((fread(mBinData, sizeof(uint8_t), 3, mFwFileBin) == 3) &&
-              (fread(mBinData + 3, sizeof(uint8_t), mBinData[2], mFwFileBin) ==
-               mBinData[2])) {
+          // save current position in stream
+          fgetpos(ctx->mFwFileBin, &ctx->mPos);
+          if (hal_fd_read_frame(ctx->mFwFileBin, ctx->mBinData)) {
             HalEventLogger::getInstance().log()
                 << __func__ << "  LINE: " << __LINE__ << std::endl;
-            if (!HalSendDownstreamTimer(mHalHandle, mBinData, mBinData[2] + 3,
+            if (!HalSendDownstreamTimer(mHalHandle, ctx->mBinData,
+                                        ctx->mBinData[2] + 3,
                                         FW_TIMER_DURATION)) {
               STLOG_HAL_E("%s - SendDownstream failed", __func__);
             }
@@ -814,20 +917,20 @@ void UpdateHandler(HALHANDLE mHalHandle, uint16_t data_len, uint8_t* p_data) {
             STLOG_HAL_D("%s - EOF of FW binary", __func__);
             SendExitLoadMode(mHalHandle);
           }
-        } else if (mRetry == true) {
+        } else if (ctx->mRetry == true) {
           STLOG_HAL_D("%s - Last Tx was NOK. Retry", __func__);
-          mRetry = false;
-          fsetpos(mFwFileBin, &mPos);
-          if ((fread(mBinData, sizeof(uint8_t), 3, mFwFileBin) == 3) &&
-              (fread(mBinData + 3, sizeof(uint8_t), mBinData[2], mFwFileBin) ==
-               mBinData[2])) {
+          ctx->mRetry = false;
+          fsetpos(ctx->mFwFileBin, &ctx->mPos);
+          if (hal_fd_read_frame(ctx->mFwFileBin, ctx->mBinData)) {
             HalEventLogger::getInstance().store_timer_activity(
                 "Last Tx was NOK. Retry", FW_TIMER_DURATION);
-            if (!HalSendDownstreamTimer(mHalHandle, mBinData, mBinData[2] + 3,
+            if (!HalSendDownstreamTimer(mHalHandle, ctx->mBinData,
+                                        ctx->mBinData[2] + 3,
                                         FW_TIMER_DURATION)) {
               STLOG_HAL_E("%s - SendDownstream failed", __func__);
             }
-            fgetpos(mFwFileBin, &mPos);  // save current position in stream
+            // save current position in stream
+            fgetpos(ctx->mFwFileBin, &ctx->mPos);
           } else {
             STLOG_HAL_D("%s - EOF of FW binary", __func__);
             SendExitLoadMode(mHalHandle);
@@ -851,7 +954,7 @@ void UpdateHandler(HALHANDLE mHalHandle, uint16_t data_len, uint8_t* p_data) {
 
       I2cResetPulse();
       hal_wrapper_set_state(HAL_WRAPPER_STATE_OPEN);
-      mHalFDState = HAL_FD_STATE_AUTHENTICATE;
+      ctx->mHalFDState = HAL_FD_STATE_AUTHENTICATE;
       break;
 
     default:
@@ -876,19 +979,20 @@ void UpdateHandler(HALHANDLE mHalHandle, uint16_t data_len, uint8_t* p_data) {
 *******************************************************************************/
 static void UpdateHandlerST54L(HALHANDLE mHalHandle, uint16_t data_len,
                                uint8_t* p_data) {
-  STLOG_HAL_D("%s : Enter state = %d", __func__, mHalFD54LState);
+  HalFdContext* ctx = HalFdContext::current();
+  STLOG_HAL_D("%s : Enter state = %d", __func__, ctx->mHalFD54LState);
 
-  switch (mHalFD54LState) {
+  switch (ctx->mHalFD54LState) {
     case HAL_FD_ST54L_STATE_PUY_KEYUSER:
       HalEventLogger::getInstance().store_timer_activity("ApduPutKeyUser1",
                                                          FW_TIMER_DURATION);
       if (!HalSendDownstreamTimer(
-              mHalHandle, (uint8_t*)ApduPutKeyUser1[mFWInfo->chipProdType],
-              sizeof(ApduPutKeyUser1[mFWInfo->chipProdType]),
+              mHalHandle, (uint8_t*)ApduPutKeyUser1[ctx->mFWInfo->chipProdType],
+              sizeof(ApduPutKeyUser1[ctx->mFWInfo->chipProdType]),
               FW_TIMER_DURATION)) {
         STLOG_HAL_E("%s - SendDownstream failed", __func__);
       }
-      mHalFD54LState = HAL_FD_ST54L_STATE_ERASE_UPGRADE_START;
+      ctx->mHalFD54LState = HAL_FD_ST54L_STATE_ERASE_UPGRADE_START;
       break;
 
     case HAL_FD_ST54L_STATE_ERASE_UPGRADE_START:
@@ -900,7 +1004,7 @@ static void UpdateHandlerST54L(HALHANDLE mHalHandle, uint16_t data_len,
                                     FW_TIMER_DURATION)) {
           STLOG_HAL_E("%s - SendDownstream failed", __func__);
         }
-        mHalFD54LState = HAL_FD_ST54L_STATE_ERASE_NFC_AREA;
+        ctx->mHalFD54LState = HAL_FD_ST54L_STATE_ERASE_NFC_AREA;
       } else {
         STLOG_HAL_D("%s - FW flash not succeeded", __func__);
         SendSwitchToUserMode(mHalHandle);
@@ -916,7 +1020,7 @@ static void UpdateHandlerST54L(HALHANDLE mHalHandle, uint16_t data_len,
                                     FW_TIMER_DURATION)) {
           STLOG_HAL_E("%s - SendDownstream failed", __func__);
         }
-        mHalFD54LState = HAL_FD_ST54L_STATE_ERASE_UPGRADE_STOP;
+        ctx->mHalFD54LState = HAL_FD_ST54L_STATE_ERASE_UPGRADE_STOP;
       } else {
         STLOG_HAL_D("%s - FW flash not succeeded", __func__);
         SendSwitchToUserMode(mHalHandle);
@@ -932,7 +1036,7 @@ static void UpdateHandlerST54L(HALHANDLE mHalHandle, uint16_t data_len,
                                     FW_TIMER_DURATION)) {
           STLOG_HAL_E("%s - SendDownstream failed", __func__);
         }
-        mHalFD54LState = HAL_FD_ST54L_STATE_SEND_RAW_APDU;
+        ctx->mHalFD54LState = HAL_FD_ST54L_STATE_SEND_RAW_APDU;
       } else {
         STLOG_HAL_D("%s - FW flash not succeeded", __func__);
         SendSwitchToUserMode(mHalHandle);
@@ -944,15 +1048,15 @@ static void UpdateHandlerST54L(HALHANDLE mHalHandle, uint16_t data_len,
                   __func__);
       if ((p_data[0] == 0x4f) && (p_data[1] == 0x04)) {
         if ((p_data[data_len - 2] == 0x90) && (p_data[data_len - 1] == 0x00)) {
-          mRetry = true;
+          ctx->mRetry = true;
 
-          fgetpos(mFwFileBin, &mPos);  // save current position in stream
-          if ((fread(mBinData, sizeof(uint8_t), 3, mFwFileBin) == 3) &&
-              (fread(mBinData + 3, sizeof(uint8_t), mBinData[2], mFwFileBin) ==
-               mBinData[2])) {
+          // save current position in stream
+          fgetpos(ctx->mFwFileBin, &ctx->mPos);
+          if (hal_fd_read_frame(ctx->mFwFileBin, ctx->mBinData)) {
             HalEventLogger::getInstance().store_timer_activity(
                 "mBinData", FW_TIMER_DURATION);
-            if (!HalSendDownstreamTimer(mHalHandle, mBinData, mBinData[2] + 3,
+            if (!HalSendDownstreamTimer(mHalHandle, ctx->mBinData,
+                                        ctx->mBinData[2] + 3,
                                         FW_TIMER_DURATION)) {
               STLOG_HAL_E("%s - SendDownstream failed", __func__);
             }
@@ -965,22 +1069,22 @@ static void UpdateHandlerST54L(HALHANDLE mHalHandle, uint16_t data_len,
                     sizeof(ApduSetVariousConfig), FW_TIMER_DURATION)) {
               STLOG_HAL_E("%s - SendDownstream failed", __func__);
             }
-            mHalFD54LState = HAL_FD_ST54L_STATE_SET_CONFIG;
+            ctx->mHalFD54LState = HAL_FD_ST54L_STATE_SET_CONFIG;
           }
-        } else if (mRetry == true) {
+        } else if (ctx->mRetry == true) {
           STLOG_HAL_D("%s - Last Tx was NOK. Retry", __func__);
-          mRetry = false;
-          fsetpos(mFwFileBin, &mPos);
-          if ((fread(mBinData, sizeof(uint8_t), 3, mFwFileBin) == 3) &&
-              (fread(mBinData + 3, sizeof(uint8_t), mBinData[2], mFwFileBin) ==
-               mBinData[2])) {
+          ctx->mRetry = false;
+          fsetpos(ctx->mFwFileBin, &ctx->mPos);
+          if (hal_fd_read_frame(ctx->mFwFileBin, ctx->mBinData)) {
             HalEventLogger::getInstance().store_timer_activity(
                 "Last Tx was NOK. Retry", FW_TIMER_DURATION);
-            if (!HalSendDownstreamTimer(mHalHandle, mBinData, mBinData[2] + 3,
+            if (!HalSendDownstreamTimer(mHalHandle, ctx->mBinData,
+                                        ctx->mBinData[2] + 3,
                                         FW_TIMER_DURATION)) {
               STLOG_HAL_E("%s - SendDownstream failed", __func__);
             }
-            fgetpos(mFwFileBin, &mPos);  // save current position in stream
+            // save current position in stream
+            fgetpos(ctx->mFwFileBin, &ctx->mPos);
           } else {
             STLOG_HAL_D("%s - EOF of FW binary", __func__);
             HalEventLogger::getInstance().store_timer_activity(
@@ -990,7 +1094,7 @@ static void UpdateHandlerST54L(HALHANDLE mHalHandle, uint16_t data_len,
                     sizeof(ApduSetVariousConfig), FW_TIMER_DURATION)) {
               STLOG_HAL_E("%s - SendDownstream failed", __func__);
             }
-            mHalFD54LState = HAL_FD_ST54L_STATE_SET_CONFIG;
+            ctx->mHalFD54LState = HAL_FD_ST54L_STATE_SET_CONFIG;
           }
         } else {
           STLOG_HAL_D("%s - FW flash not succeeded.", __func__);
@@ -1017,7 +1121,7 @@ static void UpdateHandlerST54L(HALHANDLE mHalHandle, uint16_t data_len,
 
       I2cResetPulse();
       hal_wrapper_set_state(HAL_WRAPPER_STATE_OPEN);
-      mHalFD54LState = HAL_FD_ST54L_STATE_PUY_KEYUSER;
+      ctx->mHalFD54LState = HAL_FD_ST54L_STATE_PUY_KEYUSER;
       break;
 
     default:
@@ -1041,7 +1145,8 @@ static void UpdateHandlerST54L(HALHANDLE mHalHandle, uint16_t data_len,
 **
 *******************************************************************************/
 void FwUpdateHandler(HALHANDLE mHalHandle, uint16_t data_len, uint8_t* p_data) {
-  if (mFWInfo->chipHwVersion == HW_ST54L) {
+  HalFdContext* ctx = HalFdContext::current();
+  if (ctx->mFWInfo->chipHwVersion == HW_ST54L) {
     UpdateHandlerST54L(mHalHandle, data_len, p_data);
   } else {
     UpdateHandler(mHalHandle, data_len, p_data);
@@ -1050,6 +1155,7 @@ void FwUpdateHandler(HALHANDLE mHalHandle, uint16_t data_len, uint8_t* p_data) {
 
 void ApplyCustomParamHandler(HALHANDLE mHalHandle, uint16_t data_len,
                              uint8_t* p_data) {
+  HalFdContext* ctx = HalFdContext::current();
   STLOG_HAL_D("%s - Enter ", __func__);
   if (data_len < 3) {
     STLOG_HAL_E("%s : Error, too short data (%d)", __func__, data_len);
@@ -1062,18 +1168,23 @@ void ApplyCustomParamHandler(HALHANDLE mHalHandle, uint16_t data_len,
       if ((p_data[1] == 0x0) && (p_data[3] == 0x0)) {
         // do nothing
       } else if ((p_data[1] == 0x1) && (p_data[3] == 0x0)) {
-        if (mFWInfo->hibernate_exited == 0) {
+        if (ctx->mFWInfo->hibernate_exited == 0) {
           // Send a NFC mode on .
           if (!HalSendDownstream(mHalHandle, propNfcModeSetCmdOn,
                                  sizeof(propNfcModeSetCmdOn))) {
             STLOG_HAL_E("%s - SendDownstream failed", __func__);
           }
           // CORE_INIT_RSP
-        } else if (mFWInfo->hibernate_exited == 1) {
-          if ((fread(mBinData, sizeof(uint8_t), 3, mCustomFileBin)) &&
-              (fread(mBinData + 3, sizeof(uint8_t), mBinData[2],
-                     mCustomFileBin))) {
-            if (!HalSendDownstream(mHalHandle, mBinData, mBinData[2] + 3)) {
+        } else if ((ctx->mFWInfo->hibernate_exited == 1) &&
+                   !ctx->mGetCustomerField) {
+          // Not the reset that follows the customer field update.
+          ctx->mCustomReadPending = false;
+          StNfcContext::current()->config.beginProp();
+          if (!hal_fd_send_custom_frame(mHalHandle, false)) {
+            // Nothing to apply, update the customer field.
+            ctx->mGetCustomerField = true;
+            if (!HalSendDownstream(mHalHandle, nciGetPropConfig,
+                                   sizeof(nciGetPropConfig))) {
               STLOG_HAL_E("%s - SendDownstream failed", __func__);
             }
           }
@@ -1081,53 +1192,58 @@ void ApplyCustomParamHandler(HALHANDLE mHalHandle, uint16_t data_len,
 
       } else {
         STLOG_HAL_D("%s - Error in custom param application", __func__);
-        mCustomParamFailed = true;
+        ctx->mCustomParamFailed = true;
         I2cResetPulse();
         hal_wrapper_set_state(HAL_WRAPPER_STATE_OPEN);
       }
       break;
 
     case 0x4f:
-      if (mFWInfo->hibernate_exited == 1) {
-        if ((fread(mBinData, sizeof(uint8_t), 3, mCustomFileBin) == 3) &&
-            (fread(mBinData + 3, sizeof(uint8_t), mBinData[2],
-                   mCustomFileBin) == mBinData[2])) {
-          if (!HalSendDownstream(mHalHandle, mBinData, mBinData[2] + 3)) {
-            STLOG_HAL_E("%s - SendDownstream failed", __func__);
-          }
-        } else {
-          STLOG_HAL_D("%s - mCustomParamDone = %d", __func__, mCustomParamDone);
-          if (!mGetCustomerField) {
-            mGetCustomerField = true;
+      if (ctx->mFWInfo->hibernate_exited == 1) {
+        bool again = ctx->mCustomReadPending;
+        if (again) {
+          ctx->mCustomReadPending = false;
+          StNfcContext::current()->config.onPropGetResponse(p_data, data_len);
+        }
+        if (ctx->mGetCustomerField ||
+            !hal_fd_send_custom_frame(mHalHandle, again)) {
+          STLOG_HAL_D("%s - mCustomParamDone = %d", __func__,
+                      ctx->mCustomParamDone);
+          if (!ctx->mGetCustomerField) {
+            ctx->mGetCustomerField = true;
             if (!HalSendDownstream(mHalHandle, nciGetPropConfig,
                                    sizeof(nciGetPropConfig))) {
               STLOG_HAL_E("%s - SendDownstream failed", __func__);
             }
-            mGetCustomerField = true;
+            ctx->mGetCustomerField = true;
 
-          } else if (!mCustomParamDone) {
+          } else if (!ctx->mCustomParamDone) {
             STLOG_HAL_D("%s - EOF of custom file.", __func__);
-            memset(nciPropSetConfig_CustomField, 0x0,
-                   sizeof(nciPropSetConfig_CustomField));
-            memcpy(nciPropSetConfig_CustomField, nciSetPropConfig, 9);
-            nciPropSetConfig_CustomField[8] = p_data[6];
-            nciPropSetConfig_CustomField[2] = p_data[6] + 6;
-            memcpy(nciPropSetConfig_CustomField + 9, p_data + 7, p_data[6]);
-            nciPropSetConfig_CustomField[13] = mFWInfo->chipUwbVersion >> 8;
-            nciPropSetConfig_CustomField[14] = mFWInfo->chipUwbVersion;
-
-            if (!HalSendDownstream(mHalHandle, nciPropSetConfig_CustomField,
-                                   nciPropSetConfig_CustomField[2] + 3)) {
+            memset(ctx->nciPropSetConfig_CustomField, 0x0,
+                   sizeof(ctx->nciPropSetConfig_CustomField));
+            memcpy(ctx->nciPropSetConfig_CustomField, nciSetPropConfig, 9);
+            ctx->nciPropSetConfig_CustomField[8] = p_data[6];
+            ctx->nciPropSetConfig_CustomField[2] = p_data[6] + 6;
+            memcpy(ctx->nciPropSetConfig_CustomField + 9, p_data + 7,
+                   p_data[6]);
+            ctx->nciPropSetConfig_CustomField[13] =
+                ctx->mFWInfo->chipUwbVersion >> 8;
+            ctx->nciPropSetConfig_CustomField[14] =
+                ctx->mFWInfo->chipUwbVersion;
+
+            if (!HalSendDownstream(mHalHandle,
+                                   ctx->nciPropSetConfig_CustomField,
+                                   ctx->nciPropSetConfig_CustomField[2] + 3)) {
               STLOG_HAL_E("%s - SendDownstream failed", __func__);
             }
 
-            mCustomParamDone = true;
+            ctx->mCustomParamDone = true;
 
           } else {
             I2cResetPulse();
-            if (mUwbConfigNeeded) {
-              mCustomParamDone = false;
-              mGetCustomerField = false;
+            if (ctx->mUwbConfigNeeded) {
+              ctx->mCustomParamDone = false;
+              ctx->mGetCustomerField = false;
               hal_wrapper_set_state(HAL_WRAPPER_STATE_APPLY_UWB_PARAM);
             }
           }
@@ -1145,23 +1261,61 @@ void ApplyCustomParamHandler(HALHANDLE mHalHandle, uint16_t data_len,
     case 0x60:  //
       if (p_data[1] == 0x0) {
         if (p_data[3] == 0xa0) {
-          mFWInfo->hibernate_exited = 1;
+          ctx->mFWInfo->hibernate_exited = 1;
         }
         if (!HalSendDownstream(mHalHandle, coreInitCmd, sizeof(coreInitCmd))) {
           STLOG_HAL_E("%s - SendDownstream failed", __func__);
         }
 
-      } else if ((p_data[1] == 0x6) && mCustomParamDone) {
-        mCustomParamDone = false;
-        mGetCustomerField = false;
+      } else if ((p_data[1] == 0x6) && ctx->mCustomParamDone) {
+        ctx->mCustomParamDone = false;
+        ctx->mGetCustomerField = false;
         hal_wrapper_update_complete();
       }
       break;
   }
 }
 
+/**
+ * Send the next frame of the custom configuration file the NFCC does not
+ * hold yet, or the read the configuration reconciler needs to tell.
+ * @param mHalHandle HAL handle
+ * @param again Check the frame in mBinData again, its read being answered
+ * @return false at the end of the file
+ */
+static bool hal_fd_send_custom_frame(HALHANDLE mHalHandle, bool again) {
+  HalFdContext* ctx = HalFdContext::current();
+  HalConfigReconciler& config = StNfcContext::current()->config;
+  uint8_t get[8];
+  size_t getLength = 0;
+
+  while (again || hal_fd_read_frame(ctx->mCustomFileBin, ctx->mBinData)) {
+    again = false;
+    switch (config.checkPropFrame(ctx->mBinData, ctx->mBinData[2] + 3, get,
+                                  &getLength)) {
+      case HalConfigReconciler::PROP_SKIP:
+        continue;
+      case HalConfigReconciler::PROP_READ:
+        ctx->mCustomReadPending = true;
+        if (!HalSendDownstream(mHalHandle, get, getLength)) {
+          STLOG_HAL_E("%s - SendDownstream failed", __func__);
+        }
+        return true;
+      case HalConfigReconciler::PROP_SEND:
+        if (!HalSendDownstream(mHalHandle, ctx->mBinData,
+                               ctx->mBinData[2] + 3)) {
+          STLOG_HAL_E("%s - SendDownstream failed", __func__);
+        }
+        return true;
+    }
+  }
+  config.endProp();
+  return false;
+}
+
 void ApplyUwbParamHandler(HALHANDLE mHalHandle, uint16_t data_len,
                           uint8_t* p_data) {
+  HalFdContext* ctx = HalFdContext::current();
   STLOG_HAL_D("%s - Enter ", __func__);
   if (data_len < 3) {
     STLOG_HAL_E("%s : Error, too short data (%d)", __func__, data_len);
@@ -1174,16 +1328,17 @@ void ApplyUwbParamHandler(HALHANDLE mHalHandle, uint16_t data_len,
       if ((p_data[1] == 0x0) && (p_data[3] == 0x0)) {
         // do nothing
       } else if ((p_data[1] == 0x1) && (p_data[3] == 0x0)) {
-        if (mFWInfo->hibernate_exited == 0) {
+        if (ctx->mFWInfo->hibernate_exited == 0) {
           // Send a NFC mode on .
           if (!HalSendDownstream(mHalHandle, propNfcModeSetCmdOn,
                                  sizeof(propNfcModeSetCmdOn))) {
             STLOG_HAL_E("%s - SendDownstream failed", __func__);
           }
           // CORE_INIT_RSP
-        } else if ((mFWInfo->hibernate_exited == 1) && !mUwbConfigDone) {
-          if (!HalSendDownstream(mHalHandle, nciPropSetUwbConfig,
-                                 nciPropSetUwbConfig[2] + 3)) {
+        } else if ((ctx->mFWInfo->hibernate_exited == 1) &&
+                   !ctx->mUwbConfigDone) {
+          if (!HalSendDownstream(mHalHandle, ctx->nciPropSetUwbConfig,
+                                 ctx->nciPropSetUwbConfig[2] + 3)) {
             STLOG_HAL_E("%s - SendDownstream failed", __func__);
           }
         }
@@ -1196,9 +1351,9 @@ void ApplyUwbParamHandler(HALHANDLE mHalHandle, uint16_t data_len,
       break;
 
     case 0x4f:
-      if (mFWInfo->hibernate_exited == 1) {
-        if (!mUwbConfigDone) {
-          mUwbConfigDone = true;
+      if (ctx->mFWInfo->hibernate_exited == 1) {
+        if (!ctx->mUwbConfigDone) {
+          ctx->mUwbConfigDone = true;
           // Check if an error has occurred for PROP_SET_CONFIG_CMD
           // Only log a warning, do not exit code
           if (p_data[3] != 0x00) {
@@ -1209,17 +1364,18 @@ void ApplyUwbParamHandler(HALHANDLE mHalHandle, uint16_t data_len,
             STLOG_HAL_E("%s - SendDownstream failed", __func__);
           }
         } else if ((p_data[1] == 0x2) && (p_data[2] == 0x0c)) {
-          memset(nciPropSetConfig_CustomField, 0x0,
-                 sizeof(nciPropSetConfig_CustomField));
-          memcpy(nciPropSetConfig_CustomField, nciSetPropConfig, 9);
-          nciPropSetConfig_CustomField[8] = p_data[6];
-          nciPropSetConfig_CustomField[2] = p_data[6] + 6;
-          memcpy(nciPropSetConfig_CustomField + 9, p_data + 7, p_data[6]);
-          nciPropSetConfig_CustomField[13] = mFWInfo->fileUwbVersion >> 8;
-          nciPropSetConfig_CustomField[14] = mFWInfo->fileUwbVersion;
-
-          if (!HalSendDownstream(mHalHandle, nciPropSetConfig_CustomField,
-                                 nciPropSetConfig_CustomField[2] + 3)) {
+          memset(ctx->nciPropSetConfig_CustomField, 0x0,
+                 sizeof(ctx->nciPropSetConfig_CustomField));
+          memcpy(ctx->nciPropSetConfig_CustomField, nciSetPropConfig, 9);
+          ctx->nciPropSetConfig_CustomField[8] = p_data[6];
+          ctx->nciPropSetConfig_CustomField[2] = p_data[6] + 6;
+          memcpy(ctx->nciPropSetConfig_CustomField + 9, p_data + 7, p_data[6]);
+          ctx->nciPropSetConfig_CustomField[13] =
+              ctx->mFWInfo->fileUwbVersion >> 8;
+          ctx->nciPropSetConfig_CustomField[14] = ctx->mFWInfo->fileUwbVersion;
+
+          if (!HalSendDownstream(mHalHandle, ctx->nciPropSetConfig_CustomField,
+                                 ctx->nciPropSetConfig_CustomField[2] + 3)) {
             STLOG_HAL_E("%s - SendDownstream failed", __func__);
           }
 
@@ -1233,15 +1389,15 @@ void ApplyUwbParamHandler(HALHANDLE mHalHandle, uint16_t data_len,
     case 0x60:  //
       if (p_data[1] == 0x0) {
         if (p_data[3] == 0xa0) {
-          mFWInfo->hibernate_exited = 1;
+          ctx->mFWInfo->hibernate_exited = 1;
         }
         if (!HalSendDownstream(mHalHandle, coreInitCmd, sizeof(coreInitCmd))) {
           STLOG_HAL_E("%s - SendDownstream failed", __func__);
         }
 
-      } else if ((p_data[1] == 0x6) && mUwbConfigDone) {
-        mUwbConfigNeeded = false;
-        mUwbConfigDone = false;
+      } else if ((p_data[1] == 0x6) && ctx->mUwbConfigDone) {
+        ctx->mUwbConfigNeeded = false;
+        ctx->mUwbConfigDone = false;
         hal_wrapper_update_complete();
       }
       break;
@@ -1249,6 +1405,7 @@ void ApplyUwbParamHandler(HALHANDLE mHalHandle, uint16_t data_len,
 }
 
 void SendExitLoadMode(HALHANDLE mmHalHandle) {
+  HalFdContext* ctx = HalFdContext::current();
   STLOG_HAL_D("%s - Send APDU_EXIT_LOAD_MODE_CMD", __func__);
   HalEventLogger::getInstance().store_timer_activity(
       "Send APDU_EXIT_LOAD_MODE_CMD", FW_TIMER_DURATION);
@@ -1256,10 +1413,11 @@ void SendExitLoadMode(HALHANDLE mmHalHandle) {
                               sizeof(ApduExitLoadMode), FW_TIMER_DURATION)) {
     STLOG_HAL_E("%s - SendDownstream failed", __func__);
   }
-  mHalFDState = HAL_FD_STATE_EXIT_APDU;
+  ctx->mHalFDState = HAL_FD_STATE_EXIT_APDU;
 }
 
 void SendSwitchToUserMode(HALHANDLE mmHalHandle) {
+  HalFdContext* ctx = HalFdContext::current();
   STLOG_HAL_D("%s: enter", __func__);
   HalEventLogger::getInstance().store_timer_activity("SendSwitchToUserMode",
                                                      FW_TIMER_DURATION);
@@ -1267,5 +1425,11 @@ void SendSwitchToUserMode(HALHANDLE mmHalHandle) {
                               sizeof(ApduSwitchToUser), FW_TIMER_DURATION)) {
     STLOG_HAL_E("%s - SendDownstream failed", __func__);
   }
-  mHalFD54LState = HAL_FD_ST54L_STATE_SWITCH_TO_USER;
+  ctx->mHalFD54LState = HAL_FD_ST54L_STATE_SWITCH_TO_USER;
+}
+
+/* Reads the next NCI frame, header then payload, of a FW or config binary */
+static bool hal_fd_read_frame(FILE* file, uint8_t* frame) {
+  return (fread(frame, sizeof(uint8_t), 3, file) == 3) &&
+         (fread(frame + 3, sizeof(uint8_t), frame[2], file) == frame[2]);
 }
@@ -0,0 +1,301 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hal_fd_snapshot.h"
+
+#include <cutils/properties.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "android_logmsg.h"
+#include "hal_config.h"
+#include "hal_event_logger.h"
+
+#define HAL_FD_SNAPSHOT_MAGIC 0x53545753  // "STWS"
+#define HAL_FD_SNAPSHOT_VERSION 2
+#define HAL_FD_SNAPSHOT_FINGERPRINT_PROP "ro.vendor.build.fingerprint"
+
+struct HalFdSnapshotHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t size;
+  uint32_t checksum;
+};
+
+/**
+ * FNV-1a, to key and check the snapshot.
+ * @param hash Hash so far, 2166136261 to start
+ * @param data Bytes to add
+ * @param length Their number
+ * @return The hash including them
+ */
+static uint32_t HalFdSnapshotHash(uint32_t hash, const void* data,
+                                  size_t length) {
+  const uint8_t* p = (const uint8_t*)data;
+
+  for (size_t i = 0; i < length; i++) {
+    hash ^= p[i];
+    hash *= 16777619;
+  }
+  return hash;
+}
+
+static uint32_t HalFdSnapshotHashString(uint32_t hash, const char* s) {
+  // With the terminating NUL, so that "ab" "c" and "a" "bc" differ.
+  return HalFdSnapshotHash(hash, s, strlen(s) + 1);
+}
+
+static void HalFdSnapshotIdentifyFile(const char* path,
+                                      HalFdSnapshot::FileId* id) {
+  struct stat st;
+
+  memset(id, 0, sizeof(*id));
+  if (stat(path, &st) != 0) return;
+  id->present = 1;
+  id->dev = st.st_dev;
+  id->ino = st.st_ino;
+  id->size = st.st_size;
+  id->mtimeNs = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+}
+
+HalFdSnapshot::HalFdSnapshot()
+    : mEnabled(false), mValid(false), mLoaded(false), mKey(0) {
+  memset(mFiles, 0, sizeof(mFiles));
+  memset(&mData, 0, sizeof(mData));
+}
+
+bool HalFdSnapshot::identify(const char* devNode, const char* fwPath,
+                             const char* confPath) {
+  unsigned long enabled = 1;
+  char fingerprint[PROPERTY_VALUE_MAX] = {0};
+  char dir[256];
+
+  GetNumValue(NAME_STNFC_WARM_START, &enabled, sizeof(enabled));
+  mEnabled = enabled != 0;
+  if (!mEnabled) return false;
+
+  property_get(HAL_FD_SNAPSHOT_FINGERPRINT_PROP, fingerprint, "");
+  mKey = 2166136261u;
+  mKey = HalFdSnapshotHashString(mKey, fingerprint);
+  mKey = HalFdSnapshotHashString(mKey, devNode);
+  mKey = HalFdSnapshotHashString(mKey, fwPath);
+  mKey = HalFdSnapshotHashString(mKey, confPath);
+  HalFdSnapshotIdentifyFile(fwPath, &mFiles[FILE_FW]);
+  HalFdSnapshotIdentifyFile(confPath, &mFiles[FILE_CONF]);
+
+  if (!GetStrValue(NAME_HAL_EVENT_LOG_STORAGE, dir, sizeof(dir))) {
+    strcpy(dir, "/data/vendor/nfc");
+  }
+  mPath = dir;
+  mPath += HAL_FD_SNAPSHOT_FILE_NAME;
+  return true;
+}
+
+bool HalFdSnapshot::restore(uint8_t* resMask, FWInfo* info, FWCap* cap) {
+  if (!mEnabled) return false;
+  if (!mValid && !mLoaded) {
+    mLoaded = true;
+    mValid = load();
+  }
+  if (!mValid || mData.key != mKey ||
+      memcmp(mData.files, mFiles, sizeof(mFiles)) != 0) {
+    STLOG_HAL_D("%s - no matching snapshot, full discovery", __func__);
+    return false;
+  }
+
+  *resMask = mData.resMask;
+  info->fileFwVersion = mData.fileFwVersion;
+  info->fileHwVersion = mData.fileHwVersion;
+  info->fileCustVersion = mData.fileCustVersion;
+  if (mData.chipKnown) *cap = mData.cap;
+  STLOG_HAL_D("%s - FW 0x%08X (r:%d), custom 0x%04X", __func__,
+              mData.fileFwVersion, mData.fileHwVersion, mData.fileCustVersion);
+  return true;
+}
+
+void HalFdSnapshot::store(uint8_t resMask, const FWInfo* info) {
+  bool keepUwb = mValid && mData.key == mKey && mData.uwbKnown;
+  uint32_t uwbKey = mData.uwbKey;
+  uint8_t uwbConfig[HAL_FD_UWB_CONFIG_SIZE];
+
+  if (!mEnabled) return;
+  // The UWB parameters do not depend on the files, they are keyed apart.
+  memcpy(uwbConfig, mData.uwbConfig, sizeof(uwbConfig));
+  memset(&mData, 0, sizeof(mData));
+  if (keepUwb) {
+    mData.uwbKnown = 1;
+    mData.uwbKey = uwbKey;
+    memcpy(mData.uwbConfig, uwbConfig, sizeof(uwbConfig));
+  }
+  mData.key = mKey;
+  memcpy(mData.files, mFiles, sizeof(mFiles));
+  mData.resMask = resMask;
+  mData.fileFwVersion = info->fileFwVersion;
+  mData.fileHwVersion = info->fileHwVersion;
+  mData.fileCustVersion = info->fileCustVersion;
+  mValid = true;
+  save();
+}
+
+void HalFdSnapshot::storeChip(const FWInfo* info, const FWCap* cap) {
+  if (!mEnabled || !mValid) return;
+  if (mData.chipKnown && mData.chipHwVersion == info->chipHwVersion &&
+      mData.chipFwVersion == info->chipFwVersion &&
+      mData.chipLoaderVersion == info->chipLoaderVersion &&
+      mData.chipCustVersion == info->chipCustVersion &&
+      mData.chipUwbVersion == info->chipUwbVersion &&
+      mData.cap.ObserveMode == cap->ObserveMode &&
+      mData.cap.ExitFrameSupport == cap->ExitFrameSupport) {
+    return;
+  }
+  mData.chipKnown = 1;
+  mData.chipHwVersion = info->chipHwVersion;
+  mData.chipFwVersion = info->chipFwVersion;
+  mData.chipLoaderVersion = info->chipLoaderVersion;
+  mData.chipCustVersion = info->chipCustVersion;
+  mData.chipUwbVersion = info->chipUwbVersion;
+  memset(&mData.cap, 0, sizeof(mData.cap));
+  mData.cap.ObserveMode = cap->ObserveMode;
+  mData.cap.ExitFrameSupport = cap->ExitFrameSupport;
+  save();
+}
+
+uint32_t HalFdSnapshot::uwbKey(const char* libName) {
+  char files[512] = {0};
+  FileId id;
+  uint32_t key = 2166136261u;
+
+  HalFdSnapshotIdentifyFile(libName, &id);
+  if (!id.present) return 0;
+  key = HalFdSnapshotHashString(key, libName);
+  key = HalFdSnapshotHash(key, &id, sizeof(id));
+
+  if (uwbParamFiles(files, sizeof(files))) {
+    for (char* save = NULL, *path = strtok_r(files, ";", &save); path;
+         path = strtok_r(NULL, ";", &save)) {
+      HalFdSnapshotIdentifyFile(path, &id);
+      key = HalFdSnapshotHashString(key, path);
+      key = HalFdSnapshotHash(key, &id, sizeof(id));
+    }
+  }
+  // 0 tells the library is not there.
+  return key ? key : 1;
+}
+
+bool HalFdSnapshot::restoreUwb(uint32_t key, uint8_t* config, size_t size) {
+  char files[512];
+
+  if (!mEnabled || !mValid || mData.key != mKey || !mData.uwbKnown ||
+      mData.uwbKey != key || !uwbParamFiles(files, sizeof(files))) {
+    return false;
+  }
+  memcpy(config, mData.uwbConfig,
+         size < sizeof(mData.uwbConfig) ? size : sizeof(mData.uwbConfig));
+  return true;
+}
+
+void HalFdSnapshot::storeUwb(uint32_t key, const uint8_t* config,
+                             size_t size) {
+  char files[512];
+
+  if (!mEnabled || !mValid || mData.key != mKey ||
+      !uwbParamFiles(files, sizeof(files))) {
+    return;
+  }
+  mData.uwbKnown = 1;
+  mData.uwbKey = key;
+  memset(mData.uwbConfig, 0, sizeof(mData.uwbConfig));
+  memcpy(mData.uwbConfig, config,
+         size < sizeof(mData.uwbConfig) ? size : sizeof(mData.uwbConfig));
+  save();
+}
+
+/**
+ * Files the UWB library reads its parameters from. Without them, a change
+ * of the parameters cannot be told from the library alone: they are not
+ * cached then, the library builds them on every open.
+ * @param files Buffer for the paths, separated by ';'
+ * @param size Its size
+ * @return true if STNFC_UWB_PARAM_FILES is set
+ */
+bool HalFdSnapshot::uwbParamFiles(char* files, size_t size) {
+  return GetStrValue(NAME_STNFC_UWB_PARAM_FILES, files, size) && files[0];
+}
+
+/**
+ * Read the snapshot persisted in the storage directory.
+ * @return true if it is there and intact
+ */
+bool HalFdSnapshot::load() {
+  HalFdSnapshotHeader header;
+  Data data;
+  bool ok;
+  int fd;
+
+  fd = open(mPath.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return false;
+  ok = read(fd, &header, sizeof(header)) == (ssize_t)sizeof(header) &&
+       header.magic == HAL_FD_SNAPSHOT_MAGIC &&
+       header.version == HAL_FD_SNAPSHOT_VERSION &&
+       header.size == sizeof(data) &&
+       read(fd, &data, sizeof(data)) == (ssize_t)sizeof(data) &&
+       header.checksum == HalFdSnapshotHash(2166136261u, &data, sizeof(data));
+  close(fd);
+
+  if (!ok) {
+    STLOG_HAL_W("%s - %s invalid, ignored", __func__, mPath.c_str());
+    return false;
+  }
+  mData = data;
+  return true;
+}
+
+/**
+ * Persist the snapshot, replacing the previous one atomically.
+ */
+void HalFdSnapshot::save() {
+  std::string tmp = mPath + ".tmp";
+  HalFdSnapshotHeader header;
+  bool ok;
+  int fd;
+
+  header.magic = HAL_FD_SNAPSHOT_MAGIC;
+  header.version = HAL_FD_SNAPSHOT_VERSION;
+  header.size = sizeof(mData);
+  header.checksum = HalFdSnapshotHash(2166136261u, &mData, sizeof(mData));
+
+  fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+  if (fd < 0) {
+    STLOG_HAL_W("%s - %s: %s", __func__, tmp.c_str(), strerror(errno));
+    return;
+  }
+  ok = write(fd, &header, sizeof(header)) == (ssize_t)sizeof(header) &&
+       write(fd, &mData, sizeof(mData)) == (ssize_t)sizeof(mData) &&
+       fsync(fd) == 0;
+  close(fd);
+  if (!ok || rename(tmp.c_str(), mPath.c_str()) != 0) {
+    STLOG_HAL_W("%s - %s: %s", __func__, mPath.c_str(), strerror(errno));
+    unlink(tmp.c_str());
+    return;
+  }
+  HalEventLogger::getInstance().log()
+      << __func__ << " warm start snapshot, chip known "
+      << (int)mData.chipKnown << std::endl;
+}
@@ -0,0 +1,295 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <hardware/nfc.h>
+#include <sched.h>
+#include <stdio.h>
+
+#include "hal_front_end.h"
+
+#include "android_logmsg.h"
+#include "hal_context.h"
+#include "hal_fd.h"
+#include "hal_nci_translator.h"
+#include "hal_observe_mode.h"
+#include "hal_threads.h"
+
+extern bool hal_wrapper_open(st21nfc_dev_t* dev, nfc_stack_callback_t* p_cback,
+                             nfc_stack_data_callback_t* p_data_cback,
+                             HALHANDLE* pHandle);
+extern int hal_wrapper_close(int call_cb, int nfc_mode);
+extern void hal_wrapper_send_config();
+extern void hal_wrapper_set_observer_mode(uint8_t enable);
+extern void hal_wrapper_cancel_observer_mode();
+
+HalFrontEnd& HalFrontEnd::getInstance() {
+  static HalFrontEnd nfc_hal_front_end;
+  return nfc_hal_front_end;
+}
+
+HalFrontEnd::HalFrontEnd()
+    : mMutex(PTHREAD_MUTEX_INITIALIZER),
+      mClosed(true),
+      mWriters(0),
+      mDev(),
+      mCallbackThread(),
+      mCallbackThreadRunning(false),
+      mNfcMode(0),
+      mName("") {}
+
+uint32_t HalFrontEnd::version() { return HAL_FRONT_END_VERSION; }
+
+void* HalFrontEnd::callbackThread(void* arg) {
+  HalFrontEnd* frontEnd = (HalFrontEnd*)arg;
+  uint8_t event;
+  uint8_t event_status;
+
+  // Ends once the queue is stopped and every event is delivered
+  while (frontEnd->mCallbacks.take(&event, &event_status)) {
+    STLOG_HAL_D("HAL st21nfc: %s event %hhx status %hhx", __func__, event,
+                event_status);
+    frontEnd->mDev.p_cback_unwrap(event, event_status);
+  }
+  return NULL;
+}
+
+void HalFrontEnd::postCallback(nfc_event_t event, nfc_status_t status) {
+  getInstance().postEvent(event, status);
+}
+
+int HalFrontEnd::startCallbackThread() {
+  int ret;
+
+  if (mCallbackThreadRunning) return 0;
+
+  // Also waits for the thread of the previous session to be done
+  mCallbacks.open();
+  ret = HalThreads::create(&mCallbackThread, HalThreads::ROLE_CALLBACK,
+                           callbackThread, this);
+  if (ret != 0) {
+    STLOG_HAL_E("HAL: %s thread creation failed", __func__);
+    mCallbacks.close();
+    return ret;
+  }
+  mCallbackThreadRunning = true;
+  return 0;
+}
+
+int HalFrontEnd::endCallbackThread() {
+  int ret;
+
+  if (!mCallbackThreadRunning) return 0;
+
+  // Let the thread deliver what is pending, it then stops by itself
+  mCallbacks.stop();
+  mCallbackThreadRunning = false;
+  ret = pthread_join(mCallbackThread, (void**)NULL);
+  if (ret != 0) {
+    STLOG_HAL_E("HAL: %s pthread_join failed", __func__);
+  }
+  return ret;
+}
+
+void HalFrontEnd::postEvent(uint8_t event, uint8_t status) {
+  // Never waits for the callback thread: the HAL worker may be the caller,
+  // and so may the callback thread itself
+  switch (mCallbacks.post(event, status)) {
+    case HalCallbackQueue::POSTED:
+      break;
+    case HalCallbackQueue::CLOSED:
+      STLOG_HAL_E("HAL: %s thread is not running", __func__);
+      mDev.p_cback_unwrap(event, status);
+      break;
+  }
+}
+
+bool HalFrontEnd::beginWrite() {
+  mWriters++;
+  if (mClosed) {
+    mWriters--;
+    return false;
+  }
+  return true;
+}
+
+void HalFrontEnd::endWrite() { mWriters--; }
+
+/* Called with mMutex held, before the HAL instance goes away */
+void HalFrontEnd::setClosed() {
+  mClosed = true;
+  // Writes never wait for a buffer (HalTrySendDownstream), this is short
+  while (mWriters != 0) {
+    sched_yield();
+  }
+}
+
+int HalFrontEnd::open(const char* name, nfc_stack_callback_t* p_cback,
+                      nfc_stack_data_callback_t* p_data_cback,
+                      uint32_t frontEndVersion) {
+  bool result;
+
+  if (frontEndVersion != HAL_FRONT_END_VERSION) {
+    STLOG_HAL_E("HAL st21nfc: %s built for front end core v%u, library is v%u",
+                name, frontEndVersion, HAL_FRONT_END_VERSION);
+    p_cback(HAL_NFC_OPEN_CPLT_EVT, HAL_NFC_STATUS_FAILED);
+    return -1;
+  }
+
+  (void)pthread_mutex_lock(&mMutex);
+  mName = name;
+
+  if (!mClosed) {
+    setClosed();
+    hal_wrapper_close(0, mNfcMode);
+  }
+
+  mDev.p_cback = p_cback;  // will be replaced by wrapper version
+  mDev.p_cback_unwrap = p_cback;
+  mDev.p_data_cback = p_data_cback;
+  // Initialize and get global logging level
+  InitializeSTLogLevel();
+
+  if (startCallbackThread() != 0) {
+    mDev.p_cback(HAL_NFC_OPEN_CPLT_EVT, HAL_NFC_STATUS_FAILED);
+    (void)pthread_mutex_unlock(&mMutex);
+    return -1;  // We are doomed, stop it here, NOW !
+  }
+  result = hal_wrapper_open(&mDev, postCallback, p_data_cback, &(mDev.hHAL));
+
+  if (!result || !(mDev.hHAL)) {
+    postEvent(HAL_NFC_OPEN_CPLT_EVT, HAL_NFC_STATUS_FAILED);
+    (void)pthread_mutex_unlock(&mMutex);
+    return -1;  // We are doomed, stop it here, NOW !
+  }
+  mClosed = false;
+  (void)pthread_mutex_unlock(&mMutex);
+  return 0;
+}
+
+int HalFrontEnd::write(uint16_t length, const uint8_t* data) {
+  int ret = (int)length;
+
+  if (!ret || !beginWrite()) {
+    return 0;
+  }
+
+  // The Android extensions (2f 0c) are translated into commands the FW
+  // understands, anything else goes down as is. The observe mode query is
+  // answered, or translated, by the HAL worker thread from the state it
+  // holds then.
+  const uint8_t* frame = data;
+  size_t frame_len = length;
+  uint8_t nci_cmd[HAL_NCI_MAX_FRAME_SIZE];
+  HalNciTranslator* translator = nullptr;
+  HalNciTranslator::CommandResult result = {};
+  if (length >= 2 && data[0] == 0x2f && data[1] == 0x0c &&
+      !HalObserveMode::isQuery(data, length)) {
+    translator = &HalWrapperContext::current()->nciTranslator;
+    int nci_length = translator->translateCommand(
+        data, length, hal_fd_getFwCap()->ObserveMode, nci_cmd,
+        sizeof(nci_cmd), &result);
+    if (nci_length < 0) {
+      STLOG_HAL_E("HAL st21nfc %s  malformed command", __func__);
+      endWrite();
+      return 0;
+    }
+    if (nci_length > 0 && result.installed) {
+      // Already held by the NFCC, acknowledged through the HAL worker
+      // thread like a response. Like the writes, it never waits for a
+      // buffer: with none left the write fails.
+      DispHal("TX DATA", (data), length);
+      if (!HalTrySendUpstream(mDev.hHAL, nci_cmd, nci_length)) {
+        STLOG_HAL_E("HAL st21nfc %s  SendUpstream failed", __func__);
+        ret = 0;
+      }
+      endWrite();
+      return ret;
+    }
+    if (nci_length > 0) {
+      DispHal("TX DATA", (data), length);
+      // Armed before the frame is queued: its response, and the polling
+      // loop frames the FW sends first, may reach the worker before this
+      // thread returns from the send.
+      if (result.setsObserveMode) {
+        hal_wrapper_set_observer_mode(result.observeMode);
+      }
+      frame = nci_cmd;
+      frame_len = nci_length;
+    } else {
+      translator = nullptr;
+    }
+  }
+
+  if (!HalTrySendDownstream(mDev.hHAL, frame, frame_len)) {
+    STLOG_HAL_E("HAL st21nfc %s  SendDownstream failed", __func__);
+    // The NFCC never gets the frame: no response is to be translated and
+    // the observe mode stays as it was.
+    if (translator) {
+      translator->abortCommand();
+      if (result.setsObserveMode) hal_wrapper_cancel_observer_mode();
+    }
+    ret = 0;
+  }
+  endWrite();
+  return ret;
+}
+
+void HalFrontEnd::coreInitialized() {
+  (void)pthread_mutex_lock(&mMutex);
+  hal_wrapper_send_config();
+  (void)pthread_mutex_unlock(&mMutex);
+}
+
+int HalFrontEnd::close(int nfcMode) {
+  (void)pthread_mutex_lock(&mMutex);
+  if (mClosed) {
+    (void)pthread_mutex_unlock(&mMutex);
+    return 1;
+  }
+  setClosed();
+  if (hal_wrapper_close(1, nfcMode) == -1) {
+    (void)pthread_mutex_unlock(&mMutex);
+    return 1;
+  }
+  (void)pthread_mutex_unlock(&mMutex);
+
+  deInitializeHalLog();
+
+  // Not holding mMutex: the stack may call back into the HAL from the
+  // events still to deliver.
+  if (endCallbackThread() != 0) {
+    return -1;  // We are doomed, stop it here, NOW !
+  }
+  return 0;
+}
+
+int HalFrontEnd::powerCycle() {
+  int ret = HAL_NFC_STATUS_OK;
+
+  (void)pthread_mutex_lock(&mMutex);
+  if (mClosed) {
+    ret = HAL_NFC_STATUS_FAILED;
+  } else {
+    postEvent(HAL_NFC_OPEN_CPLT_EVT, HAL_NFC_STATUS_OK);
+  }
+  (void)pthread_mutex_unlock(&mMutex);
+  return ret;
+}
+
+void HalFrontEnd::dump(int fd) {
+  dprintf(fd, "Front end: %s, core v%u\n", mName.load(),
+          HAL_FRONT_END_VERSION);
+}
@@ -0,0 +1,314 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hal_fw_trace.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <chrono>
+
+#include "android_logmsg.h"
+#include "hal_config.h"
+#include "hal_event_logger.h"
+#include "hal_metrics.h"
+#include "hal_threads.h"
+
+#define HAL_FW_TRACE_DEFAULT_FILE_SIZE (1024 * 1024)
+#define HAL_FW_TRACE_FLUSH_MS 1000
+
+HalFwTrace::HalFwTrace()
+    : mEnabled(false),
+      mNci(false),
+      mBlocks(0),
+      mWriter((pthread_t)NULL),
+      mHead(0),
+      mTail(0),
+      mStop(false),
+      mFd(-1),
+      mSeq(0),
+      mSession(0),
+      mUsed(0),
+      mDirty(false),
+      mWrittenUs(0) {}
+
+HalFwTrace::~HalFwTrace() { close(); }
+
+void HalFwTrace::open() {
+  unsigned long capture = 0;
+  unsigned long nci = 0;
+  unsigned long size = HAL_FW_TRACE_DEFAULT_FILE_SIZE;
+  char dir[256];
+
+  close();
+  GetNumValue(NAME_STNFC_FW_TRACE_CAPTURE, &capture, sizeof(capture));
+  if (capture != 1) return;
+  GetNumValue(NAME_STNFC_FW_TRACE_FILE_SIZE, &size, sizeof(size));
+  GetNumValue(NAME_STNFC_FW_TRACE_NCI, &nci, sizeof(nci));
+  mBlocks = size / HAL_FW_TRACE_BLOCK_SIZE;
+  if (mBlocks < 2) mBlocks = 2;
+
+  if (!GetStrValue(NAME_HAL_EVENT_LOG_STORAGE, dir, sizeof(dir))) {
+    strcpy(dir, "/data/vendor/nfc");
+  }
+  mPath = dir;
+  mPath += HAL_FW_TRACE_FILE_NAME;
+
+  {
+    std::lock_guard<std::mutex> lock(mProducerMutex);
+    mHead = 0;
+    mTail = 0;
+  }
+  mStop = false;
+  if (HalThreads::create(&mWriter, HalThreads::ROLE_FW_TRACE, writerThread,
+                         this) != 0) {
+    STLOG_HAL_E("%s - no writer thread, capture off", __func__);
+    mWriter = (pthread_t)NULL;
+    return;
+  }
+  mNci = nci == 1;
+  mEnabled = true;
+}
+
+void HalFwTrace::close() {
+  if (mWriter == (pthread_t)NULL) return;
+  {
+    std::lock_guard<std::mutex> lock(mProducerMutex);
+    mEnabled = false;
+    mNci = false;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStop = true;
+  }
+  mCond.notify_one();
+  pthread_join(mWriter, NULL);
+  mWriter = (pthread_t)NULL;
+}
+
+bool HalFwTrace::isTrace(const uint8_t* frame, size_t length) {
+  return length >= 3 && frame[0] == 0x6f && frame[1] == 0x02;
+}
+
+void HalFwTrace::capture(const uint8_t* frame, size_t length) {
+  queue(HAL_FW_TRACE_KIND_FW, frame, length);
+}
+
+void HalFwTrace::captureFrame(bool tx, const uint8_t* frame, size_t length) {
+  // Data packets may carry user data, the analysis only needs their header.
+  if (length > 3 && (frame[0] & 0xe0) == 0x00) length = 3;
+  queue(tx ? HAL_FW_TRACE_KIND_TX : HAL_FW_TRACE_KIND_RX, frame, length);
+}
+
+void HalFwTrace::captureState(uint8_t from, uint8_t to) {
+  uint8_t states[2] = {from, to};
+
+  if (!mNci.load(std::memory_order_relaxed)) return;
+  queue(HAL_FW_TRACE_KIND_STATE, states, sizeof(states));
+}
+
+/**
+ * Copy a record to the queue for the writer, or drop it if it is full.
+ * @param kind HalFwTraceKind of the record
+ * @param data Its payload
+ * @param length Length of the payload
+ */
+void HalFwTrace::queue(uint8_t kind, const uint8_t* data, size_t length) {
+  size_t need = HAL_FW_TRACE_RECORD_HEADER_SIZE + length;
+  uint16_t length16 = length;
+  struct timespec now;
+  uint64_t timeUs;
+  uint64_t queued;
+  uint64_t head;
+
+  std::lock_guard<std::mutex> lock(mProducerMutex);
+  if (!mEnabled.load(std::memory_order_relaxed)) return;
+  head = mHead.load(std::memory_order_relaxed);
+  queued = head - mTail.load(std::memory_order_acquire);
+  if (need > HAL_FW_TRACE_QUEUE_SIZE - queued) {
+    HalMetrics::getInstance().increment(HalMetrics::FW_TRACE_DROPS);
+    return;
+  }
+  clock_gettime(CLOCK_REALTIME, &now);
+  timeUs = (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+  queueWrite(head, &timeUs, sizeof(timeUs));
+  queueWrite(head + sizeof(timeUs), &length16, sizeof(length16));
+  queueWrite(head + sizeof(timeUs) + sizeof(length16), &kind, sizeof(kind));
+  queueWrite(head + HAL_FW_TRACE_RECORD_HEADER_SIZE, data, length);
+  mHead.store(head + need, std::memory_order_release);
+  HalMetrics::getInstance().increment(HalMetrics::FW_TRACE_RECORDS);
+
+  // The writer polls anyway, only hurry it when the queue fills up. Not
+  // taking mMutex, a missed wakeup costs one period.
+  if (queued + need >= HAL_FW_TRACE_QUEUE_SIZE / 2) mCond.notify_one();
+}
+
+void* HalFwTrace::writerThread(void* arg) {
+  ((HalFwTrace*)arg)->run();
+  return NULL;
+}
+
+/**
+ * Writer thread: moves the queued frames to the file until close().
+ */
+void HalFwTrace::run() {
+  bool stop = false;
+
+  if (!openFile()) {
+    // Keep draining, so that the I/O thread counts drops and not stalls.
+    HalMetrics::getInstance().increment(HalMetrics::FW_TRACE_WRITE_ERRORS);
+  }
+  while (!stop) {
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      mCond.wait_for(lock, std::chrono::milliseconds(HAL_FW_TRACE_FLUSH_MS),
+                     [this] { return mStop; });
+      stop = mStop;
+    }
+    drain();
+    if (mDirty &&
+        (stop || HalThreads::nowUs() - mWrittenUs >=
+                     (uint64_t)HAL_FW_TRACE_FLUSH_MS * 1000)) {
+      writeBlock();
+    }
+  }
+
+  if (mFd >= 0) {
+    fdatasync(mFd);
+    ::close(mFd);
+    mFd = -1;
+  }
+}
+
+/**
+ * Open the trace file and continue its ring after the last block written,
+ * in a new session.
+ * @return false if it cannot be opened
+ */
+bool HalFwTrace::openFile() {
+  HalFwTraceBlockHeader header;
+  bool found = false;
+  uint32_t lastSeq = 0;
+  uint32_t lastSession = 0;
+
+  mFd = ::open(mPath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+  if (mFd < 0) {
+    STLOG_HAL_E("%s - %s: %s", __func__, mPath.c_str(), strerror(errno));
+    return false;
+  }
+  for (uint32_t b = 0; b < mBlocks; b++) {
+    if (pread(mFd, &header, sizeof(header),
+              (off_t)b * HAL_FW_TRACE_BLOCK_SIZE) != (ssize_t)sizeof(header)) {
+      break;
+    }
+    if (header.magic != HAL_FW_TRACE_MAGIC ||
+        header.version != HAL_FW_TRACE_VERSION) {
+      continue;
+    }
+    if (!found || (int32_t)(header.seq - lastSeq) > 0) {
+      lastSeq = header.seq;
+      lastSession = header.session;
+      found = true;
+    }
+  }
+  // Blocks of a larger ring configured before.
+  if (ftruncate(mFd, (off_t)mBlocks * HAL_FW_TRACE_BLOCK_SIZE) != 0) {
+    STLOG_HAL_W("%s - %s: %s", __func__, mPath.c_str(), strerror(errno));
+  }
+
+  mSeq = found ? lastSeq + 1 : 0;
+  mSession = lastSession + 1;
+  mUsed = 0;
+  mDirty = false;
+  mWrittenUs = HalThreads::nowUs();
+  HalEventLogger::getInstance().log()
+      << __func__ << " FW trace session " << mSession << ", block " << mSeq
+      << std::endl;
+  return true;
+}
+
+/**
+ * Append the queued records to the current block, writing the blocks they
+ * fill.
+ */
+void HalFwTrace::drain() {
+  uint64_t tail = mTail.load(std::memory_order_relaxed);
+  uint64_t head = mHead.load(std::memory_order_acquire);
+
+  while (tail != head) {
+    uint16_t length;
+    size_t need;
+
+    queueRead(tail + sizeof(uint64_t), &length, sizeof(length));
+    need = HAL_FW_TRACE_RECORD_HEADER_SIZE + length;
+    if (mUsed + need >
+        HAL_FW_TRACE_BLOCK_SIZE - sizeof(HalFwTraceBlockHeader)) {
+      writeBlock();
+      mSeq++;
+      mUsed = 0;
+    }
+    queueRead(tail, mBlock + sizeof(HalFwTraceBlockHeader) + mUsed, need);
+    mUsed += need;
+    mDirty = true;
+    tail += need;
+    mTail.store(tail, std::memory_order_release);
+  }
+}
+
+/**
+ * Write the current block to its slot of the ring, complete or not.
+ */
+void HalFwTrace::writeBlock() {
+  HalFwTraceBlockHeader* header = (HalFwTraceBlockHeader*)mBlock;
+
+  mWrittenUs = HalThreads::nowUs();
+  if (!mDirty || mFd < 0) return;
+  mDirty = false;
+  header->magic = HAL_FW_TRACE_MAGIC;
+  header->version = HAL_FW_TRACE_VERSION;
+  header->used = mUsed;
+  header->seq = mSeq;
+  header->session = mSession;
+  memset(mBlock + sizeof(*header) + mUsed, 0,
+         HAL_FW_TRACE_BLOCK_SIZE - sizeof(*header) - mUsed);
+  if (pwrite(mFd, mBlock, HAL_FW_TRACE_BLOCK_SIZE,
+             (off_t)(mSeq % mBlocks) * HAL_FW_TRACE_BLOCK_SIZE) !=
+      HAL_FW_TRACE_BLOCK_SIZE) {
+    HalMetrics::getInstance().increment(HalMetrics::FW_TRACE_WRITE_ERRORS);
+  }
+}
+
+void HalFwTrace::queueRead(uint64_t pos, void* dst, size_t length) {
+  size_t offset = pos % HAL_FW_TRACE_QUEUE_SIZE;
+  size_t first = HAL_FW_TRACE_QUEUE_SIZE - offset;
+
+  if (first > length) first = length;
+  memcpy(dst, mQueue + offset, first);
+  memcpy((uint8_t*)dst + first, mQueue, length - first);
+}
+
+void HalFwTrace::queueWrite(uint64_t pos, const void* src, size_t length) {
+  size_t offset = pos % HAL_FW_TRACE_QUEUE_SIZE;
+  size_t first = HAL_FW_TRACE_QUEUE_SIZE - offset;
+
+  if (first > length) first = length;
+  memcpy(mQueue + offset, src, first);
+  memcpy(mQueue, (const uint8_t*)src + first, length - first);
+}
@@ -0,0 +1,479 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hal_metrics.h"
+
+#include <android-base/file.h>
+#include <android-base/logging.h>
+#include <unistd.h>
+
+#include <sstream>
+#include <string>
+
+extern std::string hal_wrapper_state_to_str(uint16_t event);
+
+static const char* kCounterNames[HalMetrics::COUNTER_MAX] = {
+    "i2c.read_errors",
+    "i2c.read_retries",
+    "i2c.write_errors",
+    "i2c.write_retries",
+    "i2c.idle_resyncs",
+    "i2c.truncated_frames",
+    "msg_ring.overflows",
+    "wrapper.recoveries",
+    "wrapper.act_to_act_errors",
+    "wrapper.observe_mode_ntfs",
+    "buffer_pool.exhausted",
+    "buffer_pool.growths",
+    "callback_queue.overflows",
+    "rx.delivery_allocations",
+    "recovery.failures",
+    "power.clock_transitions",
+    "power.clock_errors",
+    "config.reads",
+    "config.sets",
+    "config.set_bytes",
+    "config.skipped",
+    "config.skipped_bytes",
+    "observe.local_queries",
+    "observe.syncs",
+    "translator.frame_cache_hits",
+    "translator.local_acks",
+    "fw_trace.records",
+    "fw_trace.drops",
+    "fw_trace.write_errors",
+    "binder.calls_queued",
+    "buffer_pool.rx_throttled",
+    "buffer_pool.worker_failures",
+};
+
+static const char* kGaugeNames[HalMetrics::GAUGE_MAX] = {
+    "msg_ring.depth",
+    "buffer_pool.in_use",
+    "buffer_pool.created",
+    "callback_queue.depth",
+    "binder.calls_in_flight",
+    "buffer_pool.rx_in_use",
+};
+
+static const char* kDirectionNames[HalMetrics::DIR_MAX] = {"tx", "rx"};
+
+// Upper bounds of the wakeup delay buckets, in us, the last one is open.
+static const uint64_t kWakeupBucketsUs[HAL_METRICS_WAKEUP_BUCKETS - 1] = {
+    50, 100, 250, 500, 1000, 2000, 5000, 10000,
+};
+
+static const char* kMtNames[HAL_METRICS_NCI_MT_MAX] = {"data", "cmd", "rsp",
+                                                       "ntf"};
+
+static const char* kOpenPhaseNames[HalMetrics::OPEN_PHASE_MAX] = {
+    "fd_init", "uwb_params", "transport", "nfcc_reset", "total"};
+
+HalMetrics& HalMetrics::getInstance() {
+  static HalMetrics nfc_hal_metrics;
+  return nfc_hal_metrics;
+}
+
+HalMetrics::HalMetrics() {
+  for (auto& c : mCounters) c = 0;
+  for (auto& g : mGauges) g = 0;
+  for (auto& g : mGaugesMax) g = 0;
+  for (auto& dir : mFrames)
+    for (auto& mt : dir)
+      for (auto& f : mt) f = 0;
+  for (auto& dir : mBytes)
+    for (auto& mt : dir)
+      for (auto& b : mt) b = 0;
+  for (auto& t : mTimerFires) t = 0;
+  for (int s = 0; s < HalRecovery::STRATEGY_MAX; s++) {
+    mRecoveryAttempts[s] = 0;
+    mRecoverySuccesses[s] = 0;
+    mRecoveryTimeLastUs[s] = 0;
+    mRecoveryTimeMaxUs[s] = 0;
+    mRecoveryTimeTotalUs[s] = 0;
+  }
+  for (int f = 0; f < HalFaultInjector::FAULT_MAX; f++) {
+    mFaultHits[f] = 0;
+    mFaultRecoveries[f] = 0;
+    mFaultDetectLastUs[f] = 0;
+    mFaultDetectMaxUs[f] = 0;
+  }
+  for (int r = 0; r < HalThreads::ROLE_MAX; r++) {
+    for (auto& w : mWakeups[r]) w = 0;
+    mWakeupTotalUs[r] = 0;
+    mWakeupMaxUs[r] = 0;
+  }
+  for (int r = 0; r < HalPowerManager::RESIDENCY_MAX; r++) {
+    mPowerResidencyUs[r] = 0;
+    mPowerEntries[r] = 0;
+  }
+  for (int p = 0; p < OPEN_PHASE_MAX; p++) {
+    mOpenPhaseCount[p] = 0;
+    mOpenPhaseLastUs[p] = 0;
+    mOpenPhaseMaxUs[p] = 0;
+    mOpenPhaseTotalUs[p] = 0;
+  }
+  for (int c = 0; c < HalBinderCalls::CALL_MAX; c++) {
+    mBinderCalls[c] = 0;
+    mBinderWaitTotalUs[c] = 0;
+    mBinderWaitMaxUs[c] = 0;
+    mBinderRunTotalUs[c] = 0;
+    mBinderRunMaxUs[c] = 0;
+  }
+}
+
+void HalMetrics::increment(Counter counter, uint64_t value) {
+  if (counter >= COUNTER_MAX) return;
+  mCounters[counter].fetch_add(value, std::memory_order_relaxed);
+}
+
+void HalMetrics::setGauge(Gauge gauge, int64_t value) {
+  if (gauge >= GAUGE_MAX) return;
+  mGauges[gauge].store(value, std::memory_order_relaxed);
+
+  int64_t max = mGaugesMax[gauge].load(std::memory_order_relaxed);
+  while (value > max && !mGaugesMax[gauge].compare_exchange_weak(
+                            max, value, std::memory_order_relaxed)) {
+  }
+}
+
+/**
+ * Account one NCI frame seen on the transport.
+ * The frame is classified by Message Type (octet 0, bits 7-5) and by Group ID
+ * (octet 0, bits 3-0), which is the connection ID for data packets.
+ */
+void HalMetrics::countFrame(Direction dir, const uint8_t* data,
+                            size_t length) {
+  if (dir >= DIR_MAX || data == nullptr || length == 0) return;
+  uint8_t mt = (data[0] >> 5) & 0x03;
+  uint8_t gid = data[0] & 0x0F;
+
+  mFrames[dir][mt][gid].fetch_add(1, std::memory_order_relaxed);
+  mBytes[dir][mt][gid].fetch_add(length, std::memory_order_relaxed);
+}
+
+void HalMetrics::countTimerFire(hal_wrapper_state_e state) {
+  if (state >= HAL_METRICS_WRAPPER_STATE_MAX) return;
+  mTimerFires[state].fetch_add(1, std::memory_order_relaxed);
+}
+
+void HalMetrics::countRecovery(HalRecovery::Strategy strategy, bool recovered,
+                               uint64_t timeToRecoverUs) {
+  if (strategy >= HalRecovery::STRATEGY_MAX) return;
+  mRecoveryAttempts[strategy].fetch_add(1, std::memory_order_relaxed);
+  if (!recovered) return;
+
+  mRecoverySuccesses[strategy].fetch_add(1, std::memory_order_relaxed);
+  mRecoveryTimeLastUs[strategy].store(timeToRecoverUs,
+                                      std::memory_order_relaxed);
+  mRecoveryTimeTotalUs[strategy].fetch_add(timeToRecoverUs,
+                                           std::memory_order_relaxed);
+  uint64_t max = mRecoveryTimeMaxUs[strategy].load(std::memory_order_relaxed);
+  while (timeToRecoverUs > max &&
+         !mRecoveryTimeMaxUs[strategy].compare_exchange_weak(
+             max, timeToRecoverUs, std::memory_order_relaxed)) {
+  }
+}
+
+void HalMetrics::countFault(HalFaultInjector::Fault fault) {
+  if (fault >= HalFaultInjector::FAULT_MAX) return;
+  mFaultHits[fault].fetch_add(1, std::memory_order_relaxed);
+}
+
+void HalMetrics::countFaultRecovery(HalFaultInjector::Fault fault,
+                                    uint64_t detectUs) {
+  if (fault >= HalFaultInjector::FAULT_MAX) return;
+  mFaultRecoveries[fault].fetch_add(1, std::memory_order_relaxed);
+  mFaultDetectLastUs[fault].store(detectUs, std::memory_order_relaxed);
+  uint64_t max = mFaultDetectMaxUs[fault].load(std::memory_order_relaxed);
+  while (detectUs > max && !mFaultDetectMaxUs[fault].compare_exchange_weak(
+                               max, detectUs, std::memory_order_relaxed)) {
+  }
+}
+
+void HalMetrics::countWakeup(HalThreads::Role role, uint64_t delayUs) {
+  int bucket = 0;
+
+  if (role >= HalThreads::ROLE_MAX) return;
+  while (bucket < HAL_METRICS_WAKEUP_BUCKETS - 1 &&
+         delayUs > kWakeupBucketsUs[bucket]) {
+    bucket++;
+  }
+  mWakeups[role][bucket].fetch_add(1, std::memory_order_relaxed);
+  mWakeupTotalUs[role].fetch_add(delayUs, std::memory_order_relaxed);
+  uint64_t max = mWakeupMaxUs[role].load(std::memory_order_relaxed);
+  while (delayUs > max && !mWakeupMaxUs[role].compare_exchange_weak(
+                              max, delayUs, std::memory_order_relaxed)) {
+  }
+}
+
+void HalMetrics::addPowerResidency(HalPowerManager::Residency residency,
+                                   uint64_t us) {
+  if (residency >= HalPowerManager::RESIDENCY_MAX) return;
+  mPowerResidencyUs[residency].fetch_add(us, std::memory_order_relaxed);
+}
+
+void HalMetrics::countPowerEntry(HalPowerManager::Residency residency) {
+  if (residency >= HalPowerManager::RESIDENCY_MAX) return;
+  mPowerEntries[residency].fetch_add(1, std::memory_order_relaxed);
+}
+
+void HalMetrics::countOpenPhase(OpenPhase phase, uint64_t us) {
+  if (phase >= OPEN_PHASE_MAX) return;
+  mOpenPhaseCount[phase].fetch_add(1, std::memory_order_relaxed);
+  mOpenPhaseLastUs[phase].store(us, std::memory_order_relaxed);
+  mOpenPhaseTotalUs[phase].fetch_add(us, std::memory_order_relaxed);
+  uint64_t max = mOpenPhaseMaxUs[phase].load(std::memory_order_relaxed);
+  while (us > max && !mOpenPhaseMaxUs[phase].compare_exchange_weak(
+                         max, us, std::memory_order_relaxed)) {
+  }
+}
+
+void HalMetrics::countBinderCall(HalBinderCalls::Call call, uint64_t waitUs,
+                                 uint64_t runUs) {
+  if (call >= HalBinderCalls::CALL_MAX) return;
+  mBinderCalls[call].fetch_add(1, std::memory_order_relaxed);
+  mBinderWaitTotalUs[call].fetch_add(waitUs, std::memory_order_relaxed);
+  mBinderRunTotalUs[call].fetch_add(runUs, std::memory_order_relaxed);
+  uint64_t max = mBinderWaitMaxUs[call].load(std::memory_order_relaxed);
+  while (waitUs > max && !mBinderWaitMaxUs[call].compare_exchange_weak(
+                             max, waitUs, std::memory_order_relaxed)) {
+  }
+  max = mBinderRunMaxUs[call].load(std::memory_order_relaxed);
+  while (runUs > max && !mBinderRunMaxUs[call].compare_exchange_weak(
+                            max, runUs, std::memory_order_relaxed)) {
+  }
+}
+
+uint64_t HalMetrics::get(Counter counter) const {
+  if (counter >= COUNTER_MAX) return 0;
+  return mCounters[counter].load(std::memory_order_relaxed);
+}
+
+int64_t HalMetrics::getGauge(Gauge gauge) const {
+  if (gauge >= GAUGE_MAX) return 0;
+  return mGauges[gauge].load(std::memory_order_relaxed);
+}
+
+int64_t HalMetrics::getGaugeMax(Gauge gauge) const {
+  if (gauge >= GAUGE_MAX) return 0;
+  return mGaugesMax[gauge].load(std::memory_order_relaxed);
+}
+
+/**
+ * Dump all metrics, first as a human readable summary, then as a block of
+ * "key=value" lines between fixed markers. Key names of the block are part of
+ * the v1 format and must not be renamed; new keys may only be appended.
+ */
+void HalMetrics::dump(int fd) {
+  LOG(DEBUG) << __func__;
+  std::ostringstream text;
+  std::ostringstream block;
+  uint64_t frames[DIR_MAX] = {0, 0};
+  uint64_t bytes[DIR_MAX] = {0, 0};
+
+  for (int dir = 0; dir < DIR_MAX; dir++) {
+    for (int mt = 0; mt < HAL_METRICS_NCI_MT_MAX; mt++) {
+      for (int gid = 0; gid < HAL_METRICS_NCI_GID_MAX; gid++) {
+        uint64_t f = mFrames[dir][mt][gid].load(std::memory_order_relaxed);
+        uint64_t b = mBytes[dir][mt][gid].load(std::memory_order_relaxed);
+        frames[dir] += f;
+        bytes[dir] += b;
+      }
+    }
+  }
+
+  text << "Frames: tx=" << frames[DIR_TX] << " (" << bytes[DIR_TX]
+       << " bytes) rx=" << frames[DIR_RX] << " (" << bytes[DIR_RX]
+       << " bytes)\n";
+  for (int dir = 0; dir < DIR_MAX; dir++) {
+    block << kDirectionNames[dir] << ".frames=" << frames[dir] << "\n";
+    block << kDirectionNames[dir] << ".bytes=" << bytes[dir] << "\n";
+  }
+
+  for (int dir = 0; dir < DIR_MAX; dir++) {
+    for (int mt = 0; mt < HAL_METRICS_NCI_MT_MAX; mt++) {
+      for (int gid = 0; gid < HAL_METRICS_NCI_GID_MAX; gid++) {
+        uint64_t f = mFrames[dir][mt][gid].load(std::memory_order_relaxed);
+        if (f == 0) continue;
+        uint64_t b = mBytes[dir][mt][gid].load(std::memory_order_relaxed);
+        text << "  " << kDirectionNames[dir] << " " << kMtNames[mt]
+             << " gid=" << gid << ": " << f << " frames, " << b << " bytes\n";
+        block << kDirectionNames[dir] << "." << kMtNames[mt] << ".gid" << gid
+              << ".frames=" << f << "\n";
+        block << kDirectionNames[dir] << "." << kMtNames[mt] << ".gid" << gid
+              << ".bytes=" << b << "\n";
+      }
+    }
+  }
+
+  for (int c = 0; c < COUNTER_MAX; c++) {
+    uint64_t value = mCounters[c].load(std::memory_order_relaxed);
+    text << kCounterNames[c] << ": " << value << "\n";
+    block << kCounterNames[c] << "=" << value << "\n";
+  }
+
+  for (int g = 0; g < GAUGE_MAX; g++) {
+    int64_t value = mGauges[g].load(std::memory_order_relaxed);
+    int64_t max = mGaugesMax[g].load(std::memory_order_relaxed);
+    text << kGaugeNames[g] << ": " << value << " (high watermark " << max
+         << ")\n";
+    block << kGaugeNames[g] << ".current=" << value << "\n";
+    block << kGaugeNames[g] << ".max=" << max << "\n";
+  }
+
+  text << "Timer fires per wrapper state:\n";
+  for (int s = 0; s < HAL_METRICS_WRAPPER_STATE_MAX; s++) {
+    uint64_t value = mTimerFires[s].load(std::memory_order_relaxed);
+    if (value) {
+      text << "  " << hal_wrapper_state_to_str(s) << ": " << value << "\n";
+    }
+    block << "timer_fires.state" << s << "=" << value << "\n";
+  }
+
+  text << "Recovery strategies:\n";
+  for (int s = 0; s < HalRecovery::STRATEGY_MAX; s++) {
+    const char* name = HalRecovery::strategyName((HalRecovery::Strategy)s);
+    uint64_t attempts = mRecoveryAttempts[s].load(std::memory_order_relaxed);
+    uint64_t successes = mRecoverySuccesses[s].load(std::memory_order_relaxed);
+    uint64_t last = mRecoveryTimeLastUs[s].load(std::memory_order_relaxed);
+    uint64_t max = mRecoveryTimeMaxUs[s].load(std::memory_order_relaxed);
+    uint64_t total = mRecoveryTimeTotalUs[s].load(std::memory_order_relaxed);
+    if (attempts) {
+      text << "  " << name << ": " << attempts << " attempts, " << successes
+           << " recovered";
+      if (successes) {
+        text << ", time to recover last " << last << " us, max " << max
+             << " us, avg " << total / successes << " us";
+      }
+      text << "\n";
+    }
+    block << "recovery." << name << ".attempts=" << attempts << "\n";
+    block << "recovery." << name << ".recovered=" << successes << "\n";
+    block << "recovery." << name << ".ttr_last_us=" << last << "\n";
+    block << "recovery." << name << ".ttr_max_us=" << max << "\n";
+    block << "recovery." << name << ".ttr_total_us=" << total << "\n";
+  }
+
+  text << "Injected faults:\n";
+  for (int f = 0; f < HalFaultInjector::FAULT_MAX; f++) {
+    const char* name = HalFaultInjector::faultName((HalFaultInjector::Fault)f);
+    uint64_t hits = mFaultHits[f].load(std::memory_order_relaxed);
+    uint64_t recoveries = mFaultRecoveries[f].load(std::memory_order_relaxed);
+    uint64_t last = mFaultDetectLastUs[f].load(std::memory_order_relaxed);
+    uint64_t max = mFaultDetectMaxUs[f].load(std::memory_order_relaxed);
+    if (hits) {
+      text << "  " << name << ": " << hits << " injected, " << recoveries
+           << " recoveries";
+      if (recoveries) {
+        text << ", detected after last " << last << " us, max " << max
+             << " us";
+      }
+      text << "\n";
+    }
+    block << "fault." << name << ".injected=" << hits << "\n";
+    block << "fault." << name << ".recoveries=" << recoveries << "\n";
+    block << "fault." << name << ".detect_last_us=" << last << "\n";
+    block << "fault." << name << ".detect_max_us=" << max << "\n";
+  }
+
+  text << "Thread wakeup delay:\n";
+  for (int r = 0; r < HalThreads::ROLE_MAX; r++) {
+    const char* name = HalThreads::roleName((HalThreads::Role)r);
+    uint64_t samples = 0;
+    uint64_t total = mWakeupTotalUs[r].load(std::memory_order_relaxed);
+    uint64_t max = mWakeupMaxUs[r].load(std::memory_order_relaxed);
+
+    for (int b = 0; b < HAL_METRICS_WAKEUP_BUCKETS; b++) {
+      uint64_t value = mWakeups[r][b].load(std::memory_order_relaxed);
+      samples += value;
+      if (b < HAL_METRICS_WAKEUP_BUCKETS - 1) {
+        block << "thread." << name << ".wakeup_le_" << kWakeupBucketsUs[b]
+              << "us=" << value << "\n";
+      } else {
+        block << "thread." << name << ".wakeup_gt_"
+              << kWakeupBucketsUs[b - 1] << "us=" << value << "\n";
+      }
+    }
+    if (samples) {
+      text << "  " << name << ": " << samples << " samples, avg "
+           << total / samples << " us, max " << max << " us\n";
+    }
+    block << "thread." << name << ".wakeups=" << samples << "\n";
+    block << "thread." << name << ".wakeup_total_us=" << total << "\n";
+    block << "thread." << name << ".wakeup_max_us=" << max << "\n";
+  }
+
+  text << "Power state residency:\n";
+  for (int r = 0; r < HalPowerManager::RESIDENCY_MAX; r++) {
+    const char* name =
+        HalPowerManager::residencyName((HalPowerManager::Residency)r);
+    uint64_t timeMs =
+        mPowerResidencyUs[r].load(std::memory_order_relaxed) / 1000;
+    uint64_t entries = mPowerEntries[r].load(std::memory_order_relaxed);
+    if (timeMs || entries) {
+      text << "  " << name << ": " << timeMs << " ms, " << entries
+           << " entries\n";
+    }
+    block << "power." << name << ".time_ms=" << timeMs << "\n";
+    block << "power." << name << ".entries=" << entries << "\n";
+  }
+
+  text << "Open phases:\n";
+  for (int p = 0; p < OPEN_PHASE_MAX; p++) {
+    const char* name = kOpenPhaseNames[p];
+    uint64_t count = mOpenPhaseCount[p].load(std::memory_order_relaxed);
+    uint64_t last = mOpenPhaseLastUs[p].load(std::memory_order_relaxed);
+    uint64_t max = mOpenPhaseMaxUs[p].load(std::memory_order_relaxed);
+    uint64_t total = mOpenPhaseTotalUs[p].load(std::memory_order_relaxed);
+    if (count) {
+      text << "  " << name << ": " << count << " times, last " << last
+           << " us, max " << max << " us, avg " << total / count << " us\n";
+    }
+    block << "open." << name << ".count=" << count << "\n";
+    block << "open." << name << ".last_us=" << last << "\n";
+    block << "open." << name << ".total_us=" << total << "\n";
+    block << "open." << name << ".max_us=" << max << "\n";
+  }
+
+  text << "Binder calls:\n";
+  for (int c = 0; c < HalBinderCalls::CALL_MAX; c++) {
+    const char* name = HalBinderCalls::callName((HalBinderCalls::Call)c);
+    uint64_t count = mBinderCalls[c].load(std::memory_order_relaxed);
+    uint64_t waitTotal = mBinderWaitTotalUs[c].load(std::memory_order_relaxed);
+    uint64_t waitMax = mBinderWaitMaxUs[c].load(std::memory_order_relaxed);
+    uint64_t runTotal = mBinderRunTotalUs[c].load(std::memory_order_relaxed);
+    uint64_t runMax = mBinderRunMaxUs[c].load(std::memory_order_relaxed);
+    if (count) {
+      text << "  " << name << ": " << count << " calls, queued avg "
+           << waitTotal / count << " us, max " << waitMax << " us, run avg "
+           << runTotal / count << " us, max " << runMax << " us\n";
+    }
+    block << "binder." << name << ".count=" << count << "\n";
+    block << "binder." << name << ".wait_total_us=" << waitTotal << "\n";
+    block << "binder." << name << ".wait_max_us=" << waitMax << "\n";
+    block << "binder." << name << ".run_total_us=" << runTotal << "\n";
+    block << "binder." << name << ".run_max_us=" << runMax << "\n";
+  }
+
+  dprintf(fd, "===== Nfc HAL Metrics v1 =====\n");
+  ::android::base::WriteStringToFd(text.str(), fd);
+  dprintf(fd, "--- BEGIN NFC_HAL_METRICS v1 ---\n");
+  ::android::base::WriteStringToFd(block.str(), fd);
+  dprintf(fd, "--- END NFC_HAL_METRICS v1 ---\n");
+  dprintf(fd, "===== Nfc HAL Metrics v1 =====\n");
+  fsync(fd);
+}
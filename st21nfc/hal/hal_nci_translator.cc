@@ -0,0 +1,446 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hal_nci_translator.h"
+
+#include <string.h>
+
+#include "android_logmsg.h"
+#include "hal_crc.h"
+#include "hal_metrics.h"
+
+#define NCI_HEADER_SIZE 3
+
+// Android sub-opcodes of the 2f 0c command, octet 3
+#define NCI_ANDROID_PASSIVE_OBSERVE 0x02
+#define NCI_ANDROID_QUERY_PASSIVE_OBSERVE 0x04
+#define NCI_ANDROID_SET_PASSIVE_OBSERVER_TECH 0x05
+#define NCI_ANDROID_SET_PASSIVE_OBSERVER_EXIT_FRAME 0x06
+#define NCI_ANDROID_SET_TECH_A_POLLING_LOOP_ANNOTATION 0x09
+
+// FW observe mode variant using RF_xxx_LISTEN_OBSERVE_MODE_STATE
+#define FW_OBSERVE_MODE_PER_TECH 2
+
+typedef HalNciTranslator::CommandResult CommandResult;
+typedef HalNciTranslator::ObserveState ObserveState;
+
+struct HalNciTranslator::Rule {
+  uint8_t subOid;
+  uint8_t length;         // exact command length, 0 if variable
+  uint8_t fwObserveMode;  // FW variant the rule is for, 0 for any
+  bool cached;            // frames kept built, and tracked once accepted
+  int (*command)(const uint8_t* cmd, size_t length, uint8_t* out,
+                 size_t outSize, CommandResult* result);
+  uint8_t rspHeader[2];
+  uint8_t rspMinLength;
+  uint16_t (*response)(const Rule* rule, uint8_t* rsp, uint16_t length,
+                       ObserveState* state);
+};
+
+/*
+ * Commands
+ */
+
+static int CopyFrame(const uint8_t* frame, size_t length, uint8_t* out,
+                     size_t outSize) {
+  if (length > outSize) return -1;
+  memcpy(out, frame, length);
+  return length;
+}
+
+static int CmdQueryObserve(const uint8_t* /* cmd */, size_t /* length */,
+                           uint8_t* out, size_t outSize,
+                           CommandResult* /* result */) {
+  // CORE_GET_CONFIG(0xa3)
+  static const uint8_t kCmd[] = {0x20, 0x03, 0x02, 0x01, 0xa3};
+  return CopyFrame(kCmd, sizeof(kCmd), out, outSize);
+}
+
+static int CmdQueryObservePerTech(const uint8_t* /* cmd */,
+                                  size_t /* length */, uint8_t* out,
+                                  size_t outSize,
+                                  CommandResult* /* result */) {
+  // RF_GET_LISTEN_OBSERVE_MODE_STATE
+  static const uint8_t kCmd[] = {0x21, 0x17, 0x00};
+  return CopyFrame(kCmd, sizeof(kCmd), out, outSize);
+}
+
+static int CmdObserve(const uint8_t* cmd, size_t /* length */, uint8_t* out,
+                      size_t outSize, CommandResult* result) {
+  // CORE_SET_CONFIG(0xa3 = enable)
+  const uint8_t frame[] = {0x20, 0x02, 0x04, 0x01, 0xa3, 0x01, cmd[4]};
+  result->setsObserveMode = true;
+  result->observeMode = cmd[4];
+  return CopyFrame(frame, sizeof(frame), out, outSize);
+}
+
+static int CmdObservePerTech(const uint8_t* cmd, size_t /* length */,
+                             uint8_t* out, size_t outSize,
+                             CommandResult* result) {
+  // RF_SET_LISTEN_OBSERVE_MODE_STATE, all technologies or none
+  uint8_t techs = cmd[4] ? 0x07 : 0x00;
+  const uint8_t frame[] = {0x21, 0x16, 0x01, techs};
+  result->setsObserveMode = true;
+  result->observeMode = techs;
+  return CopyFrame(frame, sizeof(frame), out, outSize);
+}
+
+static int CmdObserveTech(const uint8_t* cmd, size_t /* length */,
+                          uint8_t* out, size_t outSize,
+                          CommandResult* result) {
+  // RF_SET_LISTEN_OBSERVE_MODE_STATE, technologies given by the stack
+  const uint8_t frame[] = {0x21, 0x16, 0x01, cmd[4]};
+  result->setsObserveMode = true;
+  result->observeMode = cmd[4];
+  return CopyFrame(frame, sizeof(frame), out, outSize);
+}
+
+/*
+ * PROP_SET_PASSIVE_OBSERVER_EXIT_FRAME: the Android TLVs (type, length,
+ * power state, value, mask) are copied, with the CRC appended to the value
+ * and the mask of the type A/B frames. The CRC is only matched when the
+ * whole frame is; an empty value gets the CRC preset.
+ */
+static int CmdExitFrames(const uint8_t* cmd, size_t length, uint8_t* out,
+                         size_t outSize, CommandResult* /* result */) {
+  size_t in = 8;
+  size_t pos = 7;
+
+  if (length < in || outSize < pos) return -1;
+  out[0] = 0x2f;
+  out[1] = 0x19;
+  memcpy(out + 3, cmd + 4, 4);
+
+  while (in < length) {
+    if (length - in < 3) return -1;
+    uint8_t type = cmd[in];
+    size_t n = cmd[in + 1] ? (cmd[in + 1] - 1) / 2 : 0;
+    bool withCrc = (type & 0xF0) == 0x00;
+    size_t crcLength = withCrc ? 2 : 0;
+
+    if (length - in - 3 < 2 * n || outSize - pos < 3 + 2 * (n + crcLength) ||
+        cmd[in + 1] + 2 * crcLength > 0xFF) {
+      return -1;
+    }
+    const uint8_t* value = cmd + in + 3;
+    const uint8_t* mask = value + n;
+    bool exactMatch = true;
+    for (size_t i = 0; i < n; i++) {
+      if (mask[i] != 0xFF) {
+        exactMatch = false;
+        break;
+      }
+    }
+
+    out[pos++] = type;
+    out[pos++] = cmd[in + 1] + 2 * crcLength;
+    out[pos++] = cmd[in + 2];
+    memcpy(out + pos, value, n);
+    pos += n;
+    if (withCrc) {
+      uint16_t crc = 0;
+      if (exactMatch) {
+        crc = iso14443_crc(value, n, type == 0x01 ? Type_B : Type_A);
+      }
+      out[pos++] = (uint8_t)crc;
+      out[pos++] = (uint8_t)(crc >> 8);
+    }
+    memcpy(out + pos, mask, n);
+    pos += n;
+    if (withCrc) {
+      uint8_t crcMask = exactMatch ? 0xFF : 0x00;
+      out[pos++] = crcMask;
+      out[pos++] = crcMask;
+    }
+    in += 3 + 2 * n;
+  }
+  if (pos - NCI_HEADER_SIZE > 0xFF) return -1;
+  out[2] = pos - NCI_HEADER_SIZE;
+  return pos;
+}
+
+/*
+ * PROP_RF_SET_CUST_PASSIVE_POLL_FRAME: the type A annotation gets the CRC
+ * of its frame bytes after the first one appended, the CRC preset if there
+ * are none and 0 for a zero length frame. An empty annotation (length 2,
+ * flag 0) clears it.
+ */
+static int CmdPollingLoopAnnotation(const uint8_t* cmd, size_t length,
+                                    uint8_t* out, size_t outSize,
+                                    CommandResult* /* result */) {
+  if (length < 5) {
+    STLOG_HAL_E("HAL st21nfc %s  data_len is too short", __func__);
+    return -1;
+  }
+  if (cmd[2] == 0x02 && cmd[4] == 0x00) {
+    const uint8_t frame[] = {0x2f, 0x1d, 0x01, 0x00};
+    return CopyFrame(frame, sizeof(frame), out, outSize);
+  }
+  // Frame length at octet 6 (5 once the sub-opcode is dropped), frame data
+  // from octet 8, and the CRC replacing the sub-opcode in the total length.
+  if (length < 7 || cmd[6] > length - 7 || length >= HAL_NCI_MAX_FRAME_SIZE ||
+      length + 1 > outSize) {
+    return -1;
+  }
+
+  out[0] = 0x2f;
+  out[1] = 0x1d;
+  out[2] = cmd[2] + 1;
+  memcpy(out + 3, cmd + 4, length - 4);
+  uint16_t crc = 0;
+  if (out[5] > 0) {
+    crc = iso14443_crc(out + 7, out[5] - 1, Type_A);
+  }
+  out[5] += 2;
+  out[length - 1] = (uint8_t)crc;
+  out[length] = (uint8_t)(crc >> 8);
+  return length + 1;
+}
+
+/*
+ * Responses
+ */
+
+static uint16_t RspStatus(const HalNciTranslator::Rule* rule, uint8_t* rsp,
+                          uint16_t /* length */, ObserveState* /* state */) {
+  uint8_t status = rsp[3];
+  rsp[0] = 0x4f;
+  rsp[1] = 0x0c;
+  rsp[2] = 0x02;
+  rsp[3] = rule->subOid;
+  rsp[4] = status;
+  return 5;
+}
+
+static uint16_t RspObserveState(uint8_t* rsp, uint8_t fwMode,
+                                uint8_t androidMode, ObserveState* state) {
+  uint8_t status = rsp[3];
+  if (fwMode != state->observeMode) {
+    STLOG_HAL_E("mObserverMode got out of sync");
+    state->observeMode = fwMode;
+  }
+  rsp[0] = 0x4f;
+  rsp[1] = 0x0c;
+  rsp[2] = 0x03;
+  rsp[3] = NCI_ANDROID_QUERY_PASSIVE_OBSERVE;
+  rsp[4] = status;
+  rsp[5] = androidMode;
+  return 6;
+}
+
+static uint16_t RspQueryObserve(const HalNciTranslator::Rule* /* rule */,
+                                uint8_t* rsp, uint16_t /* length */,
+                                ObserveState* state) {
+  // CORE_GET_CONFIG_RSP, value of the single 0xa3 parameter
+  return RspObserveState(rsp, rsp[7], rsp[7], state);
+}
+
+static uint16_t RspQueryObservePerTech(
+    const HalNciTranslator::Rule* /* rule */, uint8_t* rsp,
+    uint16_t /* length */, ObserveState* state) {
+  // Seen as disabled by the stack while the FW has suspended it
+  return RspObserveState(rsp, rsp[4], state->suspended ? 0x00 : rsp[4],
+                         state);
+}
+
+/*
+ * Rules are matched in order on the sub-opcode, the command length and the
+ * FW variant: the per variant rules come first.
+ */
+static const HalNciTranslator::Rule kRules[] = {
+    {NCI_ANDROID_QUERY_PASSIVE_OBSERVE, 4, FW_OBSERVE_MODE_PER_TECH, false,
+     CmdQueryObservePerTech, {0x41, 0x17}, 5, RspQueryObservePerTech},
+    {NCI_ANDROID_QUERY_PASSIVE_OBSERVE, 4, 0, false, CmdQueryObserve,
+     {0x40, 0x03}, 8, RspQueryObserve},
+    {NCI_ANDROID_PASSIVE_OBSERVE, 5, FW_OBSERVE_MODE_PER_TECH, false,
+     CmdObservePerTech, {0x41, 0x16}, 4, RspStatus},
+    {NCI_ANDROID_PASSIVE_OBSERVE, 5, 0, false, CmdObserve, {0x40, 0x02}, 4,
+     RspStatus},
+    {NCI_ANDROID_SET_PASSIVE_OBSERVER_TECH, 5, 0, false, CmdObserveTech,
+     {0x41, 0x16}, 4, RspStatus},
+    {NCI_ANDROID_SET_PASSIVE_OBSERVER_EXIT_FRAME, 0, 0, true, CmdExitFrames,
+     {0x4f, 0x19}, 4, RspStatus},
+    {NCI_ANDROID_SET_TECH_A_POLLING_LOOP_ANNOTATION, 0, 0, true,
+     CmdPollingLoopAnnotation, {0x4f, 0x1d}, 4, RspStatus},
+};
+
+#define NUM_RULES (sizeof(kRules) / sizeof(kRules[0]))
+
+/**
+ * FNV-1a of an Android command, key of the frame cache.
+ * @param data Command
+ * @param length Its length
+ * @return The hash
+ */
+static uint32_t HashCommand(const uint8_t* data, size_t length) {
+  uint32_t hash = 2166136261u;
+
+  for (size_t i = 0; i < length; i++) {
+    hash ^= data[i];
+    hash *= 16777619;
+  }
+  return hash;
+}
+
+HalNciTranslator::HalNciTranslator()
+    : mPendingRule(0), mCacheClock(0), mPendingFrame(-1) {
+  memset(mCache, 0, sizeof(mCache));
+}
+
+int HalNciTranslator::translateCommand(const uint8_t* cmd, size_t length,
+                                       uint8_t fwObserveMode, uint8_t* out,
+                                       size_t outSize, CommandResult* result) {
+  if (length < 4 || cmd[0] != 0x2f || cmd[1] != 0x0c ||
+      cmd[2] != length - NCI_HEADER_SIZE) {
+    return 0;
+  }
+
+  for (size_t i = 0; i < NUM_RULES; i++) {
+    const Rule* rule = &kRules[i];
+    if (rule->subOid != cmd[3] || (rule->length && rule->length != length) ||
+        (rule->fwObserveMode && rule->fwObserveMode != fwObserveMode)) {
+      continue;
+    }
+    result->setsObserveMode = false;
+    result->observeMode = 0;
+    result->installed = false;
+    if (rule->cached) {
+      return translateCached(i, cmd, length, out, outSize, result);
+    }
+    int outLength = rule->command(cmd, length, out, outSize, result);
+    if (outLength > 0) mPendingRule = i + 1;
+    return outLength;
+  }
+  return 0;
+}
+
+bool HalNciTranslator::translateResponse(uint8_t* rsp, uint16_t* length,
+                                         ObserveState* state) {
+  uint8_t pending = mPendingRule.load(std::memory_order_relaxed);
+  if (pending == 0 || *length < NCI_HEADER_SIZE) return false;
+
+  const Rule* rule = &kRules[pending - 1];
+  if (rsp[0] != rule->rspHeader[0] || rsp[1] != rule->rspHeader[1] ||
+      *length < rule->rspMinLength ||
+      !mPendingRule.compare_exchange_strong(pending, 0)) {
+    return false;
+  }
+  if (rule->cached) onCachedResponse(pending - 1, rsp[3]);
+  *length = rule->response(rule, rsp, *length, state);
+  return true;
+}
+
+void HalNciTranslator::abortCommand() {
+  mPendingRule = 0;
+  std::lock_guard<std::mutex> lock(mCacheMutex);
+  mPendingFrame = -1;
+}
+
+void HalNciTranslator::reset() {
+  mPendingRule = 0;
+  onNfccReset();
+}
+
+void HalNciTranslator::onNfccReset() {
+  std::lock_guard<std::mutex> lock(mCacheMutex);
+  for (auto& entry : mCache) entry.installed = false;
+  mPendingFrame = -1;
+}
+
+/**
+ * Translation of a command of a cached rule: the frame is built on a miss
+ * only, and not sent at all if the NFCC holds it already.
+ * @param index Index of the rule in the table
+ * @param cmd Android command
+ * @param length Its length
+ * @param out Frame to send, or response if installed
+ * @param outSize Size of out
+ * @param result Result of the translation
+ * @return Length written to out, -1 if malformed
+ */
+int HalNciTranslator::translateCached(size_t index, const uint8_t* cmd,
+                                      size_t length, uint8_t* out,
+                                      size_t outSize, CommandResult* result) {
+  const Rule* rule = &kRules[index];
+  uint32_t hash = HashCommand(cmd, length);
+  CachedFrame* entry = NULL;
+  CachedFrame* victim = &mCache[0];
+
+  std::lock_guard<std::mutex> lock(mCacheMutex);
+  for (auto& e : mCache) {
+    if (e.valid && e.rule == index && e.hash == hash &&
+        e.cmdLength == length && memcmp(e.cmd, cmd, length) == 0) {
+      entry = &e;
+      break;
+    }
+    if (!e.valid || (victim->valid && e.lastUse < victim->lastUse)) {
+      victim = &e;
+    }
+  }
+
+  if (entry && entry->installed) {
+    const uint8_t rsp[] = {0x4f, 0x0c, 0x02, rule->subOid, 0x00};
+    entry->lastUse = ++mCacheClock;
+    result->installed = true;
+    HalMetrics::getInstance().increment(HalMetrics::NCI_FRAME_LOCAL_ACKS);
+    return CopyFrame(rsp, sizeof(rsp), out, outSize);
+  }
+
+  if (entry) {
+    HalMetrics::getInstance().increment(HalMetrics::NCI_FRAME_CACHE_HITS);
+  } else {
+    if (length > sizeof(victim->cmd)) return -1;
+    entry = victim;
+    entry->valid = false;
+    if (mPendingFrame == entry - mCache) mPendingFrame = -1;
+    int frameLength = rule->command(cmd, length, entry->frame,
+                                    sizeof(entry->frame), result);
+    if (frameLength <= 0) return frameLength;
+    entry->valid = true;
+    entry->installed = false;
+    entry->rule = index;
+    entry->hash = hash;
+    entry->cmdLength = length;
+    memcpy(entry->cmd, cmd, length);
+    entry->frameLength = frameLength;
+  }
+  entry->lastUse = ++mCacheClock;
+
+  int outLength = CopyFrame(entry->frame, entry->frameLength, out, outSize);
+  if (outLength > 0) {
+    mPendingFrame = entry - mCache;
+    mPendingRule = index + 1;
+  }
+  return outLength;
+}
+
+/**
+ * Response of the NFCC to the frame of a cached rule: on success it holds
+ * that frame, in place of any other of the rule.
+ * @param rule Index of the rule in the table
+ * @param status Status of the response
+ */
+void HalNciTranslator::onCachedResponse(uint8_t rule, uint8_t status) {
+  std::lock_guard<std::mutex> lock(mCacheMutex);
+  for (auto& entry : mCache) {
+    if (entry.rule == rule) entry.installed = false;
+  }
+  if (mPendingFrame >= 0 && mCache[mPendingFrame].valid &&
+      mCache[mPendingFrame].rule == rule && status == 0x00) {
+    mCache[mPendingFrame].installed = true;
+  }
+  mPendingFrame = -1;
+}
@@ -0,0 +1,179 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hal_observe_mode.h"
+
+#include <string.h>
+
+#include "android_logmsg.h"
+#include "hal_metrics.h"
+#include "hal_threads.h"
+
+// Android sub-opcodes of the 2f 0c command and 4f 0c response, octet 3
+#define NCI_ANDROID_PASSIVE_OBSERVE 0x02
+#define NCI_ANDROID_QUERY_PASSIVE_OBSERVE 0x04
+#define NCI_ANDROID_SET_PASSIVE_OBSERVER_TECH 0x05
+
+HalObserveMode::HalObserveMode()
+    : mResyncUs(0),
+      mKnown(false),
+      mTechs(0),
+      mSetPending(false),
+      mPendingTechs(0),
+      mSuspended(false),
+      mSuspendPending(false),
+      mSyncedUs(0),
+      mPrevSetPending(false),
+      mPrevPendingTechs(0),
+      mPrevSuspended(false),
+      mPrevSuspendPending(false) {}
+
+void HalObserveMode::open() {
+  unsigned long resyncMs = 0;
+
+  GetNumValue(NAME_STNFC_OBSERVE_MODE_RESYNC_MS, &resyncMs, sizeof(resyncMs));
+  mResyncUs = (uint64_t)resyncMs * 1000;
+
+  std::lock_guard<std::mutex> lock(mMutex);
+  forget();
+  mTechs = 0;
+  mSetPending = false;
+  mSuspended = false;
+  mSuspendPending = false;
+}
+
+void HalObserveMode::onReset() {
+  std::lock_guard<std::mutex> lock(mMutex);
+  forget();
+}
+
+void HalObserveMode::requestResync() {
+  std::lock_guard<std::mutex> lock(mMutex);
+  forget();
+}
+
+void HalObserveMode::onSetCommand(uint8_t techs) {
+  std::lock_guard<std::mutex> lock(mMutex);
+  mPrevSetPending = mSetPending;
+  mPrevPendingTechs = mPendingTechs;
+  mPrevSuspended = mSuspended;
+  mPrevSuspendPending = mSuspendPending;
+  mSetPending = true;
+  mPendingTechs = techs;
+  mSuspended = false;
+  mSuspendPending = false;
+}
+
+void HalObserveMode::onSetCommandNotSent() {
+  std::lock_guard<std::mutex> lock(mMutex);
+  mSetPending = mPrevSetPending;
+  mPendingTechs = mPrevPendingTechs;
+  mSuspended = mPrevSuspended;
+  mSuspendPending = mPrevSuspendPending;
+}
+
+void HalObserveMode::onResponse(const uint8_t* rsp, size_t length,
+                                const HalNciTranslator::ObserveState& fw) {
+  if (length < 5 || rsp[0] != 0x4f || rsp[1] != 0x0c) return;
+  bool ok = rsp[4] == 0x00;
+
+  std::lock_guard<std::mutex> lock(mMutex);
+  switch (rsp[3]) {
+    case NCI_ANDROID_PASSIVE_OBSERVE:
+    case NCI_ANDROID_SET_PASSIVE_OBSERVER_TECH:
+      if (!mSetPending) break;
+      mSetPending = false;
+      if (!ok) {
+        // The FW may have applied part of it, ask it.
+        STLOG_HAL_W("%s - set 0x%02X failed, resync", __func__,
+                    mPendingTechs);
+        forget();
+        break;
+      }
+      mTechs = mPendingTechs;
+      mKnown = true;
+      mSyncedUs = HalThreads::nowUs();
+      break;
+    case NCI_ANDROID_QUERY_PASSIVE_OBSERVE:
+      HalMetrics::getInstance().increment(HalMetrics::OBSERVE_MODE_SYNCS);
+      if (!ok || mSetPending) break;
+      mTechs = fw.observeMode;
+      mKnown = true;
+      mSyncedUs = HalThreads::nowUs();
+      break;
+    default:
+      break;
+  }
+}
+
+HalNciTranslator::ObserveState HalObserveMode::state() {
+  std::lock_guard<std::mutex> lock(mMutex);
+  return {mSetPending ? mPendingTechs : mTechs, mSuspended};
+}
+
+void HalObserveMode::onSuspended() {
+  std::lock_guard<std::mutex> lock(mMutex);
+  mSuspendPending = true;
+}
+
+void HalObserveMode::onResumed() {
+  std::lock_guard<std::mutex> lock(mMutex);
+  mSuspended = false;
+  mSuspendPending = false;
+}
+
+bool HalObserveMode::takePollingLoopFrame() {
+  std::lock_guard<std::mutex> lock(mMutex);
+  if ((mSetPending ? mPendingTechs : mTechs) == 0 || mSuspended) return false;
+  if (mSuspendPending) {
+    mSuspended = true;
+    mSuspendPending = false;
+  }
+  return true;
+}
+
+bool HalObserveMode::wantsPollingLoopFrames() {
+  std::lock_guard<std::mutex> lock(mMutex);
+  return (mSetPending ? mPendingTechs : mTechs) != 0 && !mSuspended;
+}
+
+bool HalObserveMode::isQuery(const uint8_t* cmd, size_t length) {
+  return length == 4 && cmd[0] == 0x2f && cmd[1] == 0x0c && cmd[2] == 0x01 &&
+         cmd[3] == NCI_ANDROID_QUERY_PASSIVE_OBSERVE;
+}
+
+size_t HalObserveMode::answerQuery(uint8_t* rsp, size_t size) {
+  std::lock_guard<std::mutex> lock(mMutex);
+  if (size < 6 || !mKnown || mSetPending ||
+      (mResyncUs && HalThreads::nowUs() - mSyncedUs >= mResyncUs)) {
+    return 0;
+  }
+  rsp[0] = 0x4f;
+  rsp[1] = 0x0c;
+  rsp[2] = 0x03;
+  rsp[3] = NCI_ANDROID_QUERY_PASSIVE_OBSERVE;
+  rsp[4] = 0x00;
+  // Seen as disabled by the stack while the FW has suspended it
+  rsp[5] = mSuspended ? 0x00 : mTechs;
+  HalMetrics::getInstance().increment(HalMetrics::OBSERVE_MODE_LOCAL_QUERIES);
+  return 6;
+}
+
+/**
+ * Forget the state, the next query goes to the NFCC. The technologies are
+ * kept to filter the polling loop frames until then. Called with mMutex held.
+ */
+void HalObserveMode::forget() { mKnown = false; }
@@ -0,0 +1,217 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hal_power.h"
+
+#include <errno.h>
+#include <string.h>
+
+#include "android_logmsg.h"
+#include "hal_event_logger.h"
+#include "hal_metrics.h"
+#include "hal_threads.h"
+#include "i2clayer.h"
+
+// Clock transitions tried before giving up on the state the driver reports.
+#define HAL_POWER_CLK_ATTEMPTS 2
+#define HAL_POWER_NO_SUB_STATE 0xFF
+
+static const char* kResidencyNames[HalPowerManager::RESIDENCY_MAX] = {
+    "off",
+    "screen_on_unlocked",
+    "screen_off_unlocked",
+    "screen_on_locked",
+    "screen_off_locked",
+    "clock_on",
+    "active_rw",
+};
+
+static bool HalPowerIsScreenOn(uint8_t subState) {
+  return subState == 0x00 || subState == 0x02;
+}
+
+HalPowerManager::HalPowerManager()
+    : mFid(-1),
+      mControlClock(false),
+      mActiveRwTimer(false),
+      mScreen(OFF),
+      mClock(-1),
+      mActiveRW(false),
+      mSinceUs(HalThreads::nowUs()),
+      mPendingSubState(HAL_POWER_NO_SUB_STATE) {}
+
+void HalPowerManager::open(int fid) {
+  unsigned long controlClock = 0;
+  unsigned long activeRwTimer = 0;
+
+  GetNumValue(NAME_STNFC_CONTROL_CLK, &controlClock, sizeof(controlClock));
+  GetNumValue(NAME_STNFC_ACTIVERW_TIMER, &activeRwTimer,
+              sizeof(activeRwTimer));
+  mControlClock = controlClock != 0;
+  mActiveRwTimer = activeRwTimer != 0;
+  mPendingSubState = HAL_POWER_NO_SUB_STATE;
+
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    account();
+    mFid = fid;
+    mScreen = SCREEN_ON_UNLOCKED;
+    mActiveRW = false;
+    HalMetrics::getInstance().countPowerEntry(mScreen);
+  }
+
+  if (mControlClock) setClock(false);
+}
+
+void HalPowerManager::close() {
+  std::lock_guard<std::mutex> lock(mMutex);
+  account();
+  mFid = -1;
+  mScreen = OFF;
+  mActiveRW = false;
+  HalMetrics::getInstance().countPowerEntry(OFF);
+}
+
+void HalPowerManager::onCommand(const uint8_t* data, size_t length) {
+  int clock;
+
+  // CORE_SET_POWER_SUB_STATE_CMD
+  if (length < 4 || data[0] != 0x20 || data[1] != 0x09 || data[3] > 0x03) {
+    return;
+  }
+  mPendingSubState = data[3];
+  if (!mControlClock) return;
+
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    clock = mClock;
+  }
+  if (clock < 0) clock = readClockState();
+  STLOG_HAL_D("%s - sub-state %d, clock %d", __func__, data[3], clock);
+
+  if (clock == 1 && !HalPowerIsScreenOn(data[3])) {
+    setClock(false);
+  } else if (clock == 0 && HalPowerIsScreenOn(data[3])) {
+    setClock(true);
+  }
+}
+
+bool HalPowerManager::onSubStateResponse(const uint8_t* data, size_t length) {
+  uint8_t subState = mPendingSubState;
+  bool activeRW;
+
+  if (subState == HAL_POWER_NO_SUB_STATE) return false;
+  mPendingSubState = HAL_POWER_NO_SUB_STATE;
+
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    Residency screen = (Residency)(SCREEN_ON_UNLOCKED + subState);
+    if (length >= 4 && data[3] == 0x00 && screen != mScreen) {
+      account();
+      mScreen = screen;
+      HalMetrics::getInstance().countPowerEntry(screen);
+    }
+    activeRW = mActiveRW;
+  }
+
+  return mActiveRwTimer && activeRW && !HalPowerIsScreenOn(subState);
+}
+
+void HalPowerManager::setActiveRW(bool active) {
+  std::lock_guard<std::mutex> lock(mMutex);
+  if (active == mActiveRW) return;
+  account();
+  mActiveRW = active;
+  if (active) HalMetrics::getInstance().countPowerEntry(ACTIVE_RW);
+}
+
+bool HalPowerManager::activeRW() {
+  std::lock_guard<std::mutex> lock(mMutex);
+  return mActiveRW;
+}
+
+int HalPowerManager::readClockState() {
+  int state;
+
+  if (mFid < 0) return -1;
+  state = ioctl(mFid, ST21NFC_CLK_STATE, NULL);
+  if (state < 0) {
+    STLOG_HAL_E("ST21NFC_CLK_STATE failed errno %d(%s)", errno,
+                strerror(errno));
+    return -1;
+  }
+  return state;
+}
+
+void HalPowerManager::flush() {
+  std::lock_guard<std::mutex> lock(mMutex);
+  account();
+}
+
+const char* HalPowerManager::residencyName(Residency residency) {
+  if (residency >= RESIDENCY_MAX) return "unknown";
+  return kResidencyNames[residency];
+}
+
+/**
+ * Add the time since the last change to the current states. Called with
+ * mMutex held, before any change.
+ */
+void HalPowerManager::account() {
+  HalMetrics& metrics = HalMetrics::getInstance();
+  uint64_t now = HalThreads::nowUs();
+  uint64_t elapsed = now - mSinceUs;
+
+  mSinceUs = now;
+  metrics.addPowerResidency(mScreen, elapsed);
+  if (mClock == 1) metrics.addPowerResidency(CLOCK_ON, elapsed);
+  if (mActiveRW) metrics.addPowerResidency(ACTIVE_RW, elapsed);
+}
+
+/**
+ * Switch the NFCC clock and check the driver did.
+ * @param enable Clock state to set
+ * @return true if the driver reports the clock in that state
+ */
+bool HalPowerManager::setClock(bool enable) {
+  const char* name = enable ? "CLK_ENABLE" : "CLK_DISABLE";
+  int state = -1;
+
+  for (int attempt = 0; attempt < HAL_POWER_CLK_ATTEMPTS; attempt++) {
+    if (ioctl(mFid, enable ? ST21NFC_CLK_ENABLE : ST21NFC_CLK_DISABLE, NULL) <
+        0) {
+      STLOG_HAL_E("ST21NFC_%s failed errno %d(%s)", name, errno,
+                  strerror(errno));
+      continue;
+    }
+    state = readClockState();
+    if (state == (enable ? 1 : 0)) break;
+    STLOG_HAL_E("%s STATE ERROR clk_state = %d", name, state);
+  }
+
+  std::lock_guard<std::mutex> lock(mMutex);
+  account();
+  mClock = state;
+  if (state != (enable ? 1 : 0)) {
+    HalMetrics::getInstance().increment(HalMetrics::CLOCK_ERRORS);
+    HalEventLogger::getInstance().log()
+        << __func__ << " " << name << " clk_state " << state << std::endl;
+    return false;
+  }
+  HalMetrics::getInstance().increment(HalMetrics::CLOCK_TRANSITIONS);
+  if (enable) HalMetrics::getInstance().countPowerEntry(CLOCK_ON);
+  return true;
+}
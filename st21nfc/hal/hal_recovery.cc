@@ -0,0 +1,320 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hal_recovery.h"
+
+#include <cutils/properties.h>
+#include <dlfcn.h>
+#include <string.h>
+
+#include <string>
+
+#include "android_logmsg.h"
+#include "hal_event_logger.h"
+#include "hal_metrics.h"
+
+#if defined(ST_LIB_32)
+#define VENDOR_LIB_PATH "/vendor/lib/"
+#else
+#define VENDOR_LIB_PATH "/vendor/lib64/"
+#endif
+#define VENDOR_LIB_EXT ".so"
+
+#define HAL_RECOVERY_STRESET_PROP "persist.vendor.nfc.streset"
+
+// A recovery triggered again within this delay, in ms, of one that worked
+// starts past the strategy that worked.
+#define HAL_RECOVERY_ESCALATION_WINDOW 10000
+
+typedef int (*STEseReset)(void);
+
+static const char* kStrategyNames[HalRecovery::STRATEGY_MAX] = {
+    "retry_command", "rf_deactivate", "soft_reset", "reset_pulse",
+    "cold_reset",
+};
+
+static const uint8_t kRfDeactivateCmd[] = {0x21, 0x06, 0x01, 0x00};
+static const uint8_t kCoreResetCmd[] = {0x20, 0x00, 0x01, 0x01};
+
+static uint64_t HalRecoveryElapsedUs(const struct timespec& start) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)(now.tv_sec - start.tv_sec) * 1000000 +
+         (now.tv_nsec - start.tv_nsec) / 1000;
+}
+
+HalRecovery::HalRecovery()
+    : mActive(false),
+      mHalHandle(NULL),
+      mStrategy(RETRY_COMMAND),
+      mPhase(PHASE_WAIT_RSP),
+      mOrigin(HAL_WRAPPER_STATE_CLOSED),
+      mReason(0),
+      mStart(),
+      mRsp(),
+      mLastRecovered(STRATEGY_MAX),
+      mLastRecoveredAt(),
+      mLastCommandLength(0),
+      mLastDiscoverLength(0) {}
+
+void HalRecovery::reset() {
+  mActive = false;
+  mLastRecovered = STRATEGY_MAX;
+  mLastCommandLength = 0;
+  mLastDiscoverLength = 0;
+}
+
+void HalRecovery::noteCommand(const uint8_t* data, size_t length) {
+  // Only commands, 001b in the MT field of octet 0.
+  if (mActive || length < 3 || (data[0] & 0xE0) != 0x20 ||
+      length > HAL_RECOVERY_NCI_MAX_SIZE) {
+    return;
+  }
+  memcpy(mLastCommand, data, length);
+  mLastCommandLength = length;
+  if (data[0] == 0x21 && data[1] == 0x03) {
+    memcpy(mLastDiscover, data, length);
+    mLastDiscoverLength = length;
+  }
+}
+
+HalRecovery::Action HalRecovery::start(HALHANDLE hHAL, Strategy first,
+                                       hal_wrapper_state_e origin,
+                                       uint8_t reason) {
+  int from = first;
+
+  mHalHandle = hHAL;
+  mOrigin = origin;
+  mReason = reason;
+  mActive = true;
+  clock_gettime(CLOCK_MONOTONIC, &mStart);
+  HalSendDownstreamStopTimer(hHAL);
+
+  // The same trouble coming back right away: what worked last time is not
+  // enough.
+  if (mLastRecovered != STRATEGY_MAX && mLastRecovered >= first &&
+      HalRecoveryElapsedUs(mLastRecoveredAt) <
+          (uint64_t)HAL_RECOVERY_ESCALATION_WINDOW * 1000) {
+    from = mLastRecovered + 1;
+  }
+
+  STLOG_HAL_W("%s - from %s, reason 0x%02x", __func__,
+              from < STRATEGY_MAX ? kStrategyNames[from] : "none", reason);
+  HalEventLogger::getInstance().log()
+      << __func__ << " origin=" << origin << " reason=" << (int)reason
+      << std::endl;
+  return tryFrom(from);
+}
+
+HalRecovery::Action HalRecovery::onFrame(uint8_t* data, uint16_t length) {
+  if (!mActive || length < 3) return CONSUMED;
+
+  switch (mPhase) {
+    case PHASE_WAIT_RSP:
+      if (data[0] != mRsp[0] || (data[1] & 0x3F) != mRsp[1]) break;
+      if (mStrategy == RETRY_COMMAND) return succeed(REPLAY);
+      // RF_DEACTIVATE_RSP
+      if (length < 4 || data[3] != 0x00) return escalate();
+      mPhase = PHASE_WAIT_RF_SETTLE;
+      HalSendDownstreamStopTimer(mHalHandle);
+      HalSendDownstreamTimer(mHalHandle, HAL_RECOVERY_RF_SETTLE_TIMEOUT);
+      break;
+
+    case PHASE_WAIT_RF_SETTLE:
+      // RF_DEACTIVATE_NTF: a link was active. The stack sees it go back to
+      // discovery, which is where the NFCC is about to be.
+      if (data[0] == 0x61 && data[1] == 0x06 && length >= 5) {
+        data[3] = 0x03;
+        sendDiscover();
+        return FORWARD;
+      }
+      break;
+
+    case PHASE_WAIT_DISCOVER_RSP:
+      if (data[0] == 0x41 && data[1] == 0x03) {
+        if (length >= 4 && data[3] == 0x00) return succeed(RESUMED);
+        return escalate();
+      }
+      break;
+
+    case PHASE_WAIT_RESET_NTF:
+      // CORE_RESET_NTF, the CORE_RESET_RSP of SOFT_RESET is not enough.
+      if (data[0] == 0x60 && data[1] == 0x00) return succeed(RESET);
+      break;
+  }
+  return CONSUMED;
+}
+
+HalRecovery::Action HalRecovery::onTimeout() {
+  if (!mActive) return CONSUMED;
+
+  HalSendDownstreamStopTimer(mHalHandle);
+  if (mPhase == PHASE_WAIT_RF_SETTLE) {
+    // No link was active, the NFCC is idle.
+    sendDiscover();
+    return CONSUMED;
+  }
+  STLOG_HAL_E("%s - no answer to %s", __func__, kStrategyNames[mStrategy]);
+  return escalate();
+}
+
+const char* HalRecovery::strategyName(Strategy strategy) {
+  if (strategy >= STRATEGY_MAX) return "unknown";
+  return kStrategyNames[strategy];
+}
+
+bool HalRecovery::coldReset() {
+  char valueStr[PROPERTY_VALUE_MAX] = {0};
+  void* stdll;
+
+  if (property_get(HAL_RECOVERY_STRESET_PROP, valueStr, "") <= 0) {
+    return false;
+  }
+  stdll = dlopen(valueStr, RTLD_NOW);
+  if (!stdll) {
+    std::string path = std::string(VENDOR_LIB_PATH) + valueStr +
+                       VENDOR_LIB_EXT;
+    stdll = dlopen(path.c_str(), RTLD_NOW);
+  }
+  if (!stdll) {
+    STLOG_HAL_D("%s not found, do nothing.", valueStr);
+    return false;
+  }
+
+  STLOG_HAL_D("STReset Cold reset");
+  STEseReset fn = (STEseReset)dlsym(stdll, "cold_reset");
+  if (!fn) return false;
+  int ret = fn();
+  STLOG_HAL_D("STReset Result=%d", ret);
+  return true;
+}
+
+bool HalRecovery::applies(int strategy) const {
+  switch (strategy) {
+    case RETRY_COMMAND:
+      return mLastCommandLength != 0;
+    case RF_DEACTIVATE:
+      return mOrigin == HAL_WRAPPER_STATE_READY && mLastDiscoverLength != 0;
+    default:
+      return true;
+  }
+}
+
+/**
+ * Send the stimulus of a strategy and arm its timer.
+ * @return false if it could not be tried
+ */
+bool HalRecovery::attempt(int strategy) {
+  const uint8_t* cmd = NULL;
+  size_t cmdLength = 0;
+  uint32_t timeout;
+
+  mStrategy = (Strategy)strategy;
+  switch (strategy) {
+    case RETRY_COMMAND:
+      timeout = HAL_RECOVERY_RETRY_TIMEOUT;
+      mPhase = PHASE_WAIT_RSP;
+      mRsp[0] = 0x40 | (mLastCommand[0] & 0x0F);
+      mRsp[1] = mLastCommand[1] & 0x3F;
+      cmd = mLastCommand;
+      cmdLength = mLastCommandLength;
+      break;
+
+    case RF_DEACTIVATE:
+      timeout = HAL_RECOVERY_RF_DEACTIVATE_TIMEOUT;
+      mPhase = PHASE_WAIT_RSP;
+      mRsp[0] = 0x41;
+      mRsp[1] = 0x06;
+      cmd = kRfDeactivateCmd;
+      cmdLength = sizeof(kRfDeactivateCmd);
+      break;
+
+    case SOFT_RESET:
+      timeout = HAL_RECOVERY_SOFT_RESET_TIMEOUT;
+      mPhase = PHASE_WAIT_RESET_NTF;
+      cmd = kCoreResetCmd;
+      cmdLength = sizeof(kCoreResetCmd);
+      break;
+
+    case RESET_PULSE:
+      timeout = HAL_RECOVERY_RESET_PULSE_TIMEOUT;
+      mPhase = PHASE_WAIT_RESET_NTF;
+      I2cResetPulse();
+      break;
+
+    case COLD_RESET:
+      timeout = HAL_RECOVERY_COLD_RESET_TIMEOUT;
+      mPhase = PHASE_WAIT_RESET_NTF;
+      if (!coldReset()) return false;
+      break;
+
+    default:
+      return false;
+  }
+
+  HalEventLogger::getInstance().store_timer_activity(kStrategyNames[strategy],
+                                                     timeout);
+  if (cmd) return HalSendDownstreamTimer(mHalHandle, cmd, cmdLength, timeout);
+  return HalSendDownstreamTimer(mHalHandle, timeout);
+}
+
+HalRecovery::Action HalRecovery::tryFrom(int strategy) {
+  for (; strategy < STRATEGY_MAX; strategy++) {
+    if (!applies(strategy)) continue;
+    STLOG_HAL_W("%s - trying %s", __func__, kStrategyNames[strategy]);
+    if (attempt(strategy)) return CONSUMED;
+  }
+
+  mActive = false;
+  STLOG_HAL_E("%s - NFCC not recovered after %llu us", __func__,
+              (unsigned long long)HalRecoveryElapsedUs(mStart));
+  HalEventLogger::getInstance().log()
+      << __func__ << " NFCC not recovered" << std::endl;
+  HalMetrics::getInstance().increment(HalMetrics::RECOVERY_FAILURES);
+  return FAILED;
+}
+
+HalRecovery::Action HalRecovery::escalate() {
+  HalMetrics::getInstance().countRecovery(mStrategy, false, 0);
+  HalSendDownstreamStopTimer(mHalHandle);
+  return tryFrom(mStrategy + 1);
+}
+
+HalRecovery::Action HalRecovery::succeed(Action action) {
+  uint64_t elapsed = HalRecoveryElapsedUs(mStart);
+
+  HalSendDownstreamStopTimer(mHalHandle);
+  mActive = false;
+  mLastRecovered = mStrategy;
+  clock_gettime(CLOCK_MONOTONIC, &mLastRecoveredAt);
+  HalMetrics::getInstance().countRecovery(mStrategy, true, elapsed);
+
+  STLOG_HAL_W("%s - NFCC back after %s, %llu us", __func__,
+              kStrategyNames[mStrategy], (unsigned long long)elapsed);
+  HalEventLogger::getInstance().log()
+      << __func__ << " " << kStrategyNames[mStrategy] << " " << elapsed
+      << " us" << std::endl;
+  return action;
+}
+
+void HalRecovery::sendDiscover() {
+  mPhase = PHASE_WAIT_DISCOVER_RSP;
+  HalSendDownstreamStopTimer(mHalHandle);
+  HalEventLogger::getInstance().store_timer_activity(
+      "rf_deactivate discover", HAL_RECOVERY_RF_DEACTIVATE_TIMEOUT);
+  HalSendDownstreamTimer(mHalHandle, mLastDiscover, mLastDiscoverLength,
+                         HAL_RECOVERY_RF_DEACTIVATE_TIMEOUT);
+}
@@ -0,0 +1,223 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hal_threads.h"
+
+#include <errno.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "android_logmsg.h"
+
+#define HAL_THREAD_SCHED_SIZE 32
+
+struct HalThreadStart {
+  HalThreads::Role role;
+  void* (*start)(void*);
+  void* arg;
+};
+
+// At most 15 characters, the limit of the kernel.
+static const char* kThreadNames[HalThreads::ROLE_MAX] = {
+    "nfc_hal_io",
+    "nfc_hal_worker",
+    "nfc_hal_cb",
+    "nfc_hal_fwtrace",
+};
+
+static const char* kRoleNames[HalThreads::ROLE_MAX] = {
+    "io",
+    "worker",
+    "callback",
+    "fw_trace",
+};
+
+static const char* kSchedKeys[HalThreads::ROLE_MAX] = {
+    NAME_STNFC_THREAD_IO_SCHED,
+    NAME_STNFC_THREAD_WORKER_SCHED,
+    NAME_STNFC_THREAD_CALLBACK_SCHED,
+    NAME_STNFC_THREAD_FW_TRACE_SCHED,
+};
+
+static const char* kCpusKeys[HalThreads::ROLE_MAX] = {
+    NAME_STNFC_THREAD_IO_CPUS,
+    NAME_STNFC_THREAD_WORKER_CPUS,
+    NAME_STNFC_THREAD_CALLBACK_CPUS,
+    NAME_STNFC_THREAD_FW_TRACE_CPUS,
+};
+
+/* Scheduling of the roles the configuration leaves unset, NULL to inherit. */
+static const char* kDefaultSched[HalThreads::ROLE_MAX] = {
+    NULL,
+    NULL,
+    NULL,
+    "nice:10",
+};
+
+/**
+ * Apply the CPU affinity of the configuration to the calling thread.
+ * @param role Role of the thread
+ */
+static void HalThreadSetAffinity(HalThreads::Role role) {
+  unsigned long cpus = 0;
+  cpu_set_t set;
+
+  if (!GetNumValue(kCpusKeys[role], &cpus, sizeof(cpus)) || cpus == 0) {
+    return;
+  }
+  CPU_ZERO(&set);
+  for (size_t cpu = 0; cpu < sizeof(cpus) * 8 && cpu < CPU_SETSIZE; cpu++) {
+    if (cpus & (1UL << cpu)) CPU_SET(cpu, &set);
+  }
+  if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+    STLOG_HAL_E("%s - %s cpus 0x%lx: %s", __func__, kRoleNames[role], cpus,
+                strerror(errno));
+  }
+}
+
+/**
+ * Apply the scheduling of the configuration to the calling thread.
+ * @param role Role of the thread
+ */
+static void HalThreadSetScheduling(HalThreads::Role role) {
+  char sched[HAL_THREAD_SCHED_SIZE] = {0};
+  struct sched_param param;
+  const char* value;
+  int policy;
+  int ret;
+
+  if (!GetStrValue(kSchedKeys[role], sched, sizeof(sched))) {
+    if (!kDefaultSched[role]) return;
+    snprintf(sched, sizeof(sched), "%s", kDefaultSched[role]);
+  }
+
+  value = strchr(sched, ':');
+  if (!value) {
+    STLOG_HAL_E("%s - %s: invalid scheduling '%s'", __func__,
+                kRoleNames[role], sched);
+    return;
+  }
+  value++;
+
+  if (strncmp(sched, "nice:", 5) == 0) {
+    ret = setpriority(PRIO_PROCESS, gettid(), atoi(value));
+  } else {
+    if (strncmp(sched, "fifo:", 5) == 0) {
+      policy = SCHED_FIFO;
+    } else if (strncmp(sched, "rr:", 3) == 0) {
+      policy = SCHED_RR;
+    } else {
+      STLOG_HAL_E("%s - %s: invalid scheduling '%s'", __func__,
+                  kRoleNames[role], sched);
+      return;
+    }
+    memset(&param, 0, sizeof(param));
+    param.sched_priority = atoi(value);
+    ret = pthread_setschedparam(pthread_self(), policy, &param);
+    if (ret != 0) {
+      errno = ret;
+      ret = -1;
+    }
+  }
+
+  if (ret != 0) {
+    STLOG_HAL_E("%s - %s %s: %s", __func__, kRoleNames[role], sched,
+                strerror(errno));
+  } else {
+    STLOG_HAL_D("%s - %s %s", __func__, kRoleNames[role], sched);
+  }
+}
+
+/**
+ * Fault in and lock the top of the stack of the calling thread, where it
+ * runs.
+ */
+static void HalThreadLockStack() {
+  pthread_attr_t attr;
+  void* addr;
+  size_t size;
+
+  if (pthread_getattr_np(pthread_self(), &attr) != 0) return;
+  if (pthread_attr_getstack(&attr, &addr, &size) == 0) {
+    size_t locked =
+        size < HAL_THREAD_STACK_LOCK_SIZE ? size : HAL_THREAD_STACK_LOCK_SIZE;
+    if (mlock((uint8_t*)addr + size - locked, locked) != 0) {
+      STLOG_HAL_E("%s - %s", __func__, strerror(errno));
+    }
+  }
+  pthread_attr_destroy(&attr);
+}
+
+static void* HalThreadEntry(void* arg) {
+  HalThreadStart start = *(HalThreadStart*)arg;
+  free(arg);
+
+  pthread_setname_np(pthread_self(), kThreadNames[start.role]);
+  HalThreadSetAffinity(start.role);
+  HalThreadSetScheduling(start.role);
+  if (HalThreads::memoryLocked()) HalThreadLockStack();
+
+  return start.start(start.arg);
+}
+
+int HalThreads::create(pthread_t* thread, Role role, void* (*start)(void*),
+                       void* arg) {
+  HalThreadStart* s = (HalThreadStart*)malloc(sizeof(HalThreadStart));
+  int ret;
+
+  if (!s) return ENOMEM;
+  s->role = role;
+  s->start = start;
+  s->arg = arg;
+
+  ret = pthread_create(thread, NULL, HalThreadEntry, s);
+  if (ret != 0) free(s);
+  return ret;
+}
+
+bool HalThreads::memoryLocked() {
+  unsigned long locked = 0;
+  return GetNumValue(NAME_STNFC_THREAD_MLOCK, &locked, sizeof(locked)) &&
+         locked == 1;
+}
+
+void HalThreads::lockBuffer(const void* addr, size_t length) {
+  if (!memoryLocked()) return;
+  if (mlock(addr, length) != 0) {
+    STLOG_HAL_E("%s - %zu bytes: %s", __func__, length, strerror(errno));
+  }
+}
+
+void HalThreads::unlockBuffer(const void* addr, size_t length) {
+  if (memoryLocked()) munlock(addr, length);
+}
+
+uint64_t HalThreads::nowUs() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+const char* HalThreads::roleName(Role role) {
+  if (role >= ROLE_MAX) return "unknown";
+  return kRoleNames[role];
+}
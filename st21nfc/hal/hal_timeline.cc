@@ -0,0 +1,274 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hal_timeline.h"
+
+#include <android-base/file.h>
+#include <android-base/logging.h>
+#include <cutils/properties.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <ctime>
+#include <sstream>
+
+#include "config.h"
+#include "hal_config.h"
+
+#define HAL_TIMELINE_EXPORT_PROP "vendor.nfc.debug.timeline_export"
+#define HAL_TIMELINE_FILE_NAME "/hal_timeline.json"
+
+extern std::string hal_wrapper_state_to_str(uint16_t event);
+
+static const char* kTrackNames[] = {"", "wrapper state", "wrapper timer",
+                                    "nci cmd/rsp"};
+
+static uint64_t HalTimelineNowUs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_BOOTTIME, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void HalTimelineCopy(char* dst, size_t size, const char* src) {
+  snprintf(dst, size, "%s", src ? src : "");
+}
+
+static void HalTimelineAppendEscaped(std::ostringstream& oss, const char* s) {
+  for (; *s; s++) {
+    if (*s == '"' || *s == '\\') {
+      oss << '\\' << *s;
+    } else if ((unsigned char)*s >= 0x20) {
+      oss << *s;
+    }
+  }
+}
+
+HalTimeline& HalTimeline::getInstance() {
+  static HalTimeline nfc_hal_timeline;
+  return nfc_hal_timeline;
+}
+
+HalTimeline::HalTimeline()
+    : mHead(0),
+      mCount(0),
+      mDropped(0),
+      mCommandId(0),
+      mExportEnabled(false) {
+  memset(mSpans, 0, sizeof(mSpans));
+  memset(&mState, 0, sizeof(mState));
+  memset(&mTimer, 0, sizeof(mTimer));
+  memset(&mCommand, 0, sizeof(mCommand));
+}
+
+void HalTimeline::initialize() {
+  std::lock_guard<std::mutex> lock(mMutex);
+  char path[256];
+
+  mExportEnabled = property_get_int32(HAL_TIMELINE_EXPORT_PROP, 0) == 1;
+  if (!mExportEnabled) return;
+
+  if (!GetStrValue(NAME_HAL_EVENT_LOG_STORAGE, path, sizeof(path))) {
+    strcpy(path, "/data/vendor/nfc");
+  }
+  mExportPath = path;
+  mExportPath += HAL_TIMELINE_FILE_NAME;
+  LOG(INFO) << __func__ << " timeline export to " << mExportPath;
+}
+
+void HalTimeline::openLocked(OpenSpan& open, uint64_t now, const char* name,
+                             const char* args) {
+  open.active = true;
+  open.startUs = now;
+  HalTimelineCopy(open.name, sizeof(open.name), name);
+  HalTimelineCopy(open.args, sizeof(open.args), args);
+}
+
+void HalTimeline::closeLocked(OpenSpan& open, uint8_t track, uint64_t now,
+                              const char* extraArgs) {
+  if (!open.active) return;
+  open.active = false;
+
+  if (mCount == HAL_TIMELINE_MAX_SPANS) {
+    mDropped++;
+  } else {
+    mCount++;
+  }
+  Span& span = mSpans[mHead];
+  mHead = (mHead + 1) % HAL_TIMELINE_MAX_SPANS;
+
+  span.startUs = open.startUs;
+  span.durUs = now - open.startUs;
+  span.track = track;
+  memcpy(span.name, open.name, sizeof(span.name));
+  memcpy(span.args, open.args, sizeof(span.args));
+  if (extraArgs && extraArgs[0]) {
+    size_t used = strlen(span.args);
+    // Only append whole key/value pairs so that the JSON stays valid.
+    if (used + strlen(extraArgs) + 1 < sizeof(span.args)) {
+      if (used) span.args[used++] = ',';
+      strcpy(span.args + used, extraArgs);
+    }
+  }
+}
+
+void HalTimeline::stateChange(hal_wrapper_state_e from,
+                              hal_wrapper_state_e to) {
+  std::string name = hal_wrapper_state_to_str(to);
+  char args[HAL_TIMELINE_ARGS_SIZE];
+  bool doExport;
+  const char* prefix = "HAL_WRAPPER_STATE_";
+
+  if (name.compare(0, strlen(prefix), prefix) == 0) {
+    name = name.substr(strlen(prefix));
+  }
+  snprintf(args, sizeof(args), "\"from\":%d", from);
+
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    uint64_t now = HalTimelineNowUs();
+    closeLocked(mState, TRACK_STATE, now, nullptr);
+    openLocked(mState, now, name.c_str(), args);
+    doExport = mExportEnabled &&
+               (to == HAL_WRAPPER_STATE_READY ||
+                to == HAL_WRAPPER_STATE_RECOVERY ||
+                to == HAL_WRAPPER_STATE_CLOSED);
+  }
+
+  // Bring-up completed, failed or ended: flush for offline analysis.
+  if (doExport) exportToFile();
+}
+
+void HalTimeline::timerStart(const std::string& activity, uint32_t duration) {
+  std::lock_guard<std::mutex> lock(mMutex);
+  char args[HAL_TIMELINE_ARGS_SIZE];
+  uint64_t now = HalTimelineNowUs();
+
+  snprintf(args, sizeof(args), "\"duration_ms\":%u", duration);
+  closeLocked(mTimer, TRACK_TIMER, now, "\"end\":\"replaced\"");
+  openLocked(mTimer, now, activity.c_str(), args);
+}
+
+void HalTimeline::timerStop(const char* reason) {
+  std::lock_guard<std::mutex> lock(mMutex);
+  char args[HAL_TIMELINE_ARGS_SIZE];
+
+  snprintf(args, sizeof(args), "\"end\":\"%s\"", reason);
+  closeLocked(mTimer, TRACK_TIMER, HalTimelineNowUs(), args);
+}
+
+/**
+ * Open a span for an NCI command (MT=1). There is at most one command
+ * outstanding on NCI, so a new command closes the previous one if its
+ * response was never seen.
+ */
+void HalTimeline::commandSent(const uint8_t* data, size_t length) {
+  if (length < 2 || ((data[0] >> 5) & 0x03) != 0x01) return;
+  std::lock_guard<std::mutex> lock(mMutex);
+  char name[HAL_TIMELINE_NAME_SIZE];
+  uint64_t now = HalTimelineNowUs();
+
+  snprintf(name, sizeof(name), "CMD %02x %02x", data[0], data[1]);
+  closeLocked(mCommand, TRACK_NCI, now, "\"rsp\":\"none\"");
+  openLocked(mCommand, now, name, nullptr);
+  mCommandId = ((data[0] & 0x0F) << 8) | (data[1] & 0x3F);
+}
+
+void HalTimeline::responseReceived(const uint8_t* data, size_t length,
+                                   bool local) {
+  if (length < 2 || ((data[0] >> 5) & 0x03) != 0x02) return;
+  std::lock_guard<std::mutex> lock(mMutex);
+  char args[HAL_TIMELINE_ARGS_SIZE];
+  uint16_t id = ((data[0] & 0x0F) << 8) | (data[1] & 0x3F);
+
+  if (!mCommand.active || id != mCommandId) return;
+  snprintf(args, sizeof(args), "\"status\":%d%s",
+           length > 3 ? data[3] : -1, local ? ",\"local\":true" : "");
+  closeLocked(mCommand, TRACK_NCI, HalTimelineNowUs(), args);
+}
+
+std::string HalTimeline::toJsonLocked() {
+  std::ostringstream oss;
+  uint64_t now = HalTimelineNowUs();
+  int pid = getpid();
+
+  oss << "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped_spans\":"
+      << mDropped << "},\"traceEvents\":[";
+  oss << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << pid
+      << ",\"args\":{\"name\":\"nfc hal\"}}";
+  for (int track = TRACK_STATE; track <= TRACK_NCI; track++) {
+    oss << ",{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid
+        << ",\"tid\":" << track << ",\"args\":{\"name\":\""
+        << kTrackNames[track] << "\"}}";
+  }
+
+  auto emit = [&](uint8_t track, const char* name, uint64_t start,
+                  uint64_t dur, const char* args, bool open) {
+    oss << ",\n{\"name\":\"";
+    HalTimelineAppendEscaped(oss, name);
+    oss << "\",\"cat\":\"" << kTrackNames[track] << "\",\"ph\":\"X\",\"ts\":"
+        << start << ",\"dur\":" << dur << ",\"pid\":" << pid
+        << ",\"tid\":" << (int)track << ",\"args\":{" << args;
+    if (open) oss << (args[0] ? "," : "") << "\"open\":true";
+    oss << "}}";
+  };
+
+  size_t start = (mHead + HAL_TIMELINE_MAX_SPANS - mCount) %
+                 HAL_TIMELINE_MAX_SPANS;
+  for (size_t i = 0; i < mCount; i++) {
+    const Span& span = mSpans[(start + i) % HAL_TIMELINE_MAX_SPANS];
+    emit(span.track, span.name, span.startUs, span.durUs, span.args, false);
+  }
+
+  const OpenSpan* open[] = {nullptr, &mState, &mTimer, &mCommand};
+  for (int track = TRACK_STATE; track <= TRACK_NCI; track++) {
+    if (open[track]->active) {
+      emit(track, open[track]->name, open[track]->startUs,
+           now - open[track]->startUs, open[track]->args, true);
+    }
+  }
+  oss << "]}\n";
+  return oss.str();
+}
+
+void HalTimeline::dump(int fd) {
+  std::string json;
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    json = toJsonLocked();
+  }
+
+  dprintf(fd, "===== Nfc HAL Timeline v1 (Chrome trace JSON) =====\n");
+  ::android::base::WriteStringToFd(json, fd);
+  dprintf(fd, "===== Nfc HAL Timeline v1 (Chrome trace JSON) =====\n");
+  fsync(fd);
+}
+
+void HalTimeline::exportToFile() {
+  std::string json;
+  std::string path;
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (!mExportEnabled) return;
+    json = toJsonLocked();
+    path = mExportPath;
+  }
+
+  if (!::android::base::WriteStringToFile(json, path)) {
+    LOG(ERROR) << __func__ << " failed to write " << path
+               << " errno: " << errno;
+  }
+}
@@ -26,8 +26,14 @@
 #include <string.h>
 #include <unistd.h>
 
+#include <algorithm>
+
 #include "android_logmsg.h"
+#include "hal_context.h"
 #include "hal_fd.h"
+#include "hal_metrics.h"
+#include "hal_threads.h"
+#include "hal_timeline.h"
 #include "halcore_private.h"
 #include "st21nfc_dev.h"
 
@@ -38,10 +44,8 @@ extern uint32_t ScrProtocolTraceFlag;  // = SCR_PROTO_TRACE_ALL;
 
 // HAL WRAPPER
 static void HalStopTimer(HalInstance* inst);
-static bool rf_deactivate_delay;
-struct timespec start_tx_data;
-uint8_t NCI_ANDROID_GET_CAPS[] = {0x2f, 0x0c, 0x01, 0x0};
-uint8_t NCI_ANDROID_GET_CAPS_RSP[] = {
+static const uint8_t NCI_ANDROID_GET_CAPS[] = {0x2f, 0x0c, 0x01, 0x0};
+static const uint8_t NCI_ANDROID_GET_CAPS_RSP[] = {
     0x4f, 0x0c,
     0x14,  // Command length
     0x00, 0x00, 0x00, 0x00,
@@ -60,16 +64,30 @@ uint8_t NCI_ANDROID_GET_CAPS_RSP[] = {
  **************************************************************************************************/
 
 static void* HalWorkerThread(void* arg);
-static inline int sem_wait_nointr(sem_t* sem);
 
-static void HalOnNewUpstreamFrame(HalInstance* inst, const uint8_t* data,
-                                  size_t length);
+static void HalOnNewUpstreamFrame(HalInstance* inst, HalBuffer* b);
 static void HalTriggerNextDsPacket(HalInstance* inst);
+static bool HalObserveQuery(st21nfc_dev_t* dev, const uint8_t** data,
+                            size_t* length, uint8_t* query, size_t size);
 static bool HalEnqueueThreadMessage(HalInstance* inst, ThreadMessage* msg);
 static bool HalDequeueThreadMessage(HalInstance* inst, ThreadMessage* msg);
+static bool HalBufferPoolInit(HalBufferPool* pool, uint32_t initial,
+                              uint32_t max);
+static void HalBufferPoolRelease(HalBufferPool* pool);
+static HalBuffer* HalBufferPoolGrow(HalBufferPool* pool);
+static void HalBufferPoolPush(HalBufferPool* pool, HalBuffer* b);
+static HalBuffer* HalBufferPoolPop(HalBufferPool* pool);
+static HalBuffer* HalBufferPoolTake(HalInstance* inst, uint32_t limit);
+static uint32_t HalBufferPoolLimit(HalInstance* inst);
+static HalBuffer* HalTryAllocBuffer(HalInstance* inst);
 static HalBuffer* HalAllocBuffer(HalInstance* inst);
 static HalBuffer* HalFreeBuffer(HalInstance* inst, HalBuffer* b);
+static bool HalEnqueueTxBuffer(HalInstance* inst, HalBuffer* b,
+                               uint32_t command, const uint8_t* data,
+                               size_t size, uint32_t duration);
 static uint32_t HalSemWait(sem_t* pSemaphore, uint32_t timeout);
+// HAL instance the calling thread is the worker thread of, NULL on others
+static thread_local HalInstance* sWorkerInstance = nullptr;
 struct timespec HalGetTimestamp(void);
 int HalTimeDiffInMs(struct timespec start, struct timespec end);
 
@@ -92,7 +110,9 @@ int HalTimeDiffInMs(struct timespec start, struct timespec end);
  */
 void HalCoreCallback(void* context, uint32_t event, const void* d,
                      size_t length) {
+  HalCoreContext* ctx = HalCoreContext::current();
   const uint8_t* data = (const uint8_t*)d;
+  uint8_t query[HAL_NCI_MAX_FRAME_SIZE];
   uint8_t cmd = 'W';
   int delta_time_ms;
 
@@ -100,28 +120,34 @@ void HalCoreCallback(void* context, uint32_t event, const void* d,
 
   switch (event) {
     case HAL_EVENT_DSWRITE:
-      if (rf_deactivate_delay && length == 4 && data[0] == 0x21 &&
+      if (ctx->rf_deactivate_delay && length == 4 && data[0] == 0x21 &&
           data[1] == 0x06 && data[2] == 0x01) {
-        delta_time_ms = HalTimeDiffInMs(start_tx_data, HalGetTimestamp());
+        delta_time_ms =
+            HalTimeDiffInMs(ctx->start_tx_data, HalGetTimestamp());
         if (delta_time_ms >= 0 && delta_time_ms < TX_DELAY) {
           STLOG_HAL_D("Delay %d ms\n", TX_DELAY - delta_time_ms);
           usleep(1000 * (TX_DELAY - delta_time_ms));
         }
-        rf_deactivate_delay = false;
+        ctx->rf_deactivate_delay = false;
       } else if (length > 1 && data[0] == 0x00 && data[1] == 0x00) {
-        start_tx_data = HalGetTimestamp();
-        rf_deactivate_delay = true;
+        ctx->start_tx_data = HalGetTimestamp();
+        ctx->rf_deactivate_delay = true;
       } else {
-        rf_deactivate_delay = false;
+        ctx->rf_deactivate_delay = false;
       }
       STLOG_HAL_V("!! got event HAL_EVENT_DSWRITE for %zu bytes\n", length);
 
       DispHal("TX DATA", (data), length);
+      HalTimeline::getInstance().commandSent(data, length);
+      StNfcContext::current()->recovery.noteCommand(data, length);
+      StNfcContext::current()->power.onCommand(data, length);
       if (length == 4 &&
           !memcmp(data, NCI_ANDROID_GET_CAPS, sizeof(NCI_ANDROID_GET_CAPS))) {
-        NCI_ANDROID_GET_CAPS_RSP[2] = sizeof(NCI_ANDROID_GET_CAPS_RSP) - 3;
-        NCI_ANDROID_GET_CAPS_RSP[10] = hal_fd_getFwCap()->ObserveMode;
-        NCI_ANDROID_GET_CAPS_RSP[16] = hal_fd_getFwCap()->ExitFrameSupport;
+        uint8_t caps_rsp[sizeof(NCI_ANDROID_GET_CAPS_RSP)];
+        memcpy(caps_rsp, NCI_ANDROID_GET_CAPS_RSP, sizeof(caps_rsp));
+        caps_rsp[2] = sizeof(caps_rsp) - 3;
+        caps_rsp[10] = hal_fd_getFwCap()->ObserveMode;
+        caps_rsp[16] = hal_fd_getFwCap()->ExitFrameSupport;
         uint8_t FWVersionMajor =
             (uint8_t)(hal_fd_getFwInfo()->chipFwVersion >> 24);
         uint8_t FWVersionMinor =
@@ -130,13 +156,17 @@ void HalCoreCallback(void* context, uint32_t event, const void* d,
         // >= 2.06.
         if (hal_fd_getFwInfo()->chipHwVersion == HW_ST54L &&
             (FWVersionMajor >= 0x2) && (FWVersionMinor >= 0x6)) {
-          NCI_ANDROID_GET_CAPS_RSP[22] = 1;
+          caps_rsp[22] = 1;
         } else {
-          NCI_ANDROID_GET_CAPS_RSP[22] = 0;
+          caps_rsp[22] = 0;
         }
 
-        dev->p_data_cback(sizeof(NCI_ANDROID_GET_CAPS_RSP),
-                          NCI_ANDROID_GET_CAPS_RSP);
+        HalTimeline::getInstance().responseReceived(caps_rsp, sizeof(caps_rsp),
+                                                    true);
+        dev->p_data_cback(sizeof(caps_rsp), caps_rsp);
+      } else if (HalObserveMode::isQuery(data, length) &&
+                 HalObserveQuery(dev, &data, &length, query, sizeof(query))) {
+        // Answered from the observe mode state
       } else {
         // Send write command to IO thread
         cmd = 'W';
@@ -153,11 +183,12 @@ void HalCoreCallback(void* context, uint32_t event, const void* d,
         STLOG_HAL_W(
             "length is illogical. Header length is %d, packet length %zu\n",
             data[2], length);
-      } else if (length > 1 && rf_deactivate_delay && data[0] == 0x00 &&
-                 data[1] == 0x00) {
-        rf_deactivate_delay = false;
+      } else if (length > 1 && ctx->rf_deactivate_delay &&
+                 data[0] == 0x00 && data[1] == 0x00) {
+        ctx->rf_deactivate_delay = false;
       }
 
+      HalTimeline::getInstance().responseReceived(data, length, false);
       dev->p_data_cback(length, (uint8_t*)data);
       break;
 
@@ -214,74 +245,59 @@ HALHANDLE HalCreate(void* context, HAL_CALLBACK callback, uint32_t flags) {
     return NULL;
   }
 
-  // We need a semaphore to manage buffers
-  if (0 != sem_init(&inst->bufferResourceSem, 0, NUM_BUFFERS)) {
-    STLOG_HAL_E("!sem_init failed\n");
-    sem_destroy(&inst->semaphore);
-    free(inst);
-    return NULL;
-  }
-
-  // We need a semaphore to block upstream data indications
-  if (0 != sem_init(&inst->upstreamBlock, 0, 0)) {
-    STLOG_HAL_E("!sem_init failed\n");
-    sem_destroy(&inst->semaphore);
-    sem_destroy(&inst->bufferResourceSem);
-    free(inst);
-    return NULL;
-  }
-
   // Initialize remaining data-members
   inst->context = context;
+  inst->nfcContext = StNfcContext::current();
   inst->callback = callback;
   inst->flags = flags;
-  inst->freeBufferList = 0;
   inst->pendingNciList = 0;
   inst->nciBuffer = 0;
+  inst->usBuffer = 0;
   inst->ringReadPos = 0;
   inst->ringWritePos = 0;
   inst->timeout = HAL_SLEEP_TIMER_DURATION;
 
-  inst->bufferData = (HalBuffer*)calloc(NUM_BUFFERS, sizeof(HalBuffer));
-  if (!inst->bufferData) {
+  // The pool starts small and grows on demand up to its maximum
+  unsigned long buffersInitial = NUM_BUFFERS;
+  unsigned long buffersMax = NUM_BUFFERS_MAX;
+  GetNumValue(NAME_STNFC_HAL_BUFFERS_INITIAL, &buffersInitial,
+              sizeof(buffersInitial));
+  GetNumValue(NAME_STNFC_HAL_BUFFERS_MAX, &buffersMax, sizeof(buffersMax));
+  if (buffersMax < 1 || buffersMax > NUM_BUFFERS_MAX) {
+    buffersMax = NUM_BUFFERS_MAX;
+  }
+  if (buffersInitial > buffersMax || HalThreads::memoryLocked()) {
+    // Locked buffers are all created up front, off the data path
+    buffersInitial = buffersMax;
+  }
+
+  if (!HalBufferPoolInit(&inst->bufferPool, buffersInitial, buffersMax)) {
     STLOG_HAL_E("!failed to allocate memory\n");
     sem_destroy(&inst->semaphore);
-    sem_destroy(&inst->bufferResourceSem);
-    sem_destroy(&inst->upstreamBlock);
     free(inst);
     return NULL;
   }
 
-  // Concatenate the buffers into a linked list for easy access
-  size_t i;
-  for (i = 0; i < NUM_BUFFERS; i++) {
-    HalBuffer* b = &inst->bufferData[i];
-    b->next = inst->freeBufferList;
-    inst->freeBufferList = b;
-  }
-
   if (0 != pthread_mutex_init(&inst->hMutex, 0)) {
     STLOG_HAL_E("!failed to initialize Mutex \n");
     sem_destroy(&inst->semaphore);
-    sem_destroy(&inst->bufferResourceSem);
-    sem_destroy(&inst->upstreamBlock);
-    free(inst->bufferData);
+    HalBufferPoolRelease(&inst->bufferPool);
     free(inst);
     return NULL;
   }
 
   // Spawn the thread
-  if (0 != pthread_create(&inst->thread, NULL, HalWorkerThread, inst)) {
+  if (0 != HalThreads::create(&inst->thread, HalThreads::ROLE_WORKER,
+                              HalWorkerThread, inst)) {
     STLOG_HAL_E("!failed to spawn workerthread \n");
     sem_destroy(&inst->semaphore);
-    sem_destroy(&inst->bufferResourceSem);
-    sem_destroy(&inst->upstreamBlock);
     pthread_mutex_destroy(&inst->hMutex);
-    free(inst->bufferData);
+    HalBufferPoolRelease(&inst->bufferPool);
     free(inst);
     return NULL;
   }
 
+  HalThreads::lockBuffer(inst, sizeof(HalInstance));
   STLOG_HAL_V("HalCreate exit\n");
   return (HALHANDLE)inst;
 }
@@ -307,12 +323,11 @@ void HalDestroy(HALHANDLE hHAL) {
 
   // Cleanup and exit
   sem_destroy(&inst->semaphore);
-  sem_destroy(&inst->upstreamBlock);
-  sem_destroy(&inst->bufferResourceSem);
   pthread_mutex_destroy(&inst->hMutex);
 
   // Free resources
-  free(inst->bufferData);
+  HalBufferPoolRelease(&inst->bufferPool);
+  HalThreads::unlockBuffer(inst, sizeof(HalInstance));
   free(inst);
 
   STLOG_HAL_V("HalDestroy done\n");
@@ -320,8 +335,9 @@ void HalDestroy(HALHANDLE hHAL) {
 
 /**
  * Send an NCI message downstream to HAL protocol layer (DH->NFCC transfer).
- * Block if more than NUM_BUFFERS (10) transfers are outstanding, otherwise will
- * return immediately.
+ * Block if the buffer pool is exhausted and already at its maximum size,
+ * otherwise will return immediately. On the worker thread, fails instead of
+ * blocking once its own share of the pool is used up too.
  * @param hHAL HAL handle
  * @param data Data message
  * @param size Message size
@@ -335,23 +351,14 @@ bool HalSendDownstream(HALHANDLE hHAL, const uint8_t* data, size_t size) {
   }
 
   if ((size <= MAX_BUFFER_SIZE) && (size > 0)) {
-    ThreadMessage msg;
     HalBuffer* b = HalAllocBuffer(inst);
 
     if (!b) {
-      // Should never be reachable
+      // Only on the worker thread, which never waits for a buffer
       return false;
     }
 
-    memcpy(b->data, data, size);
-    b->length = size;
-
-    msg.command = MSG_TX_DATA;
-    msg.payload = 0;
-    msg.length = 0;
-    msg.buffer = b;
-
-    return HalEnqueueThreadMessage(inst, &msg);
+    return HalEnqueueTxBuffer(inst, b, MSG_TX_DATA, data, size, 0);
 
   } else {
     STLOG_HAL_E("HalSendDownstream size to large %zu instead of %d\n", size,
@@ -360,11 +367,43 @@ bool HalSendDownstream(HALHANDLE hHAL, const uint8_t* data, size_t size) {
   }
 }
 
+/**
+ * Send an NCI message downstream to HAL protocol layer (DH->NFCC transfer).
+ * Never blocks: fails if the buffer pool is exhausted and already at its
+ * maximum size.
+ * @param hHAL HAL handle
+ * @param data Data message
+ * @param size Message size
+ * @return false if the message was not queued
+ */
+bool HalTrySendDownstream(HALHANDLE hHAL, const uint8_t* data, size_t size) {
+  HalInstance* inst = (HalInstance*)hHAL;
+  if (inst == nullptr) {
+    STLOG_HAL_E("HalInstance is null.");
+    return false;
+  }
+
+  if ((size <= MAX_BUFFER_SIZE) && (size > 0)) {
+    HalBuffer* b = HalTryAllocBuffer(inst);
+
+    if (!b) {
+      return false;
+    }
+
+    return HalEnqueueTxBuffer(inst, b, MSG_TX_DATA, data, size, 0);
+
+  } else {
+    STLOG_HAL_E("HalTrySendDownstream size to large %zu instead of %d\n",
+                size, MAX_BUFFER_SIZE);
+    return false;
+  }
+}
+
 // HAL WRAPPER
 /**
  * Send an NCI message downstream to HAL protocol layer (DH->NFCC transfer).
- * Block if more than NUM_BUFFERS (10) transfers are outstanding, otherwise will
- * return immediately.
+ * Block if the buffer pool is exhausted and already at its maximum size,
+ * otherwise will return immediately.
  * @param hHAL HAL handle
  * @param data Data message
  * @param size Message size
@@ -375,23 +414,15 @@ bool HalSendDownstreamTimer(HALHANDLE hHAL, const uint8_t* data, size_t size,
   HalInstance* inst = (HalInstance*)hHAL;
 
   if ((size <= MAX_BUFFER_SIZE) && (size > 0)) {
-    ThreadMessage msg;
     HalBuffer* b = HalAllocBuffer(inst);
 
     if (!b) {
-      // Should never be reachable
+      // Only on the worker thread, which never waits for a buffer
       return false;
     }
 
-    memcpy(b->data, data, size);
-    b->length = size;
-
-    msg.command = MSG_TX_DATA_TIMER_START;
-    msg.payload = 0;
-    msg.length = duration;
-    msg.buffer = b;
-
-    return HalEnqueueThreadMessage(inst, &msg);
+    return HalEnqueueTxBuffer(inst, b, MSG_TX_DATA_TIMER_START, data, size,
+                              duration);
 
   } else {
     STLOG_HAL_E("HalSendDownstreamTimer size to large %zu instead of %d\n",
@@ -414,8 +445,8 @@ bool HalSendDownstreamTimer(HALHANDLE hHAL, uint32_t duration) {
 }
 /**
  * Send an NCI message downstream to HAL protocol layer (DH->NFCC transfer).
- * Block if more than NUM_BUFFERS (10) transfers are outstanding, otherwise will
- * return immediately.
+ * Block if the buffer pool is exhausted and already at its maximum size,
+ * otherwise will return immediately.
  * @param hHAL HAL handle
  * @param data Data message
  * @param size Message size
@@ -430,6 +461,8 @@ bool HalSendDownstreamStopTimer(HALHANDLE hHAL) {
 
 /**
  * Send an NCI message upstream to NFC NCI layer (NFCC->DH transfer).
+ * Copying form of HalSendUpstreamBuffer(), for callers not reading into a
+ * pool buffer.
  * @param hHAL HAL handle
  * @param data Data message
  * @param size Message size
@@ -437,17 +470,13 @@ bool HalSendDownstreamStopTimer(HALHANDLE hHAL) {
 bool HalSendUpstream(HALHANDLE hHAL, const uint8_t* data, size_t size) {
   HalInstance* inst = (HalInstance*)hHAL;
   if ((size <= MAX_BUFFER_SIZE) && (size > 0)) {
-    ThreadMessage msg;
-    msg.command = MSG_RX_DATA;
-    msg.payload = data;
-    msg.length = size;
-
-    if (HalEnqueueThreadMessage(inst, &msg)) {
-      // Block until the protocol has taken a copy of the data
-      sem_wait_nointr(&inst->upstreamBlock);
-      return true;
+    HalBuffer* b = HalAllocBuffer(inst);
+    if (!b) {
+      return false;
     }
-    return false;
+    memcpy(b->data, data, size);
+    b->length = size;
+    return HalSendUpstreamBuffer(hHAL, b);
   } else {
     STLOG_HAL_E("HalSendUpstream size to large %zu instead of %d\n", size,
                 MAX_BUFFER_SIZE);
@@ -455,6 +484,118 @@ bool HalSendUpstream(HALHANDLE hHAL, const uint8_t* data, size_t size) {
   }
 }
 
+/**
+ * Send an NCI message upstream to NFC NCI layer (NFCC->DH transfer).
+ * Never blocks: fails if the buffer pool is exhausted and already at its
+ * maximum size.
+ * @param hHAL HAL handle
+ * @param data Data message
+ * @param size Message size
+ * @return false if the message was not queued
+ */
+bool HalTrySendUpstream(HALHANDLE hHAL, const uint8_t* data, size_t size) {
+  HalInstance* inst = (HalInstance*)hHAL;
+  if ((size <= MAX_BUFFER_SIZE) && (size > 0)) {
+    HalBuffer* b = HalTryAllocBuffer(inst);
+    if (!b) {
+      return false;
+    }
+    memcpy(b->data, data, size);
+    b->length = size;
+    return HalSendUpstreamBuffer(hHAL, b);
+  } else {
+    STLOG_HAL_E("HalTrySendUpstream size to large %zu instead of %d\n",
+                size, MAX_BUFFER_SIZE);
+    return false;
+  }
+}
+
+/**
+ * Count one more buffer held by RX frames, if below the RX share.
+ * @param pool Buffer pool
+ * @return true if the caller may take a buffer for a RX frame
+ */
+static bool HalBufferPoolReserveRx(HalBufferPool* pool) {
+  uint32_t rxInUse = pool->rxInUse.load(std::memory_order_relaxed);
+
+  do {
+    if (rxInUse >= pool->rxMax) {
+      return false;
+    }
+  } while (!pool->rxInUse.compare_exchange_weak(rxInUse, rxInUse + 1));
+  return true;
+}
+
+/**
+ * Take a pool buffer for the next frame read from the CLF. Waits for the
+ * worker thread to deliver RX frames if they hold their whole share of the
+ * pool, then for a buffer if the pool is exhausted at its maximum size.
+ * @param hHAL HAL handle
+ * @return Pointer to the buffer
+ */
+HalBuffer* HalAllocUpstreamBuffer(HALHANDLE hHAL) {
+  HalInstance* inst = (HalInstance*)hHAL;
+  HalBufferPool* pool = &inst->bufferPool;
+
+  if (!HalBufferPoolReserveRx(pool)) {
+    HalMetrics::getInstance().increment(HalMetrics::BUFFER_POOL_RX_THROTTLED);
+    pthread_mutex_lock(&pool->waitMutex);
+    // Registered before trying again, as in HalAllocBuffer
+    pool->waiters++;
+    while (!HalBufferPoolReserveRx(pool)) {
+      pthread_cond_wait(&pool->waitCond, &pool->waitMutex);
+    }
+    pool->waiters--;
+    pthread_mutex_unlock(&pool->waitMutex);
+  }
+  HalMetrics::getInstance().setGauge(HalMetrics::BUFFER_POOL_RX_IN_USE,
+                                     pool->rxInUse);
+
+  HalBuffer* b = HalAllocBuffer(inst);
+  b->upstream = true;
+  return b;
+}
+
+/**
+ * Give back a buffer from HalAllocUpstreamBuffer() that was not sent.
+ * @param hHAL HAL handle
+ * @param b Pointer of HAL buffer to free
+ */
+void HalFreeUpstreamBuffer(HALHANDLE hHAL, HalBuffer* b) {
+  HalFreeBuffer((HalInstance*)hHAL, b);
+}
+
+/**
+ * Send the frame held in a pool buffer upstream to NFC NCI layer without
+ * copying it. The worker thread frees the buffer once the frame has been
+ * delivered, so the caller does not wait and must not touch it anymore.
+ * @param hHAL HAL handle
+ * @param b Buffer from HalAllocUpstreamBuffer(), length set
+ * @return true if the frame is queued for delivery
+ */
+bool HalSendUpstreamBuffer(HALHANDLE hHAL, HalBuffer* b) {
+  HalInstance* inst = (HalInstance*)hHAL;
+  ThreadMessage msg;
+
+  if ((b->length > MAX_BUFFER_SIZE) || (b->length == 0)) {
+    STLOG_HAL_E("HalSendUpstream size to large %zu instead of %d\n",
+                b->length, MAX_BUFFER_SIZE);
+    HalFreeBuffer(inst, b);
+    return false;
+  }
+
+  msg.command = MSG_RX_DATA;
+  msg.payload = 0;
+  msg.length = b->length;
+  msg.buffer = b;
+
+  if (!HalEnqueueThreadMessage(inst, &msg)) {
+    HalFreeBuffer(inst, b);
+    return false;
+  }
+  return true;
+}
+
 /**************************************************************************************************
  *
  *                                      Private API Definition
@@ -522,6 +663,9 @@ static uint32_t HalCalcSemWaitingTime(HalInstance* inst, struct timespec* now) {
  **************************************************************************************************/
 
 static void HalStopTimer(HalInstance* inst) {
+  if (inst->timer.active) {
+    HalTimeline::getInstance().timerStop("stopped");
+  }
   inst->timer.active = false;
   STLOG_HAL_D("HalStopTimer \n");
 }
@@ -548,6 +692,7 @@ static void HalStartTimer(HalInstance* inst, uint32_t duration) {
 static bool HalEnqueueThreadMessage(HalInstance* inst, ThreadMessage* msg) {
   // Put a message to the queue
   int nextWriteSlot;
+  int depth;
   bool result = true;
 
   pthread_mutex_lock(&inst->hMutex);
@@ -561,17 +706,25 @@ static bool HalEnqueueThreadMessage(HalInstance* inst, ThreadMessage* msg) {
   // Check that we don't overflow the queue entries
   if (nextWriteSlot == inst->ringReadPos) {
     STLOG_HAL_E("HAL thread message ring: RNR (implement me!!)");
+    HalMetrics::getInstance().increment(HalMetrics::MSG_RING_OVERFLOWS);
     result = false;
   }
 
   if (result) {
+    if (inst->ringReadPos == inst->ringWritePos) {
+      inst->wakeupPostedUs = HalThreads::nowUs();
+    }
     // inst->ring[nextWriteSlot] = *msg;
     memcpy(&(inst->ring[nextWriteSlot]), msg, sizeof(ThreadMessage));
     inst->ringWritePos = nextWriteSlot;
   }
+  depth = (inst->ringWritePos - inst->ringReadPos + HAL_QUEUE_MAX) %
+          HAL_QUEUE_MAX;
 
   pthread_mutex_unlock(&inst->hMutex);
 
+  HalMetrics::getInstance().setGauge(HalMetrics::MSG_RING_DEPTH, depth);
+
   if (result) {
     sem_post(&inst->semaphore);
   }
@@ -587,6 +740,8 @@ static bool HalEnqueueThreadMessage(HalInstance* inst, ThreadMessage* msg) {
  */
 static bool HalDequeueThreadMessage(HalInstance* inst, ThreadMessage* msg) {
   int nextCmdIndex;
+  int depth;
+  uint64_t posted;
   bool result = true;
   // New data available
   pthread_mutex_lock(&inst->hMutex);
@@ -608,9 +763,19 @@ static bool HalDequeueThreadMessage(HalInstance* inst, ThreadMessage* msg) {
     memcpy(msg, &(inst->ring[nextCmdIndex]), sizeof(ThreadMessage));
     inst->ringReadPos = nextCmdIndex;
   }
+  depth = (inst->ringWritePos - inst->ringReadPos + HAL_QUEUE_MAX) %
+          HAL_QUEUE_MAX;
+  posted = inst->wakeupPostedUs;
+  inst->wakeupPostedUs = 0;
 
   pthread_mutex_unlock(&inst->hMutex);
 
+  HalMetrics::getInstance().setGauge(HalMetrics::MSG_RING_DEPTH, depth);
+  if (posted) {
+    HalMetrics::getInstance().countWakeup(HalThreads::ROLE_WORKER,
+                                          HalThreads::nowUs() - posted);
+  }
+
   return result;
 }
 
@@ -621,35 +786,247 @@ static bool HalDequeueThreadMessage(HalInstance* inst, ThreadMessage* msg) {
  **************************************************************************************************/
 
 /**
- * Allocate buffer from pre-allocated pool.
- * @param inst HAL instance
- * @return Pointer to allocated HAL buffer
+ * Set up the buffer pool. The slot table is sized for the maximum so that
+ * the pool grows without moving anything; only the initial buffers are
+ * allocated here.
+ * @param pool Pool to initialize
+ * @param initial Number of buffers created up front
+ * @param max Number of buffers the pool may grow to
+ * @return true on success
  */
-static HalBuffer* HalAllocBuffer(HalInstance* inst) {
+static bool HalBufferPoolInit(HalBufferPool* pool, uint32_t initial,
+                              uint32_t max) {
+  pool->slots = (HalBuffer**)calloc(max, sizeof(HalBuffer*));
+  if (!pool->slots) {
+    return false;
+  }
+  pool->maxCount = max;
+  pool->created = 0;
+  pool->freeHead = 0;
+  pool->inUse = 0;
+  pool->sharedMax =
+      max - std::min((uint32_t)NUM_BUFFERS_WORKER_RESERVE, max / 4);
+  pool->rxMax = max - std::max(max / NUM_BUFFERS_TX_RESERVE_DIV, 1u);
+  if (pool->rxMax == 0) {
+    // A single buffer pool: RX and TX share it in turn
+    pool->rxMax = 1;
+  }
+  pool->rxInUse = 0;
+  pool->waiters = 0;
+
+  if (0 != pthread_mutex_init(&pool->growMutex, 0)) {
+    free(pool->slots);
+    return false;
+  }
+  if (0 != pthread_mutex_init(&pool->waitMutex, 0)) {
+    pthread_mutex_destroy(&pool->growMutex);
+    free(pool->slots);
+    return false;
+  }
+  if (0 != pthread_cond_init(&pool->waitCond, 0)) {
+    pthread_mutex_destroy(&pool->waitMutex);
+    pthread_mutex_destroy(&pool->growMutex);
+    free(pool->slots);
+    return false;
+  }
+
+  for (uint32_t i = 0; i < initial; i++) {
+    HalBuffer* b = HalBufferPoolGrow(pool);
+    if (!b) {
+      HalBufferPoolRelease(pool);
+      return false;
+    }
+    HalBufferPoolPush(pool, b);
+  }
+  HalMetrics::getInstance().setGauge(HalMetrics::BUFFER_POOL_CREATED, initial);
+  return true;
+}
+
+/**
+ * Free every buffer created by the pool. No buffer may be in use.
+ * @param pool Pool to release
+ */
+static void HalBufferPoolRelease(HalBufferPool* pool) {
+  uint32_t created = pool->created;
+
+  for (uint32_t i = 0; i < created; i++) {
+    if (!pool->slots[i]) {
+      continue;
+    }
+    HalThreads::unlockBuffer(pool->slots[i], sizeof(HalBuffer));
+    free(pool->slots[i]);
+  }
+  free(pool->slots);
+  pool->slots = nullptr;
+  pthread_cond_destroy(&pool->waitCond);
+  pthread_mutex_destroy(&pool->waitMutex);
+  pthread_mutex_destroy(&pool->growMutex);
+}
+
+/**
+ * Create one more buffer if the pool is below its maximum size. The pool
+ * grows up to its maximum once, so this takes growMutex rather than
+ * reserving slots: a failed allocation leaves the next slot free for the
+ * next call, and the free list stays lock free.
+ * @param pool Buffer pool
+ * @return New buffer, not linked in the free list, or NULL
+ */
+static HalBuffer* HalBufferPoolGrow(HalBufferPool* pool) {
+  HalBuffer* b = nullptr;
+
+  pthread_mutex_lock(&pool->growMutex);
+  uint32_t index = pool->created.load(std::memory_order_relaxed);
+  if (index < pool->maxCount) {
+    b = (HalBuffer*)calloc(1, sizeof(HalBuffer));
+    if (!b) {
+      STLOG_HAL_E("!failed to allocate memory\n");
+    } else {
+      HalThreads::lockBuffer(b, sizeof(HalBuffer));
+      b->poolIndex = index;
+      pool->slots[index] = b;
+      pool->created.store(index + 1, std::memory_order_release);
+    }
+  }
+  pthread_mutex_unlock(&pool->growMutex);
+  return b;
+}
+
+/**
+ * Put a buffer on top of the free list.
+ * @param pool Buffer pool
+ * @param b Buffer created by the pool
+ */
+static void HalBufferPoolPush(HalBufferPool* pool, HalBuffer* b) {
+  uint64_t head = pool->freeHead;
+  uint64_t top;
+
+  do {
+    b->poolNext.store((uint32_t)head, std::memory_order_relaxed);
+    top = (((head >> 32) + 1) << 32) | (b->poolIndex + 1);
+  } while (!pool->freeHead.compare_exchange_weak(head, top));
+}
+
+/**
+ * Take the buffer on top of the free list.
+ * @param pool Buffer pool
+ * @return Buffer, or NULL if the free list is empty
+ */
+static HalBuffer* HalBufferPoolPop(HalBufferPool* pool) {
+  uint64_t head = pool->freeHead;
+  uint64_t top;
   HalBuffer* b;
+
+  do {
+    if ((uint32_t)head == 0) {
+      return nullptr;
+    }
+    // b may be taken and pushed back meanwhile: the tag then differs and
+    // the compare-exchange fails, whatever poolNext was read
+    b = pool->slots[(uint32_t)head - 1];
+    top = (((head >> 32) + 1) << 32) |
+          b->poolNext.load(std::memory_order_relaxed);
+  } while (!pool->freeHead.compare_exchange_weak(head, top));
+  return b;
+}
+
+/**
+ * Number of buffers the calling thread may have in use with the others: the
+ * whole pool for the worker thread of inst, sharedMax for any other.
+ * @param inst HAL instance
+ * @return Limit of HalBufferPoolTake()
+ */
+static uint32_t HalBufferPoolLimit(HalInstance* inst) {
+  return sWorkerInstance == inst ? inst->bufferPool.maxCount
+                                 : inst->bufferPool.sharedMax;
+}
+
+/**
+ * Take a free buffer, growing the pool if needed. The buffer is counted in
+ * use before it is taken: a buffer is pushed back before it is uncounted,
+ * so a count below the maximum guarantees one to take.
+ * @param inst HAL instance
+ * @param limit Buffers in use above which the caller gets none
+ * @return Buffer, or NULL if limit buffers are in use
+ */
+static HalBuffer* HalBufferPoolTake(HalInstance* inst, uint32_t limit) {
+  HalBufferPool* pool = &inst->bufferPool;
+  int inUse = pool->inUse.load(std::memory_order_relaxed);
+
+  do {
+    if (inUse >= (int)limit) {
+      return nullptr;
+    }
+  } while (!pool->inUse.compare_exchange_weak(inUse, inUse + 1));
+
+  HalBuffer* b = HalBufferPoolPop(pool);
+  if (!b) {
+    b = HalBufferPoolGrow(pool);
+    if (b) {
+      HalMetrics::getInstance().increment(HalMetrics::BUFFER_POOL_GROWTHS);
+      HalMetrics::getInstance().setGauge(HalMetrics::BUFFER_POOL_CREATED,
+                                         b->poolIndex + 1);
+    } else {
+      // Out of memory
+      pool->inUse--;
+      return nullptr;
+    }
+  }
+  b->next = 0;
+  HalMetrics::getInstance().setGauge(HalMetrics::BUFFER_POOL_IN_USE,
+                                     inUse + 1);
+  return b;
+}
+
+/**
+ * Allocate buffer from the pool without blocking. The last buffers are left
+ * to the worker thread, see HalBufferPoolLimit().
+ * @param inst HAL instance
+ * @return Pointer to allocated HAL buffer, NULL if the pool is exhausted
+ */
+static HalBuffer* HalTryAllocBuffer(HalInstance* inst) {
   if (inst == nullptr) {
     STLOG_HAL_E("HalInstance is null.");
     return nullptr;
   }
 
-  // Wait until we have a buffer resource
-  sem_wait_nointr(&inst->bufferResourceSem);
-
-  pthread_mutex_lock(&inst->hMutex);
-
-  b = inst->freeBufferList;
-  if (b) {
-    inst->freeBufferList = b->next;
-    b->next = 0;
+  HalBuffer* b = HalBufferPoolTake(inst, HalBufferPoolLimit(inst));
+  if (!b) {
+    HalMetrics::getInstance().increment(HalMetrics::BUFFER_POOL_EXHAUSTED);
+    STLOG_HAL_W("! buffer pool exhausted (%u buffers)\n",
+                inst->bufferPool.maxCount);
   }
+  return b;
+}
 
-  pthread_mutex_unlock(&inst->hMutex);
+/**
+ * Allocate buffer from the pool, waiting for one to be freed if the pool is
+ * exhausted at its maximum size. The worker thread never waits: it is the
+ * one freeing the buffers.
+ * @param inst HAL instance
+ * @return Pointer to allocated HAL buffer, NULL if the worker thread found
+ * the pool exhausted
+ */
+static HalBuffer* HalAllocBuffer(HalInstance* inst) {
+  HalBuffer* b = HalTryAllocBuffer(inst);
+  if (b || inst == nullptr) {
+    return b;
+  }
+  if (sWorkerInstance == inst) {
+    HalMetrics::getInstance().increment(HalMetrics::BUFFER_POOL_WORKER_FAILURES);
+    STLOG_HAL_E("! worker thread out of buffers, frame dropped\n");
+    return nullptr;
+  }
 
-  if (!b) {
-    STLOG_HAL_E(
-        "! unable to allocate buffer resource."
-        "check bufferResourceSem\n");
+  HalBufferPool* pool = &inst->bufferPool;
+  pthread_mutex_lock(&pool->waitMutex);
+  // Registered before trying again, so that HalFreeBuffer either sees the
+  // waiter or has already pushed the buffer this loop then finds
+  pool->waiters++;
+  while (!(b = HalBufferPoolTake(inst, pool->sharedMax))) {
+    pthread_cond_wait(&pool->waitCond, &pool->waitMutex);
   }
+  pool->waiters--;
+  pthread_mutex_unlock(&pool->waitMutex);
 
   return b;
 }
@@ -661,17 +1038,57 @@ static HalBuffer* HalAllocBuffer(HalInstance* inst) {
  * @return Pointer of freed HAL buffer
  */
 static HalBuffer* HalFreeBuffer(HalInstance* inst, HalBuffer* b) {
-  pthread_mutex_lock(&inst->hMutex);
+  HalBufferPool* pool = &inst->bufferPool;
 
-  b->next = inst->freeBufferList;
-  inst->freeBufferList = b;
+  if (b->upstream) {
+    b->upstream = false;
+    HalMetrics::getInstance().setGauge(HalMetrics::BUFFER_POOL_RX_IN_USE,
+                                       --pool->rxInUse);
+  }
+  HalBufferPoolPush(pool, b);
+  HalMetrics::getInstance().setGauge(HalMetrics::BUFFER_POOL_IN_USE,
+                                     --pool->inUse);
+
+  // Unblock treads waiting for a buffer. All of them: the I/O thread may be
+  // waiting for a RX buffer while a writer waits for any buffer.
+  if (pool->waiters > 0) {
+    pthread_mutex_lock(&pool->waitMutex);
+    pthread_cond_broadcast(&pool->waitCond);
+    pthread_mutex_unlock(&pool->waitMutex);
+  }
 
-  pthread_mutex_unlock(&inst->hMutex);
+  return b;
+}
+
+/**
+ * Copy an NCI message into a pool buffer and queue it to the worker thread.
+ * The buffer goes back to the pool if the message cannot be queued.
+ * @param inst HAL instance
+ * @param b Buffer taken from the pool
+ * @param command MSG_TX_DATA or MSG_TX_DATA_TIMER_START
+ * @param data Data message
+ * @param size Message size
+ * @param duration Timer duration for MSG_TX_DATA_TIMER_START
+ * @return true if message properly queued
+ */
+static bool HalEnqueueTxBuffer(HalInstance* inst, HalBuffer* b,
+                               uint32_t command, const uint8_t* data,
+                               size_t size, uint32_t duration) {
+  ThreadMessage msg;
 
-  // Unblock treads waiting for a buffer
-  sem_post(&inst->bufferResourceSem);
+  memcpy(b->data, data, size);
+  b->length = size;
 
-  return b;
+  msg.command = command;
+  msg.payload = 0;
+  msg.length = duration;
+  msg.buffer = b;
+
+  if (!HalEnqueueThreadMessage(inst, &msg)) {
+    HalFreeBuffer(inst, b);
+    return false;
+  }
+  return true;
 }
 
 /**************************************************************************************************
@@ -693,8 +1110,8 @@ static void Hal_event_handler(HalInstance* inst, HalEvent e) {
       size_t nciLength;
 
       // Extract raw NCI data from frame
-      nciData = inst->lastUsFrame;
-      nciLength = inst->lastUsFrameSize;
+      nciData = inst->usBuffer->data;
+      nciLength = inst->usBuffer->length;
 
       // Pass received raw NCI data to stack
       inst->callback(inst->context, HAL_EVENT_DATAIND, nciData, nciLength);
@@ -713,6 +1130,7 @@ static void Hal_event_handler(HalInstance* inst, HalEvent e) {
 
     // HAL WRAPPER
     case EVT_TIMER:
+      HalTimeline::getInstance().timerStop("expired");
       inst->callback(inst->context, HAL_EVENT_TIMER_TIMEOUT, NULL, 0);
       break;
   }
@@ -731,6 +1149,8 @@ static void Hal_event_handler(HalInstance* inst, HalEvent e) {
  */
 static void* HalWorkerThread(void* arg) {
   HalInstance* inst = (HalInstance*)arg;
+  StNfcContext::bindThread(inst->nfcContext);
+  sWorkerInstance = inst;
   inst->exitRequest = false;
 
   STLOG_HAL_V("thread running\n");
@@ -814,8 +1234,7 @@ static void* HalWorkerThread(void* arg) {
 
             case MSG_RX_DATA:
               STLOG_HAL_V("received new data from CLF\n");
-              HalOnNewUpstreamFrame(inst, (unsigned char*)msg.payload,
-                                    msg.length);
+              HalOnNewUpstreamFrame(inst, msg.buffer);
               break;
 
             case MSG_TIMER_START:
@@ -852,36 +1271,53 @@ static void* HalWorkerThread(void* arg) {
  *
  **************************************************************************************************/
 /**
- *  helper to make sem_t interrupt safe
- * @param sem_t  semaphore
- * @return sem_wait return value.
+ * Android observe mode query, answered from the state of the controller
+ * when it is known, else translated to be read from the NFCC.
+ * @param dev NFC callbacks for control/data
+ * @param data Query, replaced by the NFCC command if not answered
+ * @param length Its length, updated likewise
+ * @param query Buffer for the NFCC command
+ * @param size Its size
+ * @return true if answered
  */
+static bool HalObserveQuery(st21nfc_dev_t* dev, const uint8_t** data,
+                            size_t* length, uint8_t* query, size_t size) {
+  uint8_t rsp[6];
+  size_t rspLength =
+      StNfcContext::current()->observe.answerQuery(rsp, sizeof(rsp));
+  if (rspLength) {
+    HalTimeline::getInstance().responseReceived(rsp, rspLength, true);
+    dev->p_data_cback(rspLength, rsp);
+    return true;
+  }
 
-static inline int sem_wait_nointr(sem_t* sem) {
-  while (sem_wait(sem))
-    if (errno == EINTR)
-      errno = 0;
-    else
-      return -1;
-  return 0;
+  HalNciTranslator::CommandResult result;
+  int queryLength =
+      HalWrapperContext::current()->nciTranslator.translateCommand(
+          *data, *length, hal_fd_getFwCap()->ObserveMode, query, size,
+          &result);
+  if (queryLength > 0) {
+    DispHal("TX DATA", query, queryLength);
+    *data = query;
+    *length = queryLength;
+  }
+  return false;
 }
 
 /**
- * Handle RX frames here first in HAL context.
+ * Handle RX frames here first in HAL context. The frame is delivered in the
+ * buffer the I2C worker thread read it into, then the buffer is freed.
  * @param inst HAL instance
- * @param data HAL data received from I2C worker thread
- * @param length Size of HAL data
+ * @param b HAL buffer received from I2C worker thread
  */
-static void HalOnNewUpstreamFrame(HalInstance* inst, const uint8_t* data,
-                                  size_t length) {
-  memcpy(inst->lastUsFrame, data, length);
-  inst->lastUsFrameSize = length;
+static void HalOnNewUpstreamFrame(HalInstance* inst, HalBuffer* b) {
+  inst->usBuffer = b;
 
   // Data frame
   Hal_event_handler(inst, EVT_RX_DATA);
-  // Allow the I2C thread to get the next message (if done early, it may
-  // overwrite before handled)
-  sem_post(&inst->upstreamBlock);
+
+  inst->usBuffer = 0;
+  HalFreeBuffer(inst, b);
 }
 
 /**
@@ -24,6 +24,8 @@
 #include <stdint.h>
 #include <time.h>
 
+#include <atomic>
+
 #include "halcore.h"
 
 #define MAX_NCIFRAME_PAYLOAD_SIZE 255
@@ -41,9 +43,6 @@
 /* ----------------------------------------------------------------------------------------------*/
 /* ----------------------------------------------------------------------------------------------*/
 
-#define HAL_QUEUE_MAX \
-  8 /* max. # of messages enqueued before going into blocking mode */
-
 /* thread messages  */
 #define MSG_EXIT_REQUEST 0 /* worker thread should terminate itself */
 #define MSG_TX_DATA 1      /* send a message downstream */
@@ -53,8 +52,20 @@
 #define MSG_TX_DATA_TIMER_START 3
 #define MSG_TIMER_START 4
 
-/* number of buffers used for incoming & outgoing data */
-#define NUM_BUFFERS 10
+/* number of buffers used for incoming & outgoing data, see HalBufferPool */
+#define NUM_BUFFERS 10     /* created with the pool */
+#define NUM_BUFFERS_MAX 64 /* upper bound the pool may grow to */
+/* share of the pool (1/N, at least one buffer) RX frames never take, so
+ * that writes and the frames the worker sends always find buffers */
+#define NUM_BUFFERS_TX_RESERVE_DIV 4
+/* buffers only the worker thread takes, for the frames the wrapper sends
+ * from its callbacks: the worker is the one freeing buffers, it never waits
+ * for one. At most 1/4 of the pool. */
+#define NUM_BUFFERS_WORKER_RESERVE 4
+
+/* max. # of messages enqueued: every buffer can be in flight plus control
+ * messages, so a grown pool never overflows the ring */
+#define HAL_QUEUE_MAX (NUM_BUFFERS_MAX + 8)
 
 /* constants for the return value of osWait */
 #define OS_SYNC_INFINITE 0xffffffffu
@@ -66,12 +77,44 @@
 #define HAL_SLEEP_TIMER 0
 #define HAL_SLEEP_TIMER_DURATION 500 /* ordinary t1 timeout to resent data */
 
+class StNfcContext;
+
 typedef struct tagHalBuffer {
   uint8_t data[MAX_BUFFER_SIZE];
   size_t length;
   struct tagHalBuffer* next;
+  uint32_t poolIndex;             /* position in HalBufferPool.slots */
+  std::atomic<uint32_t> poolNext; /* free list link, poolIndex + 1 */
+  bool upstream; /* taken by HalAllocUpstreamBuffer, counted in rxInUse */
 } HalBuffer;
 
+/*
+ * Lock-free pool of HalBuffer. Starts with the configured initial count and
+ * grows up to the configured maximum, one buffer at a time under growMutex;
+ * buffers are only released with the pool. Free buffers form a Treiber stack
+ * of slot indexes, the head carrying a generation tag in its upper 32 bits
+ * against ABA. Frames read from the CLF hold at most rxMax buffers: a burst
+ * of notifications waits for the worker to deliver them instead of starving
+ * the writes. Every thread but the worker holds at most sharedMax buffers,
+ * so the frames the wrapper sends from the worker never wait behind the
+ * writes queued to it.
+ */
+typedef struct tagHalBufferPool {
+  HalBuffer** slots; /* every buffer created, maxCount entries */
+  uint32_t maxCount;
+  std::atomic<uint32_t> created;  /* slots filled so far, only grows */
+  pthread_mutex_t growMutex;      /* serializes the creation of buffers */
+  std::atomic<uint64_t> freeHead; /* tag << 32 | (index + 1), 0 if empty */
+  std::atomic<int> inUse;
+  uint32_t sharedMax;         /* buffers the other threads than the worker
+                                 may hold, the rest is the worker's */
+  uint32_t rxMax;             /* buffers RX frames may hold */
+  std::atomic<uint32_t> rxInUse;
+  std::atomic<int> waiters; /* callers blocked for a buffer */
+  pthread_mutex_t waitMutex;
+  pthread_cond_t waitCond;
+} HalBufferPool;
+
 typedef struct tagThreadMessage {
   uint32_t command;    /* message type / command */
   const void* payload; /* ptr to message related data item */
@@ -97,6 +140,8 @@ typedef struct tagHalInstance {
 
   void* context;
   HAL_CALLBACK callback;
+  /* controller the worker thread is bound to */
+  StNfcContext* nfcContext;
 
   /* current timeout values */
   uint32_t timeout;
@@ -109,27 +154,31 @@ typedef struct tagHalInstance {
   pthread_mutex_t hMutex; /* guards the message ringbuffer */
 
   /* IOBuffers for read/writes */
-  HalBuffer* bufferData;
-  HalBuffer* freeBufferList;
+  HalBufferPool bufferPool;
   HalBuffer* pendingNciList; /* outgoing packages waiting to be processed */
   HalBuffer* nciBuffer;      /* current buffer in progress */
-  sem_t bufferResourceSem;
-
-  sem_t upstreamBlock;
+  HalBuffer* usBuffer;       /* frame from CLF being delivered */
 
   /* message ring-buffer */
   ThreadMessage ring[HAL_QUEUE_MAX];
   int ringReadPos;
   int ringWritePos;
+  uint64_t wakeupPostedUs; /* message queued in the empty ring, if any */
 
   /* current frame going downstream */
   uint8_t lastDsFrame[MAX_BUFFER_SIZE];
   size_t lastDsFrameSize;
 
-  /* current frame from CLF */
-  uint8_t lastUsFrame[MAX_BUFFER_SIZE];
-  size_t lastUsFrameSize;
-
 } HalInstance;
 
+/*
+ * Zero-copy RX for the I/O thread: a frame is read straight into a pool
+ * buffer, then handed to the HAL worker thread which delivers it in place
+ * and puts the buffer back into the pool. HalSendUpstreamBuffer() takes
+ * ownership of the buffer even when it fails.
+ */
+HalBuffer* HalAllocUpstreamBuffer(HALHANDLE hHAL);
+void HalFreeUpstreamBuffer(HALHANDLE hHAL, HalBuffer* b);
+bool HalSendUpstreamBuffer(HALHANDLE hHAL, HalBuffer* b);
+
 #endif
@@ -22,15 +22,20 @@
 #include <hardware/nfc.h>
 #include <log/log.h>
 #include <string.h>
-#include <sys/ioctl.h>
 #include <unistd.h>
 
 #include "android_logmsg.h"
+#include "hal_context.h"
 #include "hal_event_logger.h"
 #include "hal_fd.h"
+#include "hal_front_end.h"
 #include "hal_fwlog.h"
+#include "hal_metrics.h"
+#include "hal_nci_translator.h"
+#include "hal_recovery.h"
+#include "hal_threads.h"
+#include "hal_timeline.h"
 #include "halcore.h"
-#include "i2clayer.h"
 #include "st21nfc_dev.h"
 #define OPEN_TIMEOUT_MAX_COUNT 5
 
@@ -42,128 +47,107 @@ extern void I2cRecovery();
 
 static void halWrapperDataCallback(uint16_t data_len, uint8_t* p_data);
 static void halWrapperCallback(uint8_t event, uint8_t event_status);
-static std::string hal_wrapper_state_to_str(uint16_t event);
+std::string hal_wrapper_state_to_str(uint16_t event);
 static void hal_wrapper_store_timeout_log();
-
-nfc_stack_callback_t* mHalWrapperCallback = NULL;
-nfc_stack_data_callback_t* mHalWrapperDataCallback = NULL;
-hal_wrapper_state_e mHalWrapperState = HAL_WRAPPER_STATE_CLOSED;
-HALHANDLE mHalHandle = NULL;
-
-uint8_t mClfMode;
-uint8_t mFwUpdateTaskMask;
-int mRetryFwDwl;
-uint8_t mFwUpdateResMask = 0;
-uint8_t* ConfigBuffer = NULL;
-uint8_t mError_count = 0;
-bool mIsActiveRW = false;
-pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
-pthread_mutex_t mutex_activerw = PTHREAD_MUTEX_INITIALIZER;
-pthread_cond_t ready_cond = PTHREAD_COND_INITIALIZER;
+static bool hal_wrapper_send_core_config_next();
+static void hal_wrapper_core_config_done();
+static void hal_wrapper_recover(HalRecovery::Strategy first, uint8_t reason);
+static void hal_wrapper_recovery_done(HalRecovery::Action action,
+                                      uint16_t data_len, uint8_t* p_data);
 
 static const uint8_t ApduGetAtr[] = {0x2F, 0x04, 0x05, 0x80,
                                      0x8A, 0x00, 0x00, 0x04};
 
 static const uint8_t nciHeaderPropSetConfig[9] = {0x2F, 0x02, 0x98, 0x04, 0x00,
                                                   0x14, 0x01, 0x00, 0x92};
-static uint8_t nciPropEnableFwDbgTraces[256];
 static uint8_t nciPropGetFwDbgTracesConfig[] = {0x2F, 0x02, 0x05, 0x03,
                                                 0x00, 0x14, 0x01, 0x00};
-static uint8_t nciAndroidPassiveObserver[256];
-static bool isDebuggable;
-
-bool mReadFwConfigDone = false;
-
-bool mHciCreditLent = false;
-bool mfactoryReset = false;
-bool ready_flag = 0;
-bool mTimerStarted = false;
-bool mFieldInfoTimerStarted = false;
-bool forceRecover = false;
-unsigned long hal_field_timer = 0;
-
-static bool sEnableFwLog = false;
-uint8_t mObserverMode = 0;
-bool mObserverRsp = false;
-bool mPerTechCmdRsp = false;
-bool storedLog = false;
-bool mObserveModeSuspended = false;
-bool mObserveModeSuspendPendingNotifyPollingLoop = false;
-static uint16_t OpenTimeoutCount = 0;
-
-bool mDisplayFwLog = false;
 
 void wait_ready() {
-  pthread_mutex_lock(&mutex);
-  while (!ready_flag) {
-    pthread_cond_wait(&ready_cond, &mutex);
+  HalWrapperContext* ctx = HalWrapperContext::current();
+  pthread_mutex_lock(&ctx->mutex);
+  while (!ctx->ready_flag) {
+    pthread_cond_wait(&ctx->ready_cond, &ctx->mutex);
   }
-  pthread_mutex_unlock(&mutex);
+  pthread_mutex_unlock(&ctx->mutex);
 }
 
 void set_ready(bool ready) {
-  pthread_mutex_lock(&mutex);
-  ready_flag = ready;
-  pthread_cond_signal(&ready_cond);
-  pthread_mutex_unlock(&mutex);
+  HalWrapperContext* ctx = HalWrapperContext::current();
+  pthread_mutex_lock(&ctx->mutex);
+  ctx->ready_flag = ready;
+  pthread_cond_signal(&ctx->ready_cond);
+  pthread_mutex_unlock(&ctx->mutex);
 }
 
 bool hal_wrapper_open(st21nfc_dev_t* dev, nfc_stack_callback_t* p_cback,
                       nfc_stack_data_callback_t* p_data_cback,
                       HALHANDLE* pHandle) {
+  HalWrapperContext* ctx = HalWrapperContext::current();
+  HalMetrics& metrics = HalMetrics::getInstance();
+  uint64_t phaseStart;
   bool result;
 
   STLOG_HAL_D("%s", __func__);
 
   set_ready(0);
-  mFwUpdateResMask = hal_fd_init();
-  mRetryFwDwl = 5;
-  mFwUpdateTaskMask = 0;
-
-  mHalWrapperState = HAL_WRAPPER_STATE_OPEN;
-  mHciCreditLent = false;
-  mReadFwConfigDone = false;
-  mError_count = 0;
-
-  mObserverMode = 0;
-  mObserverRsp = false;
-  mObserveModeSuspended = false;
-  mObserveModeSuspendPendingNotifyPollingLoop = false;
-  mDisplayFwLog = false;
-
-  mHalWrapperCallback = p_cback;
-  mHalWrapperDataCallback = p_data_cback;
+  ctx->mOpenStartUs = HalThreads::nowUs();
+  ctx->mOpenResetUs = 0;
+  HalTimeline::getInstance().initialize();
+  ctx->mFwUpdateResMask = hal_fd_init();
+  metrics.countOpenPhase(HalMetrics::OPEN_FD_INIT,
+                         HalThreads::nowUs() - ctx->mOpenStartUs);
+  ctx->mRetryFwDwl = 5;
+  ctx->mFwUpdateTaskMask = 0;
+
+  hal_wrapper_set_state(HAL_WRAPPER_STATE_OPEN);
+  ctx->mHciCreditLent = false;
+  ctx->mReadFwConfigDone = false;
+  ctx->mError_count = 0;
+
+  ctx->nciTranslator.reset();
+  StNfcContext::current()->observe.open();
+  StNfcContext::current()->recovery.reset();
+  StNfcContext::current()->faults.configure();
+  ctx->mDisplayFwLog = false;
+
+  ctx->mHalWrapperCallback = p_cback;
+  ctx->mHalWrapperDataCallback = p_data_cback;
 
   dev->p_data_cback = halWrapperDataCallback;
   dev->p_cback = halWrapperCallback;
 
+  phaseStart = HalThreads::nowUs();
   result = I2cOpenLayer(dev, HalCoreCallback, pHandle);
+  metrics.countOpenPhase(HalMetrics::OPEN_TRANSPORT,
+                         HalThreads::nowUs() - phaseStart);
 
   if (!result || !(*pHandle)) {
     return -1;  // We are doomed, stop it here, NOW !
   }
 
-  isDebuggable = property_get_int32("ro.debuggable", 0);
-  mHalHandle = *pHandle;
+  ctx->isDebuggable = property_get_int32("ro.debuggable", 0);
+  ctx->mHalHandle = *pHandle;
 
   HalEventLogger::getInstance().initialize();
   HalEventLogger::getInstance().log() << __func__ << std::endl;
   HalEventLogger::getInstance().store_timer_activity("open", 10000);
-  HalSendDownstreamTimer(mHalHandle, 10000);
+  HalSendDownstreamTimer(ctx->mHalHandle, 10000);
   wait_ready();
 
   return 1;
 }
 
 int hal_wrapper_close(int call_cb, int nfc_mode) {
+  HalWrapperContext* ctx = HalWrapperContext::current();
   STLOG_HAL_V("%s - Sending PROP_NFC_MODE_SET_CMD(%d)", __func__, nfc_mode);
   uint8_t propNfcModeSetCmdQb[] = {0x2f, 0x02, 0x02, 0x02, (uint8_t)nfc_mode};
 
-  mHalWrapperState = HAL_WRAPPER_STATE_CLOSING;
+  hal_wrapper_set_state(HAL_WRAPPER_STATE_CLOSING);
   HalEventLogger::getInstance().log() << __func__ << std::endl;
   // Send PROP_NFC_MODE_SET_CMD
   HalEventLogger::getInstance().store_timer_activity("close", 100);
-  if (!HalSendDownstreamTimer(mHalHandle, propNfcModeSetCmdQb,
+  if (!HalSendDownstreamTimer(ctx->mHalHandle, propNfcModeSetCmdQb,
                               sizeof(propNfcModeSetCmdQb), 100)) {
     STLOG_HAL_E("NFC-NCI HAL: %s  HalSendDownstreamTimer failed", __func__);
     return -1;
@@ -172,44 +156,43 @@ int hal_wrapper_close(int call_cb, int nfc_mode) {
   usleep(50000);
 
   I2cCloseLayer();
-  if (call_cb) mHalWrapperCallback(HAL_NFC_CLOSE_CPLT_EVT, HAL_NFC_STATUS_OK);
+  if (call_cb)
+    ctx->mHalWrapperCallback(HAL_NFC_CLOSE_CPLT_EVT, HAL_NFC_STATUS_OK);
 
   return 1;
 }
 
 void hal_wrapper_send_core_config_prop() {
+  HalWrapperContext* ctx = HalWrapperContext::current();
   long retlen = 0;
   int isfound = 0;
 
   // allocate buffer for setting parameters
-  ConfigBuffer = (uint8_t*)malloc(256 * sizeof(uint8_t));
-  if (ConfigBuffer != NULL) {
-    isfound = GetByteArrayValue(NAME_CORE_CONF_PROP, (char*)ConfigBuffer, 256,
-                                &retlen);
+  ctx->ConfigBuffer = (uint8_t*)malloc(256 * sizeof(uint8_t));
+  if (ctx->ConfigBuffer != NULL) {
+    isfound = GetByteArrayValue(NAME_CORE_CONF_PROP, (char*)ctx->ConfigBuffer,
+                                256, &retlen);
 
     if (isfound > 0) {
       STLOG_HAL_V("%s - Enter", __func__);
       set_ready(0);
 
-      HalEventLogger::getInstance().store_timer_activity("send core config",
-                                                         1000);
-      if (!HalSendDownstreamTimer(mHalHandle, ConfigBuffer, retlen, 1000)) {
-        STLOG_HAL_E("NFC-NCI HAL: %s  SendDownstream failed", __func__);
-      }
-      wait_ready();
+      StNfcContext::current()->config.beginCore(ctx->ConfigBuffer, retlen);
+      if (hal_wrapper_send_core_config_next()) wait_ready();
     }
-    free(ConfigBuffer);
-    ConfigBuffer = NULL;
+    free(ctx->ConfigBuffer);
+    ctx->ConfigBuffer = NULL;
   }
 }
 
 void hal_wrapper_send_vs_config() {
+  HalWrapperContext* ctx = HalWrapperContext::current();
   STLOG_HAL_V("%s - Enter", __func__);
   set_ready(0);
-  mHalWrapperState = HAL_WRAPPER_STATE_PROP_CONFIG;
-  mReadFwConfigDone = true;
+  hal_wrapper_set_state(HAL_WRAPPER_STATE_PROP_CONFIG);
+  ctx->mReadFwConfigDone = true;
   HalEventLogger::getInstance().store_timer_activity("send vs config", 1000);
-  if (!HalSendDownstreamTimer(mHalHandle, nciPropGetFwDbgTracesConfig,
+  if (!HalSendDownstreamTimer(ctx->mHalHandle, nciPropGetFwDbgTracesConfig,
                               sizeof(nciPropGetFwDbgTracesConfig), 1000)) {
     STLOG_HAL_E("%s - SendDownstream failed", __func__);
   }
@@ -217,31 +200,37 @@ void hal_wrapper_send_vs_config() {
 }
 
 void hal_wrapper_send_config() {
+  HalWrapperContext* ctx = HalWrapperContext::current();
   hal_wrapper_send_vs_config();
-  mHalWrapperState = HAL_WRAPPER_STATE_PROP_CONFIG;
+  // The NFCC could not be recovered and was handed back to the stack.
+  if (ctx->mHalWrapperState == HAL_WRAPPER_STATE_OPEN) return;
+  hal_wrapper_set_state(HAL_WRAPPER_STATE_PROP_CONFIG);
   hal_wrapper_send_core_config_prop();
 }
 
 void hal_wrapper_factoryReset() {
-  mfactoryReset = true;
-  STLOG_HAL_V("%s - mfactoryReset = %d", __func__, mfactoryReset);
+  HalWrapperContext* ctx = HalWrapperContext::current();
+  ctx->mfactoryReset = true;
+  STLOG_HAL_V("%s - mfactoryReset = %d", __func__, ctx->mfactoryReset);
+}
+
+void hal_wrapper_set_observer_mode(uint8_t enable) {
+  StNfcContext::current()->observe.onSetCommand(enable);
 }
 
-void hal_wrapper_set_observer_mode(uint8_t enable, bool per_tech_cmd) {
-  mObserverMode = enable;
-  mObserverRsp = true;
-  mPerTechCmdRsp = per_tech_cmd;
-  mObserveModeSuspended = false;
-  mObserveModeSuspendPendingNotifyPollingLoop = false;
+void hal_wrapper_cancel_observer_mode() {
+  StNfcContext::current()->observe.onSetCommandNotSent();
 }
-void hal_wrapper_get_observer_mode() { mObserverRsp = true; }
 
 void hal_wrapper_update_complete() {
+  HalWrapperContext* ctx = HalWrapperContext::current();
   STLOG_HAL_V("%s ", __func__);
-  mHalWrapperCallback(HAL_NFC_OPEN_CPLT_EVT, HAL_NFC_STATUS_OK);
-  mHalWrapperState = HAL_WRAPPER_STATE_OPEN_CPLT;
+  ctx->mHalWrapperCallback(HAL_NFC_OPEN_CPLT_EVT, HAL_NFC_STATUS_OK);
+  hal_wrapper_set_state(HAL_WRAPPER_STATE_OPEN_CPLT);
 }
 void halWrapperDataCallback(uint16_t data_len, uint8_t* p_data) {
+  HalWrapperContext* ctx = HalWrapperContext::current();
+  HalObserveMode& observeMode = StNfcContext::current()->observe;
   uint8_t propNfcModeSetCmdOn[] = {0x2f, 0x02, 0x02, 0x02, 0x01};
   uint8_t coreInitCmd[] = {0x20, 0x01, 0x02, 0x00, 0x00};
   uint8_t coreResetCmd[] = {0x20, 0x00, 0x01, 0x01};
@@ -249,25 +238,31 @@ void halWrapperDataCallback(uint16_t data_len, uint8_t* p_data) {
   unsigned long swp_log = 0;
   unsigned long rf_log = 0;
   int mObserverLength = 0;
-  int nciPropEnableFwDbgTraces_size = sizeof(nciPropEnableFwDbgTraces);
+  HalNciTranslator::ObserveState observe;
+  int nciPropEnableFwDbgTraces_size = sizeof(ctx->nciPropEnableFwDbgTraces);
 
-  if (mObserverMode && !mObserveModeSuspended && (p_data[0] == 0x6f) && (p_data[1] == 0x02)) {
-    if (mObserveModeSuspendPendingNotifyPollingLoop){
-        mObserveModeSuspended = true;
-        mObserveModeSuspendPendingNotifyPollingLoop = false;
-    }
+  if ((p_data[0] == 0x6f) && (p_data[1] == 0x02) &&
+      observeMode.takePollingLoopFrame()) {
     // Firmware logs must not be formatted before sending to upper layer.
     if ((mObserverLength = notifyPollingLoopFrames(
-             p_data, data_len, nciAndroidPassiveObserver)) > 0) {
-      DispHal("RX DATA", (nciAndroidPassiveObserver), mObserverLength);
-      mHalWrapperDataCallback(mObserverLength, nciAndroidPassiveObserver);
+             p_data, data_len, ctx->nciAndroidPassiveObserver)) > 0) {
+      DispHal("RX DATA", (ctx->nciAndroidPassiveObserver), mObserverLength);
+      HalMetrics::getInstance().increment(HalMetrics::OBSERVE_MODE_NTFS);
+      ctx->mHalWrapperDataCallback(mObserverLength,
+                                   ctx->nciAndroidPassiveObserver);
     }
   }
   if ((p_data[0] == 0x4f) && (p_data[1] == 0x0c)) {
     DispHal("RX DATA", (p_data), data_len);
   }
+  if ((p_data[0] == 0x60) && (p_data[1] == 0x00)) {
+    // CORE_RESET_NTF, the observe mode state is to be read again and the
+    // Android frames given again.
+    observeMode.onReset();
+    ctx->nciTranslator.onNfccReset();
+  }
 
-  switch (mHalWrapperState) {
+  switch (ctx->mHalWrapperState) {
     case HAL_WRAPPER_STATE_CLOSED:  // 0
       STLOG_HAL_V("%s - mHalWrapperState = HAL_WRAPPER_STATE_CLOSED", __func__);
       break;
@@ -276,94 +271,105 @@ void halWrapperDataCallback(uint16_t data_len, uint8_t* p_data) {
       STLOG_HAL_V("%s - mHalWrapperState = HAL_WRAPPER_STATE_OPEN", __func__);
 
       if ((p_data[0] == 0x60) && (p_data[1] == 0x00)) {
-        mIsActiveRW = false;
-        mFwUpdateTaskMask = ft_cmd_HwReset(p_data, &mClfMode);
+        if (!ctx->mOpenResetUs) {
+          ctx->mOpenResetUs = HalThreads::nowUs();
+          HalMetrics::getInstance().countOpenPhase(
+              HalMetrics::OPEN_NFCC_RESET,
+              ctx->mOpenResetUs - ctx->mOpenStartUs);
+        }
+        StNfcContext::current()->power.setActiveRW(false);
+        ctx->mFwUpdateTaskMask = ft_cmd_HwReset(p_data, &ctx->mClfMode);
 
-        if (mfactoryReset == true) {
+        if (ctx->mfactoryReset == true) {
           STLOG_HAL_V(
               "%s - first boot after factory reset detected - start FW update",
               __func__);
-          if ((mFwUpdateResMask & FW_PATCH_AVAILABLE) &&
-              (mFwUpdateResMask & FW_CUSTOM_PARAM_AVAILABLE)) {
-            mFwUpdateTaskMask = FW_UPDATE_NEEDED | CONF_UPDATE_NEEDED;
-            mfactoryReset = false;
+          if ((ctx->mFwUpdateResMask & FW_PATCH_AVAILABLE) &&
+              (ctx->mFwUpdateResMask & FW_CUSTOM_PARAM_AVAILABLE)) {
+            hal_fd_ensure_files();
+            ctx->mFwUpdateTaskMask = FW_UPDATE_NEEDED | CONF_UPDATE_NEEDED;
+            ctx->mfactoryReset = false;
           }
         }
         STLOG_HAL_V(
             "%s - mFwUpdateTaskMask = %d,  mClfMode = %d,  mRetryFwDwl = %d",
-            __func__, mFwUpdateTaskMask, mClfMode, mRetryFwDwl);
+            __func__, ctx->mFwUpdateTaskMask, ctx->mClfMode, ctx->mRetryFwDwl);
         // CLF in MODE LOADER & Update needed.
-        if (mClfMode == FT_CLF_MODE_LOADER) {
-          HalSendDownstreamStopTimer(mHalHandle);
+        if (ctx->mClfMode == FT_CLF_MODE_LOADER) {
+          HalSendDownstreamStopTimer(ctx->mHalHandle);
           STLOG_HAL_V("%s --- CLF mode is LOADER ---", __func__);
 
-          if (mRetryFwDwl == 0) {
+          if (ctx->mRetryFwDwl == 0) {
             STLOG_HAL_W(
                 "%s - Reached maximum nb of retries, FW update failed, exiting",
                 __func__);
-            mHalWrapperCallback(HAL_NFC_OPEN_CPLT_EVT, HAL_NFC_STATUS_FAILED);
+            ctx->mHalWrapperCallback(HAL_NFC_OPEN_CPLT_EVT,
+                                     HAL_NFC_STATUS_FAILED);
             I2cCloseLayer();
           } else {
-            mHalWrapperState = HAL_WRAPPER_STATE_UPDATE;
+            hal_wrapper_set_state(HAL_WRAPPER_STATE_UPDATE);
             if (((p_data[3] == 0x01) && (p_data[8] == HW_ST54L)) ||
                 ((p_data[2] == 0x41) && (p_data[3] == 0xA2))) {  // ST54L
-              FwUpdateHandler(mHalHandle, data_len, p_data);
+              FwUpdateHandler(ctx->mHalHandle, data_len, p_data);
             } else {
               STLOG_HAL_V("%s - Send APDU_GET_ATR_CMD", __func__);
               HalEventLogger::getInstance().log()
                   << __func__ << " Send APDU_GET_ATR_CMD" << std::endl;
               HalEventLogger::getInstance().store_timer_activity(
                   "Send APDU_GET_ATR_CMD", FW_TIMER_DURATION);
-              if (!HalSendDownstreamTimer(mHalHandle, ApduGetAtr,
+              if (!HalSendDownstreamTimer(ctx->mHalHandle, ApduGetAtr,
                                           sizeof(ApduGetAtr),
                                           FW_TIMER_DURATION)) {
                 STLOG_HAL_E("%s - SendDownstream failed", __func__);
               }
             }
-            mRetryFwDwl--;
+            ctx->mRetryFwDwl--;
           }
-        } else if (mFwUpdateTaskMask == 0 || mRetryFwDwl == 0) {
+        } else if (ctx->mFwUpdateTaskMask == 0 || ctx->mRetryFwDwl == 0) {
           STLOG_HAL_V("%s - Proceeding with normal startup", __func__);
           if (p_data[3] == 0x01) {
             // Normal mode, start HAL
-            mHalWrapperCallback(HAL_NFC_OPEN_CPLT_EVT, HAL_NFC_STATUS_OK);
-            mHalWrapperState = HAL_WRAPPER_STATE_OPEN_CPLT;
+            HalMetrics::getInstance().countOpenPhase(
+                HalMetrics::OPEN_TOTAL, HalThreads::nowUs() - ctx->mOpenStartUs);
+            ctx->mHalWrapperCallback(HAL_NFC_OPEN_CPLT_EVT, HAL_NFC_STATUS_OK);
+            hal_wrapper_set_state(HAL_WRAPPER_STATE_OPEN_CPLT);
           } else {
             // No more retries or CLF not in correct mode
-            mHalWrapperCallback(HAL_NFC_OPEN_CPLT_EVT, HAL_NFC_STATUS_FAILED);
+            ctx->mHalWrapperCallback(HAL_NFC_OPEN_CPLT_EVT,
+                                     HAL_NFC_STATUS_FAILED);
           }
           // CLF in MODE ROUTER & Update needed.
-        } else if (mClfMode == FT_CLF_MODE_ROUTER) {
-          if ((mFwUpdateTaskMask & FW_UPDATE_NEEDED) &&
-              (mFwUpdateResMask & FW_PATCH_AVAILABLE)) {
+        } else if (ctx->mClfMode == FT_CLF_MODE_ROUTER) {
+          if ((ctx->mFwUpdateTaskMask & FW_UPDATE_NEEDED) &&
+              (ctx->mFwUpdateResMask & FW_PATCH_AVAILABLE)) {
             STLOG_HAL_V(
                 "%s - CLF in ROUTER mode, FW update needed, try upgrade FW -",
                 __func__);
-            mRetryFwDwl--;
+            ctx->mRetryFwDwl--;
 
-            if (!HalSendDownstream(mHalHandle, coreResetCmd,
+            if (!HalSendDownstream(ctx->mHalHandle, coreResetCmd,
                                    sizeof(coreResetCmd))) {
               STLOG_HAL_E("%s - SendDownstream failed", __func__);
             }
-            mHalWrapperState = HAL_WRAPPER_STATE_EXIT_HIBERNATE_INTERNAL;
-          } else if ((mFwUpdateTaskMask & CONF_UPDATE_NEEDED) &&
-                     (mFwUpdateResMask & FW_CUSTOM_PARAM_AVAILABLE)) {
-            if (!HalSendDownstream(mHalHandle, coreResetCmd,
+            hal_wrapper_set_state(HAL_WRAPPER_STATE_EXIT_HIBERNATE_INTERNAL);
+          } else if ((ctx->mFwUpdateTaskMask & CONF_UPDATE_NEEDED) &&
+                     (ctx->mFwUpdateResMask & FW_CUSTOM_PARAM_AVAILABLE)) {
+            if (!HalSendDownstream(ctx->mHalHandle, coreResetCmd,
                                    sizeof(coreResetCmd))) {
               STLOG_HAL_E("%s - SendDownstream failed", __func__);
             }
-            mHalWrapperState = HAL_WRAPPER_STATE_APPLY_CUSTOM_PARAM;
-          } else if ((mFwUpdateTaskMask & UWB_CONF_UPDATE_NEEDED) &&
-                     (mFwUpdateResMask & FW_UWB_PARAM_AVAILABLE)) {
-            if (!HalSendDownstream(mHalHandle, coreResetCmd,
+            hal_wrapper_set_state(HAL_WRAPPER_STATE_APPLY_CUSTOM_PARAM);
+          } else if ((ctx->mFwUpdateTaskMask & UWB_CONF_UPDATE_NEEDED) &&
+                     (ctx->mFwUpdateResMask & FW_UWB_PARAM_AVAILABLE)) {
+            if (!HalSendDownstream(ctx->mHalHandle, coreResetCmd,
                                    sizeof(coreResetCmd))) {
               STLOG_HAL_E("%s - SendDownstream failed", __func__);
             }
-            mHalWrapperState = HAL_WRAPPER_STATE_APPLY_UWB_PARAM;
+            hal_wrapper_set_state(HAL_WRAPPER_STATE_APPLY_UWB_PARAM);
           }
         }
       } else {
-        mHalWrapperDataCallback(data_len, p_data);
+        ctx->mHalWrapperDataCallback(data_len, p_data);
       }
       set_ready(1);
       break;
@@ -376,16 +382,16 @@ void halWrapperDataCallback(uint16_t data_len, uint8_t* p_data) {
         STLOG_HAL_V("%s - Sending PROP_NFC_MODE_SET_CMD", __func__);
 
         // Send PROP_NFC_MODE_SET_CMD(ON)
-        mHalWrapperState = HAL_WRAPPER_STATE_NFC_ENABLE_ON;
+        hal_wrapper_set_state(HAL_WRAPPER_STATE_NFC_ENABLE_ON);
         HalEventLogger::getInstance().store_timer_activity(
             "Sending PROP_NFC_MODE_SET_CMD", 500);
-        if (!HalSendDownstreamTimer(mHalHandle, propNfcModeSetCmdOn,
+        if (!HalSendDownstreamTimer(ctx->mHalHandle, propNfcModeSetCmdOn,
                                     sizeof(propNfcModeSetCmdOn), 500)) {
           STLOG_HAL_E("NFC-NCI HAL: %s  HalSendDownstreamTimer failed",
                       __func__);
         }
       } else {
-        mHalWrapperDataCallback(data_len, p_data);
+        ctx->mHalWrapperDataCallback(data_len, p_data);
       }
       break;
 
@@ -399,16 +405,17 @@ void halWrapperDataCallback(uint16_t data_len, uint8_t* p_data) {
       // CORE_RESET_NTF
       else if ((p_data[0] == 0x60) && (p_data[1] == 0x00)) {
         // Stop timer
-        HalSendDownstreamStopTimer(mHalHandle);
-        if (forceRecover == true) {
-          forceRecover = false;
-          mHalWrapperDataCallback(data_len, p_data);
+        HalSendDownstreamStopTimer(ctx->mHalHandle);
+        if (ctx->forceRecover == true) {
+          ctx->forceRecover = false;
+          ctx->mHalWrapperDataCallback(data_len, p_data);
           break;
         }
 
         // Send CORE_INIT_CMD
         STLOG_HAL_V("%s - Sending CORE_INIT_CMD", __func__);
-        if (!HalSendDownstream(mHalHandle, coreInitCmd, sizeof(coreInitCmd))) {
+        if (!HalSendDownstream(ctx->mHalHandle, coreInitCmd,
+                               sizeof(coreInitCmd))) {
           STLOG_HAL_E("NFC-NCI HAL: %s  SendDownstream failed", __func__);
         }
       }
@@ -419,31 +426,32 @@ void halWrapperDataCallback(uint16_t data_len, uint8_t* p_data) {
         if (p_data[13] == 0x00) {
           STLOG_HAL_D("%s - 1 credit lent", __func__);
           p_data[13] = 0x01;
-          mHciCreditLent = true;
+          ctx->mHciCreditLent = true;
         }
 
-        mHalWrapperState = HAL_WRAPPER_STATE_READY;
-        mHalWrapperDataCallback(data_len, p_data);
+        hal_wrapper_set_state(HAL_WRAPPER_STATE_READY);
+        ctx->mHalWrapperDataCallback(data_len, p_data);
       }
       break;
 
     case HAL_WRAPPER_STATE_PROP_CONFIG:  // 4
       STLOG_HAL_V("%s - mHalWrapperState = HAL_WRAPPER_STATE_PROP_CONFIG",
                   __func__);
-      // CORE_SET_CONFIG_RSP
-      if ((p_data[0] == 0x40) && (p_data[1] == 0x02)) {
-        HalSendDownstreamStopTimer(mHalHandle);
-        GetNumValue(NAME_STNFC_REMOTE_FIELD_TIMER, &hal_field_timer,
-                    sizeof(hal_field_timer));
-        STLOG_HAL_D("%s - hal_field_timer = %lu", __func__, hal_field_timer);
-        set_ready(1);
-        // Exit state, all processing done
-        mHalWrapperCallback(HAL_NFC_POST_INIT_CPLT_EVT, HAL_NFC_STATUS_OK);
-        mHalWrapperState = HAL_WRAPPER_STATE_READY;
-      } else if (mHciCreditLent && (p_data[0] == 0x60) && (p_data[1] == 0x06)) {
+      // CORE_SET_CONFIG_RSP, CORE_GET_CONFIG_RSP
+      if ((p_data[0] == 0x40) &&
+          ((p_data[1] == 0x02) || (p_data[1] == 0x03))) {
+        HalSendDownstreamStopTimer(ctx->mHalHandle);
+        if (p_data[1] == 0x03) {
+          StNfcContext::current()->config.onCoreGetResponse(p_data, data_len);
+        }
+        if (!hal_wrapper_send_core_config_next()) {
+          hal_wrapper_core_config_done();
+        }
+      } else if (ctx->mHciCreditLent && (p_data[0] == 0x60) &&
+                 (p_data[1] == 0x06)) {
         // CORE_CONN_CREDITS_NTF
         if (p_data[4] == 0x01) {  // HCI connection
-          mHciCreditLent = false;
+          ctx->mHciCreditLent = false;
           STLOG_HAL_D("%s - credit returned", __func__);
           if (p_data[5] == 0x01) {
             // no need to send this.
@@ -455,12 +463,12 @@ void halWrapperDataCallback(uint16_t data_len, uint8_t* p_data) {
             }
           }
         }
-        mHalWrapperDataCallback(data_len, p_data);
+        ctx->mHalWrapperDataCallback(data_len, p_data);
       } else if (p_data[0] == 0x4f) {
         // PROP_RSP
-        if (mReadFwConfigDone == true) {
-          mReadFwConfigDone = false;
-          HalSendDownstreamStopTimer(mHalHandle);
+        if (ctx->mReadFwConfigDone == true) {
+          ctx->mReadFwConfigDone = false;
+          HalSendDownstreamStopTimer(ctx->mHalHandle);
           // NFC_STATUS_OK
           if (p_data[3] == 0x00) {
             bool confNeeded = false;
@@ -469,17 +477,17 @@ void halWrapperDataCallback(uint16_t data_len, uint8_t* p_data) {
 
             // Check if FW DBG shall be set
             if (GetNumValue(NAME_STNFC_FW_DEBUG_ENABLED, &num, sizeof(num)) ||
-                isDebuggable || sEnableFwLog) {
-              if (firmware_debug_enabled || sEnableFwLog) {
+                ctx->isDebuggable || ctx->sEnableFwLog) {
+              if (firmware_debug_enabled || ctx->sEnableFwLog) {
                 num = 1;
                 swp_log = 30;
-                mDisplayFwLog = true;
-              } else if (isDebuggable) {
+                ctx->mDisplayFwLog = true;
+              } else if (ctx->isDebuggable) {
                 swp_log = 30;
-                mDisplayFwLog = true;
+                ctx->mDisplayFwLog = true;
               } else {
                 swp_log = 8;
-                mDisplayFwLog = false;
+                ctx->mDisplayFwLog = false;
               }
               rf_log = 15;
 
@@ -509,11 +517,11 @@ void halWrapperDataCallback(uint16_t data_len, uint8_t* p_data) {
               // If conf file indicate set needed and not yet enabled
               if ((num == 1) && (p_data[7] == 0x00)) {
                 STLOG_HAL_D("%s - FW DBG traces enabling needed", __func__);
-                nciPropEnableFwDbgTraces[9] = 0x01;
+                ctx->nciPropEnableFwDbgTraces[9] = 0x01;
                 confNeeded = true;
               } else if ((num == 0) && (p_data[7] == 0x01)) {
                 STLOG_HAL_D("%s - FW DBG traces disabling needed", __func__);
-                nciPropEnableFwDbgTraces[9] = 0x00;
+                ctx->nciPropEnableFwDbgTraces[9] = 0x00;
                 confNeeded = true;
               } else {
                 STLOG_HAL_D(
@@ -523,7 +531,7 @@ void halWrapperDataCallback(uint16_t data_len, uint8_t* p_data) {
 
               if (data_len < 9 || p_data[6] == 0 ||
                   p_data[6] < (data_len - 7) ||
-                  p_data[6] > (sizeof(nciPropEnableFwDbgTraces) - 9)) {
+                  p_data[6] > (sizeof(ctx->nciPropEnableFwDbgTraces) - 9)) {
                 if (confNeeded) {
                   android_errorWriteLog(0x534e4554, "169328517");
                   confNeeded = false;
@@ -531,25 +539,27 @@ void halWrapperDataCallback(uint16_t data_len, uint8_t* p_data) {
               }
 
               if (confNeeded) {
-                memcpy(nciPropEnableFwDbgTraces, nciHeaderPropSetConfig, 9);
-                memcpy(&nciPropEnableFwDbgTraces[10], &p_data[8],
+                memcpy(ctx->nciPropEnableFwDbgTraces, nciHeaderPropSetConfig,
+                       9);
+                memcpy(&ctx->nciPropEnableFwDbgTraces[10], &p_data[8],
                        p_data[6] - 1);
                 if (rf_log || swp_log) {
-                  nciPropEnableFwDbgTraces[9] = (uint8_t)num;
-                  nciPropEnableFwDbgTraces[17] = (uint8_t)rf_log;
-                  nciPropEnableFwDbgTraces[19] = (uint8_t)swp_log;
+                  ctx->nciPropEnableFwDbgTraces[9] = (uint8_t)num;
+                  ctx->nciPropEnableFwDbgTraces[17] = (uint8_t)rf_log;
+                  ctx->nciPropEnableFwDbgTraces[19] = (uint8_t)swp_log;
                 }
-                if ((9 + p_data[6]) < sizeof(nciPropEnableFwDbgTraces)) {
+                if ((9 + p_data[6]) < sizeof(ctx->nciPropEnableFwDbgTraces)) {
                   nciPropEnableFwDbgTraces_size = 9 + p_data[6];
                 }
 
                 confNeeded = false;
 
-                if (!HalSendDownstream(mHalHandle, nciPropEnableFwDbgTraces,
+                if (!HalSendDownstream(ctx->mHalHandle,
+                                       ctx->nciPropEnableFwDbgTraces,
                                        nciPropEnableFwDbgTraces_size)) {
                   STLOG_HAL_E("%s - SendDownstream failed", __func__);
                 }
-                mHalWrapperState = HAL_WRAPPER_STATE_APPLY_PROP_CONFIG;
+                hal_wrapper_set_state(HAL_WRAPPER_STATE_APPLY_PROP_CONFIG);
                 break;
               } else {
                 set_ready(1);
@@ -566,77 +576,30 @@ void halWrapperDataCallback(uint16_t data_len, uint8_t* p_data) {
 
     case HAL_WRAPPER_STATE_READY:  // 5
       STLOG_HAL_V("%s - mHalWrapperState = HAL_WRAPPER_STATE_READY", __func__);
-      if (mObserverRsp) {
-        if (((p_data[0] == 0x41) && (p_data[1] == 0x16)) ||
-            ((p_data[0] == 0x40) && (p_data[1] == 0x02))) {
-          uint8_t rsp_status = p_data[3];
-          mObserverRsp = false;
-          p_data[0] = 0x4f;
-          p_data[1] = 0x0c;
-          p_data[2] = 0x02;
-          p_data[3] = mPerTechCmdRsp ? 0x05 : 0x02;
-          p_data[4] = rsp_status;
-          data_len = 0x5;
-        } else if (((p_data[0] == 0x41) && (p_data[1] == 0x17) &&
-                    (data_len > 4)) ||
-                   ((p_data[0] == 0x40) && (p_data[1] == 0x03) &&
-                    (data_len > 7))) {
-          uint8_t rsp_status = p_data[3];
-          mObserverRsp = false;
-          if (hal_fd_getFwCap()->ObserveMode == 2) {
-            if (p_data[4] != mObserverMode) {
-              STLOG_HAL_E("mObserverMode got out of sync");
-              mObserverMode = p_data[4];
-            }
-            if (!mObserveModeSuspended) {
-              p_data[5] = p_data[4];
-            } else {
-              p_data[5] = 0x00;
-            }
-          } else {
-            if (p_data[7] != mObserverMode) {
-              STLOG_HAL_E("mObserverMode got out of sync");
-              mObserverMode = p_data[7];
-            }
-            p_data[5] = p_data[7];
-          }
-          p_data[0] = 0x4f;
-          p_data[1] = 0x0c;
-          p_data[2] = 0x03;
-          p_data[3] = 0x04;
-          p_data[4] = rsp_status;
-          data_len = 0x6;
-          DispHal("RX DATA", (p_data), data_len);
-        }
-      }
-
-      if ((p_data[0] == 0x4f) && (p_data[1] == 0x19)) {
-        p_data[4] = p_data[3];
-        p_data[0] = 0x4f;
-        p_data[1] = 0x0c;
-        p_data[2] = 0x02;
-        p_data[3] = 0x06;
-        data_len = 0x5;
+      observe = observeMode.state();
+      if (ctx->nciTranslator.translateResponse(
+              p_data, &data_len, &observe)) {
+        observeMode.onResponse(p_data, data_len, observe);
         DispHal("RX DATA", (p_data), data_len);
       } else if ((p_data[0] == 0x6f) && (p_data[1] == 0x1b)) {
         // PROP_RF_OBSERVE_MODE_SUSPENDED_NTF
-        mObserveModeSuspendPendingNotifyPollingLoop = true;
+        observeMode.onSuspended();
         // Remove two byte CRC at end of frame.
         data_len -= 2;
         p_data[2] -= 2;
         p_data[4] -= 2;
-        memcpy(nciAndroidPassiveObserver, p_data + 3, data_len - 3);
+        memcpy(ctx->nciAndroidPassiveObserver, p_data + 3, data_len - 3);
 
         p_data[0] = 0x6f;
         p_data[1] = 0x0c;
         p_data[2] = p_data[2] + 1;
         p_data[3] = 0xB;
-        memcpy(p_data + 4, nciAndroidPassiveObserver, data_len - 3);
+        memcpy(p_data + 4, ctx->nciAndroidPassiveObserver, data_len - 3);
         data_len = data_len + 1;
         DispHal("RX DATA", (p_data), data_len);
       } else if ((p_data[0] == 0x6f) && (p_data[1] == 0x1c)) {
         // PROP_RF_OBSERVE_MODE_RESUMED_NTF
-        mObserveModeSuspended = false;
+        observeMode.onResumed();
 
         p_data[0] = 0x6f;
         p_data[1] = 0x0c;
@@ -644,22 +607,12 @@ void halWrapperDataCallback(uint16_t data_len, uint8_t* p_data) {
         p_data[3] = 0xC;
         data_len = data_len + 1;
         DispHal("RX DATA", (p_data), data_len);
-      } else if ((p_data[0] == 0x4f) && (p_data[1] == 0x1d)) {
-        // PROP_RF_SET_CUST_PASSIVE_POLL_FRAME_RSP
-        memcpy(nciAndroidPassiveObserver, p_data + 3, data_len - 3);
-        p_data[4] = p_data[3];
-        p_data[0] = 0x4f;
-        p_data[1] = 0x0c;
-        p_data[2] = 0x02;
-        p_data[3] = 0x09;
-        data_len = 0x5;
-        DispHal("RX DATA", (p_data), data_len);
       }
 
       if (!((p_data[0] == 0x60) && (p_data[3] == 0xa0))) {
-        if (mHciCreditLent && (p_data[0] == 0x60) && (p_data[1] == 0x06)) {
+        if (ctx->mHciCreditLent && (p_data[0] == 0x60) && (p_data[1] == 0x06)) {
           if (p_data[4] == 0x01) {  // HCI connection
-            mHciCreditLent = false;
+            ctx->mHciCreditLent = false;
             STLOG_HAL_D("%s - credit returned", __func__);
             if (p_data[5] == 0x01) {
               // no need to send this.
@@ -675,65 +628,74 @@ void halWrapperDataCallback(uint16_t data_len, uint8_t* p_data) {
           // RF_FIELD_INFO_NTF
           if (p_data[3] == 0x01) {  // field on
             // start timer
-            if (hal_field_timer) {
-              mFieldInfoTimerStarted = true;
+            if (ctx->hal_field_timer) {
+              ctx->mFieldInfoTimerStarted = true;
               HalEventLogger::getInstance().store_timer_activity("field on",
                                                                  20000);
-              HalSendDownstreamTimer(mHalHandle, 20000);
+              HalSendDownstreamTimer(ctx->mHalHandle, 20000);
             }
           } else if (p_data[3] == 0x00) {
-            if (mFieldInfoTimerStarted) {
-              HalSendDownstreamStopTimer(mHalHandle);
-              mFieldInfoTimerStarted = false;
+            if (ctx->mFieldInfoTimerStarted) {
+              HalSendDownstreamStopTimer(ctx->mHalHandle);
+              ctx->mFieldInfoTimerStarted = false;
             }
           }
         } else if ((p_data[0] == 0x6f) && (p_data[1] == 0x05)) {
-          (void)pthread_mutex_lock(&mutex_activerw);
           // start timer
-          mTimerStarted = true;
-          mIsActiveRW = true;
-          (void)pthread_mutex_unlock(&mutex_activerw);
+          ctx->mTimerStarted = true;
+          StNfcContext::current()->power.setActiveRW(true);
         } else if ((p_data[0] == 0x6f) && (p_data[1] == 0x06)) {
-          (void)pthread_mutex_lock(&mutex_activerw);
           // stop timer
-          if (mTimerStarted) {
-            HalSendDownstreamStopTimer(mHalHandle);
-            mTimerStarted = false;
+          if (ctx->mTimerStarted) {
+            HalSendDownstreamStopTimer(ctx->mHalHandle);
+            ctx->mTimerStarted = false;
           }
-          if (mIsActiveRW == true) {
-            mIsActiveRW = false;
+          if (StNfcContext::current()->power.activeRW()) {
+            StNfcContext::current()->power.setActiveRW(false);
           } else {
-            mError_count++;
-            STLOG_HAL_E("Error Act -> Act count=%d", mError_count);
-            if (mError_count > 20) {
-              mError_count = 0;
+            ctx->mError_count++;
+            HalMetrics::getInstance().increment(HalMetrics::ACT_TO_ACT_ERRORS);
+            STLOG_HAL_E("Error Act -> Act count=%d", ctx->mError_count);
+            if (ctx->mError_count > 20) {
+              ctx->mError_count = 0;
               STLOG_HAL_E("NFC Recovery Start");
-              mTimerStarted = true;
+              ctx->mTimerStarted = true;
               HalEventLogger::getInstance().store_timer_activity(
                   "NFC Recovery Start", 1);
-              HalSendDownstreamTimer(mHalHandle, 1);
+              HalSendDownstreamTimer(ctx->mHalHandle, 1);
             }
           }
-          (void)pthread_mutex_unlock(&mutex_activerw);
+        } else if ((p_data[0] == 0x40) && (p_data[1] == 0x09)) {
+          // CORE_SET_POWER_SUB_STATE_RSP
+          if (StNfcContext::current()->power.onSubStateResponse(p_data,
+                                                                data_len)) {
+            // Chip state should be back to Active at screen off.
+            ctx->mTimerStarted = true;
+            HalEventLogger::getInstance().store_timer_activity(
+                "SET_ACTIVERW_TIMER", 5000);
+            HalSendDownstreamTimer(ctx->mHalHandle, 5000);
+          }
         } else if (((p_data[0] == 0x61) && (p_data[1] == 0x05)) ||
                    ((p_data[0] == 0x61) && (p_data[1] == 0x03))) {
-          mError_count = 0;
+          ctx->mError_count = 0;
           // stop timer
-          if (mFieldInfoTimerStarted) {
-            HalSendDownstreamStopTimer(mHalHandle);
-            mFieldInfoTimerStarted = false;
+          if (ctx->mFieldInfoTimerStarted) {
+            HalSendDownstreamStopTimer(ctx->mHalHandle);
+            ctx->mFieldInfoTimerStarted = false;
           }
-          if (mTimerStarted) {
-            HalSendDownstreamStopTimer(mHalHandle);
-            mTimerStarted = false;
+          if (ctx->mTimerStarted) {
+            HalSendDownstreamStopTimer(ctx->mHalHandle);
+            ctx->mTimerStarted = false;
           }
         } else if (p_data[0] == 0x60 && p_data[1] == 0x00) {
           STLOG_HAL_E("%s - Reset trigger from 0x%x to 0x0", __func__,
                       p_data[3]);
           p_data[3] = 0x0;  // Only reset trigger that should be received in
                             // HAL_WRAPPER_STATE_READY is unreocoverable error.
-          mHalWrapperState = HAL_WRAPPER_STATE_RECOVERY;
+          hal_wrapper_set_state(HAL_WRAPPER_STATE_RECOVERY);
         } else if (data_len >= 4 && p_data[0] == 0x60 && p_data[1] == 0x07) {
+          // CORE_GENERIC_ERROR_NTF, the observe mode may not be as believed.
+          observeMode.requestResync();
           if (p_data[3] == 0xE1) {
             // Core Generic Error - Buffer Overflow Ntf - Restart all
             STLOG_HAL_E("Core Generic Error - restart");
@@ -744,15 +706,13 @@ void halWrapperDataCallback(uint16_t data_len, uint8_t* p_data) {
             p_data[4] = 0x00;
             p_data[5] = 0x00;
             data_len = 0x6;
-            mHalWrapperState = HAL_WRAPPER_STATE_RECOVERY;
+            hal_wrapper_set_state(HAL_WRAPPER_STATE_RECOVERY);
           } else if (p_data[3] == 0xE6) {
-            unsigned long hal_ctrl_clk = 0;
-            GetNumValue(NAME_STNFC_CONTROL_CLK, &hal_ctrl_clk,
-                        sizeof(hal_ctrl_clk));
-            if (hal_ctrl_clk) {
+            HalPowerManager& power = StNfcContext::current()->power;
+            if (power.controlsClock()) {
               STLOG_HAL_E("%s - Clock Error - restart", __func__);
               STLOG_HAL_E("%s ST21NFC_CLK_STATE:%d", __func__,
-                          ioctl(fidI2c, ST21NFC_CLK_STATE, NULL));
+                          power.readClockState());
               // Core Generic Error
               p_data[0] = 0x60;
               p_data[1] = 0x00;
@@ -761,16 +721,16 @@ void halWrapperDataCallback(uint16_t data_len, uint8_t* p_data) {
               p_data[4] = 0x00;
               p_data[5] = 0x00;
               data_len = 0x6;
-              mHalWrapperState = HAL_WRAPPER_STATE_RECOVERY;
+              hal_wrapper_set_state(HAL_WRAPPER_STATE_RECOVERY);
             }
           } else if (p_data[3] == 0xA1) {
-            if (mFieldInfoTimerStarted) {
-              HalSendDownstreamStopTimer(mHalHandle);
-              mFieldInfoTimerStarted = false;
+            if (ctx->mFieldInfoTimerStarted) {
+              HalSendDownstreamStopTimer(ctx->mHalHandle);
+              ctx->mFieldInfoTimerStarted = false;
             }
           }
         }
-        mHalWrapperDataCallback(data_len, p_data);
+        ctx->mHalWrapperDataCallback(data_len, p_data);
       } else {
         STLOG_HAL_V("%s - Core reset notification - Nfc mode ", __func__);
       }
@@ -782,9 +742,9 @@ void halWrapperDataCallback(uint16_t data_len, uint8_t* p_data) {
       hal_fd_close();
       if ((p_data[0] == 0x4f) && (p_data[1] == 0x02)) {
         // intercept this expected message, don t forward.
-        mHalWrapperState = HAL_WRAPPER_STATE_CLOSED;
+        hal_wrapper_set_state(HAL_WRAPPER_STATE_CLOSED);
       } else {
-        mHalWrapperDataCallback(data_len, p_data);
+        ctx->mHalWrapperDataCallback(data_len, p_data);
       }
       break;
 
@@ -792,53 +752,39 @@ void halWrapperDataCallback(uint16_t data_len, uint8_t* p_data) {
       STLOG_HAL_V(
           "%s - mHalWrapperState = HAL_WRAPPER_STATE_EXIT_HIBERNATE_INTERNAL",
           __func__);
-      ExitHibernateHandler(mHalHandle, data_len, p_data);
+      ExitHibernateHandler(ctx->mHalHandle, data_len, p_data);
       break;
 
     case HAL_WRAPPER_STATE_UPDATE:  // 7
       STLOG_HAL_V("%s - mHalWrapperState = HAL_WRAPPER_STATE_UPDATE", __func__);
-      FwUpdateHandler(mHalHandle, data_len, p_data);
+      FwUpdateHandler(ctx->mHalHandle, data_len, p_data);
       break;
     case HAL_WRAPPER_STATE_APPLY_CUSTOM_PARAM:  // 8
       STLOG_HAL_V(
           "%s - mHalWrapperState = HAL_WRAPPER_STATE_APPLY_CUSTOM_PARAM",
           __func__);
-      ApplyCustomParamHandler(mHalHandle, data_len, p_data);
+      ApplyCustomParamHandler(ctx->mHalHandle, data_len, p_data);
       break;
     case HAL_WRAPPER_STATE_APPLY_UWB_PARAM:  // 9
       STLOG_HAL_V("%s - mHalWrapperState = HAL_WRAPPER_STATE_APPLY_UWB_PARAM",
                   __func__);
-      ApplyUwbParamHandler(mHalHandle, data_len, p_data);
-      break;
-    case HAL_WRAPPER_STATE_SET_ACTIVERW_TIMER:  // 10
-      (void)pthread_mutex_lock(&mutex_activerw);
-      if (mIsActiveRW == true) {
-        STLOG_HAL_D(
-            "%s - mHalWrapperState = "
-            "HAL_WRAPPER_STATE_SET_ACTIVERW_TIMER",
-            __func__);
-        // start timer
-        mTimerStarted = true;
-        HalEventLogger::getInstance().store_timer_activity("SET_ACTIVERW_TIMER",
-                                                           5000);
-        HalSendDownstreamTimer(mHalHandle, 5000);
-        // Chip state should back to Active
-        // at screen off state.
-      }
-      (void)pthread_mutex_unlock(&mutex_activerw);
-      mHalWrapperState = HAL_WRAPPER_STATE_READY;
-      mHalWrapperDataCallback(data_len, p_data);
+      ApplyUwbParamHandler(ctx->mHalHandle, data_len, p_data);
       break;
-
     case HAL_WRAPPER_STATE_APPLY_PROP_CONFIG:
       STLOG_HAL_V("%s - mHalWrapperState = HAL_WRAPPER_STATE_APPLY_PROP_CONFIG",
                   __func__);
       if (p_data[0] == 0x4f) {
         I2cResetPulse();
+        HalEventLogger::getInstance().store_timer_activity(
+            "apply prop config reset", HAL_RECOVERY_RESET_PULSE_TIMEOUT);
+        HalSendDownstreamTimer(ctx->mHalHandle,
+                               HAL_RECOVERY_RESET_PULSE_TIMEOUT);
       } else if ((p_data[0] == 0x60) && (p_data[1] == 0x00)) {
+        HalSendDownstreamStopTimer(ctx->mHalHandle);
         // Send CORE_INIT_CMD
         STLOG_HAL_D("%s - Sending CORE_INIT_CMD", __func__);
-        if (!HalSendDownstream(mHalHandle, coreInitCmd, sizeof(coreInitCmd))) {
+        if (!HalSendDownstream(ctx->mHalHandle, coreInitCmd,
+                               sizeof(coreInitCmd))) {
           STLOG_HAL_E("NFC-NCI HAL: %s  SendDownstream failed", __func__);
         }
       }
@@ -848,6 +794,12 @@ void halWrapperDataCallback(uint16_t data_len, uint8_t* p_data) {
       }
       break;
     case HAL_WRAPPER_STATE_RECOVERY:
+      if (StNfcContext::current()->recovery.active()) {
+        hal_wrapper_recovery_done(
+            StNfcContext::current()->recovery.onFrame(p_data, data_len),
+            data_len, p_data);
+        break;
+      }
       STLOG_HAL_W("%s - mHalWrapperState = HAL_WRAPPER_STATE_RECOVERY",
                   __func__);
       break;
@@ -856,18 +808,22 @@ void halWrapperDataCallback(uint16_t data_len, uint8_t* p_data) {
 
 static void halWrapperCallback(uint8_t event,
                                __attribute__((unused)) uint8_t event_status) {
+  HalWrapperContext* ctx = HalWrapperContext::current();
   uint8_t coreInitCmd[] = {0x20, 0x01, 0x02, 0x00, 0x00};
-  uint8_t rfDeactivateCmd[] = {0x21, 0x06, 0x01, 0x00};
   uint8_t p_data[6];
   uint16_t data_len;
 
-  switch (mHalWrapperState) {
+  if (event == HAL_WRAPPER_TIMEOUT_EVT) {
+    HalMetrics::getInstance().countTimerFire(ctx->mHalWrapperState);
+  }
+
+  switch (ctx->mHalWrapperState) {
     case HAL_WRAPPER_STATE_CLOSING:
       if (event == HAL_WRAPPER_TIMEOUT_EVT) {
         STLOG_HAL_D("NFC-NCI HAL: %s  Timeout. Close anyway", __func__);
-        HalSendDownstreamStopTimer(mHalHandle);
+        HalSendDownstreamStopTimer(ctx->mHalHandle);
         hal_fd_close();
-        mHalWrapperState = HAL_WRAPPER_STATE_CLOSED;
+        hal_wrapper_set_state(HAL_WRAPPER_STATE_CLOSED);
         return;
       }
       break;
@@ -875,15 +831,15 @@ static void halWrapperCallback(uint8_t event,
     case HAL_WRAPPER_STATE_OPEN:
       if (event == HAL_WRAPPER_TIMEOUT_EVT) {
         set_ready(1);
-        OpenTimeoutCount++;
+        ctx->OpenTimeoutCount++;
         STLOG_HAL_E(
             "NFC-NCI HAL: %s  Timeout accessing the CLF. OpenTimeoutCount:%d",
-            __func__, OpenTimeoutCount);
-        HalSendDownstreamStopTimer(mHalHandle);
+            __func__, ctx->OpenTimeoutCount);
+        HalSendDownstreamStopTimer(ctx->mHalHandle);
         hal_wrapper_store_timeout_log();
-        if (OpenTimeoutCount > OPEN_TIMEOUT_MAX_COUNT) {
-          mHalWrapperState = HAL_WRAPPER_STATE_CLOSED;
-          OpenTimeoutCount = 0;
+        if (ctx->OpenTimeoutCount > OPEN_TIMEOUT_MAX_COUNT) {
+          hal_wrapper_set_state(HAL_WRAPPER_STATE_CLOSED);
+          ctx->OpenTimeoutCount = 0;
           return;
         }
         p_data[0] = 0x60;
@@ -893,8 +849,8 @@ static void halWrapperCallback(uint8_t event,
         p_data[4] = 0x00;
         p_data[5] = 0x00;
         data_len = 0x6;
-        mHalWrapperDataCallback(data_len, p_data);
-        mHalWrapperState = HAL_WRAPPER_STATE_OPEN;
+        ctx->mHalWrapperDataCallback(data_len, p_data);
+        hal_wrapper_set_state(HAL_WRAPPER_STATE_OPEN);
         return;
       }
       break;
@@ -902,7 +858,7 @@ static void halWrapperCallback(uint8_t event,
     case HAL_WRAPPER_STATE_CLOSED:
       if (event == HAL_WRAPPER_TIMEOUT_EVT) {
         STLOG_HAL_D("NFC-NCI HAL: %s  Timeout. Close anyway", __func__);
-        HalSendDownstreamStopTimer(mHalHandle);
+        HalSendDownstreamStopTimer(ctx->mHalHandle);
         return;
       }
       break;
@@ -919,8 +875,8 @@ static void halWrapperCallback(uint8_t event,
         p_data[4] = 0x00;
         p_data[5] = 0x00;
         data_len = 0x6;
-        mHalWrapperDataCallback(data_len, p_data);
-        mHalWrapperState = HAL_WRAPPER_STATE_OPEN;
+        ctx->mHalWrapperDataCallback(data_len, p_data);
+        hal_wrapper_set_state(HAL_WRAPPER_STATE_OPEN);
         return;
       }
       break;
@@ -930,7 +886,8 @@ static void halWrapperCallback(uint8_t event,
         // timeout
         // Send CORE_INIT_CMD
         STLOG_HAL_V("%s - Sending CORE_INIT_CMD", __func__);
-        if (!HalSendDownstream(mHalHandle, coreInitCmd, sizeof(coreInitCmd))) {
+        if (!HalSendDownstream(ctx->mHalHandle, coreInitCmd,
+                               sizeof(coreInitCmd))) {
           STLOG_HAL_E("NFC-NCI HAL: %s  SendDownstream failed", __func__);
         }
         return;
@@ -940,40 +897,25 @@ static void halWrapperCallback(uint8_t event,
       if (event == HAL_WRAPPER_TIMEOUT_EVT) {
         STLOG_HAL_E("%s - Timer when sending conf parameters, retry", __func__);
         hal_wrapper_store_timeout_log();
-        abort();  // TODO: fix it when we have a better recovery method.
-        HalSendDownstreamStopTimer(mHalHandle);
+        HalSendDownstreamStopTimer(ctx->mHalHandle);
         resetHandlerState();
-        I2cResetPulse();
-        mHalWrapperState = HAL_WRAPPER_STATE_OPEN;
+        hal_wrapper_recover(HalRecovery::RETRY_COMMAND, 0xB0);
+        return;
       }
       break;
 
     case HAL_WRAPPER_STATE_READY:
       if (event == HAL_WRAPPER_TIMEOUT_EVT) {
-        if (mTimerStarted || mFieldInfoTimerStarted) {
+        if (ctx->mTimerStarted || ctx->mFieldInfoTimerStarted) {
           STLOG_HAL_E("NFC-NCI HAL: %s  Timeout.. Recover!", __func__);
-          STLOG_HAL_E("%s mIsActiveRW = %d", __func__, mIsActiveRW);
-          HalSendDownstreamStopTimer(mHalHandle);
-          mTimerStarted = false;
-          mFieldInfoTimerStarted = false;
+          STLOG_HAL_E("%s mIsActiveRW = %d", __func__,
+                      StNfcContext::current()->power.activeRW());
+          HalSendDownstreamStopTimer(ctx->mHalHandle);
+          ctx->mTimerStarted = false;
+          ctx->mFieldInfoTimerStarted = false;
           // forceRecover = true;
           resetHandlerState();
-          if (!HalSendDownstream(mHalHandle, rfDeactivateCmd,
-                                 sizeof(rfDeactivateCmd))) {
-            STLOG_HAL_E("%s - SendDownstream failed", __func__);
-          }
-          usleep(10000);
-          // Core Generic Error
-
-          p_data[0] = 0x60;
-          p_data[1] = 0x00;
-          p_data[2] = 0x03;
-          p_data[3] = 0xAA;
-          p_data[4] = 0x00;
-          p_data[5] = 0x00;
-          data_len = 0x6;
-          mHalWrapperDataCallback(data_len, p_data);
-          mHalWrapperState = HAL_WRAPPER_STATE_RECOVERY;
+          hal_wrapper_recover(HalRecovery::RF_DEACTIVATE, 0xAA);
         }
         return;
       }
@@ -982,18 +924,10 @@ static void halWrapperCallback(uint8_t event,
     case HAL_WRAPPER_STATE_EXIT_HIBERNATE_INTERNAL:
       if (event == HAL_WRAPPER_TIMEOUT_EVT) {
         STLOG_HAL_E("NFC-NCI HAL: %s  Timeout at state: %s", __func__,
-                    hal_wrapper_state_to_str(mHalWrapperState).c_str());
+                    hal_wrapper_state_to_str(ctx->mHalWrapperState).c_str());
         hal_wrapper_store_timeout_log();
-        HalSendDownstreamStopTimer(mHalHandle);
-        p_data[0] = 0x60;
-        p_data[1] = 0x00;
-        p_data[2] = 0x03;
-        p_data[3] = 0xAB;
-        p_data[4] = 0x00;
-        p_data[5] = 0x00;
-        data_len = 0x6;
-        mHalWrapperDataCallback(data_len, p_data);
-        mHalWrapperState = HAL_WRAPPER_STATE_OPEN;
+        HalSendDownstreamStopTimer(ctx->mHalHandle);
+        hal_wrapper_recover(HalRecovery::RESET_PULSE, 0xAB);
         return;
       }
       break;
@@ -1001,18 +935,10 @@ static void halWrapperCallback(uint8_t event,
     case HAL_WRAPPER_STATE_OPEN_CPLT:
       if (event == HAL_WRAPPER_TIMEOUT_EVT) {
         STLOG_HAL_E("NFC-NCI HAL: %s  Timeout at state: %s", __func__,
-                    hal_wrapper_state_to_str(mHalWrapperState).c_str());
+                    hal_wrapper_state_to_str(ctx->mHalWrapperState).c_str());
         hal_wrapper_store_timeout_log();
-        HalSendDownstreamStopTimer(mHalHandle);
-        p_data[0] = 0x60;
-        p_data[1] = 0x00;
-        p_data[2] = 0x03;
-        p_data[3] = 0xAC;
-        p_data[4] = 0x00;
-        p_data[5] = 0x00;
-        data_len = 0x6;
-        mHalWrapperDataCallback(data_len, p_data);
-        mHalWrapperState = HAL_WRAPPER_STATE_OPEN;
+        HalSendDownstreamStopTimer(ctx->mHalHandle);
+        hal_wrapper_recover(HalRecovery::SOFT_RESET, 0xAC);
         return;
       }
       break;
@@ -1020,28 +946,37 @@ static void halWrapperCallback(uint8_t event,
     case HAL_WRAPPER_STATE_APPLY_CUSTOM_PARAM:
       if (event == HAL_WRAPPER_TIMEOUT_EVT) {
         STLOG_HAL_E("NFC-NCI HAL: %s  Timeout at state: %s", __func__,
-                    hal_wrapper_state_to_str(mHalWrapperState).c_str());
+                    hal_wrapper_state_to_str(ctx->mHalWrapperState).c_str());
         hal_wrapper_store_timeout_log();
-        HalSendDownstreamStopTimer(mHalHandle);
-        p_data[0] = 0x60;
-        p_data[1] = 0x00;
-        p_data[2] = 0x03;
-        p_data[3] = 0xAD;
-        p_data[4] = 0x00;
-        p_data[5] = 0x00;
-        data_len = 0x6;
-        mHalWrapperDataCallback(data_len, p_data);
-        mHalWrapperState = HAL_WRAPPER_STATE_OPEN;
+        HalSendDownstreamStopTimer(ctx->mHalHandle);
+        hal_wrapper_recover(HalRecovery::RESET_PULSE, 0xAD);
+        return;
+      }
+      break;
+
+    case HAL_WRAPPER_STATE_APPLY_PROP_CONFIG:
+      if (event == HAL_WRAPPER_TIMEOUT_EVT) {
+        STLOG_HAL_E("NFC-NCI HAL: %s  Timeout at state: %s", __func__,
+                    hal_wrapper_state_to_str(ctx->mHalWrapperState).c_str());
+        hal_wrapper_store_timeout_log();
+        HalSendDownstreamStopTimer(ctx->mHalHandle);
+        hal_wrapper_recover(HalRecovery::RESET_PULSE, 0xB0);
         return;
       }
       break;
 
     case HAL_WRAPPER_STATE_RECOVERY:
+      if (event == HAL_WRAPPER_TIMEOUT_EVT &&
+          StNfcContext::current()->recovery.active()) {
+        hal_wrapper_recovery_done(
+            StNfcContext::current()->recovery.onTimeout(), 0, NULL);
+        return;
+      }
       if (event == HAL_WRAPPER_TIMEOUT_EVT) {
         STLOG_HAL_E("NFC-NCI HAL: %s  Timeout at state: %s", __func__,
-                    hal_wrapper_state_to_str(mHalWrapperState).c_str());
+                    hal_wrapper_state_to_str(ctx->mHalWrapperState).c_str());
         hal_wrapper_store_timeout_log();
-        HalSendDownstreamStopTimer(mHalHandle);
+        HalSendDownstreamStopTimer(ctx->mHalHandle);
         p_data[0] = 0x60;
         p_data[1] = 0x00;
         p_data[2] = 0x03;
@@ -1049,8 +984,8 @@ static void halWrapperCallback(uint8_t event,
         p_data[4] = 0x00;
         p_data[5] = 0x00;
         data_len = 0x6;
-        mHalWrapperDataCallback(data_len, p_data);
-        mHalWrapperState = HAL_WRAPPER_STATE_OPEN;
+        ctx->mHalWrapperDataCallback(data_len, p_data);
+        hal_wrapper_set_state(HAL_WRAPPER_STATE_OPEN);
         return;
       }
       break;
@@ -1058,16 +993,16 @@ static void halWrapperCallback(uint8_t event,
     default:
       if (event == HAL_WRAPPER_TIMEOUT_EVT) {
         STLOG_HAL_E("NFC-NCI HAL: %s  Timeout at state: %s", __func__,
-                    hal_wrapper_state_to_str(mHalWrapperState).c_str());
-        if (!storedLog) {
+                    hal_wrapper_state_to_str(ctx->mHalWrapperState).c_str());
+        if (!ctx->storedLog) {
           hal_wrapper_store_timeout_log();
-          storedLog = true;
+          ctx->storedLog = true;
         }
       }
       break;
   }
 
-  mHalWrapperCallback(event, event_status);
+  ctx->mHalWrapperCallback(event, event_status);
 }
 
 /*******************************************************************************
@@ -1080,9 +1015,20 @@ static void halWrapperCallback(uint8_t event,
  **
  *******************************************************************************/
 void hal_wrapper_set_state(hal_wrapper_state_e new_wrapper_state) {
-  ALOGD("nfc_set_state %d->%d", mHalWrapperState, new_wrapper_state);
+  HalWrapperContext* ctx = HalWrapperContext::current();
+  ALOGD("nfc_set_state %d->%d", ctx->mHalWrapperState, new_wrapper_state);
 
-  mHalWrapperState = new_wrapper_state;
+  if (new_wrapper_state != ctx->mHalWrapperState) {
+    if (new_wrapper_state == HAL_WRAPPER_STATE_RECOVERY) {
+      HalMetrics::getInstance().increment(HalMetrics::RECOVERIES);
+      StNfcContext::current()->faults.noteRecovery();
+    }
+    HalTimeline::getInstance().stateChange(ctx->mHalWrapperState,
+                                           new_wrapper_state);
+    StNfcContext::current()->fwTrace.captureState(ctx->mHalWrapperState,
+                                                  new_wrapper_state);
+  }
+  ctx->mHalWrapperState = new_wrapper_state;
 }
 
 /*******************************************************************************
@@ -1095,16 +1041,17 @@ void hal_wrapper_set_state(hal_wrapper_state_e new_wrapper_state) {
  **
  *******************************************************************************/
 void hal_wrapper_setFwLogging(bool enable) {
+  HalWrapperContext* ctx = HalWrapperContext::current();
   ALOGD("%s : enable = %d", __func__, enable);
 
-  sEnableFwLog = enable;
+  ctx->sEnableFwLog = enable;
 }
 
 /*******************************************************************************
  **
  ** Function         hal_wrapper_dumplog
  **
- ** Description      Dump HAL event logs.
+ ** Description      Dump HAL event logs, metrics and timeline.
  **
  ** Returns          void
  **
@@ -1112,7 +1059,11 @@ void hal_wrapper_setFwLogging(bool enable) {
 void hal_wrapper_dumplog(int fd) {
   ALOGD("%s : fd= %d", __func__, fd);
 
+  HalFrontEnd::getInstance().dump(fd);
   HalEventLogger::getInstance().dump_log(fd);
+  StNfcContext::current()->power.flush();
+  HalMetrics::getInstance().dump(fd);
+  HalTimeline::getInstance().dump(fd);
 }
 
 /*******************************************************************************
@@ -1124,7 +1075,7 @@ void hal_wrapper_dumplog(int fd) {
 ** Returns          string
 **
 *******************************************************************************/
-static std::string hal_wrapper_state_to_str(uint16_t event) {
+std::string hal_wrapper_state_to_str(uint16_t event) {
   switch (event) {
     case HAL_WRAPPER_STATE_CLOSED:
       return "HAL_WRAPPER_STATE_CLOSED";
@@ -1148,8 +1099,6 @@ static std::string hal_wrapper_state_to_str(uint16_t event) {
       return "HAL_WRAPPER_STATE_APPLY_CUSTOM_PARAM";
     case HAL_WRAPPER_STATE_APPLY_UWB_PARAM:
       return "HAL_WRAPPER_STATE_APPLY_UWB_PARAM";
-    case HAL_WRAPPER_STATE_SET_ACTIVERW_TIMER:
-      return "HAL_WRAPPER_STATE_SET_ACTIVERW_TIMER";
     case HAL_WRAPPER_STATE_APPLY_PROP_CONFIG:
       return "HAL_WRAPPER_STATE_APPLY_PROP_CONFIG";
     case HAL_WRAPPER_STATE_RECOVERY:
@@ -1159,6 +1108,80 @@ static std::string hal_wrapper_state_to_str(uint16_t event) {
   }
 }
 
+/*******************************************************************************
+**
+** Function         hal_wrapper_recover
+**
+** Description      Recover the NFCC from strategy first, in
+**                  HAL_WRAPPER_STATE_RECOVERY. reason is the one of the
+**                  CORE_RESET_NTF given to the stack should the NFCC be reset.
+**
+** Returns          void
+*******************************************************************************/
+static void hal_wrapper_recover(HalRecovery::Strategy first, uint8_t reason) {
+  HalWrapperContext* ctx = HalWrapperContext::current();
+  HalRecovery* recovery = &StNfcContext::current()->recovery;
+  hal_wrapper_state_e origin = ctx->mHalWrapperState;
+
+  hal_wrapper_set_state(HAL_WRAPPER_STATE_RECOVERY);
+  hal_wrapper_recovery_done(
+      recovery->start(ctx->mHalHandle, first, origin, reason), 0, NULL);
+}
+
+/*******************************************************************************
+**
+** Function         hal_wrapper_recovery_done
+**
+** Description      Act on the recovery outcome for a frame or a timeout. If
+**                  the NFCC kept its state, go back to the trigger state.
+**                  Otherwise the stack gets a CORE_RESET_NTF with the reason
+**                  of the trigger and initializes the NFCC again.
+**
+** Returns          void
+*******************************************************************************/
+static void hal_wrapper_recovery_done(HalRecovery::Action action,
+                                      uint16_t data_len, uint8_t* p_data) {
+  HalWrapperContext* ctx = HalWrapperContext::current();
+  HalRecovery* recovery = &StNfcContext::current()->recovery;
+  uint8_t coreResetNtf[] = {0x60, 0x00, 0x03, recovery->reason(), 0x00, 0x00};
+
+  switch (action) {
+    case HalRecovery::CONSUMED:
+      break;
+
+    case HalRecovery::FORWARD:
+      ctx->mHalWrapperDataCallback(data_len, p_data);
+      break;
+
+    case HalRecovery::RESUMED:
+      hal_wrapper_set_state(recovery->origin());
+      break;
+
+    case HalRecovery::REPLAY:
+      hal_wrapper_set_state(recovery->origin());
+      halWrapperDataCallback(data_len, p_data);
+      break;
+
+    case HalRecovery::RESET:
+      // The reset pulse is how the FW configuration applies: go on with it.
+      if (recovery->origin() == HAL_WRAPPER_STATE_APPLY_PROP_CONFIG) {
+        hal_wrapper_set_state(recovery->origin());
+        halWrapperDataCallback(data_len, p_data);
+        break;
+      }
+      [[fallthrough]];
+    case HalRecovery::FAILED:
+      ctx->mHalWrapperDataCallback(sizeof(coreResetNtf), coreResetNtf);
+      // From READY, frames are dropped until the stack restarts NFC.
+      if (recovery->origin() != HAL_WRAPPER_STATE_READY) {
+        hal_wrapper_set_state(HAL_WRAPPER_STATE_OPEN);
+      }
+      // A binder thread may wait for the configuration to complete.
+      set_ready(1);
+      break;
+  }
+}
+
 /*******************************************************************************
 **
 ** Function         hal_wrapper_store_timeout_log
@@ -1168,10 +1191,58 @@ static std::string hal_wrapper_state_to_str(uint16_t event) {
 ** Returns          void
 *******************************************************************************/
 static void hal_wrapper_store_timeout_log() {
+  HalWrapperContext* ctx = HalWrapperContext::current();
   HalEventLogger::getInstance().log()
-      << " Timeout at state: " << hal_wrapper_state_to_str(mHalWrapperState)
-      << " mIsActiveRW=" << mIsActiveRW << " mTimerStarted=" << mTimerStarted
-      << " activity=" << TimerAct.activity << " duration=" << TimerAct.duration
-      << std::endl;
+      << " Timeout at state: "
+      << hal_wrapper_state_to_str(ctx->mHalWrapperState)
+      << " mIsActiveRW=" << StNfcContext::current()->power.activeRW()
+      << " mTimerStarted=" << ctx->mTimerStarted
+      << " activity=" << ctx->TimerAct.activity
+      << " duration=" << ctx->TimerAct.duration << std::endl;
   HalEventLogger::getInstance().store_log();
 }
+
+/*******************************************************************************
+**
+** Function         hal_wrapper_send_core_config_next
+**
+** Description      Send the next command applying CORE_CONF_PROP, as the
+**                  configuration reconciler gives them: reads of the
+**                  parameters, then sets of those that differ.
+**
+** Returns          false once CORE_CONF_PROP is applied
+*******************************************************************************/
+static bool hal_wrapper_send_core_config_next() {
+  HalWrapperContext* ctx = HalWrapperContext::current();
+  uint8_t cmd[HAL_CONFIG_CMD_SIZE];
+  size_t length = 0;
+
+  if (!StNfcContext::current()->config.nextCoreCommand(cmd, &length)) {
+    return false;
+  }
+  HalEventLogger::getInstance().store_timer_activity("send core config", 1000);
+  if (!HalSendDownstreamTimer(ctx->mHalHandle, cmd, length, 1000)) {
+    STLOG_HAL_E("NFC-NCI HAL: %s  SendDownstream failed", __func__);
+  }
+  return true;
+}
+
+/*******************************************************************************
+**
+** Function         hal_wrapper_core_config_done
+**
+** Description      CORE_CONF_PROP applied, the post init is complete.
+**
+** Returns          void
+*******************************************************************************/
+static void hal_wrapper_core_config_done() {
+  HalWrapperContext* ctx = HalWrapperContext::current();
+
+  GetNumValue(NAME_STNFC_REMOTE_FIELD_TIMER, &ctx->hal_field_timer,
+              sizeof(ctx->hal_field_timer));
+  STLOG_HAL_D("%s - hal_field_timer = %lu", __func__, ctx->hal_field_timer);
+  set_ready(1);
+  // Exit state, all processing done
+  ctx->mHalWrapperCallback(HAL_NFC_POST_INIT_CPLT_EVT, HAL_NFC_STATUS_OK);
+  hal_wrapper_set_state(HAL_WRAPPER_STATE_READY);
+}
@@ -40,8 +40,6 @@ extern int GetByteArrayValue(const char* name, char* pValue, long bufflen,
                              long* len);
 extern int GetStrValue(const char* name, char* pValue, unsigned long l);
 
-extern bool mDisplayFwLog;
-
 /* #######################
  * Set the log module name in .conf file
  * ########################## */
@@ -59,6 +57,26 @@ extern bool mDisplayFwLog;
 #define NAME_STNFC_FW_SWP_LOG_SIZE "STNFC_FW_SWP_LOG_SIZE"
 #define NAME_STNFC_FW_RF_LOG_SIZE "STNFC_FW_RF_LOG_SIZE"
 #define NAME_STNFC_REMOTE_FIELD_TIMER "STNFC_REMOTE_FIELD_TIMER"
+#define NAME_STNFC_HAL_BUFFERS_INITIAL "STNFC_HAL_BUFFERS_INITIAL"
+#define NAME_STNFC_HAL_BUFFERS_MAX "STNFC_HAL_BUFFERS_MAX"
+#define NAME_STNFC_FAULT_INJECTION "STNFC_FAULT_INJECTION"
+#define NAME_STNFC_THREAD_IO_SCHED "STNFC_THREAD_IO_SCHED"
+#define NAME_STNFC_THREAD_IO_CPUS "STNFC_THREAD_IO_CPUS"
+#define NAME_STNFC_THREAD_WORKER_SCHED "STNFC_THREAD_WORKER_SCHED"
+#define NAME_STNFC_THREAD_WORKER_CPUS "STNFC_THREAD_WORKER_CPUS"
+#define NAME_STNFC_THREAD_CALLBACK_SCHED "STNFC_THREAD_CALLBACK_SCHED"
+#define NAME_STNFC_THREAD_CALLBACK_CPUS "STNFC_THREAD_CALLBACK_CPUS"
+#define NAME_STNFC_THREAD_FW_TRACE_SCHED "STNFC_THREAD_FW_TRACE_SCHED"
+#define NAME_STNFC_THREAD_FW_TRACE_CPUS "STNFC_THREAD_FW_TRACE_CPUS"
+#define NAME_STNFC_THREAD_MLOCK "STNFC_THREAD_MLOCK"
+#define NAME_STNFC_CONFIG_DELTA "STNFC_CONFIG_DELTA"
+#define NAME_STNFC_WARM_START "STNFC_WARM_START"
+#define NAME_STNFC_UWB_PARAM_FILES "STNFC_UWB_PARAM_FILES"
+#define NAME_STNFC_OBSERVE_MODE_RESYNC_MS "STNFC_OBSERVE_MODE_RESYNC_MS"
+#define NAME_STNFC_FW_TRACE_CAPTURE "STNFC_FW_TRACE_CAPTURE"
+#define NAME_STNFC_FW_TRACE_FILE_SIZE "STNFC_FW_TRACE_FILE_SIZE"
+#define NAME_STNFC_FW_TRACE_NCI "STNFC_FW_TRACE_NCI"
+#define NAME_STNFC_BINDER_THREADS "STNFC_BINDER_THREADS"
 
 /* #######################
  * Set the logging level
@@ -19,5 +19,6 @@
 
 extern "C" int GetNumValue(const char* name, void* pValue, unsigned long len);
 extern "C" int GetStrValue(const char* name, char* pValue, unsigned long l);
+extern "C" int IsConfigFound();
 
 #endif  // CONFIG_H_
\ No newline at end of file
@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+#define HAL_BINDER_THREADS_DEFAULT 2
+#define HAL_BINDER_THREADS_MAX 16
+
+/*
+ * Order of the calls of the NFC stack into the service, which runs
+ * STNFC_BINDER_THREADS binder threads (2 by default, 1 serializes every
+ * call as before).
+ *
+ * The calls changing the HAL state or sending to the NFCC (open, close,
+ * coreInitialized, write...) still run one at a time, in the order they
+ * reach the service: each takes a ticket and waits for its turn. getConfig
+ * is one of them, as it sets the NFC mode the next close applies. dump and
+ * isVerboseLoggingEnabled only read and run alongside them, so that a
+ * bugreport does not hold the NCI writes queued behind it. The metrics
+ * account per call the time waited for the turn and the time run.
+ */
+class HalBinderCalls {
+ public:
+  enum Call {
+    CALL_OPEN,
+    CALL_CLOSE,
+    CALL_CORE_INITIALIZED,
+    CALL_WRITE,
+    CALL_POWER_CYCLE,
+    CALL_PRE_DISCOVER,
+    CALL_FACTORY_RESET,
+    CALL_SET_VERBOSE_LOGGING,
+    CALL_GET_CONFIG,
+    CALL_IS_VERBOSE_LOGGING,  // first of the concurrent calls
+    CALL_DUMP,
+    CALL_MAX,
+  };
+
+  // One call, for the duration of the method.
+  class Scope {
+   public:
+    explicit Scope(Call call);
+    ~Scope();
+
+   private:
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+    Call mCall;
+    bool mOrdered;  // took a turn
+    uint64_t mStartUs;
+    uint64_t mWaitUs;
+  };
+
+  static HalBinderCalls& getInstance();
+
+  // Binder threads of the service, from the HAL configuration. Read before
+  // the thread pool starts, it also loads the configuration on the main
+  // thread.
+  static uint32_t threadCount();
+  static bool isOrdered(Call call) { return call < CALL_IS_VERBOSE_LOGGING; }
+  static const char* callName(Call call);
+
+ private:
+  HalBinderCalls();
+  HalBinderCalls(const HalBinderCalls&) = delete;
+  HalBinderCalls& operator=(const HalBinderCalls&) = delete;
+
+  // Returns true if the call had to wait for another one.
+  bool enter();
+  void leave();
+  void setInFlight(int64_t delta);
+
+  std::mutex mMutex;
+  std::condition_variable mCond;
+  uint64_t mNextTicket;  // Guarded by mMutex
+  uint64_t mServing;     // Guarded by mMutex
+
+  std::atomic<int64_t> mInFlight;
+};
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+#define HAL_CALLBACK_QUEUE_SIZE 32
+
+/*
+ * FIFO of the (event, status) pairs a service front end reports to the NFC
+ * stack from its callback thread. Any thread may post and posting never
+ * waits for the consumer. Events are never dropped: the stack waits for
+ * OPEN_CPLT, CLOSE_CPLT, ERROR and the other HAL events, so once the
+ * fixed ring is full they spill, in order, into an overflow list, which is
+ * counted. Event and status are nfc_event_t and nfc_status_t, kept as plain
+ * bytes so that both the libhardware and the AIDL definitions fit.
+ */
+class HalCallbackQueue {
+ public:
+  enum PostResult {
+    POSTED,
+    CLOSED,  // no consumer, the caller has to deliver the event itself
+  };
+
+  HalCallbackQueue();
+
+  // Start accepting events. Waits for the consumer of a previous session, if
+  // any, to have delivered everything it took.
+  void open();
+  // Stop accepting events without consumer, e.g. if it could not start.
+  void close();
+
+  PostResult post(uint8_t event, uint8_t status);
+
+  // Consumer side: blocks until an event is queued. Returns false once
+  // stop() was called and every queued event was taken, the queue is then
+  // closed.
+  bool take(uint8_t* event, uint8_t* status);
+
+  // Drain-then-stop: waits until the consumer has taken every queued event.
+  // Events posted meanwhile are still delivered. Not to be called from the
+  // consumer.
+  void stop();
+
+ private:
+  HalCallbackQueue(const HalCallbackQueue&) = delete;
+  HalCallbackQueue& operator=(const HalCallbackQueue&) = delete;
+
+  struct Entry {
+    uint8_t event;
+    uint8_t status;
+  };
+
+  std::mutex mMutex;
+  std::condition_variable mCond;
+  Entry mRing[HAL_CALLBACK_QUEUE_SIZE];
+  size_t mHead;
+  size_t mCount;
+  // Events posted while the ring is full, moved into it as it drains
+  std::deque<Entry> mOverflow;
+  uint64_t mPostedUs;  // event posted in the empty queue, if any
+  bool mOpen;
+  bool mStopping;
+};
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <map>
+#include <vector>
+
+/* Largest NCI control packet, header included. */
+#define HAL_CONFIG_CMD_SIZE (3 + 255)
+#define HAL_CONFIG_CORE_PARAMS_MAX 128
+
+/*
+ * Applies the configuration of the HAL to the NFCC, sending only what the
+ * NFCC does not hold yet (STNFC_CONFIG_DELTA, on by default):
+ *
+ * - CORE_CONF_PROP, the CORE_SET_CONFIG_CMD sent at each core_initialized:
+ *   its parameters are read back with as few CORE_GET_CONFIG_CMD as fit, and
+ *   those that differ set with as few CORE_SET_CONFIG_CMD as fit. A
+ *   parameter the NFCC does not report is set.
+ * - The PROP_SET_CONFIG_CMD frames of the custom configuration file,
+ *   replayed when its version changed: a frame writing a parameter block
+ *   from its start is skipped if the block already holds its data. Each
+ *   block is read once per replay.
+ *
+ * What was sent and skipped is logged and added to the metrics. Driven by
+ * the wrapper, on the HAL worker thread but for the begin calls.
+ */
+class HalConfigReconciler {
+ public:
+  enum PropAction {
+    PROP_SEND,  // send the frame
+    PROP_SKIP,  // the NFCC already holds it
+    PROP_READ,  // send the read given first, then check the frame again
+  };
+
+  HalConfigReconciler();
+
+  // Starts applying a CORE_SET_CONFIG_CMD.
+  void beginCore(const uint8_t* cmd, size_t length);
+  // Next command to send, a CORE_GET_CONFIG_CMD while reading, then the
+  // CORE_SET_CONFIG_CMD. False when done.
+  bool nextCoreCommand(uint8_t* cmd, size_t* length);
+  void onCoreGetResponse(const uint8_t* rsp, size_t length);
+
+  // Starts a replay of the custom configuration file.
+  void beginProp();
+  PropAction checkPropFrame(const uint8_t* frame, size_t length, uint8_t* get,
+                            size_t* getLength);
+  void onPropGetResponse(const uint8_t* rsp, size_t length);
+  void endProp();
+
+ private:
+  struct CoreParam {
+    uint8_t id;
+    uint16_t offset;  // of the value in mCoreCmd
+    uint8_t length;
+    bool differs;
+  };
+
+  struct Stats {
+    uint32_t reads;
+    uint32_t sets;
+    uint32_t setBytes;
+    uint32_t skipped;  // core parameters or custom frames already held
+    uint32_t skippedBytes;
+  };
+
+  HalConfigReconciler(const HalConfigReconciler&) = delete;
+  HalConfigReconciler& operator=(const HalConfigReconciler&) = delete;
+
+  bool parseCore(const uint8_t* cmd, size_t length);
+  void report(const char* what, const Stats& stats);
+
+  bool mDelta;
+
+  uint8_t mCoreCmd[HAL_CONFIG_CMD_SIZE];
+  size_t mCoreLength;
+  CoreParam mCoreParams[HAL_CONFIG_CORE_PARAMS_MAX];
+  size_t mCoreCount;
+  size_t mCoreNextGet;
+  size_t mCoreNextSet;
+  bool mCoreDone;
+  Stats mCoreStats;
+
+  // Blocks read during the current replay, by id. Absent: not read yet,
+  // empty: could not be read.
+  std::map<uint8_t, std::vector<uint8_t>> mPropBlocks;
+  int mPropPending;  // block being read, -1 if none
+  Stats mPropStats;
+};
@@ -0,0 +1,209 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <poll.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include <atomic>
+
+#include "hal_config_reconciler.h"
+#include "hal_event_logger.h"
+#include "hal_fault_injector.h"
+#include "hal_fd.h"
+#include "hal_fd_snapshot.h"
+#include "hal_fw_trace.h"
+#include "hal_nci_translator.h"
+#include "hal_observe_mode.h"
+#include "hal_power.h"
+#include "hal_recovery.h"
+#include "halcore.h"
+
+/* The nfc_stack_callback_t types come from the HAL interface of the
+ * includer, as for st21nfc_dev.h. */
+
+/* I2C transport, adaptation/i2clayer.cc */
+struct I2cTransportContext {
+  // Device node of the controller, ST_NFC_DEV_NODE of the configuration if
+  // left empty.
+  char devNode[64] = {};
+
+  int fidI2c = 0;
+  int cmdPipe[2] = {0, 0};
+  int notifyResetRequest = 0;
+  bool recovery_mode = false;
+  uint16_t i2c_error_count = 0;
+  struct pollfd event_table[3] = {};
+  pthread_t threadHandle = (pthread_t)NULL;
+  pthread_mutex_t i2ctransport_mtx = PTHREAD_MUTEX_INITIALIZER;
+  HALHANDLE hHAL = NULL;
+  // First command queued while the I/O thread had none, for its wakeup delay
+  std::atomic<uint64_t> wakeupPostedUs = 0;
+
+  static I2cTransportContext* current();
+};
+
+/* HalCore callback side, hal/halcore.cc. The HalInstance itself is owned
+ * through transport.hHAL. */
+struct HalCoreContext {
+  bool rf_deactivate_delay = false;
+  struct timespec start_tx_data = {};
+
+  static HalCoreContext* current();
+};
+
+/* Wrapper state machine, hal_wrapper.cc */
+struct HalWrapperContext {
+  nfc_stack_callback_t* mHalWrapperCallback = NULL;
+  nfc_stack_data_callback_t* mHalWrapperDataCallback = NULL;
+  hal_wrapper_state_e mHalWrapperState = HAL_WRAPPER_STATE_CLOSED;
+  HALHANDLE mHalHandle = NULL;
+
+  uint8_t mClfMode = 0;
+  uint8_t mFwUpdateTaskMask = 0;
+  int mRetryFwDwl = 0;
+  uint8_t mFwUpdateResMask = 0;
+  uint8_t* ConfigBuffer = NULL;
+  uint8_t mError_count = 0;
+  pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+  pthread_cond_t ready_cond = PTHREAD_COND_INITIALIZER;
+
+  uint8_t nciPropEnableFwDbgTraces[256] = {};
+  uint8_t nciAndroidPassiveObserver[256] = {};
+
+  bool mReadFwConfigDone = false;
+  bool mHciCreditLent = false;
+  bool mfactoryReset = false;
+  bool ready_flag = 0;
+  bool mTimerStarted = false;
+  bool mFieldInfoTimerStarted = false;
+  bool forceRecover = false;
+  unsigned long hal_field_timer = 0;
+
+  bool sEnableFwLog = false;
+  bool storedLog = false;
+  uint16_t OpenTimeoutCount = 0;
+  // hal_wrapper_open() time, and of the CORE_RESET_NTF once seen (0 before).
+  uint64_t mOpenStartUs = 0;
+  uint64_t mOpenResetUs = 0;
+
+  bool mDisplayFwLog = false;
+  bool isDebuggable = false;
+
+  TimerActivity TimerAct = {"", 0};
+  HalNciTranslator nciTranslator;
+
+  static HalWrapperContext* current();
+};
+
+/* FW download and configuration, hal/hal_fd.cc */
+struct HalFdContext {
+  FWInfo* mFWInfo = NULL;
+  FWCap* mFWCap = NULL;
+
+  FILE* mFwFileBin = NULL;
+  FILE* mCustomFileBin = NULL;
+  char* mCustomFileBuffer = NULL;
+  fpos_t mPos = {};
+  fpos_t mPosInit = {};
+  uint8_t mBinData[260] = {};
+  bool mRetry = true;
+  bool mCustomParamFailed = false;
+  bool mCustomParamDone = false;
+  bool mUwbConfigDone = false;
+  bool mUwbConfigNeeded = false;
+  bool mGetCustomerField = false;
+  // A read of the configuration reconciler is in flight, the frame in
+  // mBinData to be checked again once answered.
+  bool mCustomReadPending = false;
+  uint8_t* pCmd = NULL;
+  int mFWRecovCount = 0;
+  const char* FwType = "generic";
+  char mApduAuthent[24] = {};
+
+  // nciPropSetUwbConfig and fileUwbVersion, loaded once needed if the UWB
+  // library is there.
+  bool mUwbAvailable = false;
+  bool mUwbLoaded = false;
+  uint8_t nciPropSetUwbConfig[HAL_FD_UWB_CONFIG_SIZE] = {};
+  uint8_t nciPropSetConfig_CustomField[64] = {};
+  // Files behind mFwFileBin and mCustomFileBin, opened by hal_fd_init() or,
+  // on a warm start, only once an update may be needed.
+  char mFwPath[256] = {};
+  char mConfPath[256] = {};
+  bool mFilesLoaded = false;
+  HalFdSnapshot mSnapshot;
+  hal_fd_state_e mHalFDState = HAL_FD_STATE_AUTHENTICATE;
+  hal_fd_st54l_state_e mHalFD54LState = HAL_FD_ST54L_STATE_PUY_KEYUSER;
+
+  static HalFdContext* current();
+};
+
+/*
+ * State of one NFC controller: transport, HalCore, wrapper, FW download,
+ * recovery, power state, configuration and fault injection. The C entry
+ * points (hal_wrapper_*, I2c*, hal_fd_*) are thin shims working on the
+ * context of the calling thread: the one bound by a Scope, else the default
+ * context used by the HAL services.
+ * The threads a context starts (I/O, HAL worker) are bound to it for their
+ * whole life.
+ *
+ * Logging, metrics, timeline and configuration stay process wide: they are
+ * what a bug report or a dump sees, whatever the number of controllers.
+ */
+class StNfcContext {
+ public:
+  StNfcContext() = default;
+
+  static StNfcContext* getDefault();
+  static StNfcContext* current();
+
+  // Binds the calling thread to ctx, for a thread started by the HAL.
+  static void bindThread(StNfcContext* ctx);
+
+  // Binds the calling thread to a context until the end of the scope, so
+  // that the C entry points drive that controller.
+  class Scope {
+   public:
+    explicit Scope(StNfcContext* ctx);
+    ~Scope();
+
+   private:
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+    StNfcContext* mPrevious;
+  };
+
+  I2cTransportContext transport;
+  HalCoreContext core;
+  HalWrapperContext wrapper;
+  HalFdContext fd;
+  HalRecovery recovery;
+  HalPowerManager power;
+  HalConfigReconciler config;
+  HalObserveMode observe;
+  HalFwTrace fwTrace;
+  HalFaultInjector faults;
+
+ private:
+  StNfcContext(const StNfcContext&) = delete;
+  StNfcContext& operator=(const StNfcContext&) = delete;
+};
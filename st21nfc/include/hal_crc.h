@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define CRC_PRESET_A 0x6363
+#define CRC_PRESET_B 0xFFFF
+#define Type_A 0
+#define Type_B 1
+
+/*
+ * CRC_A / CRC_B of ISO/IEC 14443-3, as appended by the HAL to the custom
+ * polling frames. Table driven, 4 bytes per step.
+ */
+uint16_t iso14443_crc(const uint8_t* data, size_t szLen, int type);
+
+/*
+ * Incremental form, for frames gathered in pieces:
+ *   crc = iso14443_crc_init(Type_A);
+ *   crc = iso14443_crc_update(crc, part1, len1);
+ *   crc = iso14443_crc_update(crc, part2, len2);
+ * gives iso14443_crc() of part1 followed by part2.
+ */
+uint16_t iso14443_crc_init(int type);
+uint16_t iso14443_crc_update(uint16_t crc, const uint8_t* data, size_t szLen);
@@ -54,9 +54,8 @@ class HalEventLogger {
   std::mutex mMutex;
 };
 
+// Timer running for the controller, kept in its HalWrapperContext.
 struct TimerActivity {
   std::string activity;
   uint32_t duration;
-};
-
-extern TimerActivity TimerAct;
\ No newline at end of file
+};
\ No newline at end of file
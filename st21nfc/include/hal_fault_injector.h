@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <random>
+
+#define HAL_FAULT_MATCH_MAX 4
+#define HAL_FAULT_FRAME_MAX 8
+// Delay, in ms, within which a recovery is accounted to the last fault hit.
+#define HAL_FAULT_CORRELATION_WINDOW 5000
+
+/*
+ * Faults injected on the I2C transport of one controller, to reproduce on
+ * demand what the recovery has to cope with. Disabled unless a schedule is
+ * set, by the vendor.nfc.debug.fault_injection property or else by
+ * STNFC_FAULT_INJECTION in the HAL configuration, read at each open:
+ *
+ *   [seed=<n>;]<fault>[:<key>=<value>[,<key>=<value>]...][;<fault>...]
+ *
+ * Faults:
+ *   short_read   header read coming up short, the frame stays in the driver
+ *   write_error  write failing with EREMOTEIO, the retries of i2cWrite apply
+ *   idle_storm   idle bytes (0x7E) read instead of a header
+ *   truncate     payload shorter than its header, the frame is dropped
+ *   delay        frame delivered late, to trip the wrapper timers
+ *   reset_ntf    spurious CORE_RESET_NTF after a received frame
+ *   act_storm    RF_DEACTIVATE of an inactive link, Act -> Act, after a
+ *                received frame
+ *   overflow     CORE_GENERIC_ERROR_NTF(buffer overflow) after a received
+ *                frame
+ *
+ * Each read, write or received frame is an opportunity for the faults acting
+ * there. Keys:
+ *   p=<0..1>     probability of hitting an opportunity
+ *   at=<n>       hit the n-th opportunity only
+ *   every=<n>    hit every n-th opportunity
+ *   limit=<n>    stop after triggering n times
+ *   count=<n>    hits in a row once triggered, or frames added for the last
+ *                three faults (21 by default for act_storm, one above the
+ *                Act -> Act threshold of the wrapper)
+ *   ms=<n>       delay, 1100 by default to trip the 1000 ms timers
+ *   match=<hex>  only frames starting with these octets, e.g. match=4f02
+ *
+ * A recovery starting within HAL_FAULT_CORRELATION_WINDOW of a hit is
+ * accounted to that fault in the metrics, along with the time it took the
+ * HAL to react.
+ */
+class HalFaultInjector {
+ public:
+  enum Fault {
+    SHORT_READ,
+    WRITE_ERROR,
+    IDLE_STORM,
+    TRUNCATE,
+    DELAY,
+    RESET_NTF,
+    ACT_STORM,
+    OVERFLOW,
+    FAULT_MAX,
+  };
+
+  HalFaultInjector();
+
+  // Reads the schedule of the configuration, the hit counts start over.
+  void configure();
+  // Parses a schedule, false if it does not make sense. Exposed for tools.
+  bool configure(const char* schedule);
+
+  bool enabled() const { return mEnabled; }
+
+  // Whether fault hits this opportunity, data being the frame at hand if
+  // any. Only called from the I/O thread.
+  bool inject(Fault fault, const uint8_t* data = NULL, size_t length = 0);
+  uint32_t delayMs() const { return mRules[DELAY].delayMs; }
+
+  // Frames of the RESET_NTF, ACT_STORM and OVERFLOW faults hit by a received
+  // frame, to deliver after it.
+  void onRxFrame(const uint8_t* data, size_t length);
+  bool nextFrame(uint8_t* data, size_t* length);
+
+  // A recovery started, from any thread.
+  void noteRecovery();
+
+  static const char* faultName(Fault fault);
+
+ private:
+  struct Rule {
+    bool active;
+    double probability;
+    uint32_t at;
+    uint32_t every;
+    uint32_t limit;
+    uint32_t count;
+    uint32_t delayMs;
+    uint8_t match[HAL_FAULT_MATCH_MAX];
+    size_t matchLength;
+
+    uint32_t opportunities;
+    uint32_t triggers;
+    uint32_t burst;  // hits left of the current burst
+  };
+
+  HalFaultInjector(const HalFaultInjector&) = delete;
+  HalFaultInjector& operator=(const HalFaultInjector&) = delete;
+
+  bool parseRule(char* rule);
+  void hit(Fault fault);
+
+  bool mEnabled;
+  Rule mRules[FAULT_MAX];
+  std::minstd_rand mRandom;
+
+  Fault mPending[HAL_FAULT_FRAME_MAX];
+  uint32_t mPendingCount[HAL_FAULT_FRAME_MAX];
+  size_t mPendingHead;
+  size_t mPendingLength;
+
+  std::atomic<int> mLastFault;
+  std::atomic<uint64_t> mLastFaultUs;
+};
@@ -90,6 +90,8 @@ typedef enum {
 /* Function declarations */
 int hal_fd_init();
 void hal_fd_close();
+// Opens the files a warm start left closed, before an update.
+void hal_fd_ensure_files();
 uint8_t ft_cmd_HwReset(uint8_t* pdata, uint8_t* clf_mode);
 void ExitHibernateHandler(HALHANDLE mHalHandle, uint16_t data_len,
                           uint8_t* p_data);
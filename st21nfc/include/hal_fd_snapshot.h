@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+#include "hal_fd.h"
+
+#define HAL_FD_SNAPSHOT_FILE_NAME "/st21nfc_warm_start.bin"
+/* PROP_SET_CONFIG_CMD of the UWB parameters, as nciPropSetUwbConfig. */
+#define HAL_FD_UWB_CONFIG_SIZE 128
+
+/*
+ * Warm start of the FW download module: what hal_fd_init() learnt from the
+ * FW patch and custom configuration files, and the versions and
+ * capabilities the NFCC reported last, kept in memory across opens and
+ * persisted in the HAL storage directory across HAL restarts
+ * (STNFC_WARM_START, on by default).
+ *
+ * A snapshot is only used when taken with the same vendor build, device
+ * node, file paths, and files of the same identity (device, inode, size,
+ * modification time). hal_fd_init() then leaves the files closed, they are
+ * only loaded if the CORE_RESET_NTF of the NFCC shows an update may be
+ * needed. Anything else falls back to the full discovery.
+ *
+ * It also caches the UWB parameters built by the UWB library, keyed by the
+ * identity of the library and of the parameter files it reads
+ * (STNFC_UWB_PARAM_FILES), so that it is only loaded when they change. They
+ * are only cached if those files are configured.
+ */
+class HalFdSnapshot {
+ public:
+  enum File {
+    FILE_FW,    // FW patch binary
+    FILE_CONF,  // custom configuration, binary or text
+    FILE_MAX,
+  };
+
+  struct FileId {
+    uint8_t present;
+    uint64_t dev;
+    uint64_t ino;
+    uint64_t size;
+    int64_t mtimeNs;
+  };
+
+  struct Data {
+    uint32_t key;  // hash of the build, device node and paths
+    FileId files[FILE_MAX];
+    uint8_t resMask;  // FW_PATCH_AVAILABLE, FW_CUSTOM_PARAM_AVAILABLE
+    uint32_t fileFwVersion;
+    uint8_t fileHwVersion;
+    uint16_t fileCustVersion;
+    // Last NFCC seen in router mode with nothing to update, if chipKnown.
+    uint8_t chipKnown;
+    uint8_t chipHwVersion;
+    uint32_t chipFwVersion;
+    uint32_t chipLoaderVersion;
+    uint16_t chipCustVersion;
+    uint16_t chipUwbVersion;
+    FWCap cap;
+    // UWB parameters, if uwbKnown. uwbConfig is empty if the library built
+    // none.
+    uint8_t uwbKnown;
+    uint32_t uwbKey;
+    uint8_t uwbConfig[HAL_FD_UWB_CONFIG_SIZE];
+  };
+
+  HalFdSnapshot();
+
+  // Identity of this open. False if warm start is disabled.
+  bool identify(const char* devNode, const char* fwPath, const char* confPath);
+  // True if the snapshot, from memory or else the storage, matches the
+  // identity. Gives the file part of the hal_fd_init() result, fills the
+  // file versions of info and the last capabilities of the NFCC.
+  bool restore(uint8_t* resMask, FWInfo* info, FWCap* cap);
+  // Results of a full discovery of the files, for the identity.
+  void store(uint8_t resMask, const FWInfo* info);
+  // NFCC in router mode with nothing to update. Persisted if it changed.
+  void storeChip(const FWInfo* info, const FWCap* cap);
+
+  // Key of the UWB library and of its parameter files, 0 if the library is
+  // not there.
+  uint32_t uwbKey(const char* libName);
+  // True if the UWB parameters of the key are cached, copied to config.
+  // Never for a library whose parameter files are not configured.
+  bool restoreUwb(uint32_t key, uint8_t* config, size_t size);
+  void storeUwb(uint32_t key, const uint8_t* config, size_t size);
+
+ private:
+  HalFdSnapshot(const HalFdSnapshot&) = delete;
+  HalFdSnapshot& operator=(const HalFdSnapshot&) = delete;
+
+  static bool uwbParamFiles(char* files, size_t size);
+  bool load();
+  void save();
+
+  bool mEnabled;
+  bool mValid;  // mData holds a snapshot
+  bool mLoaded;  // storage read once
+  std::string mPath;
+  uint32_t mKey;
+  FileId mFiles[FILE_MAX];
+  Data mData;
+};
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include <atomic>
+
+#include "hal_callback_queue.h"
+#include "halcore.h"
+#include "st21nfc_dev.h"
+
+/* The nfc_stack_callback_t types come from the HAL interface of the
+ * includer, as for st21nfc_dev.h. */
+
+// Bumped whenever the calls below change meaning: a front end built against
+// another version refuses to open.
+#define HAL_FRONT_END_VERSION 1
+
+/*
+ * Calls of the service front ends, HIDL 1.1, 1.2 and AIDL, down to the HAL
+ * wrapper: what every NCI frame goes through is here once, and the front
+ * ends only keep what their interface defines (configuration types, what to
+ * do once closed).
+ *
+ * open, close, coreInitialized and powerCycle run one at a time. Writes do
+ * not wait for them: they only check the HAL is open and register as
+ * writers, so that close can wait for them before the HAL instance goes
+ * away. Android extensions (2f 0c) are translated on the way down. Events
+ * for the stack are posted to a callback thread, so that the stack is never
+ * called back from the thread it called the HAL on.
+ */
+class HalFrontEnd {
+ public:
+  static HalFrontEnd& getInstance();
+
+  // HAL_FRONT_END_VERSION of the library.
+  static uint32_t version();
+
+  // name is the version string of the front end, logged and dumped. Leave
+  // frontEndVersion to its default. Returns 0 when the HAL wrapper is
+  // opening, HAL_NFC_OPEN_CPLT_EVT comes later; -1 otherwise, the event is
+  // then given already.
+  int open(const char* name, nfc_stack_callback_t* p_cback,
+           nfc_stack_data_callback_t* p_data_cback,
+           uint32_t frontEndVersion = HAL_FRONT_END_VERSION);
+  // Returns length if the frame was queued or answered, 0 otherwise.
+  int write(uint16_t length, const uint8_t* data);
+  void coreInitialized();
+  // Returns 0 once closed and the pending events given to the stack, 1 if
+  // it was closed already or the NFCC did not take the mode, -1 if the
+  // callback thread could not be stopped.
+  int close(int nfcMode);
+  int powerCycle();
+
+  // Event for the stack, from any thread.
+  void postEvent(uint8_t event, uint8_t status);
+
+  // Mode the NFCC is left in when the service goes away, from the
+  // configuration the front end reads in getConfig.
+  void setNfcMode(int nfcMode) { mNfcMode = nfcMode; }
+  int nfcMode() const { return mNfcMode; }
+
+  // Version string of the front end that opened the HAL last.
+  const char* name() const { return mName; }
+  void dump(int fd);
+
+ private:
+  HalFrontEnd();
+  HalFrontEnd(const HalFrontEnd&) = delete;
+  HalFrontEnd& operator=(const HalFrontEnd&) = delete;
+
+  static void* callbackThread(void* arg);
+  static void postCallback(nfc_event_t event, nfc_status_t status);
+  int startCallbackThread();
+  int endCallbackThread();
+  bool beginWrite();
+  void endWrite();
+  void setClosed();
+
+  // Serializes open, close, coreInitialized and powerCycle.
+  pthread_mutex_t mMutex;
+  std::atomic<bool> mClosed;
+  std::atomic<int> mWriters;
+  st21nfc_dev_t mDev;
+  // Started by open, stopped by close once the HAL wrapper is closed.
+  pthread_t mCallbackThread;
+  bool mCallbackThreadRunning;
+  HalCallbackQueue mCallbacks;
+  std::atomic<int> mNfcMode;
+  std::atomic<const char*> mName;
+};
@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+
+#define HAL_FW_TRACE_FILE_NAME "/st21nfc_fw_trace.bin"
+
+/*
+ * Trace file: a ring of HAL_FW_TRACE_BLOCK_SIZE blocks, block seq at offset
+ * (seq % number of blocks) * HAL_FW_TRACE_BLOCK_SIZE. A block is a
+ * HalFwTraceBlockHeader then used bytes of records, a record being the
+ * CLOCK_REALTIME time of the event in us (8 bytes), the payload length
+ * (2 bytes), its HalFwTraceKind (1 byte) and the payload: the frame as
+ * read from or written to the NFCC, or the wrapper states before and after
+ * a change. Records do not straddle blocks. Little endian, as the devices
+ * and hosts it is read on. The sessions number the HAL opens.
+ */
+#define HAL_FW_TRACE_MAGIC 0x54465453  // "STFT"
+#define HAL_FW_TRACE_VERSION 2
+#define HAL_FW_TRACE_BLOCK_SIZE 4096
+#define HAL_FW_TRACE_RECORD_HEADER_SIZE 11
+
+enum HalFwTraceKind {
+  HAL_FW_TRACE_KIND_FW,     // PROP_FW_DBG_NTF
+  HAL_FW_TRACE_KIND_RX,     // other frames from the NFCC
+  HAL_FW_TRACE_KIND_TX,     // frames to the NFCC
+  HAL_FW_TRACE_KIND_STATE,  // hal_wrapper_state_e from, to
+};
+
+struct HalFwTraceBlockHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t used;
+  uint32_t seq;
+  uint32_t session;
+};
+
+/* Frames queued between the I/O thread and the writer, in bytes. */
+#define HAL_FW_TRACE_QUEUE_SIZE (64 * 1024)
+
+/*
+ * Capture of the FW debug traces (PROP_FW_DBG_NTF, 6f 02) of one
+ * controller to the trace file of the HAL storage directory
+ * (STNFC_FW_TRACE_CAPTURE, off by default, STNFC_FW_TRACE_FILE_SIZE).
+ *
+ * The I/O thread classifies the frames as they are read and copies the
+ * traces to a queue, dropping them when it is full; they are neither logged
+ * nor given to the NFC stack, unless observe mode makes polling loop frames
+ * of them. With STNFC_FW_TRACE_NCI, the other frames in both directions,
+ * only the header of the data packets, and the wrapper state changes are
+ * recorded too. The queue is not lock free: its producers, the I/O thread
+ * and the worker recording the state changes, share a mutex held for the
+ * copy only. A writer thread of low priority (HalThreads::ROLE_FW_TRACE,
+ * "nice:10" by default) consumes it without that mutex and moves the
+ * records to the file, flushing a partial block every second and on close.
+ *
+ * On a host, st21nfc_fw_trace_decode prints the FW traces of the file and
+ * st21nfc_nci_trace analyzes the NCI traffic.
+ */
+class HalFwTrace {
+ public:
+  HalFwTrace();
+  ~HalFwTrace();
+
+  // I2C layer open, before its thread starts: reads the configuration and
+  // starts the writer if the capture is on.
+  void open();
+  // I2C layer close, after its thread stopped: writes what is queued.
+  void close();
+
+  bool enabled() const { return mEnabled.load(std::memory_order_relaxed); }
+  bool nciEnabled() const { return mNci.load(std::memory_order_relaxed); }
+  static bool isTrace(const uint8_t* frame, size_t length);
+  // I/O thread: queues a copy of the FW trace for the writer. Never waits
+  // for it.
+  void capture(const uint8_t* frame, size_t length);
+  // With nciEnabled(): frame read from or written to the NFCC, and wrapper
+  // state change.
+  void captureFrame(bool tx, const uint8_t* frame, size_t length);
+  void captureState(uint8_t from, uint8_t to);
+
+ private:
+  HalFwTrace(const HalFwTrace&) = delete;
+  HalFwTrace& operator=(const HalFwTrace&) = delete;
+
+  void queue(uint8_t kind, const uint8_t* data, size_t length);
+  static void* writerThread(void* arg);
+  void run();
+  bool openFile();
+  void drain();
+  void writeBlock();
+  void queueRead(uint64_t pos, void* dst, size_t length);
+  void queueWrite(uint64_t pos, const void* src, size_t length);
+
+  std::atomic<bool> mEnabled;
+  std::atomic<bool> mNci;
+  std::string mPath;
+  uint32_t mBlocks;
+  pthread_t mWriter;
+
+  // The producers, the I/O thread and the worker for the state changes,
+  // take mProducerMutex for the copy. The writer consumes without it.
+  std::mutex mProducerMutex;
+  uint8_t mQueue[HAL_FW_TRACE_QUEUE_SIZE];
+  std::atomic<uint64_t> mHead;
+  std::atomic<uint64_t> mTail;
+
+  std::mutex mMutex;
+  std::condition_variable mCond;
+  bool mStop;  // Guarded by mMutex
+
+  // Writer thread only
+  int mFd;
+  uint32_t mSeq;
+  uint32_t mSession;
+  uint8_t mBlock[HAL_FW_TRACE_BLOCK_SIZE];
+  size_t mUsed;  // record bytes in mBlock
+  bool mDirty;   // mBlock has records not written yet
+  uint64_t mWrittenUs;
+};
@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+#include "hal_binder_calls.h"
+#include "hal_fault_injector.h"
+#include "hal_power.h"
+#include "hal_recovery.h"
+#include "hal_threads.h"
+#include "halcore.h"
+
+#define HAL_METRICS_NCI_MT_MAX 4
+#define HAL_METRICS_NCI_GID_MAX 16
+#define HAL_METRICS_WRAPPER_STATE_MAX (HAL_WRAPPER_STATE_RECOVERY + 1)
+#define HAL_METRICS_WAKEUP_BUCKETS 9
+
+/*
+ * Process wide counters and gauges of the HAL. All updates are lock-free so
+ * they can be done from the I/O thread, the HAL worker thread and the binder
+ * threads without adding contention on the data path.
+ */
+class HalMetrics {
+ public:
+  enum Counter {
+    I2C_READ_ERRORS,
+    I2C_READ_RETRIES,
+    I2C_WRITE_ERRORS,
+    I2C_WRITE_RETRIES,
+    I2C_IDLE_RESYNCS,
+    I2C_TRUNCATED_FRAMES,
+    MSG_RING_OVERFLOWS,
+    RECOVERIES,
+    ACT_TO_ACT_ERRORS,
+    OBSERVE_MODE_NTFS,
+    BUFFER_POOL_EXHAUSTED,
+    BUFFER_POOL_GROWTHS,
+    CALLBACK_QUEUE_OVERFLOWS,
+    RX_DELIVERY_ALLOCATIONS,
+    RECOVERY_FAILURES,
+    CLOCK_TRANSITIONS,
+    CLOCK_ERRORS,
+    CONFIG_READS,
+    CONFIG_SETS,
+    CONFIG_SET_BYTES,
+    CONFIG_SKIPPED,
+    CONFIG_SKIPPED_BYTES,
+    OBSERVE_MODE_LOCAL_QUERIES,
+    OBSERVE_MODE_SYNCS,
+    NCI_FRAME_CACHE_HITS,
+    NCI_FRAME_LOCAL_ACKS,
+    FW_TRACE_RECORDS,
+    FW_TRACE_DROPS,
+    FW_TRACE_WRITE_ERRORS,
+    BINDER_CALLS_QUEUED,
+    BUFFER_POOL_RX_THROTTLED,
+    BUFFER_POOL_WORKER_FAILURES,
+    COUNTER_MAX,
+  };
+
+  enum Gauge {
+    MSG_RING_DEPTH,
+    BUFFER_POOL_IN_USE,
+    BUFFER_POOL_CREATED,
+    CALLBACK_QUEUE_DEPTH,
+    BINDER_CALLS_IN_FLIGHT,
+    BUFFER_POOL_RX_IN_USE,
+    GAUGE_MAX,
+  };
+
+  // Phases of a HAL open, until the NFC stack is told it is complete.
+  enum OpenPhase {
+    OPEN_FD_INIT,      // hal_fd_init(), FW and configuration files
+    OPEN_UWB_PARAMS,   // UWB parameters library, when loaded
+    OPEN_TRANSPORT,    // I2C layer and threads
+    OPEN_NFCC_RESET,   // until the CORE_RESET_NTF of the NFCC
+    OPEN_TOTAL,        // hal_wrapper_open() to HAL_NFC_OPEN_CPLT_EVT
+    OPEN_PHASE_MAX,
+  };
+
+  enum Direction {
+    DIR_TX,
+    DIR_RX,
+    DIR_MAX,
+  };
+
+  static HalMetrics& getInstance();
+
+  void increment(Counter counter, uint64_t value = 1);
+  void setGauge(Gauge gauge, int64_t value);
+  void countFrame(Direction dir, const uint8_t* data, size_t length);
+  void countTimerFire(hal_wrapper_state_e state);
+  // One attempt of a recovery strategy. The time to recover, from the
+  // trigger, is only accounted for the attempt that brought the NFCC back.
+  void countRecovery(HalRecovery::Strategy strategy, bool recovered,
+                     uint64_t timeToRecoverUs);
+  void countFault(HalFaultInjector::Fault fault);
+  // A recovery following an injected fault, detectUs after it.
+  void countFaultRecovery(HalFaultInjector::Fault fault, uint64_t detectUs);
+  // Delay between a HAL thread being signaled and it running, sampled on
+  // the first message or event queued while it was idle.
+  void countWakeup(HalThreads::Role role, uint64_t delayUs);
+  // Time spent in a power state, and entries into it.
+  void addPowerResidency(HalPowerManager::Residency residency, uint64_t us);
+  void countPowerEntry(HalPowerManager::Residency residency);
+  void countOpenPhase(OpenPhase phase, uint64_t us);
+  // A call of the NFC stack: time waiting for its turn, and running.
+  void countBinderCall(HalBinderCalls::Call call, uint64_t waitUs,
+                       uint64_t runUs);
+
+  uint64_t get(Counter counter) const;
+  int64_t getGauge(Gauge gauge) const;
+  int64_t getGaugeMax(Gauge gauge) const;
+
+  void dump(int fd);
+
+ private:
+  HalMetrics();
+  HalMetrics(const HalMetrics&) = delete;
+  HalMetrics& operator=(const HalMetrics&) = delete;
+
+  std::atomic<uint64_t> mCounters[COUNTER_MAX];
+  std::atomic<int64_t> mGauges[GAUGE_MAX];
+  std::atomic<int64_t> mGaugesMax[GAUGE_MAX];
+  std::atomic<uint64_t> mFrames[DIR_MAX][HAL_METRICS_NCI_MT_MAX]
+                               [HAL_METRICS_NCI_GID_MAX];
+  std::atomic<uint64_t> mBytes[DIR_MAX][HAL_METRICS_NCI_MT_MAX]
+                              [HAL_METRICS_NCI_GID_MAX];
+  std::atomic<uint64_t> mTimerFires[HAL_METRICS_WRAPPER_STATE_MAX];
+  std::atomic<uint64_t> mRecoveryAttempts[HalRecovery::STRATEGY_MAX];
+  std::atomic<uint64_t> mRecoverySuccesses[HalRecovery::STRATEGY_MAX];
+  std::atomic<uint64_t> mRecoveryTimeLastUs[HalRecovery::STRATEGY_MAX];
+  std::atomic<uint64_t> mRecoveryTimeMaxUs[HalRecovery::STRATEGY_MAX];
+  std::atomic<uint64_t> mRecoveryTimeTotalUs[HalRecovery::STRATEGY_MAX];
+  std::atomic<uint64_t> mFaultHits[HalFaultInjector::FAULT_MAX];
+  std::atomic<uint64_t> mFaultRecoveries[HalFaultInjector::FAULT_MAX];
+  std::atomic<uint64_t> mFaultDetectLastUs[HalFaultInjector::FAULT_MAX];
+  std::atomic<uint64_t> mFaultDetectMaxUs[HalFaultInjector::FAULT_MAX];
+  std::atomic<uint64_t> mWakeups[HalThreads::ROLE_MAX]
+                                [HAL_METRICS_WAKEUP_BUCKETS];
+  std::atomic<uint64_t> mWakeupTotalUs[HalThreads::ROLE_MAX];
+  std::atomic<uint64_t> mWakeupMaxUs[HalThreads::ROLE_MAX];
+  std::atomic<uint64_t> mPowerResidencyUs[HalPowerManager::RESIDENCY_MAX];
+  std::atomic<uint64_t> mPowerEntries[HalPowerManager::RESIDENCY_MAX];
+  std::atomic<uint64_t> mOpenPhaseCount[OPEN_PHASE_MAX];
+  std::atomic<uint64_t> mOpenPhaseLastUs[OPEN_PHASE_MAX];
+  std::atomic<uint64_t> mOpenPhaseMaxUs[OPEN_PHASE_MAX];
+  std::atomic<uint64_t> mOpenPhaseTotalUs[OPEN_PHASE_MAX];
+  std::atomic<uint64_t> mBinderCalls[HalBinderCalls::CALL_MAX];
+  std::atomic<uint64_t> mBinderWaitTotalUs[HalBinderCalls::CALL_MAX];
+  std::atomic<uint64_t> mBinderWaitMaxUs[HalBinderCalls::CALL_MAX];
+  std::atomic<uint64_t> mBinderRunTotalUs[HalBinderCalls::CALL_MAX];
+  std::atomic<uint64_t> mBinderRunMaxUs[HalBinderCalls::CALL_MAX];
+};
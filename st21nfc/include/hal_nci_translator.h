@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <mutex>
+
+// Largest NCI frame, header included: size of the translation buffers.
+#define HAL_NCI_MAX_FRAME_SIZE (255 + 3)
+// Exit frames and polling loop annotations kept built.
+#define HAL_NCI_FRAME_CACHE_SIZE 4
+
+/*
+ * Translation of the Android NCI extensions (2f 0c) sent by the stack into
+ * the ST proprietary or standard commands understood by the FW, and of the
+ * NFCC responses back into the Android format.
+ *
+ * Each rule of the table pairs a command translation with the rewriting of
+ * its response and applies to a FW observe mode variant. The response
+ * expected next is the only state kept; the NCI stack waits for a response
+ * before sending the next command so a single slot is enough. Translations
+ * work on caller provided buffers and can run concurrently. There is one
+ * translator per controller, in its HalWrapperContext.
+ *
+ * The frames of the exit frame and polling loop annotation rules are kept
+ * built, keyed by a hash of the Android command, as the stack sends the same
+ * ones again on each screen or wallet state change. The one the NFCC
+ * accepted last for each rule is tracked until it is reset: the same
+ * command is then acknowledged by the HAL without being sent.
+ */
+class HalNciTranslator {
+ public:
+  struct CommandResult {
+    bool setsObserveMode;
+    uint8_t observeMode;  // technologies to observe, if setsObserveMode
+    // The NFCC holds the frame already: out is the response to give back
+    // to the stack instead.
+    bool installed;
+  };
+
+  struct ObserveState {
+    uint8_t observeMode;  // corrected from the state reported by the FW
+    bool suspended;
+  };
+
+  // Returns the length of the frame written to out, 0 if cmd is not an
+  // Android extension with a rule and goes down as is, -1 if malformed.
+  // fwObserveMode is hal_fd_getFwCap()->ObserveMode.
+  int translateCommand(const uint8_t* cmd, size_t length,
+                       uint8_t fwObserveMode, uint8_t* out, size_t outSize,
+                       CommandResult* result);
+
+  // Rewrites in place the response to the last translated command and
+  // updates length. Returns false, leaving rsp untouched, for any other frame.
+  bool translateResponse(uint8_t* rsp, uint16_t* length, ObserveState* state);
+
+  // The frame of the last translated command could not be sent: forget the
+  // response it awaits.
+  void abortCommand();
+
+  // Forget the awaited response, when the HAL is (re)opened.
+  void reset();
+  // CORE_RESET_NTF: the NFCC has lost the frames it was given.
+  void onNfccReset();
+
+  HalNciTranslator();
+
+  struct Rule;
+
+ private:
+  struct CachedFrame {
+    bool valid;
+    bool installed;  // accepted by the NFCC since its last reset
+    uint8_t rule;    // index in the rule table
+    uint32_t hash;
+    uint32_t lastUse;
+    uint16_t cmdLength;
+    uint16_t frameLength;
+    uint8_t cmd[HAL_NCI_MAX_FRAME_SIZE];
+    uint8_t frame[HAL_NCI_MAX_FRAME_SIZE];
+  };
+
+  HalNciTranslator(const HalNciTranslator&) = delete;
+  HalNciTranslator& operator=(const HalNciTranslator&) = delete;
+
+  int translateCached(size_t index, const uint8_t* cmd, size_t length,
+                      uint8_t* out, size_t outSize, CommandResult* result);
+  void onCachedResponse(uint8_t rule, uint8_t status);
+
+  std::atomic<uint8_t> mPendingRule;  // index in the rule table + 1
+
+  std::mutex mCacheMutex;
+  // Guarded by mCacheMutex
+  CachedFrame mCache[HAL_NCI_FRAME_CACHE_SIZE];
+  uint32_t mCacheClock;
+  int mPendingFrame;  // entry sent, awaiting its response, -1 if none
+};
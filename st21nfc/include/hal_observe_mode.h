@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <mutex>
+
+#include "hal_nci_translator.h"
+
+/*
+ * Observe mode state of one controller, as the FW holds it: the observed
+ * technologies (CORE_GET_CONFIG 0xa3 value, or the RF_xxx_LISTEN_OBSERVE_
+ * MODE_STATE mask of the per technology FW variant) and whether the FW has
+ * suspended it (PROP_RF_OBSERVE_MODE_SUSPENDED_NTF / _RESUMED_NTF).
+ *
+ * The state is committed by the responses to the set commands, and resynced
+ * from the NFCC by the responses to the queries. Once it is known, the
+ * Android query (2f 0c 01 04) is answered by the HAL worker thread without
+ * an NFCC round-trip. It is forgotten on CORE_RESET_NTF, on a failed set or
+ * on a forced resync, and may be resynced periodically
+ * (STNFC_OBSERVE_MODE_RESYNC_MS, 0 by default: never): the next query then
+ * goes to the NFCC.
+ */
+class HalObserveMode {
+ public:
+  HalObserveMode();
+
+  // HAL open: reads the configuration, the state is unknown.
+  void open();
+  // CORE_RESET_NTF: the FW may have lost its state.
+  void onReset();
+  // Forces the next query to the NFCC.
+  void requestResync();
+
+  // Set command translated for the stack, awaiting its response. Polling
+  // loop frames are filtered from now on, as the FW starts sending them
+  // before the response.
+  void onSetCommand(uint8_t techs);
+  // The set command could not be queued: back to the state before it.
+  void onSetCommandNotSent();
+  // Translated response of a set command or a query, 4f 0c. fw is the
+  // state the translator worked with, corrected from the query response.
+  void onResponse(const uint8_t* rsp, size_t length,
+                  const HalNciTranslator::ObserveState& fw);
+  HalNciTranslator::ObserveState state();
+
+  void onSuspended();
+  void onResumed();
+  // PROP_RF_POLLING_LOOP_NTF: true if it is to be reported as Android
+  // polling loop frames. The first one after a suspension is, then the FW
+  // is considered suspended.
+  bool takePollingLoopFrame();
+  // I/O thread: true if PROP_RF_POLLING_LOOP_NTF may be reported, for the
+  // FW debug trace capture to pass it on.
+  bool wantsPollingLoopFrames();
+
+  // True for the Android observe mode query.
+  static bool isQuery(const uint8_t* cmd, size_t length);
+  // Writes the response to the query to rsp and returns its length if the
+  // state is known and fresh, else 0.
+  size_t answerQuery(uint8_t* rsp, size_t size);
+
+ private:
+  HalObserveMode(const HalObserveMode&) = delete;
+  HalObserveMode& operator=(const HalObserveMode&) = delete;
+
+  void forget();
+
+  std::mutex mMutex;
+  uint64_t mResyncUs;  // 0: no periodic resync
+
+  // Guarded by mMutex
+  bool mKnown;
+  uint8_t mTechs;
+  bool mSetPending;
+  uint8_t mPendingTechs;
+  bool mSuspended;
+  bool mSuspendPending;  // suspended after the next polling loop frame
+  uint64_t mSyncedUs;    // last state confirmed by the NFCC
+  // Pending and suspension state before the last set command
+  bool mPrevSetPending;
+  uint8_t mPrevPendingTechs;
+  bool mPrevSuspended;
+  bool mPrevSuspendPending;
+};
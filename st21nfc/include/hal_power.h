@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <mutex>
+
+/*
+ * Power state of one controller: screen and lock state of the last
+ * CORE_SET_POWER_SUB_STATE_CMD, NFCC clock when the HAL controls it
+ * (STNFC_CONTROL_CLK), and reader/writer link activity for the active RW
+ * timer (STNFC_ACTIVERW_TIMER).
+ *
+ * The clock follows the screen: on when it turns on, off when it turns off.
+ * Transitions are done on the HAL worker thread as the command goes by, so
+ * they are in place before the I/O thread writes it, and checked against the
+ * state the driver reports. The known clock state is cached, the driver is
+ * only queried to check a transition.
+ *
+ * The time spent in each state is added to the metrics on every change, and
+ * on flush() for the current one.
+ */
+class HalPowerManager {
+ public:
+  enum Residency {
+    OFF,  // HAL closed
+    SCREEN_ON_UNLOCKED,
+    SCREEN_OFF_UNLOCKED,
+    SCREEN_ON_LOCKED,
+    SCREEN_OFF_LOCKED,
+    CLOCK_ON,   // NFCC clock enabled, along with the above
+    ACTIVE_RW,  // reader/writer link active, along with the above
+    RESIDENCY_MAX,
+  };
+
+  HalPowerManager();
+
+  // HAL open on the device fid: reads the configuration, the clock is
+  // stopped if the HAL controls it and the NFCC starts screen on, unlocked.
+  void open(int fid);
+  void close();
+
+  // Command on its way to the NFCC, from the HAL worker thread.
+  void onCommand(const uint8_t* data, size_t length);
+  // CORE_SET_POWER_SUB_STATE_RSP, from the HAL worker thread. True if the
+  // active RW timer is to be started, the screen going off while a
+  // reader/writer link is active.
+  bool onSubStateResponse(const uint8_t* data, size_t length);
+
+  void setActiveRW(bool active);
+  bool activeRW();
+
+  bool controlsClock() const { return mControlClock; }
+  // Clock state reported by the driver, -1 if it cannot tell.
+  int readClockState();
+
+  // Adds the time spent in the current states to the metrics.
+  void flush();
+
+  static const char* residencyName(Residency residency);
+
+ private:
+  HalPowerManager(const HalPowerManager&) = delete;
+  HalPowerManager& operator=(const HalPowerManager&) = delete;
+
+  void account();
+  bool setClock(bool enable);
+
+  std::mutex mMutex;
+  int mFid;
+  bool mControlClock;
+  bool mActiveRwTimer;
+
+  // Guarded by mMutex
+  Residency mScreen;
+  int mClock;  // -1 unknown, 0 off, 1 on
+  bool mActiveRW;
+  uint64_t mSinceUs;
+
+  // Sub-state of the command awaiting its response, 0xFF if none. HAL
+  // worker thread only.
+  uint8_t mPendingSubState;
+};
@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "halcore.h"
+
+#define HAL_RECOVERY_NCI_MAX_SIZE 258
+
+/* Bound of each strategy, in ms, up to the NFCC answer. */
+#define HAL_RECOVERY_RETRY_TIMEOUT 1000
+#define HAL_RECOVERY_RF_DEACTIVATE_TIMEOUT 500
+#define HAL_RECOVERY_SOFT_RESET_TIMEOUT 500
+#define HAL_RECOVERY_RESET_PULSE_TIMEOUT 1000
+#define HAL_RECOVERY_COLD_RESET_TIMEOUT 2000
+/* Wait for the RF_DEACTIVATE_NTF of an active link, in ms. */
+#define HAL_RECOVERY_RF_SETTLE_TIMEOUT 50
+
+/*
+ * Escalating recovery of an NFCC that stopped answering, run on the HAL
+ * worker thread while the wrapper is in HAL_WRAPPER_STATE_RECOVERY. Each
+ * strategy is bounded by the wrapper timer and only succeeds once the NFCC
+ * answered; on timeout the next one is tried:
+ *   RETRY_COMMAND  send the last command again, the NFCC state is kept
+ *   RF_DEACTIVATE  RF_DEACTIVATE_CMD(idle) then the last RF_DISCOVER_CMD of
+ *                  the stack, the NCI state is kept
+ *   SOFT_RESET     CORE_RESET_CMD, up to the CORE_RESET_NTF
+ *   RESET_PULSE    reset line pulse, up to the CORE_RESET_NTF
+ *   COLD_RESET     cold_reset() of the persist.vendor.nfc.streset library,
+ *                  up to the CORE_RESET_NTF
+ * Strategies that do not apply (nothing to retry, no discovery running, no
+ * reset library) are skipped. What the wrapper does of the outcome, resume
+ * or hand a CORE_RESET_NTF to the stack, is up to the trigger state.
+ */
+class HalRecovery {
+ public:
+  enum Strategy {
+    RETRY_COMMAND,
+    RF_DEACTIVATE,
+    SOFT_RESET,
+    RESET_PULSE,
+    COLD_RESET,
+    STRATEGY_MAX,
+  };
+
+  // Outcome of a frame or a timer expiry while recovering.
+  enum Action {
+    // Handled, the recovery goes on. Other frames are dropped.
+    CONSUMED,
+    // Frame to pass to the stack, as the RF_DEACTIVATE_NTF of a link.
+    FORWARD,
+    // The NFCC answered and kept its state, the frame is consumed.
+    RESUMED,
+    // The NFCC answered and kept its state, the frame is the response to
+    // the retried command and is for the trigger state.
+    REPLAY,
+    // The NFCC restarted, the frame is its CORE_RESET_NTF.
+    RESET,
+    // No strategy brought the NFCC back.
+    FAILED,
+  };
+
+  HalRecovery();
+
+  // Start from first, or the next strategy that applies. origin is the
+  // wrapper state of the trigger, reason the one of the CORE_RESET_NTF the
+  // stack gets should the NFCC be reset.
+  Action start(HALHANDLE hHAL, Strategy first, hal_wrapper_state_e origin,
+               uint8_t reason);
+  Action onFrame(uint8_t* data, uint16_t length);
+  Action onTimeout();
+  void reset();
+
+  // Commands seen on the way to the NFCC, as material for RETRY_COMMAND and
+  // RF_DEACTIVATE. Ignored while recovering.
+  void noteCommand(const uint8_t* data, size_t length);
+
+  bool active() const { return mActive; }
+  Strategy strategy() const { return mStrategy; }
+  hal_wrapper_state_e origin() const { return mOrigin; }
+  uint8_t reason() const { return mReason; }
+
+  static const char* strategyName(Strategy strategy);
+
+  // cold_reset() of the persist.vendor.nfc.streset library, false if there
+  // is none.
+  static bool coldReset();
+
+ private:
+  enum Phase {
+    PHASE_WAIT_RSP,
+    PHASE_WAIT_RF_SETTLE,
+    PHASE_WAIT_DISCOVER_RSP,
+    PHASE_WAIT_RESET_NTF,
+  };
+
+  HalRecovery(const HalRecovery&) = delete;
+  HalRecovery& operator=(const HalRecovery&) = delete;
+
+  bool applies(int strategy) const;
+  bool attempt(int strategy);
+  Action tryFrom(int strategy);
+  Action escalate();
+  Action succeed(Action action);
+  void sendDiscover();
+
+  bool mActive;
+  HALHANDLE mHalHandle;
+  Strategy mStrategy;
+  Phase mPhase;
+  hal_wrapper_state_e mOrigin;
+  uint8_t mReason;
+  struct timespec mStart;
+  uint8_t mRsp[2];  // octets 0 and 1 of the awaited response
+
+  Strategy mLastRecovered;
+  struct timespec mLastRecoveredAt;
+
+  uint8_t mLastCommand[HAL_RECOVERY_NCI_MAX_SIZE];
+  size_t mLastCommandLength;
+  uint8_t mLastDiscover[HAL_RECOVERY_NCI_MAX_SIZE];
+  size_t mLastDiscoverLength;
+};
@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Top of the stack of a HAL thread faulted in and locked, in bytes. */
+#define HAL_THREAD_STACK_LOCK_SIZE (64 * 1024)
+
+/*
+ * Creation of the HAL threads with the scheduling of the HAL configuration,
+ * per role:
+ *   STNFC_THREAD_<ROLE>_SCHED  "fifo:<prio>", "rr:<prio>" or "nice:<n>"
+ *   STNFC_THREAD_<ROLE>_CPUS   CPU affinity mask, 0 for any
+ * with <ROLE> one of IO, WORKER, CALLBACK, FW_TRACE (nice:10 if unset).
+ * STNFC_THREAD_MLOCK=1 locks the top of their stacks and preallocates and
+ * locks the frame buffers, so that the data path does not page fault. A
+ * setting the kernel refuses is logged and the thread runs with the default.
+ */
+class HalThreads {
+ public:
+  enum Role {
+    ROLE_IO,        // I2C reads and writes, adaptation/i2clayer.cc
+    ROLE_WORKER,    // HalCore and wrapper, hal/halcore.cc
+    ROLE_CALLBACK,  // events to the NFC stack, service front ends
+    ROLE_FW_TRACE,  // FW debug trace writer, hal/hal_fw_trace.cc
+    ROLE_MAX,
+  };
+
+  // pthread_create() of a named thread running start(arg) with the
+  // scheduling of role.
+  static int create(pthread_t* thread, Role role, void* (*start)(void*),
+                    void* arg);
+
+  static bool memoryLocked();
+  // Locks a buffer in memory if STNFC_THREAD_MLOCK is set, unlock before
+  // freeing it.
+  static void lockBuffer(const void* addr, size_t length);
+  static void unlockBuffer(const void* addr, size_t length);
+
+  // Monotonic clock, for the wakeup delays of the metrics.
+  static uint64_t nowUs();
+
+  static const char* roleName(Role role);
+};
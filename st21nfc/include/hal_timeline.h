@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <mutex>
+#include <string>
+
+#include "halcore.h"
+
+#define HAL_TIMELINE_MAX_SPANS 1024
+#define HAL_TIMELINE_NAME_SIZE 48
+#define HAL_TIMELINE_ARGS_SIZE 64
+
+/*
+ * Bounded record of the wrapper state machine activity: wrapper states,
+ * wrapper timers and NCI command/response round trips are kept as spans and
+ * exported in the Chrome trace-event JSON format (chrome://tracing, Perfetto).
+ * Once the buffer is full, the oldest spans are overwritten.
+ */
+class HalTimeline {
+ public:
+  enum Track {
+    TRACK_STATE = 1,
+    TRACK_TIMER,
+    TRACK_NCI,
+  };
+
+  static HalTimeline& getInstance();
+  void initialize();
+
+  void stateChange(hal_wrapper_state_e from, hal_wrapper_state_e to);
+  void timerStart(const std::string& activity, uint32_t duration);
+  void timerStop(const char* reason);
+  void commandSent(const uint8_t* data, size_t length);
+  void responseReceived(const uint8_t* data, size_t length, bool local);
+
+  void dump(int fd);
+  void exportToFile();
+
+ private:
+  struct Span {
+    uint64_t startUs;
+    uint64_t durUs;
+    uint8_t track;
+    char name[HAL_TIMELINE_NAME_SIZE];
+    char args[HAL_TIMELINE_ARGS_SIZE];
+  };
+
+  struct OpenSpan {
+    bool active;
+    uint64_t startUs;
+    char name[HAL_TIMELINE_NAME_SIZE];
+    char args[HAL_TIMELINE_ARGS_SIZE];
+  };
+
+  HalTimeline();
+  HalTimeline(const HalTimeline&) = delete;
+  HalTimeline& operator=(const HalTimeline&) = delete;
+
+  void openLocked(OpenSpan& open, uint64_t now, const char* name,
+                  const char* args);
+  void closeLocked(OpenSpan& open, uint8_t track, uint64_t now,
+                   const char* extraArgs);
+  std::string toJsonLocked();
+
+  std::mutex mMutex;
+  Span mSpans[HAL_TIMELINE_MAX_SPANS];
+  size_t mHead;
+  size_t mCount;
+  uint64_t mDropped;
+
+  OpenSpan mState;
+  OpenSpan mTimer;
+  OpenSpan mCommand;
+  uint16_t mCommandId;
+
+  bool mExportEnabled;
+  std::string mExportPath;
+};
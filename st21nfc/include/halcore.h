@@ -55,7 +55,6 @@ typedef enum {
   HAL_WRAPPER_STATE_UPDATE,
   HAL_WRAPPER_STATE_APPLY_CUSTOM_PARAM,
   HAL_WRAPPER_STATE_APPLY_UWB_PARAM,
-  HAL_WRAPPER_STATE_SET_ACTIVERW_TIMER,
   HAL_WRAPPER_STATE_APPLY_PROP_CONFIG,
   HAL_WRAPPER_STATE_RECOVERY,
 } hal_wrapper_state_e;
@@ -72,8 +71,11 @@ HALHANDLE HalCreate(void* context, HAL_CALLBACK callback, uint32_t flags);
 
 void HalDestroy(HALHANDLE hHAL);
 
-/* send an NCI frame from the HOST to the CLF */
+/* send an NCI frame from the HOST to the CLF, waiting for a buffer if none
+ * is left, except on the HAL worker thread which then fails */
 bool HalSendDownstream(HALHANDLE hHAL, const uint8_t* data, size_t size);
+/* same, but fails instead of waiting when no buffer is left */
+bool HalTrySendDownstream(HALHANDLE hHAL, const uint8_t* data, size_t size);
 
 // HAL WRAPPER
 bool HalSendDownstreamTimer(HALHANDLE hHAL, const uint8_t* data, size_t size,
@@ -83,6 +85,8 @@ bool HalSendDownstreamStopTimer(HALHANDLE hHAL);
 
 /* send a complete HDLC frame from the CLF to the HOST */
 bool HalSendUpstream(HALHANDLE hHAL, const uint8_t* data, size_t size);
+/* same, but fails instead of waiting when no buffer is left */
+bool HalTrySendUpstream(HALHANDLE hHAL, const uint8_t* data, size_t size);
 
 void hal_wrapper_set_state(hal_wrapper_state_e new_wrapper_state);
 void hal_wrapper_setFwLogging(bool enable);
@@ -1,6 +1,6 @@
 #include <sys/ioctl.h>
 
 #define ST21NFC_MAGIC 0xEA
+#define ST21NFC_CLK_ENABLE _IOR(ST21NFC_MAGIC, 0x11, unsigned int)
+#define ST21NFC_CLK_DISABLE _IOR(ST21NFC_MAGIC, 0x12, unsigned int)
 #define ST21NFC_CLK_STATE _IOR(ST21NFC_MAGIC, 0x13, unsigned int)
-
-extern int fidI2c;
\ No newline at end of file
@@ -0,0 +1,434 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Checks of HalNciTranslator::translateCommand() against the code the rule
+// table replaced: the frame sent down and the observe mode given to the
+// wrapper must match byte for byte, for every rule and FW observe mode
+// variant.
+
+#include <gtest/gtest.h>
+#include <string.h>
+
+#include <algorithm>
+#include <iterator>
+#include <random>
+#include <vector>
+
+#include "hal_crc.h"
+#include "hal_nci_translator.h"
+
+// FW observe mode variants: CORE_xxx_CONFIG(0xa3), RF_xxx_LISTEN_OBSERVE
+static const uint8_t kFwObserveModes[] = {1, 2};
+
+/*
+ * Translation of the 2f 0c commands as StNfc_hal_write() did it before the
+ * rule table, kept as reference. Returns the length of the frame sent down,
+ * 0 if cmd went down as is. *observeMode is set to the mode given to the
+ * wrapper, -1 if none.
+ */
+static int TranslateReference(const uint8_t* p_data, uint16_t data_len,
+                              uint8_t fwObserveMode, uint8_t* nci_cmd,
+                              int* observeMode) {
+  uint8_t NCI_ANDROID_PASSIVE_OBSERVER_PREFIX[] = {0x2f, 0x0c, 0x02, 0x02};
+  uint8_t NCI_ANDROID_PASSIVE_OBSERVER_PER_TECH_PREFIX[] = {0x2f, 0x0c, 0x02,
+                                                            0x05};
+  uint8_t NCI_QUERY_ANDROID_PASSIVE_OBSERVER_PREFIX[] = {0x2f, 0x0c, 0x01, 0x4};
+  uint8_t NCI_ANDROID_PREFIX[] = {0x2f, 0x0c};
+  uint8_t RF_GET_LISTEN_OBSERVE_MODE_STATE[5] = {0x21, 0x17, 0x00};
+  uint8_t RF_SET_LISTEN_OBSERVE_MODE_STATE[4] = {0x21, 0x16, 0x01, 0x0};
+  uint8_t CORE_GET_CONFIG_OBSERVER[5] = {0x20, 0x03, 0x02, 0x01, 0xa3};
+  uint8_t CORE_SET_CONFIG_OBSERVER[7] = {0x20, 0x02, 0x04, 0x01,
+                                         0xa3, 0x01, 0x00};
+  uint8_t mTechObserved = 0x0;
+
+  *observeMode = -1;
+  if (data_len == 4 &&
+      !memcmp(p_data, NCI_QUERY_ANDROID_PASSIVE_OBSERVER_PREFIX,
+              sizeof(NCI_QUERY_ANDROID_PASSIVE_OBSERVER_PREFIX))) {
+    if (fwObserveMode == 2) {
+      memcpy(nci_cmd, RF_GET_LISTEN_OBSERVE_MODE_STATE, 3);
+      return 3;
+    }
+    memcpy(nci_cmd, CORE_GET_CONFIG_OBSERVER, 5);
+    return 5;
+  } else if (data_len == 5 &&
+             !memcmp(p_data, NCI_ANDROID_PASSIVE_OBSERVER_PREFIX,
+                     sizeof(NCI_ANDROID_PASSIVE_OBSERVER_PREFIX))) {
+    if (fwObserveMode == 2) {
+      if (p_data[4]) {
+        mTechObserved = 0x7;
+      }
+      RF_SET_LISTEN_OBSERVE_MODE_STATE[3] = mTechObserved;
+      *observeMode = mTechObserved;
+      memcpy(nci_cmd, RF_SET_LISTEN_OBSERVE_MODE_STATE, 4);
+      return 4;
+    }
+    CORE_SET_CONFIG_OBSERVER[6] = p_data[4];
+    *observeMode = p_data[4];
+    memcpy(nci_cmd, CORE_SET_CONFIG_OBSERVER, 7);
+    return 7;
+  } else if (data_len == 5 &&
+             !memcmp(p_data, NCI_ANDROID_PASSIVE_OBSERVER_PER_TECH_PREFIX,
+                     sizeof(NCI_ANDROID_PASSIVE_OBSERVER_PER_TECH_PREFIX))) {
+    if (p_data[4]) {
+      mTechObserved = p_data[4];
+    }
+    RF_SET_LISTEN_OBSERVE_MODE_STATE[3] = mTechObserved;
+    *observeMode = mTechObserved;
+    memcpy(nci_cmd, RF_SET_LISTEN_OBSERVE_MODE_STATE, 4);
+    return 4;
+  } else if (!memcmp(p_data, NCI_ANDROID_PREFIX, sizeof(NCI_ANDROID_PREFIX)) &&
+             p_data[3] == 0x6) {
+    memcpy(nci_cmd + 3, p_data + 4, 4);
+    nci_cmd[0] = 0x2f;
+    nci_cmd[1] = 0x19;
+
+    int index = 8;
+    int ll_index = 7;
+    uint16_t crc = 0;
+    bool prefix_match = false;
+    bool exact_match = true;
+
+    while (index < data_len) {
+      int tlv_len = p_data[index + 1];
+      prefix_match = false;
+      exact_match = true;
+      if (p_data[index] == 0x01) {
+        crc = iso14443_crc(p_data + index + 3, (uint8_t)((tlv_len - 1) / 2),
+                           Type_B);
+      } else if ((p_data[index] & 0xF0) == 0x00) {
+        crc = iso14443_crc(p_data + index + 3, (uint8_t)((tlv_len - 1) / 2),
+                           Type_A);
+      } else {
+        prefix_match = true;
+      }
+
+      nci_cmd[ll_index++] = p_data[index++];
+      nci_cmd[ll_index++] =
+          (!prefix_match) ? p_data[index++] + 4 : p_data[index++];
+      nci_cmd[ll_index++] = p_data[index++];
+
+      memcpy(nci_cmd + ll_index, p_data + index, (uint8_t)((tlv_len - 1) / 2));
+      ll_index += (tlv_len - 1) / 2;
+      index += (tlv_len - 1) / 2;
+      int crc_index = 0;
+      if (!prefix_match) {
+        crc_index = ll_index;
+        nci_cmd[ll_index++] = (uint8_t)crc;
+        nci_cmd[ll_index++] = (uint8_t)(crc >> 8);
+      }
+
+      memcpy(nci_cmd + ll_index, p_data + index, (tlv_len - 1) / 2);
+      for (int i = 0; i < (tlv_len - 1) / 2; ++i) {
+        if (p_data[index + i] != 0xFF) {
+          exact_match = false;
+          break;
+        }
+      }
+      ll_index += (tlv_len - 1) / 2;
+      index += (tlv_len - 1) / 2;
+      uint8_t crc_mask = exact_match ? 0xFF : 0x00;
+      if (!prefix_match) {
+        nci_cmd[ll_index++] = crc_mask;
+        nci_cmd[ll_index++] = crc_mask;
+
+        if (!exact_match) {
+          nci_cmd[crc_index] = crc_mask;
+          nci_cmd[crc_index + 1] = crc_mask;
+        }
+      }
+    }
+    nci_cmd[2] = ll_index - 3;
+    return ll_index;
+  } else if (!memcmp(p_data, NCI_ANDROID_PREFIX, sizeof(NCI_ANDROID_PREFIX)) &&
+             p_data[3] == 0x9) {
+    memcpy(nci_cmd + 3, p_data + 4, data_len - 4);
+    nci_cmd[0] = 0x2f;
+    nci_cmd[1] = 0x1d;
+    if (p_data[2] == 0x2 && p_data[4] == 0x0) {
+      nci_cmd[2] = 0x1;
+    } else {
+      uint16_t crc = 0;
+      if (nci_cmd[5] > 0) {
+        crc = iso14443_crc(nci_cmd + 7, nci_cmd[5] - 1, Type_A);
+      }
+      nci_cmd[5] = nci_cmd[5] + 2;
+      nci_cmd[data_len - 1] = (uint8_t)crc;
+      nci_cmd[data_len] = (uint8_t)(crc >> 8);
+      nci_cmd[2] = p_data[2] + 1;
+    }
+    return nci_cmd[2] + 3;
+  }
+  return 0;
+}
+
+/**
+ * Random PROP_SET_PASSIVE_OBSERVER_EXIT_FRAME command: type A, type B and
+ * prefix TLVs, exact or partial masks, some with an empty value, within the
+ * size of an NCI frame once translated.
+ * @param random Generator
+ * @param cmd Command built
+ */
+static void RandomExitFrames(std::mt19937& random, std::vector<uint8_t>* cmd) {
+  static const uint8_t kTypes[] = {0x00, 0x01, 0x02, 0x07, 0x08, 0x0f,
+                                   0x10, 0x20, 0x80, 0xff};
+  std::uniform_int_distribution<int> byte(0, 0xff);
+  size_t budget = HAL_NCI_MAX_FRAME_SIZE - 7;
+  int tlvs = std::uniform_int_distribution<int>(0, 4)(random);
+
+  *cmd = {0x2f, 0x0c, 0x00, 0x06};
+  for (int i = 0; i < 4; i++) cmd->push_back(byte(random));
+  for (int t = 0; t < tlvs; t++) {
+    uint8_t type = kTypes[byte(random) % std::size(kTypes)];
+    size_t crcLength = (type & 0xF0) == 0x00 ? 2 : 0;
+    // Value bytes left: translated, T, L, power state, value, mask and their
+    // CRC; as sent by the stack, T, L, power state, value and mask.
+    if (budget < 3 + 2 * crcLength ||
+        cmd->size() + 3 > HAL_NCI_MAX_FRAME_SIZE) {
+      break;
+    }
+    size_t room = std::min<size_t>(
+        {(budget - 3 - 2 * crcLength) / 2,
+         (HAL_NCI_MAX_FRAME_SIZE - cmd->size() - 3) / 2, 60});
+    size_t n = std::uniform_int_distribution<size_t>(0, room)(random);
+    bool exact = byte(random) & 1;
+
+    cmd->push_back(type);
+    // An empty value comes as length 0 or 1
+    cmd->push_back(n == 0 && (byte(random) & 1) ? 0 : 2 * n + 1);
+    cmd->push_back(byte(random));
+    for (size_t i = 0; i < n; i++) cmd->push_back(byte(random));
+    for (size_t i = 0; i < n; i++) {
+      cmd->push_back(exact ? 0xff : (i == 0 ? 0x0f : byte(random)));
+    }
+    budget -= 3 + 2 * (n + crcLength);
+  }
+  (*cmd)[2] = cmd->size() - 3;
+}
+
+/**
+ * PROP_SET_PASSIVE_OBSERVER_EXIT_FRAME command with a single TLV.
+ * @param type TLV type
+ * @param n Length of the value and of the mask
+ * @param mask Value of the mask bytes
+ * @return The command
+ */
+static std::vector<uint8_t> ExitFrame(uint8_t type, size_t n, uint8_t mask) {
+  std::vector<uint8_t> cmd = {0x2f, 0x0c, 0x00, 0x06, 0x00, 0x00, 0x01, 0xf4,
+                              type, (uint8_t)(2 * n + 1), 0x01};
+  for (size_t i = 0; i < n; i++) cmd.push_back(0x26 + i);
+  for (size_t i = 0; i < n; i++) cmd.push_back(mask);
+  cmd[2] = cmd.size() - 3;
+  return cmd;
+}
+
+/**
+ * PROP_RF_SET_CUST_PASSIVE_POLL_FRAME command.
+ * @param frameLength Annotation length, its first byte included
+ * @param flags First byte of the command
+ * @return The command
+ */
+static std::vector<uint8_t> PollingLoopAnnotation(size_t frameLength,
+                                                  uint8_t flags) {
+  std::vector<uint8_t> cmd = {0x2f, 0x0c, 0x00, 0x09, flags, 0x00,
+                              (uint8_t)frameLength};
+  for (size_t i = 0; i < frameLength; i++) cmd.push_back(0x52 + i);
+  cmd[2] = cmd.size() - 3;
+  return cmd;
+}
+
+/**
+ * Random PROP_RF_SET_CUST_PASSIVE_POLL_FRAME command: a type A annotation up
+ * to the NCI frame size, empty ones included, or the empty annotation
+ * clearing it.
+ * @param random Generator
+ * @param cmd Command built
+ */
+static void RandomPollingLoopAnnotation(std::mt19937& random,
+                                        std::vector<uint8_t>* cmd) {
+  std::uniform_int_distribution<int> byte(0, 0xff);
+
+  if (byte(random) < 8) {
+    *cmd = {0x2f, 0x0c, 0x02, 0x09, 0x00};
+    return;
+  }
+  size_t frameLength = std::uniform_int_distribution<size_t>(
+      0, HAL_NCI_MAX_FRAME_SIZE - 1 - 7)(random);
+  *cmd = {0x2f, 0x0c, 0x00, 0x09, (uint8_t)(byte(random) | 0x01),
+          (uint8_t)byte(random), (uint8_t)frameLength};
+  for (size_t i = 0; i < frameLength; i++) cmd->push_back(byte(random));
+  (*cmd)[2] = cmd->size() - 3;
+}
+
+/**
+ * Compares the translation of a command with the reference.
+ * @param translator Translator under test
+ * @param cmd Android command
+ * @param fwObserveMode FW observe mode variant
+ * @return Success if the frame and the observe mode given to the wrapper
+ * match
+ */
+static ::testing::AssertionResult MatchesReference(
+    HalNciTranslator& translator, const std::vector<uint8_t>& cmd,
+    uint8_t fwObserveMode) {
+  uint8_t expected[HAL_NCI_MAX_FRAME_SIZE + 2];
+  uint8_t out[HAL_NCI_MAX_FRAME_SIZE];
+  HalNciTranslator::CommandResult result;
+  int observeMode;
+
+  int expectedLength = TranslateReference(cmd.data(), cmd.size(),
+                                          fwObserveMode, expected,
+                                          &observeMode);
+  int length = translator.translateCommand(cmd.data(), cmd.size(),
+                                           fwObserveMode, out, sizeof(out),
+                                           &result);
+  if (length != expectedLength ||
+      (length > 0 && memcmp(out, expected, length) != 0) ||
+      (length > 0 && result.setsObserveMode != (observeMode >= 0)) ||
+      (length > 0 && result.setsObserveMode &&
+       result.observeMode != observeMode)) {
+    ::testing::AssertionResult failure = ::testing::AssertionFailure();
+    failure << "FW mode " << (int)fwObserveMode << ", command";
+    for (uint8_t b : cmd) failure << " " << std::hex << (int)b;
+    return failure;
+  }
+  return ::testing::AssertionSuccess();
+}
+
+/**
+ * Translation of a command the reference sent with a wrapped NCI length:
+ * it must be rejected.
+ * @param translator Translator under test
+ * @param cmd Android command
+ * @param fwObserveMode FW observe mode variant
+ * @return true if rejected
+ */
+static bool Rejected(HalNciTranslator& translator,
+                     const std::vector<uint8_t>& cmd, uint8_t fwObserveMode) {
+  uint8_t out[HAL_NCI_MAX_FRAME_SIZE];
+  HalNciTranslator::CommandResult result;
+
+  return translator.translateCommand(cmd.data(), cmd.size(), fwObserveMode,
+                                     out, sizeof(out), &result) < 0;
+}
+
+TEST(NciTranslatorTest, ObserveModeCommands) {
+  HalNciTranslator translator;
+
+  for (uint8_t fwObserveMode : kFwObserveModes) {
+    EXPECT_TRUE(MatchesReference(translator, {0x2f, 0x0c, 0x01, 0x04},
+                                 fwObserveMode));
+    for (int value = 0; value <= 0xff; value++) {
+      for (uint8_t subOid : {0x02, 0x05}) {
+        EXPECT_TRUE(MatchesReference(
+            translator, {0x2f, 0x0c, 0x02, subOid, (uint8_t)value},
+            fwObserveMode));
+      }
+    }
+  }
+}
+
+TEST(NciTranslatorTest, ExitFramesEmptyValue) {
+  HalNciTranslator translator;
+
+  for (uint8_t fwObserveMode : kFwObserveModes) {
+    for (uint8_t type : {0x00, 0x01, 0x07, 0x10, 0xff}) {
+      for (uint8_t length : {0x00, 0x01}) {
+        std::vector<uint8_t> cmd = ExitFrame(type, 0, 0xff);
+        cmd[9] = length;
+        EXPECT_TRUE(MatchesReference(translator, cmd, fwObserveMode));
+      }
+    }
+    // With a non empty TLV after the empty one
+    std::vector<uint8_t> cmd = ExitFrame(0x00, 0, 0xff);
+    for (uint8_t b : {0x01, 0x03, 0x01, 0x05, 0xff}) cmd.push_back(b);
+    cmd[2] = cmd.size() - 3;
+    EXPECT_TRUE(MatchesReference(translator, cmd, fwObserveMode));
+  }
+}
+
+TEST(NciTranslatorTest, ExitFramesMaxLength) {
+  HalNciTranslator translator;
+
+  for (uint8_t fwObserveMode : kFwObserveModes) {
+    for (uint8_t mask : {0xff, 0xf0}) {
+      // Type A/B: 4 + 3 + 2 * (122 + 2) translated bytes, the largest payload
+      for (uint8_t type : {0x00, 0x01}) {
+        EXPECT_TRUE(MatchesReference(translator, ExitFrame(type, 122, mask),
+                                     fwObserveMode));
+        // The reference wraps the NCI length past it
+        EXPECT_TRUE(Rejected(translator, ExitFrame(type, 123, mask),
+                             fwObserveMode));
+      }
+      // Prefix: bound by the 255 bytes of the command
+      EXPECT_TRUE(MatchesReference(translator, ExitFrame(0x10, 123, mask),
+                                   fwObserveMode));
+    }
+  }
+}
+
+TEST(NciTranslatorTest, ExitFramesRandom) {
+  HalNciTranslator translator;
+  std::mt19937 random(1);
+  std::vector<uint8_t> cmd;
+
+  for (int i = 0; i < 100000; i++) {
+    RandomExitFrames(random, &cmd);
+    ASSERT_TRUE(MatchesReference(translator, cmd, kFwObserveModes[i & 1]));
+  }
+}
+
+TEST(NciTranslatorTest, PollingLoopAnnotationEmpty) {
+  HalNciTranslator translator;
+
+  for (uint8_t fwObserveMode : kFwObserveModes) {
+    // Clears the annotation
+    EXPECT_TRUE(MatchesReference(translator, {0x2f, 0x0c, 0x02, 0x09, 0x00},
+                                 fwObserveMode));
+    // First byte only: CRC preset, then no frame at all: CRC 0
+    for (size_t frameLength : {1, 0}) {
+      for (uint8_t flags : {0x00, 0x01}) {
+        EXPECT_TRUE(MatchesReference(
+            translator, PollingLoopAnnotation(frameLength, flags),
+            fwObserveMode));
+      }
+    }
+  }
+}
+
+TEST(NciTranslatorTest, PollingLoopAnnotationMaxLength) {
+  HalNciTranslator translator;
+
+  for (uint8_t fwObserveMode : kFwObserveModes) {
+    // 254 bytes command payload, 255 once translated
+    EXPECT_TRUE(MatchesReference(translator, PollingLoopAnnotation(250, 0x01),
+                                 fwObserveMode));
+    // The reference wraps the NCI length past it
+    EXPECT_TRUE(Rejected(translator, PollingLoopAnnotation(251, 0x01),
+                         fwObserveMode));
+  }
+}
+
+TEST(NciTranslatorTest, PollingLoopAnnotationRandom) {
+  HalNciTranslator translator;
+  std::mt19937 random(1);
+  std::vector<uint8_t> cmd;
+
+  for (int i = 0; i < 100000; i++) {
+    RandomPollingLoopAnnotation(random, &cmd);
+    ASSERT_TRUE(MatchesReference(translator, cmd, kFwObserveModes[i & 1]));
+  }
+}
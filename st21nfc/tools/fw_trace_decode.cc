@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Host decoder of the FW debug trace files the HAL captures
+ * (STNFC_FW_TRACE_CAPTURE, see hal_fw_trace.h):
+ *   st21nfc_fw_trace_decode [-r] st21nfc_fw_trace.bin
+ * prints the FW traces in reception order, with the polling loop TLVs
+ * decoded as hal_fwlog.cc reads them, or only in hex with -r. The NCI
+ * frames the file may also hold are for st21nfc_nci_trace.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "trace_common.h"
+
+struct DecodeState {
+  bool raw;
+  uint32_t session;
+};
+
+static void PrintRecord(const TraceFile::Record& record, void* arg) {
+  DecodeState* state = (DecodeState*)arg;
+  char time[32];
+
+  if (record.kind != HAL_FW_TRACE_KIND_FW) return;
+  if (record.session != state->session) {
+    state->session = record.session;
+    printf("--- session %u ---\n", state->session);
+  }
+  NciFormatTime(record.timeUs, time, sizeof(time));
+  printf("%s ", time);
+  NciPrintHex(stdout, record.data, record.length);
+  printf("\n");
+  if (!state->raw) NciPrintPollingTlvs(stdout, record.data, record.length);
+}
+
+int main(int argc, char** argv) {
+  DecodeState state = {false, 0};
+  const char* path = NULL;
+  TraceFile file;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-r") == 0) {
+      state.raw = true;
+    } else {
+      path = argv[i];
+    }
+  }
+  if (!path) {
+    fprintf(stderr, "usage: %s [-r] st21nfc_fw_trace.bin\n", argv[0]);
+    return 2;
+  }
+  if (!file.open(path)) {
+    fprintf(stderr, "%s: %s\n", path, strerror(errno));
+    return 1;
+  }
+  file.forEach(PrintRecord, &state);
+  return 0;
+}
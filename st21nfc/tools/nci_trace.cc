@@ -0,0 +1,814 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Host analyzer of the NCI traffic of the HAL:
+ *   st21nfc_nci_trace [-v] [-n <slowest>] [-r <retries>] <trace>|-
+ * The trace is the trace file of the HAL (STNFC_FW_TRACE_CAPTURE and
+ * STNFC_FW_TRACE_NCI, see hal_fw_trace.h) or logcat text, "-" for the
+ * standard input: the "(#0XXXX) Rx/Tx" frames of DispHal() and the
+ * "nfc_set_state" changes of the wrapper, with the time of the threadtime
+ * or year formats.
+ *
+ * It pairs the commands with their responses and reports the latency per
+ * command, the slowest ones, the retry storms (the same command retried
+ * -r times or more, 3 by default, before its response), the notifications
+ * and the time spent per wrapper state. -v also prints every frame,
+ * decoded. Files are mapped and read once, so that traces of several GB
+ * take seconds.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "trace_common.h"
+
+#define NCI_TRACE_MAX_FRAME 300
+#define NCI_TRACE_KEPT_BYTES 32
+#define NCI_TRACE_READ_SIZE (1024 * 1024)
+
+struct Options {
+  bool verbose;
+  size_t slowest;
+  uint32_t stormRetries;
+};
+
+/*
+ * Statistics of a stream of frames and state changes, in the order they
+ * were seen. Times are CLOCK_REALTIME us, 0 when unknown.
+ */
+class Analyzer {
+ public:
+  explicit Analyzer(const Options& options);
+
+  void onSession(uint32_t session);
+  void onFrame(uint64_t timeUs, bool tx, const uint8_t* frame, size_t length);
+  void onState(uint64_t timeUs, uint8_t from, uint8_t to);
+  void report(FILE* out);
+
+ private:
+  struct OpStats {
+    uint64_t count;
+    uint64_t answered;
+    uint64_t totalUs;
+    uint64_t maxUs;
+    uint64_t retries;
+    uint64_t unanswered;
+  };
+
+  struct Command {
+    bool active;
+    uint64_t timeUs;
+    uint32_t key;
+    uint32_t retries;
+    uint8_t frame[NCI_TRACE_KEPT_BYTES];
+    size_t length;
+  };
+
+  struct Slow {
+    uint64_t latencyUs;
+    uint64_t timeUs;
+    uint32_t key;
+    uint8_t frame[NCI_TRACE_KEPT_BYTES];
+    size_t length;
+  };
+
+  struct Storm {
+    uint64_t timeUs;
+    uint32_t key;
+    uint32_t retries;
+    uint64_t latencyUs;  // 0 if not answered
+  };
+
+  static uint32_t keyOf(const uint8_t* frame, size_t length);
+  const std::string& nameOf(uint32_t key, const uint8_t* frame, size_t length);
+  void onCommand(uint64_t timeUs, const uint8_t* frame, size_t length,
+                 uint32_t* retries);
+  uint64_t onResponse(uint64_t timeUs, const uint8_t* frame, size_t length);
+  void endCommand(uint64_t latencyUs);
+  void noteTime(uint64_t timeUs);
+  void print(uint64_t timeUs, bool tx, const uint8_t* frame, size_t length,
+             uint64_t latencyUs, uint32_t retries);
+
+  Options mOptions;
+  std::unordered_map<uint32_t, OpStats> mOps;
+  std::unordered_map<uint32_t, uint64_t> mNtfs;
+  std::unordered_map<uint32_t, std::string> mNames;
+  std::vector<Slow> mSlowest;  // min-heap on latencyUs
+  std::vector<Storm> mStorms;
+  Command mPending;
+
+  uint64_t mFrames[2];  // rx, tx
+  uint64_t mData[2];
+  uint64_t mFwTraces;
+  uint64_t mUnmatched;
+  uint32_t mSessions;
+  uint32_t mSession;
+  uint64_t mFirstUs;
+  uint64_t mLastUs;
+
+  int mState;  // -1: unknown
+  uint64_t mStateSinceUs;
+  uint64_t mStateUs[256];
+  uint64_t mStateEntries[256];
+};
+
+Analyzer::Analyzer(const Options& options)
+    : mOptions(options),
+      mFwTraces(0),
+      mUnmatched(0),
+      mSessions(0),
+      mSession(0),
+      mFirstUs(0),
+      mLastUs(0),
+      mState(-1),
+      mStateSinceUs(0) {
+  memset(&mPending, 0, sizeof(mPending));
+  memset(mFrames, 0, sizeof(mFrames));
+  memset(mData, 0, sizeof(mData));
+  memset(mStateUs, 0, sizeof(mStateUs));
+  memset(mStateEntries, 0, sizeof(mStateEntries));
+}
+
+/**
+ * Key of a control message: MT, GID, OID and the sub-opcode of the ST and
+ * Android proprietary commands, the instruction of the loader APDUs.
+ * @param frame The frame
+ * @param length Its length
+ * @return The key
+ */
+uint32_t Analyzer::keyOf(const uint8_t* frame, size_t length) {
+  uint8_t mt = frame[0] >> 5;
+  uint8_t gid = frame[0] & 0xf;
+  uint8_t oid = frame[1] & 0x3f;
+  uint32_t key = (mt << 24) | (gid << 16) | (oid << 8);
+
+  if (gid == 0xf && mt == 1 && (oid == 0x02 || oid == 0x0c) && length > 3) {
+    key |= frame[3];
+  } else if (gid == 0xf && mt == 3 && oid == 0x0c && length > 3) {
+    key |= frame[3];
+  } else if (gid == 0xf && mt == 1 && oid == 0x04 && length > 4) {
+    key |= frame[4];
+  }
+  return key;
+}
+
+const std::string& Analyzer::nameOf(uint32_t key, const uint8_t* frame,
+                                    size_t length) {
+  auto it = mNames.find(key);
+  if (it != mNames.end()) return it->second;
+
+  char buf[64];
+  std::string name = NciMessageName(frame, length, buf, sizeof(buf));
+  if ((key >> 8) == 0x010f04 && length > 4) {
+    const char* ins = NciLoaderInsName(frame[4]);
+    if (ins) {
+      name += " ";
+      name += ins;
+    } else {
+      snprintf(buf, sizeof(buf), " INS %02x", frame[4]);
+      name += buf;
+    }
+  }
+  return mNames.emplace(key, name).first->second;
+}
+
+void Analyzer::noteTime(uint64_t timeUs) {
+  if (!timeUs) return;
+  if (!mFirstUs) mFirstUs = timeUs;
+  if (timeUs > mLastUs) mLastUs = timeUs;
+}
+
+void Analyzer::onSession(uint32_t session) {
+  if (mSessions && session == mSession) return;
+  // The HAL restarted, what was going on ends with the previous session.
+  if (mPending.active) endCommand(0);
+  if (mState >= 0 && mStateSinceUs && mLastUs > mStateSinceUs) {
+    mStateUs[mState] += mLastUs - mStateSinceUs;
+  }
+  mState = -1;
+  mSessions++;
+  mSession = session;
+  if (mOptions.verbose) printf("--- session %u ---\n", session);
+}
+
+void Analyzer::onFrame(uint64_t timeUs, bool tx, const uint8_t* frame,
+                       size_t length) {
+  uint64_t latencyUs = 0;
+  uint32_t retries = 0;
+  uint8_t mt;
+
+  if (length < 3) return;
+  if (!mSessions) onSession(0);
+  noteTime(timeUs);
+  mFrames[tx]++;
+  mt = frame[0] >> 5;
+  switch (mt) {
+    case 0:
+      mData[tx]++;
+      break;
+    case 1:
+      if (tx) onCommand(timeUs, frame, length, &retries);
+      break;
+    case 2:
+      if (!tx) latencyUs = onResponse(timeUs, frame, length);
+      break;
+    case 3:
+      if (tx) break;
+      if (frame[0] == 0x6f && frame[1] == 0x02) mFwTraces++;
+      mNtfs[keyOf(frame, length)]++;
+      nameOf(keyOf(frame, length), frame, length);
+      break;
+    default:
+      break;
+  }
+  if (mOptions.verbose) print(timeUs, tx, frame, length, latencyUs, retries);
+}
+
+void Analyzer::onCommand(uint64_t timeUs, const uint8_t* frame, size_t length,
+                         uint32_t* retries) {
+  size_t kept = std::min(length, (size_t)NCI_TRACE_KEPT_BYTES);
+  uint32_t key = keyOf(frame, length);
+
+  if (mPending.active && mPending.key == key && mPending.length == length &&
+      memcmp(mPending.frame, frame, kept) == 0) {
+    // Written again before its response
+    *retries = ++mPending.retries;
+    mOps[key].retries++;
+    return;
+  }
+  if (mPending.active) endCommand(0);
+
+  nameOf(key, frame, length);
+  mOps[key].count++;
+  mPending.active = true;
+  mPending.timeUs = timeUs;
+  mPending.key = key;
+  mPending.retries = 0;
+  mPending.length = length;
+  memcpy(mPending.frame, frame, kept);
+}
+
+uint64_t Analyzer::onResponse(uint64_t timeUs, const uint8_t* frame,
+                              size_t length) {
+  uint64_t latencyUs;
+
+  (void)length;
+  // Same GID and OID, the sub-opcodes are not always echoed.
+  if (!mPending.active || ((mPending.key >> 8) & 0xffff) !=
+                              (uint32_t)(((frame[0] & 0xf) << 8) |
+                                         (frame[1] & 0x3f))) {
+    mUnmatched++;
+    return 0;
+  }
+  latencyUs = mPending.timeUs && timeUs >= mPending.timeUs
+                  ? timeUs - mPending.timeUs
+                  : 0;
+  endCommand(latencyUs ? latencyUs : 1);
+  return latencyUs;
+}
+
+/**
+ * Account for the pending command.
+ * @param latencyUs Time to its response, 0 if it got none
+ */
+void Analyzer::endCommand(uint64_t latencyUs) {
+  OpStats& op = mOps[mPending.key];
+
+  mPending.active = false;
+  if (mPending.retries >= mOptions.stormRetries) {
+    mStorms.push_back(
+        {mPending.timeUs, mPending.key, mPending.retries, latencyUs});
+  }
+  if (!latencyUs) {
+    op.unanswered++;
+    return;
+  }
+  op.answered++;
+  op.totalUs += latencyUs;
+  if (latencyUs > op.maxUs) op.maxUs = latencyUs;
+
+  auto cmp = [](const Slow& a, const Slow& b) {
+    return a.latencyUs > b.latencyUs;
+  };
+  if (!mOptions.slowest) return;
+  if (mSlowest.size() == mOptions.slowest) {
+    if (latencyUs <= mSlowest.front().latencyUs) return;
+    std::pop_heap(mSlowest.begin(), mSlowest.end(), cmp);
+    mSlowest.pop_back();
+  }
+  Slow slow;
+  slow.latencyUs = latencyUs;
+  slow.timeUs = mPending.timeUs;
+  slow.key = mPending.key;
+  slow.length = std::min(mPending.length, (size_t)NCI_TRACE_KEPT_BYTES);
+  memcpy(slow.frame, mPending.frame, slow.length);
+  mSlowest.push_back(slow);
+  std::push_heap(mSlowest.begin(), mSlowest.end(), cmp);
+}
+
+void Analyzer::onState(uint64_t timeUs, uint8_t from, uint8_t to) {
+  char name[48];
+
+  if (!mSessions) onSession(0);
+  noteTime(timeUs);
+  (void)from;
+  if (mState >= 0 && mStateSinceUs && timeUs > mStateSinceUs) {
+    mStateUs[mState] += timeUs - mStateSinceUs;
+  }
+  mState = to;
+  mStateSinceUs = timeUs;
+  mStateEntries[to]++;
+  if (mOptions.verbose) {
+    char time[32] = "-";
+    if (timeUs) NciFormatTime(timeUs, time, sizeof(time));
+    printf("%s state %s\n", time, NciWrapperStateName(to, name, sizeof(name)));
+  }
+}
+
+void Analyzer::print(uint64_t timeUs, bool tx, const uint8_t* frame,
+                     size_t length, uint64_t latencyUs, uint32_t retries) {
+  char time[32] = "-";
+  char name[64];
+
+  if (timeUs) NciFormatTime(timeUs, time, sizeof(time));
+  if ((frame[0] >> 5) == 0) {
+    NciMessageName(frame, length, name, sizeof(name));
+  } else {
+    snprintf(name, sizeof(name), "%s",
+             nameOf(keyOf(frame, length), frame, length).c_str());
+  }
+  printf("%s %s %s [%zu]", time, tx ? "Tx" : "Rx", name, length);
+  NciPrintHex(stdout, frame, std::min(length, (size_t)NCI_TRACE_KEPT_BYTES));
+  if (length > NCI_TRACE_KEPT_BYTES) printf(" ...");
+  if (frame[0] == 0x4f && frame[1] == 0x04 && length >= 5) {
+    printf("  SW %02x%02x", frame[length - 2], frame[length - 1]);
+  }
+  if (latencyUs) printf("  (+%llu us)", (unsigned long long)latencyUs);
+  if (retries) printf("  (retry %u)", retries);
+  printf("\n");
+  if (frame[0] == 0x6f && frame[1] == 0x02) {
+    NciPrintPollingTlvs(stdout, frame, length);
+  }
+}
+
+void Analyzer::report(FILE* out) {
+  uint64_t answered = 0, unanswered = 0, retries = 0;
+  std::vector<std::pair<uint32_t, OpStats>> ops(mOps.begin(), mOps.end());
+  std::vector<std::pair<uint32_t, uint64_t>> ntfs(mNtfs.begin(), mNtfs.end());
+  char time[32];
+  char name[48];
+
+  if (mPending.active) endCommand(0);
+  if (mState >= 0 && mStateSinceUs && mLastUs > mStateSinceUs) {
+    mStateUs[mState] += mLastUs - mStateSinceUs;
+    mStateSinceUs = mLastUs;
+  }
+  for (auto& op : ops) {
+    answered += op.second.answered;
+    unanswered += op.second.unanswered;
+    retries += op.second.retries;
+  }
+
+  fprintf(out,
+          "Frames: %llu tx, %llu rx (data %llu tx, %llu rx; FW traces %llu), "
+          "%u session(s)\n",
+          (unsigned long long)mFrames[1], (unsigned long long)mFrames[0],
+          (unsigned long long)mData[1], (unsigned long long)mData[0],
+          (unsigned long long)mFwTraces, mSessions);
+  if (mLastUs > mFirstUs) {
+    fprintf(out, "Span: %.3f s\n", (mLastUs - mFirstUs) / 1e6);
+  }
+  fprintf(out,
+          "Commands: %llu answered, %llu unanswered, %llu retries, %llu "
+          "unmatched responses\n",
+          (unsigned long long)answered, (unsigned long long)unanswered,
+          (unsigned long long)retries, (unsigned long long)mUnmatched);
+
+  std::sort(ops.begin(), ops.end(), [](const auto& a, const auto& b) {
+    return a.second.totalUs != b.second.totalUs
+               ? a.second.totalUs > b.second.totalUs
+               : a.second.count > b.second.count;
+  });
+  fprintf(out, "\n%-48s %8s %9s %9s %8s %6s\n", "Command", "count", "avg us",
+          "max us", "retries", "lost");
+  for (auto& op : ops) {
+    const OpStats& s = op.second;
+    fprintf(out, "%-48s %8llu %9llu %9llu %8llu %6llu\n",
+            mNames[op.first].c_str(), (unsigned long long)s.count,
+            (unsigned long long)(s.answered ? s.totalUs / s.answered : 0),
+            (unsigned long long)s.maxUs, (unsigned long long)s.retries,
+            (unsigned long long)s.unanswered);
+  }
+
+  if (!mSlowest.empty()) {
+    std::sort(mSlowest.begin(), mSlowest.end(),
+              [](const Slow& a, const Slow& b) {
+                return a.latencyUs > b.latencyUs;
+              });
+    fprintf(out, "\nSlowest commands:\n");
+    for (const Slow& slow : mSlowest) {
+      NciFormatTime(slow.timeUs, time, sizeof(time));
+      fprintf(out, "  %s %-40s %9llu us ", slow.timeUs ? time : "-",
+              mNames[slow.key].c_str(), (unsigned long long)slow.latencyUs);
+      NciPrintHex(out, slow.frame, slow.length);
+      fprintf(out, "\n");
+    }
+  }
+
+  fprintf(out, "\nRetry storms (%u+ retries): %zu\n", mOptions.stormRetries,
+          mStorms.size());
+  for (const Storm& storm : mStorms) {
+    NciFormatTime(storm.timeUs, time, sizeof(time));
+    fprintf(out, "  %s %-40s %u retries, ", storm.timeUs ? time : "-",
+            mNames[storm.key].c_str(), storm.retries);
+    if (storm.latencyUs) {
+      fprintf(out, "answered after %llu us\n",
+              (unsigned long long)storm.latencyUs);
+    } else {
+      fprintf(out, "unanswered\n");
+    }
+  }
+
+  std::sort(ntfs.begin(), ntfs.end(),
+            [](const auto& a, const auto& b) { return a.second > b.second; });
+  if (!ntfs.empty()) fprintf(out, "\nNotifications:\n");
+  for (auto& ntf : ntfs) {
+    fprintf(out, "  %-48s %8llu\n", mNames[ntf.first].c_str(),
+            (unsigned long long)ntf.second);
+  }
+
+  bool header = false;
+  for (int s = 0; s < 256; s++) {
+    if (!mStateEntries[s] && !mStateUs[s]) continue;
+    if (!header) {
+      fprintf(out, "\nTime per wrapper state:\n");
+      header = true;
+    }
+    fprintf(out, "  %-48s %12.3f s %8llu entries\n",
+            NciWrapperStateName(s, name, sizeof(name)), mStateUs[s] / 1e6,
+            (unsigned long long)mStateEntries[s]);
+  }
+}
+
+/*
+ * Logcat text to frames and state changes. The frames of DispHal() are
+ * split in lines of 32 bytes, "(#0NNNN) Rx" then "(#0NNNN) rx", and may
+ * interleave with the other direction.
+ */
+class LogcatParser {
+ public:
+  explicit LogcatParser(Analyzer* analyzer);
+
+  // Whole lines only.
+  void parse(const char* p, const char* end);
+  void finish();
+
+ private:
+  struct Partial {
+    bool active;
+    unsigned number;
+    uint64_t timeUs;
+    uint8_t data[NCI_TRACE_MAX_FRAME];
+    size_t length;
+  };
+
+  void parseLine(const char* line, const char* end);
+  uint64_t parseTime(const char* line, const char* end);
+  void flush(int tx);
+
+  Analyzer* mAnalyzer;
+  Partial mPartial[2];
+  int mYear;
+  // mktime() of the last minute seen
+  char mMinuteKey[16];
+  time_t mMinuteBase;
+};
+
+LogcatParser::LogcatParser(Analyzer* analyzer)
+    : mAnalyzer(analyzer), mMinuteBase(0) {
+  time_t now = time(NULL);
+  struct tm tm;
+
+  localtime_r(&now, &tm);
+  mYear = tm.tm_year + 1900;
+  memset(mPartial, 0, sizeof(mPartial));
+  memset(mMinuteKey, 0, sizeof(mMinuteKey));
+}
+
+void LogcatParser::parse(const char* p, const char* end) {
+  while (p < end) {
+    const char* eol = (const char*)memchr(p, '\n', end - p);
+    if (!eol) eol = end;
+    parseLine(p, eol);
+    p = eol + 1;
+  }
+}
+
+void LogcatParser::finish() {
+  flush(0);
+  flush(1);
+}
+
+static int Digits(const char* p, int n) {
+  int value = 0;
+  for (int i = 0; i < n; i++) {
+    if (p[i] < '0' || p[i] > '9') return -1;
+    value = value * 10 + p[i] - '0';
+  }
+  return value;
+}
+
+static int HexDigit(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+/**
+ * Time of a logcat line, "MM-DD HH:MM:SS.fff" or with the year first.
+ * @param line Start of the line
+ * @param end Its end
+ * @return CLOCK_REALTIME us, 0 if the line has none
+ */
+uint64_t LogcatParser::parseTime(const char* line, const char* end) {
+  int year = mYear;
+  const char* p = line;
+  int second;
+  uint64_t us = 0;
+  int scale = 100000;
+
+  if (end - p > 5 && p[4] == '-') {
+    year = Digits(p, 4);
+    p += 5;
+  }
+  if (end - p < 14 || p[2] != '-' || p[5] != ' ' || p[8] != ':' ||
+      p[11] != ':') {
+    return 0;
+  }
+  // "YYYY-MM-DD HH:MM" identifies the minute.
+  char key[16];
+  snprintf(key, sizeof(key), "%04d%.11s", year, p);
+  if (memcmp(key, mMinuteKey, sizeof(key)) != 0) {
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    tm.tm_year = year - 1900;
+    tm.tm_mon = Digits(p, 2) - 1;
+    tm.tm_mday = Digits(p + 3, 2);
+    tm.tm_hour = Digits(p + 6, 2);
+    tm.tm_min = Digits(p + 9, 2);
+    tm.tm_isdst = -1;
+    if (tm.tm_mon < 0 || tm.tm_mday < 0 || tm.tm_hour < 0 || tm.tm_min < 0) {
+      return 0;
+    }
+    mMinuteBase = mktime(&tm);
+    memcpy(mMinuteKey, key, sizeof(key));
+  }
+  second = Digits(p + 12, 2);
+  if (second < 0) return 0;
+  p += 14;
+  if (p < end && *p == '.') {
+    for (p++; p < end && *p >= '0' && *p <= '9'; p++) {
+      us += (*p - '0') * scale;
+      scale /= 10;
+    }
+  }
+  return ((uint64_t)mMinuteBase + second) * 1000000 + us;
+}
+
+void LogcatParser::parseLine(const char* line, const char* end) {
+  static const char kFrame[] = "(#0";
+  static const char kState[] = "nfc_set_state ";
+  const char* p;
+
+  p = (const char*)memmem(line, end - line, kFrame, sizeof(kFrame) - 1);
+  if (p && end - p >= 12 && p[7] == ')' && p[8] == ' ' && p[10] == 'x' &&
+      (p[9] == 'R' || p[9] == 'T' || p[9] == 'r' || p[9] == 't')) {
+    unsigned number = 0;
+    int tx = p[9] == 'T' || p[9] == 't';
+    Partial& partial = mPartial[tx];
+
+    for (int i = 3; i < 7; i++) {
+      int d = HexDigit(p[i]);
+      if (d < 0) return;
+      number = number * 16 + d;
+    }
+    if (p[9] == 'R' || p[9] == 'T') {
+      flush(tx);
+      partial.active = true;
+      partial.number = number;
+      partial.timeUs = parseTime(line, end);
+      partial.length = 0;
+    } else if (!partial.active || partial.number != number) {
+      // Continuation of a frame whose start is missing
+      return;
+    }
+    for (p += 11; p + 1 < end;) {
+      int hi, lo;
+      if (*p == ' ') {
+        p++;
+        continue;
+      }
+      hi = HexDigit(p[0]);
+      lo = HexDigit(p[1]);
+      if (hi < 0 || lo < 0) {
+        if (*p == '(') {
+          // "(hidden)": only the header is logged
+          flush(tx);
+        }
+        break;
+      }
+      if (partial.length < sizeof(partial.data)) {
+        partial.data[partial.length++] = hi << 4 | lo;
+      }
+      p += 2;
+    }
+    if (partial.active && partial.length >= 3 &&
+        partial.length >= 3 + (size_t)partial.data[2]) {
+      flush(tx);
+    }
+    return;
+  }
+
+  p = (const char*)memmem(line, end - line, kState, sizeof(kState) - 1);
+  if (p) {
+    // "from->to", not with sscanf() that would scan the rest of the mapping
+    int from = 0, to = 0;
+    for (p += sizeof(kState) - 1; p < end && *p >= '0' && *p <= '9'; p++) {
+      from = from * 10 + *p - '0';
+    }
+    if (end - p < 3 || p[0] != '-' || p[1] != '>') return;
+    for (p += 2; p < end && *p >= '0' && *p <= '9'; p++) {
+      to = to * 10 + *p - '0';
+    }
+    if (from < 256 && to < 256 && from != to) {
+      mAnalyzer->onState(parseTime(line, end), from, to);
+    }
+  }
+}
+
+void LogcatParser::flush(int tx) {
+  Partial& partial = mPartial[tx];
+
+  if (!partial.active) return;
+  partial.active = false;
+  mAnalyzer->onFrame(partial.timeUs, tx, partial.data, partial.length);
+}
+
+static void OnRecord(const TraceFile::Record& record, void* arg) {
+  Analyzer* analyzer = (Analyzer*)arg;
+
+  analyzer->onSession(record.session);
+  switch (record.kind) {
+    case HAL_FW_TRACE_KIND_FW:
+    case HAL_FW_TRACE_KIND_RX:
+      analyzer->onFrame(record.timeUs, false, record.data, record.length);
+      break;
+    case HAL_FW_TRACE_KIND_TX:
+      analyzer->onFrame(record.timeUs, true, record.data, record.length);
+      break;
+    case HAL_FW_TRACE_KIND_STATE:
+      if (record.length == 2) {
+        analyzer->onState(record.timeUs, record.data[0], record.data[1]);
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+/**
+ * Parse logcat text from a stream, in chunks.
+ * @param in The stream
+ * @param parser Its parser
+ * @return false on a read error
+ */
+static bool ParseStream(int fd, LogcatParser* parser) {
+  std::vector<char> buf(NCI_TRACE_READ_SIZE);
+  size_t kept = 0;
+  ssize_t n;
+
+  while ((n = read(fd, buf.data() + kept, buf.size() - kept)) > 0) {
+    const char* start = buf.data();
+    const char* end = start + kept + n;
+    const char* last = (const char*)memrchr(start, '\n', end - start);
+
+    if (!last) {
+      // A line longer than the buffer: grow it.
+      kept += n;
+      if (kept == buf.size()) buf.resize(buf.size() * 2);
+      continue;
+    }
+    parser->parse(start, last + 1);
+    kept = end - (last + 1);
+    memmove(buf.data(), last + 1, kept);
+  }
+  if (kept) parser->parse(buf.data(), buf.data() + kept);
+  return n == 0;
+}
+
+static void Usage(const char* name) {
+  fprintf(stderr,
+          "usage: %s [-v] [-n <slowest>] [-r <retries>] <trace>|-\n"
+          "  -v  print every frame\n"
+          "  -n  number of slowest commands listed, 10 by default\n"
+          "  -r  retries of a command making a storm, 3 by default\n",
+          name);
+}
+
+int main(int argc, char** argv) {
+  Options options = {false, 10, 3};
+  const char* path = NULL;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "vn:r:")) != -1) {
+    switch (opt) {
+      case 'v':
+        options.verbose = true;
+        break;
+      case 'n':
+        options.slowest = strtoul(optarg, NULL, 0);
+        break;
+      case 'r':
+        options.stormRetries = strtoul(optarg, NULL, 0);
+        if (!options.stormRetries) options.stormRetries = 1;
+        break;
+      default:
+        Usage(argv[0]);
+        return 2;
+    }
+  }
+  if (optind != argc - 1) {
+    Usage(argv[0]);
+    return 2;
+  }
+  path = argv[optind];
+
+  Analyzer analyzer(options);
+  LogcatParser parser(&analyzer);
+
+  if (strcmp(path, "-") == 0) {
+    if (!ParseStream(STDIN_FILENO, &parser)) {
+      fprintf(stderr, "stdin: %s\n", strerror(errno));
+      return 1;
+    }
+  } else {
+    struct stat st;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0 || fstat(fd, &st) != 0) {
+      fprintf(stderr, "%s: %s\n", path, strerror(errno));
+      return 1;
+    }
+    const char* data = NULL;
+    if (st.st_size > 0) {
+      data = (const char*)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (data == MAP_FAILED) {
+      fprintf(stderr, "%s: %s\n", path, strerror(errno));
+      return 1;
+    }
+    if (data && TraceFile::isTraceFile((const uint8_t*)data, st.st_size)) {
+      TraceFile file;
+      munmap((void*)data, st.st_size);
+      if (!file.open(path)) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return 1;
+      }
+      file.forEach(OnRecord, &analyzer);
+    } else if (data) {
+      madvise((void*)data, st.st_size, MADV_SEQUENTIAL);
+      parser.parse(data, data + st.st_size);
+      munmap((void*)data, st.st_size);
+    }
+  }
+  parser.finish();
+  analyzer.report(stdout);
+  return 0;
+}
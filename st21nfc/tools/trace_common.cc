@@ -0,0 +1,411 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "trace_common.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+// TLV types of PROP_FW_DBG_NTF, as hal_fwlog.h
+#define FW_TRACE_T_CERX 0x09
+#define FW_TRACE_T_FIELD_ON 0x10
+#define FW_TRACE_T_FIELD_OFF 0x11
+#define FW_TRACE_T_CERX_ERROR 0x19
+
+TraceFile::TraceFile() : mData(NULL), mSize(0) {}
+
+TraceFile::~TraceFile() {
+  if (mData) munmap((void*)mData, mSize);
+}
+
+bool TraceFile::open(const char* path) {
+  struct stat st;
+  int fd;
+
+  fd = ::open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return false;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return false;
+  }
+  mSize = st.st_size;
+  if (mSize) {
+    void* data = mmap(NULL, mSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      close(fd);
+      return false;
+    }
+    mData = (const uint8_t*)data;
+  }
+  close(fd);
+
+  for (size_t offset = 0; offset + HAL_FW_TRACE_BLOCK_SIZE <= mSize;
+       offset += HAL_FW_TRACE_BLOCK_SIZE) {
+    const HalFwTraceBlockHeader* header =
+        (const HalFwTraceBlockHeader*)(mData + offset);
+    if (header->magic == HAL_FW_TRACE_MAGIC &&
+        header->version == HAL_FW_TRACE_VERSION &&
+        header->used <=
+            HAL_FW_TRACE_BLOCK_SIZE - sizeof(HalFwTraceBlockHeader)) {
+      mBlocks.push_back(header);
+    }
+  }
+  std::sort(mBlocks.begin(), mBlocks.end(),
+            [](const HalFwTraceBlockHeader* a, const HalFwTraceBlockHeader* b) {
+              return a->seq < b->seq;
+            });
+  return true;
+}
+
+bool TraceFile::isTraceFile(const uint8_t* data, size_t size) {
+  uint32_t magic = HAL_FW_TRACE_MAGIC;
+  return size >= sizeof(magic) && memcmp(data, &magic, sizeof(magic)) == 0;
+}
+
+void TraceFile::forEach(void (*onRecord)(const Record& record, void* arg),
+                        void* arg) {
+  for (const HalFwTraceBlockHeader* header : mBlocks) {
+    const uint8_t* p = (const uint8_t*)(header + 1);
+    const uint8_t* end = p + header->used;
+    Record record;
+
+    record.session = header->session;
+    while (p + HAL_FW_TRACE_RECORD_HEADER_SIZE <= end) {
+      memcpy(&record.timeUs, p, sizeof(record.timeUs));
+      memcpy(&record.length, p + 8, sizeof(record.length));
+      record.kind = p[10];
+      record.data = p + HAL_FW_TRACE_RECORD_HEADER_SIZE;
+      if (record.data + record.length > end) {
+        fprintf(stderr, "block %u: truncated record\n", header->seq);
+        break;
+      }
+      onRecord(record, arg);
+      p = record.data + record.length;
+    }
+  }
+}
+
+static const char* kCoreNames[] = {
+    "CORE_RESET",
+    "CORE_INIT",
+    "CORE_SET_CONFIG",
+    "CORE_GET_CONFIG",
+    "CORE_CONN_CREATE",
+    "CORE_CONN_CLOSE",
+    "CORE_CONN_CREDITS",
+    "CORE_GENERIC_ERROR",
+    "CORE_INTERFACE_ERROR",
+    "CORE_SET_POWER_SUB_STATE",
+};
+
+static const char* kRfNames[] = {
+    "RF_DISCOVER_MAP",
+    "RF_SET_LISTEN_MODE_ROUTING",
+    "RF_GET_LISTEN_MODE_ROUTING",
+    "RF_DISCOVER",
+    "RF_DISCOVER_SELECT",
+    "RF_INTF_ACTIVATED",
+    "RF_DEACTIVATE",
+    "RF_FIELD_INFO",
+    "RF_T3T_POLLING",
+    "RF_NFCEE_ACTION",
+    "RF_NFCEE_DISCOVERY_REQ",
+    "RF_PARAMETER_UPDATE",
+    "RF_INTF_EXT_START",
+    "RF_INTF_EXT_STOP",
+    "RF_EXT_AGG_ABORT",
+    "RF_NDEF_ABORT",
+    "RF_ISO_DEP_NAK_PRESENCE",
+    "RF_SET_FORCED_NFCEE_ROUTING",
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    "RF_SET_LISTEN_OBSERVE_MODE_STATE",
+    "RF_GET_LISTEN_OBSERVE_MODE_STATE",
+};
+
+static const char* kNfceeNames[] = {
+    "NFCEE_DISCOVER",
+    "NFCEE_MODE_SET",
+    "NFCEE_STATUS",
+    "NFCEE_POWER_AND_LINK_CNTRL",
+};
+
+/**
+ * Name of a proprietary message, GID 0xf.
+ * @param frame The frame
+ * @param length Its length
+ * @return Its name, NULL if unknown
+ */
+static const char* NciPropName(const uint8_t* frame, size_t length) {
+  uint8_t mt = frame[0] >> 5;
+  uint8_t oid = frame[1] & 0x3f;
+  int sub = length > 3 ? frame[3] : -1;
+
+  if (mt == 3) {
+    switch (oid) {
+      case 0x02:
+        return "PROP_FW_DBG";
+      case 0x0c:
+        return "ANDROID_POLLING_LOOP";
+      case 0x1b:
+        return "PROP_RF_OBSERVE_MODE_SUSPENDED";
+      case 0x1c:
+        return "PROP_RF_OBSERVE_MODE_RESUMED";
+      default:
+        return NULL;
+    }
+  }
+  switch (oid) {
+    case 0x02:
+      // Sub-opcode only in the command
+      if (mt == 2) return "PROP";
+      switch (sub) {
+        case 0x02:
+          return "PROP_NFC_MODE_SET";
+        case 0x03:
+          return "PROP_GET_CONFIG";
+        case 0x04:
+          return "PROP_SET_CONFIG";
+        case 0x06:
+          return "PROP_NFC_FW_UPDATE";
+        default:
+          return "PROP";
+      }
+    case 0x04:
+      return "PROP_LOADER_APDU";
+    case 0x0c:
+      switch (sub) {
+        case 0x00:
+          return "ANDROID_GET_CAPS";
+        case 0x02:
+          return "ANDROID_PASSIVE_OBSERVE";
+        case 0x04:
+          return "ANDROID_QUERY_PASSIVE_OBSERVE";
+        case 0x05:
+          return "ANDROID_SET_PASSIVE_OBSERVER_TECH";
+        case 0x06:
+          return "ANDROID_SET_PASSIVE_OBSERVER_EXIT_FRAME";
+        case 0x09:
+          return "ANDROID_SET_TECH_A_POLLING_LOOP_ANNOTATION";
+        default:
+          return "ANDROID";
+      }
+    case 0x19:
+      return "PROP_SET_PASSIVE_OBSERVER_EXIT_FRAME";
+    case 0x1d:
+      return "PROP_RF_SET_CUST_PASSIVE_POLL_FRAME";
+    default:
+      return NULL;
+  }
+}
+
+const char* NciMessageName(const uint8_t* frame, size_t length, char* buf,
+                           size_t size) {
+  static const char* kMtSuffix[] = {"DATA", "_CMD", "_RSP", "_NTF"};
+  uint8_t mt = (frame[0] >> 5) & 0x7;
+  uint8_t gid = frame[0] & 0xf;
+  uint8_t oid = length > 1 ? frame[1] & 0x3f : 0;
+  const char* name = NULL;
+
+  if (mt == 0) {
+    snprintf(buf, size, "DATA(conn %d)", gid);
+    return buf;
+  }
+  if (mt > 3 || length < 2) {
+    snprintf(buf, size, "MT%d", mt);
+    return buf;
+  }
+  switch (gid) {
+    case 0x0:
+      if (oid < sizeof(kCoreNames) / sizeof(kCoreNames[0])) {
+        name = kCoreNames[oid];
+      }
+      break;
+    case 0x1:
+      if (oid < sizeof(kRfNames) / sizeof(kRfNames[0])) name = kRfNames[oid];
+      break;
+    case 0x2:
+      if (oid < sizeof(kNfceeNames) / sizeof(kNfceeNames[0])) {
+        name = kNfceeNames[oid];
+      }
+      break;
+    case 0xf:
+      name = NciPropName(frame, length);
+      break;
+    default:
+      break;
+  }
+  if (name) {
+    snprintf(buf, size, "%s%s", name, kMtSuffix[mt]);
+  } else {
+    snprintf(buf, size, "GID%X_OID%02X%s", gid, oid, kMtSuffix[mt]);
+  }
+  return buf;
+}
+
+const char* NciLoaderInsName(uint8_t ins) {
+  switch (ins) {
+    case 0x0c:
+      return "ERASE";
+    case 0x11:
+      return "PUT_KEY";
+    case 0x33:
+      return "ERASE_UPGRADE_STOP";
+    case 0x35:
+      return "ERASE_UPGRADE_START";
+    case 0x36:
+      return "ERASE_NFC_AREA";
+    case 0x74:
+      return "SET_VARIOUS_CONFIG";
+    case 0x8a:
+      return "GET_ATR";
+    case 0xa0:
+      return "SWITCH_MODE";
+    default:
+      return NULL;
+  }
+}
+
+const char* NciWrapperStateName(uint8_t state, char* buf, size_t size) {
+  // As hal_wrapper_state_e
+  static const char* kStates[] = {
+      "CLOSED",
+      "OPEN",
+      "OPEN_CPLT",
+      "NFC_ENABLE_ON",
+      "PROP_CONFIG",
+      "READY",
+      "CLOSING",
+      "EXIT_HIBERNATE_INTERNAL",
+      "UPDATE",
+      "APPLY_CUSTOM_PARAM",
+      "APPLY_UWB_PARAM",
+      "APPLY_PROP_CONFIG",
+      "RECOVERY",
+  };
+
+  if (state < sizeof(kStates) / sizeof(kStates[0])) {
+    snprintf(buf, size, "HAL_WRAPPER_STATE_%s", kStates[state]);
+  } else {
+    snprintf(buf, size, "HAL_WRAPPER_STATE_%d", state);
+  }
+  return buf;
+}
+
+void NciPrintHex(FILE* out, const uint8_t* data, size_t length) {
+  for (size_t i = 0; i < length; i++) fprintf(out, " %02x", data[i]);
+}
+
+/**
+ * Technology of a CERx TLV, from its frame type nibble.
+ * @param frameType Low nibble of the third byte of the TLV
+ * @return Its name
+ */
+static const char* TechName(uint8_t frameType) {
+  switch (frameType) {
+    case 0x1:
+    case 0x2:
+    case 0x3:
+    case 0x4:
+    case 0x5:
+    case 0x6:
+    case 0xB:
+    case 0xD:
+      return "A";
+    case 0x7:
+    case 0xC:
+      return "B";
+    case 0x8:
+    case 0x9:
+      return "F";
+    case 0xA:
+      return "V";
+    default:
+      return "?";
+  }
+}
+
+void NciPrintPollingTlvs(FILE* out, const uint8_t* frame, size_t length) {
+  // ST54L counts in 3.95 us, ST54J/K in 4.57 us.
+  bool st54l = length > 3 && (frame[3] & 0x30) == 0x30;
+  size_t pos = 6;
+
+  while (pos < length) {
+    const uint8_t* tlv = frame + pos;
+    size_t tlvLength = pos + 2 <= length ? tlv[1] + 2 : length - pos;
+    uint32_t ts;
+    double tsUs;
+
+    // Every TLV has a type, a length and a 4 bytes timestamp at its end:
+    // anything shorter, or past the end of the frame, is not decoded.
+    fprintf(out, "    ");
+    if (tlvLength < 6 || pos + tlvLength > length) {
+      fprintf(out, "malformed    ");
+      NciPrintHex(out, tlv, length - pos);
+      fprintf(out, "\n");
+      return;
+    }
+    ts = ((uint32_t)tlv[tlvLength - 4] << 24) | (tlv[tlvLength - 3] << 16) |
+         (tlv[tlvLength - 2] << 8) | tlv[tlvLength - 1];
+    tsUs = st54l ? ts * 1024.0 / 259 : ts * 128.0 / 28;
+    switch (tlv[0]) {
+      case FW_TRACE_T_FIELD_ON:
+        fprintf(out, "field on      fw %.0f us", tsUs);
+        break;
+      case FW_TRACE_T_FIELD_OFF:
+        fprintf(out, "field off     fw %.0f us", tsUs);
+        break;
+      case FW_TRACE_T_CERX:
+      case FW_TRACE_T_CERX_ERROR:
+        fprintf(out, "%s fw %.0f us",
+                tlv[0] == FW_TRACE_T_CERX ? "CE rx        " : "CE rx error  ",
+                tsUs);
+        if (tlvLength >= 8) {
+          fprintf(out, " type %s gain %d error 0x%02x",
+                  TechName(tlv[2] & 0xf), tlv[3] >> 4, tlv[5]);
+        }
+        if (tlvLength > 12) {
+          fprintf(out, " data");
+          NciPrintHex(out, tlv + 8, tlvLength - 12);
+        }
+        break;
+      default:
+        fprintf(out, "type 0x%02x     fw %.0f us value", tlv[0], tsUs);
+        NciPrintHex(out, tlv + 2, tlvLength - 6);
+        break;
+    }
+    fprintf(out, "\n");
+    pos += tlvLength;
+  }
+}
+
+void NciFormatTime(uint64_t timeUs, char* buf, size_t size) {
+  time_t seconds = timeUs / 1000000;
+  struct tm tm;
+  char date[32];
+
+  localtime_r(&seconds, &tm);
+  strftime(date, sizeof(date), "%m-%d %H:%M:%S", &tm);
+  snprintf(buf, size, "%s.%06u", date, (unsigned)(timeUs % 1000000));
+}
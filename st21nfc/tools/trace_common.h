@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2025 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <vector>
+
+#include "hal_fw_trace.h"
+
+/*
+ * Helpers of the host trace tools: reading of the trace file of
+ * hal_fw_trace.h and naming of the NCI messages the HAL deals with.
+ */
+
+// Trace file mapped in memory, its blocks in the order they were written.
+class TraceFile {
+ public:
+  struct Record {
+    uint32_t session;
+    uint64_t timeUs;  // CLOCK_REALTIME
+    uint8_t kind;     // HalFwTraceKind
+    const uint8_t* data;
+    uint16_t length;
+  };
+
+  TraceFile();
+  ~TraceFile();
+
+  // False with errno set if the file cannot be mapped.
+  bool open(const char* path);
+  // True if the file starts with a trace block.
+  static bool isTraceFile(const uint8_t* data, size_t size);
+
+  // Calls onRecord(record, arg) for each record, in order.
+  void forEach(void (*onRecord)(const Record& record, void* arg), void* arg);
+
+ private:
+  TraceFile(const TraceFile&) = delete;
+  TraceFile& operator=(const TraceFile&) = delete;
+
+  const uint8_t* mData;
+  size_t mSize;
+  std::vector<const HalFwTraceBlockHeader*> mBlocks;
+};
+
+// Name of a control message, with the sub-opcode of the ST and Android
+// proprietary ones ("PROP_NFC_MODE_SET", "ANDROID_QUERY_PASSIVE_OBSERVE").
+// Writes to buf if it has to build it.
+const char* NciMessageName(const uint8_t* frame, size_t length, char* buf,
+                           size_t size);
+// Instruction of a loader APDU (2f 04), NULL if unknown.
+const char* NciLoaderInsName(uint8_t ins);
+// hal_wrapper_state_e, "HAL_WRAPPER_STATE_READY"
+const char* NciWrapperStateName(uint8_t state, char* buf, size_t size);
+
+// Prints the TLVs of a PROP_FW_DBG_NTF (6f 02), one per line, up to the
+// first one too short for its type, length and timestamp, as malformed.
+void NciPrintPollingTlvs(FILE* out, const uint8_t* frame, size_t length);
+void NciPrintHex(FILE* out, const uint8_t* data, size_t length);
+// "MM-DD HH:MM:SS.uuuuuu" of a CLOCK_REALTIME time, local time.
+void NciFormatTime(uint64_t timeUs, char* buf, size_t size);